@@ -29,6 +29,11 @@ using namespace std;
 
 typedef std::string AsyncRPCOperationId;
 
+// Operations of higher priority are taken from the AsyncRPCQueue first.
+static const int ASYNC_RPC_PRIORITY_LOW = -1;
+static const int ASYNC_RPC_PRIORITY_NORMAL = 0;
+static const int ASYNC_RPC_PRIORITY_HIGH = 1;
+
 typedef enum class operationStateEnum {
     READY = 0,
     EXECUTING,
@@ -62,6 +67,21 @@ public:
         return creation_time_;
     }
 
+    // Override this method to name the RPC method the operation belongs to.
+    // The queue limits how many operations of one method execute at once.
+    virtual std::string getMethod() const {
+        return "";
+    }
+
+    int getPriority() const {
+        return priority_.load();
+    }
+
+    // Only has an effect before the operation is added to the queue.
+    void setPriority(int priority) {
+        priority_.store(priority);
+    }
+
     // Override this method to add data to the default status object.
     virtual UniValue getStatus() const;
 
@@ -114,6 +134,7 @@ protected:
     int error_code_;
     std::string error_message_;
     std::atomic<OperationStatus> state_;
+    std::atomic<int> priority_;
     std::chrono::time_point<std::chrono::system_clock> start_time_, end_time_;  
 
     void start_execution_clock();
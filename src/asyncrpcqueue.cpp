@@ -4,6 +4,8 @@
 
 #include "asyncrpcqueue.h"
 
+#include <ctime>
+
 static std::atomic<size_t> workerCounter(0);
 
 /**
@@ -15,49 +17,80 @@ shared_ptr<AsyncRPCQueue> AsyncRPCQueue::sharedInstance() {
     return q;
 }
 
-AsyncRPCQueue::AsyncRPCQueue() : closed_(false), finish_(false) {
+AsyncRPCQueue::AsyncRPCQueue() : closed_(false), finish_(false), expiry_(DEFAULT_ASYNC_RPC_EXPIRY) {
 }
 
 AsyncRPCQueue::~AsyncRPCQueue() {
     closeAndWait();     // join on all worker threads
 }
 
+/**
+ * Return the queued operation a worker should execute next, or the end of the queue
+ * if every queued operation belongs to a method already executing at its limit.
+ *
+ * Higher priorities go first, operations that waited long enough are treated as if
+ * their priority was higher so that a steady stream of payments cannot hold back
+ * a shielding operation forever.  Among equals the operation added first wins.
+ * Caller must hold lock_.
+ */
+std::list<AsyncRPCQueue::QueuedOperation>::iterator AsyncRPCQueue::next_operation() {
+    auto now = std::chrono::steady_clock::now();
+    auto best = operation_queue_.end();
+    int64_t bestPriority = 0;
+    for (auto it = operation_queue_.begin(); it != operation_queue_.end(); ++it) {
+        if (method_running_[it->method] >= method_limit(it->method)) {
+            continue;
+        }
+        int64_t waited = std::chrono::duration_cast<std::chrono::seconds>(now - it->queued).count();
+        int64_t priority = it->priority + waited / ASYNC_RPC_AGING_SECS;
+        if (best == operation_queue_.end() || priority > bestPriority) {
+            best = it;
+            bestPriority = priority;
+        }
+    }
+    return best;
+}
+
 /**
  * A worker will execute this method on a new thread
  */
 void AsyncRPCQueue::run(size_t workerId) {
 
     while (true) {
-        AsyncRPCOperationId key;
+        QueuedOperation queued;
         std::shared_ptr<AsyncRPCOperation> operation;
         {
             std::unique_lock<std::mutex> guard(lock_);
-            while (operation_id_queue_.empty() && !isClosed() && !isFinishing()) {
+            auto next = operation_queue_.end();
+            while (!isClosed() && (next = next_operation()) == operation_queue_.end()) {
+                // Exit if the queue is empty and we are finishing up
+                if (isFinishing() && operation_queue_.empty()) {
+                    break;
+                }
                 this->condition_.wait(guard);
             }
 
-            // Exit if the queue is empty and we are finishing up
-            if (isFinishing() && operation_id_queue_.empty()) {
-                break;
-            }
-
             // Exit if the queue is closing.
             if (isClosed()) {
-                while (!operation_id_queue_.empty()) {
-                    operation_id_queue_.pop();
-                }
+                operation_queue_.clear();
+                break;
+            }
+            if (next == operation_queue_.end()) {
                 break;
             }
 
             // Get operation id
-            key = operation_id_queue_.front();
-            operation_id_queue_.pop();
+            queued = *next;
+            operation_queue_.erase(next);
 
             // Search operation map
-            AsyncRPCOperationMap::const_iterator iter = operation_map_.find(key);
+            AsyncRPCOperationMap::const_iterator iter = operation_map_.find(queued.id);
             if (iter != operation_map_.end()) {
                 operation = iter->second;
             }
+            if (operation && !operation->isCancelled()) {
+                method_running_[queued.method]++;
+            }
         }
 
         if (!operation) {
@@ -65,7 +98,24 @@ void AsyncRPCQueue::run(size_t workerId) {
         } else if (operation->isCancelled()) {
             // skip cancelled operation
         } else {
+            auto start = std::chrono::steady_clock::now();
             operation->main();
+            auto end = std::chrono::steady_clock::now();
+
+            std::lock_guard<std::mutex> guard(lock_);
+            method_running_[queued.method]--;
+            AsyncRPCOperationTiming timing;
+            timing.queue_secs = std::chrono::duration<double>(start - queued.queued).count();
+            timing.execution_secs = std::chrono::duration<double>(end - start).count();
+            timing.finish_time = (int64_t)time(NULL);
+            MethodTimings& timings = method_timings_[queued.method];
+            timings.queue.add(timing.queue_secs);
+            timings.execution.add(timing.execution_secs);
+            if (operation_map_.count(queued.id)) {
+                operation_timings_[queued.id] = timing;
+            }
+            // An operation of this method may be runnable now
+            this->condition_.notify_all();
         }
     }
 }
@@ -82,6 +132,8 @@ void AsyncRPCQueue::run(size_t workerId) {
  * Don't use std::make_shared<AsyncRPCOperation>().
  */
 void AsyncRPCQueue::addOperation(const std::shared_ptr<AsyncRPCOperation> &ptrOperation) {
+    evictFinishedOperations((int64_t)time(NULL));
+
     std::lock_guard<std::mutex> guard(lock_);
 
     // Don't add if queue is closed or finishing
@@ -91,7 +143,7 @@ void AsyncRPCQueue::addOperation(const std::shared_ptr<AsyncRPCOperation> &ptrOp
 
     AsyncRPCOperationId id = ptrOperation->getId();
     operation_map_.emplace(id, ptrOperation);
-    operation_id_queue_.push(id);
+    operation_queue_.push_back({id, ptrOperation->getMethod(), ptrOperation->getPriority(), std::chrono::steady_clock::now()});
     this->condition_.notify_one();
 }
 
@@ -116,9 +168,10 @@ std::shared_ptr<AsyncRPCOperation> AsyncRPCQueue::popOperationForId(AsyncRPCOper
     std::shared_ptr<AsyncRPCOperation> ptr = getOperationForId(id);
     if (ptr) {
         std::lock_guard<std::mutex> guard(lock_);
-        // Note: if the id still exists in the operationIdQueue, when it gets processed by a worker
+        // Note: if the id still exists in the operation queue, when it gets processed by a worker
         // there will no operation in the map to execute, so nothing will happen.
         operation_map_.erase(id);
+        operation_timings_.erase(id);
     }
     return ptr;
 }
@@ -168,7 +221,7 @@ void AsyncRPCQueue::cancelAllOperations() {
  */
 size_t AsyncRPCQueue::getOperationCount() const {
     std::lock_guard<std::mutex> guard(lock_);
-    return operation_id_queue_.size();
+    return operation_queue_.size();
 }
 
 /**
@@ -179,6 +232,115 @@ void AsyncRPCQueue::addWorker() {
     workers_.emplace_back( std::thread(&AsyncRPCQueue::run, this, ++workerCounter) );
 }
 
+/**
+ * Allow up to limit operations of the given method to execute at the same time
+ */
+void AsyncRPCQueue::setMethodLimit(const std::string& method, size_t limit) {
+    std::lock_guard<std::mutex> guard(lock_);
+    method_limits_[method] = limit;
+    this->condition_.notify_all();
+}
+
+/**
+ * Caller must hold lock_.
+ */
+size_t AsyncRPCQueue::method_limit(const std::string& method) const {
+    auto it = method_limits_.find(method);
+    return it != method_limits_.end() ? it->second : DEFAULT_ASYNC_RPC_METHOD_LIMIT;
+}
+
+/**
+ * Keep finished operations for the given number of seconds, forever if 0
+ */
+void AsyncRPCQueue::setExpiry(int64_t seconds) {
+    std::lock_guard<std::mutex> guard(lock_);
+    expiry_ = seconds;
+}
+
+/**
+ * Remove operations that finished more than the expiry ago from internal storage.
+ * Operations cancelled before they ran count as finished the first time they are seen here.
+ */
+void AsyncRPCQueue::evictFinishedOperations(int64_t now) {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (expiry_ <= 0) {
+        return;
+    }
+    for (auto it = operation_map_.begin(); it != operation_map_.end();) {
+        const std::shared_ptr<AsyncRPCOperation>& operation = it->second;
+        if (!(operation->isSuccess() || operation->isFailed() || operation->isCancelled())) {
+            ++it;
+            continue;
+        }
+        AsyncRPCOperationTiming& timing = operation_timings_[it->first];
+        if (timing.finish_time == 0) {
+            timing.finish_time = now;
+        }
+        if (now - timing.finish_time >= expiry_) {
+            operation_timings_.erase(it->first);
+            it = operation_map_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+/**
+ * Return how long a finished operation waited and executed, false if it is unknown
+ */
+bool AsyncRPCQueue::getOperationTiming(AsyncRPCOperationId id, AsyncRPCOperationTiming& timing) const {
+    std::lock_guard<std::mutex> guard(lock_);
+    auto it = operation_timings_.find(id);
+    if (it == operation_timings_.end()) {
+        return false;
+    }
+    timing = it->second;
+    return true;
+}
+
+/**
+ * Return the timing histograms of all operations of a method that executed
+ */
+UniValue AsyncRPCQueue::getMethodTimings(const std::string& method) const {
+    std::lock_guard<std::mutex> guard(lock_);
+    UniValue obj(UniValue::VOBJ);
+    auto it = method_timings_.find(method);
+    if (it != method_timings_.end()) {
+        obj.push_back(Pair("queue", it->second.queue.toJSON()));
+        obj.push_back(Pair("execution", it->second.execution.toJSON()));
+    }
+    return obj;
+}
+
+void AsyncRPCTimingHistogram::add(double secs) {
+    size_t bucket = 0;
+    for (double limit = 1; bucket < BUCKETS - 1 && secs > limit; limit *= 2) {
+        bucket++;
+    }
+    buckets_[bucket]++;
+    count_++;
+    total_ += secs;
+}
+
+/**
+ * Buckets are named by their upper bound in seconds, empty ones are left out
+ */
+UniValue AsyncRPCTimingHistogram::toJSON() const {
+    UniValue buckets(UniValue::VOBJ);
+    int64_t limit = 1;
+    for (size_t i = 0; i < BUCKETS; i++, limit *= 2) {
+        if (buckets_[i] == 0) {
+            continue;
+        }
+        buckets.push_back(Pair(i < BUCKETS - 1 ? "<=" + std::to_string(limit) : ">" + std::to_string(limit / 2), buckets_[i]));
+    }
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("count", count_));
+    obj.push_back(Pair("total_secs", total_));
+    obj.push_back(Pair("buckets", buckets));
+    return obj;
+}
+
 /**
  * Return the number of worker threads spawned by the queue
  */
@@ -190,7 +352,9 @@ size_t AsyncRPCQueue::getNumberOfWorkers() const {
 /**
  * Return a list of all known operation ids found in internal storage.
  */
-std::vector<AsyncRPCOperationId> AsyncRPCQueue::getAllOperationIds() const {
+std::vector<AsyncRPCOperationId> AsyncRPCQueue::getAllOperationIds() {
+    evictFinishedOperations((int64_t)time(NULL));
+
     std::lock_guard<std::mutex> guard(lock_);
     std::vector<AsyncRPCOperationId> v;
     for(auto & entry: operation_map_) {
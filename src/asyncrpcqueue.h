@@ -7,10 +7,12 @@
 
 #include "asyncrpcoperation.h"
 
+#include <array>
 #include <iostream>
 #include <string>
 #include <chrono>
-#include <queue>
+#include <list>
+#include <map>
 #include <unordered_map>
 #include <vector>
 #include <future>
@@ -21,6 +23,45 @@
 
 typedef std::unordered_map<AsyncRPCOperationId, std::shared_ptr<AsyncRPCOperation> > AsyncRPCOperationMap; 
 
+// Default for -rpcasyncthreads
+static const int DEFAULT_ASYNC_RPC_THREADS = 2;
+// Default for -rpcasynclimit, operations of one method executing at once.
+// Notes are not locked while an operation runs, so a second z_sendmany could
+// pick the notes the first one is spending.
+static const int DEFAULT_ASYNC_RPC_METHOD_LIMIT = 1;
+// Default for -rpcasyncexpiry, seconds finished operations are kept
+static const int64_t DEFAULT_ASYNC_RPC_EXPIRY = 24 * 60 * 60;
+// A queued operation counts one priority level higher for every interval it waited
+static const int64_t ASYNC_RPC_AGING_SECS = 60;
+
+/**
+ * Counts durations in buckets of up to 1, 2, 4 ... 2^(BUCKETS-2) seconds and
+ * a last bucket for anything longer.
+ */
+class AsyncRPCTimingHistogram {
+public:
+    static const size_t BUCKETS = 14;
+
+    AsyncRPCTimingHistogram() : count_(0), total_(0) {
+        buckets_.fill(0);
+    }
+
+    void add(double secs);
+    UniValue toJSON() const;
+
+private:
+    std::array<uint64_t, BUCKETS> buckets_;
+    uint64_t count_;
+    double total_;
+};
+
+// Time an operation spent waiting in the queue and executing, and when it finished
+struct AsyncRPCOperationTiming {
+    double queue_secs = 0;
+    double execution_secs = 0;
+    int64_t finish_time = 0;
+};
+
 
 class AsyncRPCQueue {
 public:
@@ -36,6 +77,10 @@ public:
     AsyncRPCQueue& operator=(AsyncRPCQueue &&) = delete;      // Move assign
 
     void addWorker();
+    // Most operations of the given method that may execute at the same time
+    void setMethodLimit(const std::string& method, size_t limit);
+    // Seconds finished operations are kept, 0 keeps them until they are popped
+    void setExpiry(int64_t seconds);
     size_t getNumberOfWorkers() const;
     bool isClosed() const;
     bool isFinishing() const;
@@ -48,12 +93,31 @@ public:
     std::shared_ptr<AsyncRPCOperation> getOperationForId(AsyncRPCOperationId) const;
     std::shared_ptr<AsyncRPCOperation> popOperationForId(AsyncRPCOperationId);
     void addOperation(const std::shared_ptr<AsyncRPCOperation> &ptrOperation);
-    std::vector<AsyncRPCOperationId> getAllOperationIds() const;
+    std::vector<AsyncRPCOperationId> getAllOperationIds();
+    bool getOperationTiming(AsyncRPCOperationId id, AsyncRPCOperationTiming& timing) const;
+    // Queue and execution time histograms of the finished operations of a method
+    UniValue getMethodTimings(const std::string& method) const;
+    // Forget finished operations older than the expiry, done on every add and listing
+    void evictFinishedOperations(int64_t now);
 
 private:
+    struct QueuedOperation {
+        AsyncRPCOperationId id;
+        std::string method;
+        int priority;
+        std::chrono::steady_clock::time_point queued;
+    };
+
+    struct MethodTimings {
+        AsyncRPCTimingHistogram queue;
+        AsyncRPCTimingHistogram execution;
+    };
+
     // addWorker() will spawn a new thread on run())
     void run(size_t workerId);
     void wait_for_worker_threads();
+    std::list<QueuedOperation>::iterator next_operation();
+    size_t method_limit(const std::string& method) const;
 
     // Why this is not a recursive lock: http://www.zaval.org/resources/library/butenhof1.html
     mutable std::mutex lock_;
@@ -61,7 +125,13 @@ private:
     std::atomic<bool> closed_;
     std::atomic<bool> finish_;
     AsyncRPCOperationMap operation_map_;
-    std::queue <AsyncRPCOperationId> operation_id_queue_;
+    // In the order operations were added, workers pick the first of the highest priority
+    std::list<QueuedOperation> operation_queue_;
+    std::map<std::string, size_t> method_limits_;
+    std::map<std::string, size_t> method_running_;
+    std::map<std::string, MethodTimings> method_timings_;
+    std::unordered_map<AsyncRPCOperationId, AsyncRPCOperationTiming> operation_timings_;
+    int64_t expiry_;
     std::vector<std::thread> workers_;
 };
 
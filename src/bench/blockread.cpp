@@ -0,0 +1,107 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <blockstore.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <primitives/block.h>
+#include <random.h>
+#include <util.h>
+#include <validation.h>
+
+#include <assert.h>
+
+#include <boost/filesystem.hpp>
+
+static const size_t TXS_PER_BLOCK = 1000;
+
+// A block of simple payments written to blk00000.dat of a temporary data directory,
+// as a peer asking for it or getblock would read it back
+struct StoredBlock {
+    CBlockIndex index;
+    uint256 hash;
+    boost::filesystem::path path;
+    bool fHadDataDir;
+    std::string strDataDir;
+
+    StoredBlock()
+    {
+        SelectParams(CBaseChainParams::REGTEST);
+        path = GetTempPath() / strprintf("bench_blockread_%lu", (unsigned long)GetRand(1ULL << 32));
+        boost::filesystem::create_directories(path);
+        fHadDataDir = mapArgs.count("-datadir");
+        strDataDir = mapArgs["-datadir"];
+        mapArgs["-datadir"] = path.string();
+        ClearDatadirCache();
+
+        CBlock block;
+        block.nTime = GetTime();
+        block.nBits = UintToArith256(Params().GetConsensus().powLimit).GetCompact();
+        block.nNonce = GetRandHash();
+        // Not a valid solution, but checking it costs as much as checking a valid one
+        unsigned int n = Params().EquihashN(), k = Params().EquihashK();
+        block.nSolution.resize((1 << k) * (n / (k + 1) + 1) / 8);
+        GetRandBytes(block.nSolution.data(), block.nSolution.size());
+        for (size_t i = 0; i < TXS_PER_BLOCK; i++) {
+            CMutableTransaction tx;
+            tx.vin.resize(1);
+            tx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+            tx.vin[0].scriptSig = CScript() << std::vector<unsigned char>(72, 1) << std::vector<unsigned char>(33, 2);
+            tx.vout.resize(2);
+            for (CTxOut& out : tx.vout) {
+                out.nValue = 1000;
+                out.scriptPubKey = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 3) << OP_EQUALVERIFY << OP_CHECKSIG;
+            }
+            block.vtx.push_back(MakeTransactionRef(tx));
+        }
+        block.hashMerkleRoot = block.BuildMerkleTree();
+        hash = block.GetHash();
+
+        CDiskBlockPos pos(0, 0);
+        assert(WriteBlockToDisk(block, pos, Params().MessageStart()));
+        index.phashBlock = &hash;
+        index.nFile = pos.nFile;
+        index.nDataPos = pos.nPos;
+        index.nStatus = BLOCK_HAVE_DATA | BLOCK_VALID_SCRIPTS;
+    }
+
+    ~StoredBlock()
+    {
+        blockFileCache.Forget(index.nFile);
+        if (fHadDataDir)
+            mapArgs["-datadir"] = strDataDir;
+        else
+            mapArgs.erase("-datadir");
+        ClearDatadirCache();
+        boost::filesystem::remove_all(path);
+    }
+};
+
+static void ReadBlockFromDisk(benchmark::State& state, bool fParanoid)
+{
+    StoredBlock stored;
+    fParanoidBlockReads = fParanoid;
+
+    while (state.KeepRunning()) {
+        CBlock block;
+        // The paranoid read rejects the solution after doing all the work
+        bool fRead = ::ReadBlockFromDisk(block, &stored.index, Params().GetConsensus());
+        assert(fRead != fParanoid);
+    }
+    fParanoidBlockReads = DEFAULT_PARANOID_BLOCK_READS;
+}
+
+static void ReadBlockFromDisk_Trusted(benchmark::State& state)
+{
+    ReadBlockFromDisk(state, false);
+}
+
+static void ReadBlockFromDisk_Paranoid(benchmark::State& state)
+{
+    ReadBlockFromDisk(state, true);
+}
+
+BENCHMARK(ReadBlockFromDisk_Trusted, 200);
+BENCHMARK(ReadBlockFromDisk_Paranoid, 200);
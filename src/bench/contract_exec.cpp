@@ -0,0 +1,175 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <qtum/speculativeexec.h>
+#include <random.h>
+#include <util.h>
+#include <validation.h>
+
+#include <assert.h>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/thread/thread.hpp>
+
+static const size_t TRANSFERS_PER_BLOCK = 200;
+
+// Token with a balance per address in storage, transfer(to, amount) without any checks:
+//   bal[caller] -= amount; bal[to] += amount
+static const dev::bytes TOKEN_CODE = {
+    0x60, 0x20, 0x35,       // PUSH1 32 CALLDATALOAD   amount
+    0x80, 0x33, 0x54,       // DUP1 CALLER SLOAD
+    0x03, 0x33, 0x55,       // SUB CALLER SSTORE
+    0x60, 0x00, 0x35,       // PUSH1 0 CALLDATALOAD    to
+    0x80, 0x54, 0x82, 0x01, // DUP1 SLOAD DUP3 ADD
+    0x90, 0x55, 0x00,       // SWAP1 SSTORE STOP
+};
+
+static boost::thread_group contractExecThreads;
+static bool fContractExecThreadsStarted = false;
+
+struct TokenBlock {
+    boost::filesystem::path path;
+    std::unique_ptr<QtumState> state;
+    std::unique_ptr<dev::eth::SealEngineFace> sealEngine;
+    dev::eth::EnvInfo envInfo;
+    std::vector<QtumTransaction> txs;
+    dev::h256 root;
+    dev::h256 rootUTXO;
+
+    // A block of transfers spread over nTokens token contracts
+    explicit TokenBlock(size_t nTokens)
+    {
+        dev::eth::Ethash::init();
+        dev::eth::ChainParams cp((dev::eth::genesisInfo(dev::eth::Network::qtumMainNetwork)));
+        sealEngine.reset(cp.createSealEngine());
+        sealEngine->setQtumSchedule(dev::eth::EIP158Schedule);
+
+        path = GetTempPath() / strprintf("bench_contract_exec_%lu", (unsigned long)GetRand(1ULL << 32));
+        boost::filesystem::create_directories(path);
+        state.reset(new QtumState(dev::u256(0), QtumState::openDB(path.string(), dev::sha3(dev::rlp("")), dev::WithExisting::Kill), path.string(), dev::eth::BaseState::Empty));
+
+        std::vector<dev::Address> vTokens;
+        for (size_t i = 0; i < nTokens; i++) {
+            dev::Address token(uintToh256(GetRandHash()));
+            state->createContract(token);
+            state->setNewCode(token, dev::bytes(TOKEN_CODE));
+            vTokens.push_back(token);
+        }
+        state->commit(dev::eth::State::CommitBehaviour::KeepEmptyAccounts);
+        state->db().commit();
+        state->dbUtxo().commit();
+        root = state->rootHash();
+        rootUTXO = state->rootHashUTXO();
+
+        for (size_t i = 0; i < TRANSFERS_PER_BLOCK; i++) {
+            dev::bytes data(64);
+            dev::Address to(uintToh256(GetRandHash()));
+            std::copy(to.asArray().begin(), to.asArray().end(), data.begin() + 12);
+            data[63] = 1;
+            QtumTransaction tx(0, 1, 100000, vTokens[i % nTokens], data, dev::u256(0));
+            tx.forceSender(dev::Address(uintToh256(GetRandHash())));
+            tx.setHashWith(uintToh256(GetRandHash()));
+            tx.setNVout(0);
+            tx.setVersion(VersionVM::GetEVMDefault());
+            txs.push_back(tx);
+        }
+
+        envInfo.setNumber(1);
+        envInfo.setTimestamp(GetTime());
+        envInfo.setGasLimit(TRANSFERS_PER_BLOCK * 100000);
+        envInfo.setAuthor(dev::Address(uintToh256(GetRandHash())));
+        envInfo.setLastHashes(dev::eth::LastHashes(256));
+    }
+
+    ~TokenBlock()
+    {
+        state.reset();
+        boost::filesystem::remove_all(path);
+    }
+
+    void Reset()
+    {
+        state->setRoot(root);
+        state->setRootUTXO(rootUTXO);
+    }
+
+    void Commit()
+    {
+        state->db().commit();
+        state->dbUtxo().commit();
+        sealEngine->deleteAddresses.clear();
+    }
+};
+
+static void ContractExecSequential(benchmark::State& bench, size_t nTokens)
+{
+    TokenBlock block(nTokens);
+    while (bench.KeepRunning()) {
+        block.Reset();
+        for (size_t i = 0; i < block.txs.size(); i++) {
+            block.state->execute(block.envInfo, *block.sealEngine, block.txs[i]);
+            block.Commit();
+        }
+    }
+}
+
+static void ContractExecSpeculative(benchmark::State& bench, size_t nTokens)
+{
+    if (!fContractExecThreadsStarted) {
+        StartContractExecThreads(contractExecThreads, std::min(GetNumCores(), MAX_CONTRACT_EXEC_THREADS));
+        fContractExecThreadsStarted = true;
+    }
+
+    TokenBlock block(nTokens);
+
+    // Reference roots from sequential execution
+    std::vector<dev::h256> vRoots;
+    for (size_t i = 0; i < block.txs.size(); i++) {
+        vRoots.push_back(block.state->execute(block.envInfo, *block.sealEngine, block.txs[i]).txRec.stateRoot());
+        block.Commit();
+    }
+    dev::h256 rootUTXO = block.state->rootHashUTXO();
+
+    while (bench.KeepRunning()) {
+        block.Reset();
+        SpeculativeExec speculation(*block.state, block.envInfo, *block.sealEngine);
+        for (size_t i = 0; i < block.txs.size(); i++)
+            speculation.Add(i, std::vector<QtumTransaction>(1, block.txs[i]));
+        speculation.Run();
+
+        for (size_t i = 0; i < block.txs.size(); i++) {
+            std::vector<QtumTransaction> txs(1, block.txs[i]);
+            std::vector<ResultExecute> result;
+            if (!speculation.Apply(i, txs, result)) {
+                speculation.BeginSequential();
+                result.push_back(block.state->execute(block.envInfo, *block.sealEngine, txs[0]));
+                speculation.EndSequential();
+            }
+            assert(result.size() == 1 && result[0].txRec.stateRoot() == vRoots[i]);
+            block.Commit();
+        }
+        assert(block.state->rootHashUTXO() == rootUTXO);
+    }
+}
+
+static void ContractExecSequential_DisjointTokens(benchmark::State& state)
+{
+    ContractExecSequential(state, TRANSFERS_PER_BLOCK);
+}
+
+static void ContractExecSpeculative_DisjointTokens(benchmark::State& state)
+{
+    ContractExecSpeculative(state, TRANSFERS_PER_BLOCK);
+}
+
+static void ContractExecSpeculative_SingleToken(benchmark::State& state)
+{
+    ContractExecSpeculative(state, 1);
+}
+
+BENCHMARK(ContractExecSequential_DisjointTokens, 5);
+BENCHMARK(ContractExecSpeculative_DisjointTokens, 5);
+BENCHMARK(ContractExecSpeculative_SingleToken, 5);
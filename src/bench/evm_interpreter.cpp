@@ -0,0 +1,95 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <libdevcore/SHA3.h>
+#include <libevm/ExtVMFace.h>
+#include <libevm/VM.h>
+#include <libevm/VMCodeCache.h>
+
+#include <assert.h>
+
+// Counts down from 10000, doing some arithmetic per iteration:
+//   do { c -= 1; c * c + c; } while (c != 0)
+static const dev::bytes LOOP_CODE = {
+    0x61, 0x27, 0x10,             // PUSH2 10000
+    0x5b,                         // JUMPDEST
+    0x60, 0x01, 0x90, 0x03,       // PUSH1 1 SWAP1 SUB
+    0x80, 0x80, 0x02, 0x81, 0x01, // DUP1 DUP1 MUL DUP2 ADD
+    0x50,                         // POP
+    0x80, 0x60, 0x03, 0x57,       // DUP1 PUSH1 3 JUMPI
+    0x00,                         // STOP
+};
+
+// Returns right away, followed by 24KB of constants like a large contract
+static dev::bytes ShortCallCode()
+{
+    dev::bytes code = {0x60, 0x01, 0x60, 0x00, 0x55, 0x00}; // PUSH1 1 PUSH1 0 SSTORE STOP
+    for (int i = 0; code.size() < 24 * 1024; i++) {
+        code.push_back(0x7f); // PUSH32
+        dev::h256 constant = dev::sha3(dev::h256(i));
+        code.insert(code.end(), constant.asArray().begin(), constant.asArray().end());
+        code.push_back(i % 8 ? 0x50 : 0x5b); // POP or JUMPDEST
+    }
+    return code;
+}
+
+class BenchExtVM : public dev::eth::ExtVMFace
+{
+public:
+    BenchExtVM(dev::eth::EnvInfo const& envInfo, dev::bytes const& code) :
+        ExtVMFace(envInfo, dev::Address(), dev::Address(), dev::Address(), 0, 0, dev::bytesConstRef(), code, dev::sha3(code), 0) {}
+
+    void setStore(dev::u256, dev::u256) override {}
+    boost::optional<dev::eth::owning_bytes_ref> call(dev::eth::CallParameters&) override { return boost::none; }
+    dev::eth::EVMSchedule const& evmSchedule() const override { return dev::eth::EIP158Schedule; }
+};
+
+static void RunEVM(benchmark::State& state, dev::bytes const& code, bool fCache)
+{
+    dev::eth::AnalyzedCodeCache& cache = dev::eth::AnalyzedCodeCache::instance();
+    cache.clear();
+    cache.setMaxSize(fCache ? 32 * 1024 * 1024 : 0);
+
+    dev::eth::EnvInfo envInfo;
+    envInfo.setGasLimit(10000000);
+    while (state.KeepRunning()) {
+        BenchExtVM ext(envInfo, code);
+        dev::u256 gas = 10000000;
+        dev::eth::VM vm;
+        vm.exec(gas, ext, dev::eth::OnOpFunc());
+        assert(gas < 10000000);
+    }
+
+    cache.clear();
+    cache.setMaxSize(32 * 1024 * 1024);
+}
+
+// Dispatch cost: build with -DEVM_JUMP_DISPATCH=false to compare with the switch interpreter
+static void EVMLoop_Cached(benchmark::State& state)
+{
+    RunEVM(state, LOOP_CODE, true);
+}
+
+static void EVMLoop_Uncached(benchmark::State& state)
+{
+    RunEVM(state, LOOP_CODE, false);
+}
+
+// Analysis cost: calls executing a few instructions of a large contract
+static void EVMShortCall_Cached(benchmark::State& state)
+{
+    RunEVM(state, ShortCallCode(), true);
+}
+
+static void EVMShortCall_Uncached(benchmark::State& state)
+{
+    RunEVM(state, ShortCallCode(), false);
+}
+
+BENCHMARK(EVMLoop_Cached, 20);
+BENCHMARK(EVMLoop_Uncached, 20);
+BENCHMARK(EVMShortCall_Cached, 2000);
+BENCHMARK(EVMShortCall_Uncached, 2000);
@@ -0,0 +1,78 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <primitives/transaction.h>
+#include <vds/Address.hpp>
+#include <vds/Note.hpp>
+#include <wallet/saplingdecrypt.h>
+
+#include <assert.h>
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+
+using namespace libzcash;
+
+static const size_t OUTPUTS_PER_TX = 16;
+
+// The workers stay up for the whole run; -saplingdecryptthreads=1 measures the serial path.
+static boost::thread_group decryptThreads;
+static bool fDecryptThreadsStarted = false;
+
+static void SaplingTrialDecrypt(benchmark::State& state, size_t nKeys)
+{
+    if (!fDecryptThreadsStarted) {
+        StartSaplingDecryptThreads(decryptThreads);
+        fDecryptThreadsStarted = true;
+    }
+
+    SaplingSpendingKey skMine = SaplingSpendingKey::random();
+    std::vector<SaplingIncomingViewingKey> vKeys;
+    vKeys.reserve(nKeys);
+    for (size_t i = 0; i + 1 < nKeys; i++) {
+        vKeys.push_back(SaplingSpendingKey::random().full_viewing_key().in_viewing_key());
+    }
+    vKeys.push_back(skMine.full_viewing_key().in_viewing_key());
+    SaplingTrialDecryptor decryptor(std::move(vKeys));
+
+    // Outputs to random addresses, except for the last one which is sent to the last key,
+    // so every output is tried against all keys
+    std::vector<OutputDescription> vOutputs(OUTPUTS_PER_TX);
+    for (size_t i = 0; i < vOutputs.size(); i++) {
+        SaplingPaymentAddress pa = (i + 1 == vOutputs.size())
+                                   ? skMine.default_address()
+                                   : SaplingSpendingKey::random().default_address();
+        SaplingNote note(pa, 1000);
+        SaplingNotePlaintext pt(note, {});
+        auto enc = pt.encrypt(pa.pk_d).get();
+        vOutputs[i].cm = note.cm().get();
+        vOutputs[i].ephemeralKey = enc.second.get_epk();
+        vOutputs[i].encCiphertext = enc.first;
+    }
+
+    while (state.KeepRunning()) {
+        auto vDecrypted = decryptor.Decrypt(vOutputs);
+        assert(vDecrypted.size() == 1);
+    }
+}
+
+static void SaplingTrialDecrypt_10Keys(benchmark::State& state)
+{
+    SaplingTrialDecrypt(state, 10);
+}
+
+static void SaplingTrialDecrypt_100Keys(benchmark::State& state)
+{
+    SaplingTrialDecrypt(state, 100);
+}
+
+static void SaplingTrialDecrypt_1000Keys(benchmark::State& state)
+{
+    SaplingTrialDecrypt(state, 1000);
+}
+
+BENCHMARK(SaplingTrialDecrypt_10Keys, 20);
+BENCHMARK(SaplingTrialDecrypt_100Keys, 2);
+BENCHMARK(SaplingTrialDecrypt_1000Keys, 1);
@@ -0,0 +1,166 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockstore.h"
+
+#include "chainparams.h"
+#include "crypto/common.h"
+#include "util.h"
+#include "validation.h"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/** Magic bytes and size written in front of every record */
+static const size_t RECORD_HEADER_SIZE = MESSAGE_START_SIZE + sizeof(uint32_t);
+
+CBlockFileCache blockFileCache;
+
+CMappedBlockFile::~CMappedBlockFile()
+{
+#ifndef WIN32
+    munmap(const_cast<char*>(data), size);
+#endif
+}
+
+/** End of the record at pos in file, or 0 if its header is wrong or it does not fit */
+static size_t RecordEnd(const CMappedBlockFile& file, const CDiskBlockPos& pos, size_t nTrailer)
+{
+    if (pos.nPos > file.size)
+        return 0;
+    const unsigned char* header = (const unsigned char*)file.data + pos.nPos - RECORD_HEADER_SIZE;
+    if (memcmp(header, Params().MessageStart(), MESSAGE_START_SIZE) != 0)
+        return 0;
+    uint64_t nEnd = (uint64_t)pos.nPos + ReadLE32(header + MESSAGE_START_SIZE) + nTrailer;
+    if (nEnd > file.size)
+        return 0;
+    return nEnd;
+}
+
+/** Current size of the file at path, -1 if it cannot be read */
+static int64_t FileSize(const std::string& path)
+{
+#ifndef WIN32
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return -1;
+    return st.st_size;
+#else
+    return -1;
+#endif
+}
+
+CBlockFileCache::CBlockFileCache(size_t nMaxFilesIn) : nMaxFiles(nMaxFilesIn), nMaps(0)
+{
+}
+
+std::shared_ptr<const CMappedBlockFile> CBlockFileCache::Map(const std::string& path) const
+{
+#ifndef WIN32
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        return nullptr;
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping stays valid without the descriptor
+    close(fd);
+    if (data == MAP_FAILED) {
+        LogPrintf("%s: unable to map %s\n", __func__, path);
+        return nullptr;
+    }
+    return std::make_shared<const CMappedBlockFile>((const char*)data, (size_t)st.st_size);
+#else
+    return nullptr;
+#endif
+}
+
+void CBlockFileCache::SetMaxFiles(size_t nMaxFilesIn)
+{
+    LOCK(cs);
+    nMaxFiles = nMaxFilesIn;
+    while (listFiles.size() > nMaxFiles)
+        listFiles.pop_back();
+}
+
+bool CBlockFileCache::OpenRecord(const CDiskBlockPos& pos, const char* prefix, size_t nTrailer, CBlockFileReader& reader, int nType, int nVersion)
+{
+    if (pos.IsNull() || pos.nPos < RECORD_HEADER_SIZE)
+        return false;
+
+    const std::string path = GetBlockPosFilename(pos, prefix).string();
+    std::shared_ptr<const CMappedBlockFile> file;
+    size_t nEnd = 0;
+    {
+        LOCK(cs);
+        if (nMaxFiles == 0)
+            return false;
+
+        list_type::iterator it = listFiles.begin();
+        while (it != listFiles.end() && it->first != path)
+            ++it;
+
+        // Pages of a mapping past the end of the file fault with SIGBUS, so
+        // nothing is read from a file that shrank since it was mapped
+        const int64_t nFileSize = FileSize(path);
+        if (nFileSize < (int64_t)pos.nPos) {
+            if (it != listFiles.end())
+                listFiles.erase(it);
+            return false;
+        }
+
+        if (it != listFiles.end()) {
+            file = it->second;
+            nEnd = RecordEnd(*file, pos, nTrailer);
+            if (nEnd && (int64_t)nEnd <= nFileSize) {
+                listFiles.splice(listFiles.begin(), listFiles, it);
+            } else {
+                // Written after the file was mapped or truncated, readers of the old mapping keep it
+                listFiles.erase(it);
+                nEnd = 0;
+            }
+        }
+
+        if (!nEnd) {
+            file = Map(path);
+            if (!file)
+                return false;
+            nMaps++;
+            listFiles.emplace_front(path, file);
+            while (listFiles.size() > nMaxFiles)
+                listFiles.pop_back();
+            nEnd = RecordEnd(*file, pos, nTrailer);
+            if (!nEnd)
+                return false;
+        }
+    }
+
+    reader = CBlockFileReader(file, pos.nPos, nEnd, nType, nVersion);
+    return true;
+}
+
+void CBlockFileCache::Forget(int nFile)
+{
+    const CDiskBlockPos pos(nFile, 0);
+    const std::string pathBlock = GetBlockPosFilename(pos, "blk").string();
+    const std::string pathUndo = GetBlockPosFilename(pos, "rev").string();
+    LOCK(cs);
+    for (list_type::iterator it = listFiles.begin(); it != listFiles.end();) {
+        if (it->first == pathBlock || it->first == pathUndo)
+            it = listFiles.erase(it);
+        else
+            ++it;
+    }
+}
+
+void CBlockFileCache::Clear()
+{
+    LOCK(cs);
+    listFiles.clear();
+}
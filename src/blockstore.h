@@ -0,0 +1,140 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef VDS_BLOCKSTORE_H
+#define VDS_BLOCKSTORE_H
+
+#include "chain.h"
+#include "sync.h"
+
+#include <ios>
+#include <list>
+#include <memory>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+
+/** Default for -blockfilemaps, block and undo files are up to 128 MiB so only map them with a 64 bit address space */
+static const int DEFAULT_BLOCKFILE_MAPS = sizeof(void*) >= 8 ? 16 : 0;
+
+/** A block or undo file mapped read only, unmapped once the last reader lets go of it */
+class CMappedBlockFile
+{
+private:
+    CMappedBlockFile(const CMappedBlockFile&);
+    CMappedBlockFile& operator=(const CMappedBlockFile&);
+
+public:
+    const char* data;
+    size_t size;
+
+    CMappedBlockFile(const char* dataIn, size_t sizeIn) : data(dataIn), size(sizeIn) {}
+    ~CMappedBlockFile();
+};
+
+/**
+ * Stream over a record of a mapped block or undo file.
+ *
+ * Deserializes straight from the mapping, which it keeps alive even if the
+ * cache drops the file meanwhile.
+ */
+class CBlockFileReader
+{
+private:
+    std::shared_ptr<const CMappedBlockFile> file;
+    const char* pcur;
+    const char* pend;
+    int nType;
+    int nVersion;
+
+public:
+    CBlockFileReader() : pcur(nullptr), pend(nullptr), nType(0), nVersion(0) {}
+    CBlockFileReader(const std::shared_ptr<const CMappedBlockFile>& fileIn, size_t nBegin, size_t nEnd, int nTypeIn, int nVersionIn)
+        : file(fileIn), pcur(fileIn->data + nBegin), pend(fileIn->data + nEnd), nType(nTypeIn), nVersion(nVersionIn) {}
+
+    int GetType() const { return nType; }
+    int GetVersion() const { return nVersion; }
+    //! Bytes left in the record
+    size_t size() const { return pend - pcur; }
+
+    void read(char* pch, size_t nSize)
+    {
+        if (nSize > size())
+            throw std::ios_base::failure("CBlockFileReader::read: end of record");
+        memcpy(pch, pcur, nSize);
+        pcur += nSize;
+    }
+
+    void ignore(size_t nSize)
+    {
+        if (nSize > size())
+            throw std::ios_base::failure("CBlockFileReader::ignore: end of record");
+        pcur += nSize;
+    }
+
+    template <typename T>
+    CBlockFileReader& operator>>(T& obj)
+    {
+        ::Unserialize(*this, obj);
+        return *this;
+    }
+};
+
+/**
+ * Bounded cache of mapped blk?????.dat and rev?????.dat files.
+ *
+ * Mapping closes the descriptor right away, so cached files cost address
+ * space but no descriptors. Records are located through the magic bytes and
+ * size WriteBlockToDisk and UndoWriteToDisk put in front of them. Files only
+ * grow while they are written to, a record past the end of the mapping remaps
+ * the file. Data written to a position before it is handed out never changes
+ * afterwards, so reading a position taken from the block index or the tx
+ * index needs no cs_main. Files that are truncated or pruned must be dropped
+ * with Forget.
+ *
+ * Failure mode: a read from a mapping faults with SIGBUS instead of
+ * returning an error when the page cannot be read, that is when the file was
+ * truncated behind the mapping or the disk reports an I/O error. The size of
+ * the file is checked against the end of the record every time one is opened,
+ * so truncation by another process is caught unless it happens while the
+ * record is being deserialized. I/O errors are not; on unreliable storage
+ * set -blockfilemaps=0 to get them reported as failed reads.
+ */
+class CBlockFileCache
+{
+private:
+    //! Keyed by path, the files of another data directory are never confused with these
+    typedef std::list<std::pair<std::string, std::shared_ptr<const CMappedBlockFile> > > list_type;
+
+    mutable CCriticalSection cs;
+    size_t nMaxFiles;
+    //! Most recently used first
+    list_type listFiles;
+
+    std::shared_ptr<const CMappedBlockFile> Map(const std::string& path) const;
+
+public:
+    uint64_t nMaps;
+
+    explicit CBlockFileCache(size_t nMaxFilesIn = DEFAULT_BLOCKFILE_MAPS);
+
+    //! 0 turns the cache off, every read goes through the file again
+    void SetMaxFiles(size_t nMaxFilesIn);
+
+    /**
+     * Open the record stored at pos in the file with the given prefix, with
+     * nTrailer bytes following it that belong to the record. Returns false if
+     * the file cannot be mapped or the record looks wrong, callers then read
+     * the file the usual way and report what is wrong with it.
+     */
+    bool OpenRecord(const CDiskBlockPos& pos, const char* prefix, size_t nTrailer, CBlockFileReader& reader, int nType, int nVersion);
+
+    //! Drop the mappings of the block and undo file nFile
+    void Forget(int nFile);
+    void Clear();
+};
+
+extern CBlockFileCache blockFileCache;
+
+#endif // VDS_BLOCKSTORE_H
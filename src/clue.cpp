@@ -223,6 +223,11 @@ bool CClueViewCache::GetParent(const CTxDestination& dest, CTxDestination& paren
 
 bool CClueViewCache::GetParents(const CTxDestination& dest, std::vector<CTxDestination>& vParents, const bool fInvite)
 {
+    // Ancestors of an address we never touched are unchanged below us, let the backend walk them
+    // without pulling every level into the cache. A deleted clue is always cached as TRUNC.
+    if (cacheClue.find(dest) == cacheClue.end())
+        return base->GetParents(dest, vParents, fInvite);
+
     CTxDestination parent;
     if (!GetParent(dest, parent, fInvite))
         return false;
@@ -236,6 +241,8 @@ bool CClueViewCache::GetParents(const CTxDestination& dest, std::vector<CTxDesti
 
 uint32_t CClueViewCache::ChildrenSize(const CTxDestination& dest, const bool fInvite) const
 {
+    if (cacheClue.find(dest) == cacheClue.end())
+        return base->ChildrenSize(dest, fInvite);
     if (HaveClue(dest)) {
         return fInvite ? cacheClue[dest].vInvitees.size() : cacheClue[dest].vChildren.size();
     }
@@ -382,7 +389,7 @@ bool CClueViewCache::BatchWrite(CClueMap& mapClue, SeasonRankMap& mapSeason, con
 }
 
 
-bool CTopRank::operator < (const CTopRank& b)
+bool CTopRank::operator < (const CTopRank& b) const
 {
     if (item.dWeight < b.item.dWeight)
         return false;
@@ -392,19 +399,61 @@ bool CTopRank::operator < (const CTopRank& b)
         return false;
     else if (item.nInvitees > b.item.nInvitees)
         return true;
-    if (address < b.address)
+    return b.address < address;
+}
+
+bool CSeasonRank::Get(const CTxDestination& dest, CRankItem& item) const
+{
+    std::map<CTxDestination, CRankItem>::const_iterator it = mapItems.find(dest);
+    if (it == mapItems.end())
         return false;
+    item = it->second;
     return true;
 }
 
+void CSeasonRank::Update(const CTxDestination& dest, const CRankItem& item)
+{
+    std::map<CTxDestination, CRankItem>::iterator it = mapItems.find(dest);
+    if (it != mapItems.end()) {
+        setRank.erase(CTopRank(dest, it->second));
+        it->second = item;
+    } else {
+        mapItems.insert(std::make_pair(dest, item));
+    }
+    setRank.insert(CTopRank(dest, item));
+}
+
+void CSeasonRank::Erase(const CTxDestination& dest)
+{
+    std::map<CTxDestination, CRankItem>::iterator it = mapItems.find(dest);
+    if (it == mapItems.end())
+        return;
+    setRank.erase(CTopRank(dest, it->second));
+    mapItems.erase(it);
+}
+
+void CSeasonRank::Truncate(size_t nSize)
+{
+    while (setRank.size() > nSize) {
+        std::set<CTopRank>::iterator itLast = std::prev(setRank.end());
+        mapItems.erase(itLast->address);
+        setRank.erase(itLast);
+    }
+}
+
+int CSeasonRank::Position(const CTxDestination& dest) const
+{
+    std::map<CTxDestination, CRankItem>::const_iterator it = mapItems.find(dest);
+    if (it == mapItems.end())
+        return -1;
+    return std::distance(setRank.begin(), setRank.find(CTopRank(dest, it->second))) + 1;
+}
+
 bool CClueViewCache::Flush()
 {
     // rank cacheRank
     for (SeasonRankMap::iterator it = cacheRank.begin(); it != cacheRank.end(); it++) {
-        cacheRank[it->first].vTopRank.sort();
-        if (cacheRank[it->first].vTopRank.size() > 100) {
-            cacheRank[it->first].vTopRank.resize(100);
-        }
+        cacheRank[it->first].vTopRank.Truncate(CLUE_SEASON_TOP_RANK_SIZE);
         for (const auto& item : cacheRank[it->first].vTopRank) {
             assert(item.item.nInvitees <= ChildrenSize(item.address, true));
         }
@@ -440,33 +489,51 @@ bool CClueViewCache::GetParentTree(const CTxDestination& address, CClueFamilyTre
         parent = cacheClue[firstaddr].clue.parent;
     }
 
-    while (!IsNullTxDestination(parent) && HaveClue(parent) && tree.size() < uDepth) {
+    while (!IsNullTxDestination(parent) && tree.size() < uDepth) {
+        if (cacheClue.find(parent) == cacheClue.end()) {
+            CTxDestination next;
+            if (!base->GetParent(parent, next, false))
+                break;
+            tree.add(parent, base->ChildrenSize(parent, false));
+            parent = next;
+            continue;
+        }
+        if (!HaveClue(parent))
+            break;
         tree.add(parent, cacheClue[parent].vChildren.size());
         parent = cacheClue[parent].clue.parent;
     }
     return true;
 }
 
-bool CClueViewCache::GetSeasonRank(int nSeason, std::list<CTopRank>& vRank)
+const CSeasonRank* CClueViewCache::GetSeasonRank(int nSeason)
 {
     if (cacheRank.find(nSeason) == cacheRank.end()) {
-        std::list<CTopRank> vRankt;
+        CSeasonRank vRankt;
         if (!base->GetSeasonRank(nSeason, vRankt)) {
-            return false;
+            return nullptr;
         }
-        cacheRank[nSeason].vTopRank = vRankt;
+        cacheRank[nSeason].vTopRank = std::move(vRankt);
     }
-    vRank = cacheRank[nSeason].vTopRank;
+    return &cacheRank[nSeason].vTopRank;
+}
+
+bool CClueViewCache::GetSeasonRank(int nSeason, CSeasonRank& vRank)
+{
+    const CSeasonRank* pRank = GetSeasonRank(nSeason);
+    if (!pRank)
+        return false;
+    vRank = *pRank;
     return true;
 }
 
 CAmount CClueViewCache::GetTotalClue(int nSeason)
 {
     if (cacheRank.find(nSeason) == cacheRank.end()) {
-        std::list<CTopRank> vRankt;
+        CSeasonRank vRankt;
         if (!base->GetSeasonRank(nSeason, vRankt))
             return 0;
-        cacheRank[nSeason].vTopRank = vRankt;
+        cacheRank[nSeason].vTopRank = std::move(vRankt);
 
         cacheRank[nSeason].nTotalClue = base->GetTotalClue(nSeason);
     }
@@ -479,11 +546,11 @@ CAmount CClueViewCache::GetTotalClue(int nSeason)
 bool CClueViewCache::GetRankItem(const CTxDestination& dest, int nSeason, CRankItem& item)
 {
     if (cacheRank.find(nSeason) == cacheRank.end()) {
-        std::list<CTopRank> vRank;
+        CSeasonRank vRank;
         if (!base->GetSeasonRank(nSeason, vRank)) {
             return false;
         }
-        cacheRank[nSeason].vTopRank = vRank;
+        cacheRank[nSeason].vTopRank = std::move(vRank);
     }
     if ( cacheRank[nSeason].nTotalClue == 0)
         cacheRank[nSeason].nTotalClue = base->GetTotalClue(nSeason);
@@ -511,30 +578,26 @@ bool CClueViewCache::AddRankItem(const CTxDestination& dest, int nSeason, const
             stat.mRankItems[dest].flags ^= CRankItem::TRUNC;
         stat.mRankItems[dest].flags |= CRankItem::DIRTY;
         stat.nTotalClue += item.nValue;
-        bool fInRank = false;
-        for (std::list<CTopRank>::iterator it = stat.vTopRank.begin(); it != stat.vTopRank.end(); it++) {
-            if (it->address == dest) {
-                fInRank = true;
-                it->item += item;
-            }
+        CRankItem rank;
+        if (stat.vTopRank.Get(dest, rank)) {
+            rank += item;
+            stat.vTopRank.Update(dest, rank);
+        } else {
+            stat.vTopRank.Update(dest, stat.mRankItems[dest]);
         }
-        if (!fInRank)
-            stat.vTopRank.push_back(CTopRank(dest, stat.mRankItems[dest]));
         stat.flags |= CSeasonStat::DIRTY;
     } else {
         stat.mRankItems[dest] = item;
         stat.mRankItems[dest].flags |= CRankItem::DIRTY;
         stat.mRankItems[dest].flags |= CRankItem::NEW;
         stat.nTotalClue += item.nValue;
-        bool fInRank = false;
-        for (std::list<CTopRank>::iterator it = stat.vTopRank.begin(); it != stat.vTopRank.end(); it++) {
-            if (it->address == dest) {
-                fInRank = true;
-                it->item += item;
-            }
+        CRankItem rank;
+        if (stat.vTopRank.Get(dest, rank)) {
+            rank += item;
+            stat.vTopRank.Update(dest, rank);
+        } else {
+            stat.vTopRank.Update(dest, stat.mRankItems[dest]);
         }
-        if (!fInRank)
-            stat.vTopRank.push_back(CTopRank(dest, stat.mRankItems[dest]));
         stat.flags |= CSeasonStat::DIRTY;
     }
     return true;
@@ -552,28 +615,14 @@ bool CClueViewCache::DeleteRankItem(const CTxDestination& dest, int nSeason)
         stat.mRankItems[dest].SetNull();
         stat.mRankItems[dest].flags |= CRankItem::TRUNC;
         stat.mRankItems[dest].flags |= CRankItem::DIRTY;
-        bool fInRank = false;
-        for (std::list<CTopRank>::iterator it = stat.vTopRank.begin(); it != stat.vTopRank.end(); it++) {
-            if (it->address == dest) {
-                fInRank = true;
-                std::list<CTopRank>::iterator itOld = it++;
-                stat.vTopRank.erase(itOld);
-                break;
-            }
-        }
+        stat.vTopRank.Erase(dest);
         stat.flags |= CSeasonStat::DIRTY;
     } else {
-        bool fInRank = false;
-        for (std::list<CTopRank>::iterator it = stat.vTopRank.begin(); it != stat.vTopRank.end(); it++) {
-            if (it->address == dest) {
-                fInRank = true;
-                std::list<CTopRank>::iterator itOld = it++;
-                stat.vTopRank.erase(itOld);
-                break;
-            }
-        }
-        if (fInRank)
+        CRankItem rank;
+        if (stat.vTopRank.Get(dest, rank)) {
+            stat.vTopRank.Erase(dest);
             stat.flags |= CSeasonStat::DIRTY;
+        }
     }
     return true;
 }
@@ -668,7 +717,7 @@ CAmount CClueView::GetTotalClue(int nSeason)
     return 0;
 }
 
-bool CClueView::GetSeasonRank(int nSeason, std::list<CTopRank>& vRank)
+bool CClueView::GetSeasonRank(int nSeason, CSeasonRank& vRank)
 {
     return false;
 }
@@ -743,7 +792,7 @@ void CClueViewBacked::SetBackend(CClueView& viewIn)
     base = &viewIn;
 }
 
-bool CClueViewBacked::GetSeasonRank(int nSeason, std::list<CTopRank>& vRank)
+bool CClueViewBacked::GetSeasonRank(int nSeason, CSeasonRank& vRank)
 {
     return base->GetSeasonRank(nSeason, vRank);
 }
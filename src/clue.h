@@ -9,9 +9,14 @@
 #include <serialize.h>
 #include <vector>
 #include <map>
+#include <set>
+#include <list>
 
 #define FAMILY_TREE_MAX_LEVEL 12
 
+/** Number of ranked addresses of a season kept when the rank is flushed */
+static const size_t CLUE_SEASON_TOP_RANK_SIZE = 100;
+
 
 class CClue
 {
@@ -202,7 +207,7 @@ struct CTopRank {
     CTopRank(const CTxDestination& addressIn, const CRankItem& itemIn):
         address(addressIn), item(itemIn) {}
 
-    bool operator < (const CTopRank& b);
+    bool operator < (const CTopRank& b) const;
 
     ADD_SERIALIZE_METHODS
     template <typename Stream, typename Operation>
@@ -213,9 +218,68 @@ struct CTopRank {
     }
 };
 
+/**
+ * Ranked addresses of a season, ordered by weight, invitees and address.
+ *
+ * The rank is kept sorted on every change instead of being sorted when it is
+ * flushed: an address is found through its rank item in O(log n) and moved to
+ * its new place in O(log n), which is also how a disconnected block takes its
+ * rank items back. Serialized as the ordered list the clue database stores.
+ */
+class CSeasonRank
+{
+public:
+    typedef std::set<CTopRank>::const_iterator const_iterator;
+
+private:
+    std::set<CTopRank> setRank;
+    std::map<CTxDestination, CRankItem> mapItems;
+
+public:
+    CSeasonRank() {}
+
+    bool Get(const CTxDestination& dest, CRankItem& item) const;
+    /** Insert dest with item, or move it to the place of its new item */
+    void Update(const CTxDestination& dest, const CRankItem& item);
+    void Erase(const CTxDestination& dest);
+    /** Drop everything ranked below nSize */
+    void Truncate(size_t nSize);
+    /** 1-based position of dest, -1 if it is not ranked */
+    int Position(const CTxDestination& dest) const;
+
+    size_t size() const { return setRank.size(); }
+    bool empty() const { return setRank.empty(); }
+    const_iterator begin() const { return setRank.begin(); }
+    const_iterator end() const { return setRank.end(); }
+
+    void clear()
+    {
+        setRank.clear();
+        mapItems.clear();
+    }
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        WriteCompactSize(s, setRank.size());
+        for (const CTopRank& rank : setRank)
+            ::Serialize(s, rank);
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        std::list<CTopRank> vRank;
+        ::Unserialize(s, vRank);
+        clear();
+        for (const CTopRank& rank : vRank)
+            Update(rank.address, rank.item);
+    }
+};
+
 struct CSeasonStat {
 public:
-    std::list<CTopRank> vTopRank;
+    CSeasonRank vTopRank;
     CRankItemMap mRankItems;
     CAmount nTotalClue;
 
@@ -280,7 +344,7 @@ public:
     virtual bool DeleteRankItem(const CTxDestination& dest, int nSeason);
     virtual CAmount GetTotalClue(int nSeason);
 
-    virtual bool GetSeasonRank(int nSeason, std::list<CTopRank>& vRank);
+    virtual bool GetSeasonRank(int nSeason, CSeasonRank& vRank);
 
     virtual ~CClueView() {};
 };
@@ -317,7 +381,7 @@ public:
     bool BatchWrite(CClueMap& mapClue, SeasonRankMap& mapSeason, const uint256& hashBlockIn) override;
     void SetBackend(CClueView& viewIn);
 
-    bool GetSeasonRank(int nSeason, std::list<CTopRank>& vRank) override;
+    bool GetSeasonRank(int nSeason, CSeasonRank& vRank) override;
     bool GetRankItem(const CTxDestination& dest, int nSeason, CRankItem& item) override;
     bool AddRankItem(const CTxDestination& dest, int nSeason, const CRankItem& item) override;
     CAmount GetTotalClue(int nSeason) override;
@@ -363,7 +427,9 @@ public:
 
     bool GetParentTree(const CTxDestination& address, CClueFamilyTree& tree, const bool fInvite = true, const uint32_t uDepth = FAMILY_TREE_MAX_LEVEL) const ;
 
-    bool GetSeasonRank(int nSeason, std::list<CTopRank>& vRank);
+    bool GetSeasonRank(int nSeason, CSeasonRank& vRank) override;
+    /** Ranked addresses of a season, read in place. Null when the season has no rank. */
+    const CSeasonRank* GetSeasonRank(int nSeason);
     CAmount GetTotalClue(int nSeason) override;
     bool GetRankItem(const CTxDestination& dest, int nSeason, CRankItem& item) override;
     bool AddRankItem(const CTxDestination& dest, int nSeason, const CRankItem& item) override;
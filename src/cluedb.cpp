@@ -11,6 +11,8 @@
 #include <validation.h>
 #include <utilstrencodings.h>
 
+#include <boost/scoped_ptr.hpp>
+
 using namespace std;
 
 #define CLUE_TABLE_CLUE             'a'
@@ -32,6 +34,8 @@ using namespace std;
 
 #define CLUE_KEY_RANK_ITEM(nSeason, address) std::make_pair(std::make_pair(CLUE_RANK_ITEM, nSeason), address)
 
+#define CLUE_GRAPH_FILENAME         "cluegraph.dat"
+
 
 CClueLevelInfo::CClueLevelInfo() : childrenCount(0)
 {
@@ -49,9 +53,50 @@ CClueLevelInfo::CClueLevelInfo(const CTxDestination& address, const uint32_t chi
     this->address = address;
 }
 
-CClueViewDB::CClueViewDB(size_t nCacheSize, bool fMemory, bool fWipe):
-    db(GetDataDir() / "clues", nCacheSize, fMemory, fWipe)
+CClueViewDB::CClueViewDB(size_t nCacheSize, bool fMemoryIn, bool fWipe):
+    db(GetDataDir() / "clues", nCacheSize, fMemoryIn, fWipe), fMemory(fMemoryIn)
+{
+    if (!LoadGraph(fWipe))
+        LogPrintf("%s: failed to build clue graph, %u destinations loaded\n", __func__, graph.Size());
+}
+
+CClueViewDB::~CClueViewDB()
 {
+    if (!fMemory)
+        graph.Write(GetDataDir() / CLUE_GRAPH_FILENAME);
+}
+
+bool CClueViewDB::LoadGraph(bool fWipe)
+{
+    uint256 hashBestChain = GetBestBlock();
+    if (!fMemory && !fWipe && graph.Read(GetDataDir() / CLUE_GRAPH_FILENAME)) {
+        if (graph.GetBestBlock() == hashBestChain) {
+            LogPrintf("Loaded clue graph snapshot, %u destinations\n", graph.Size());
+            return true;
+        }
+        LogPrintf("Clue graph snapshot does not match clue database, rebuilding\n");
+    }
+    graph.Clear();
+
+    int64_t nStart = GetTimeMillis();
+    boost::scoped_ptr<CDBIterator> pcursor(db.NewIterator());
+    pcursor->Seek(CLUE_TABLE_CLUE);
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CTxDestination> key;
+        if (!pcursor->GetKey(key) || key.first != CLUE_TABLE_CLUE)
+            break;
+        CClue clue;
+        if (!pcursor->GetValue(clue))
+            return error("%s: failed to read clue", __func__);
+        CClueCountItem item;
+        db.Read(CLUE_KEY_CHILD_COUNT(key.second), item);
+        graph.Set(clue, item.nInvitees, item.nChildren);
+        pcursor->Next();
+    }
+    graph.SetBestBlock(hashBestChain);
+    LogPrintf("Built clue graph from database, %u destinations, %dms\n", graph.Size(), GetTimeMillis() - nStart);
+    return true;
 }
 
 uint256 CClueViewDB::GetBestBlock() const
@@ -64,7 +109,7 @@ uint256 CClueViewDB::GetBestBlock() const
 
 bool CClueViewDB::HaveClue(const CTxDestination& dest) const
 {
-    return db.Exists(CLUE_KEY_ADDR(dest));
+    return graph.HaveClue(dest);
 }
 
 bool CClueViewDB::GetClue(const CTxDestination& dest, CClue& clue)
@@ -74,25 +119,17 @@ bool CClueViewDB::GetClue(const CTxDestination& dest, CClue& clue)
 
 bool CClueViewDB::GetParent(const CTxDestination& dest, CTxDestination& parent, const bool fInvite)
 {
-    CClue clue;
-    if (db.Read(CLUE_KEY_ADDR(dest), clue)) {
-        parent = (fInvite ? clue.inviter : clue.parent);
-        return true;
-    }
-    return false;
+    return graph.GetParent(dest, parent, fInvite);
 }
 
 bool CClueViewDB::GetParents(const CTxDestination& dest, std::vector<CTxDestination>& vParents, const bool fInvite)
 {
-    return false;
+    return graph.GetParents(dest, vParents, fInvite, Params().ClueChildrenDepth());
 }
 
 uint32_t CClueViewDB::ChildrenSize(const CTxDestination& dest, const bool fInvite) const
 {
-    CClueCountItem item;
-    if (db.Read(CLUE_KEY_CHILD_COUNT(dest), item))
-        return fInvite ? item.nInvitees : item.nChildren;
-    return 0;
+    return graph.ChildrenSize(dest, fInvite);
 }
 
 bool CClueViewDB::GetChildren(const CTxDestination& dest, std::set<CTxDestination>& children, const bool fInvite)
@@ -148,6 +185,7 @@ bool CClueViewDB::BatchWrite(CClueMap& mapClue, SeasonRankMap& mapSeason, const
                     batch.Erase(CLUE_KEY_CHILD(clue.address, false, i));
 
                 batch.Erase(CLUE_KEY_CHILD_COUNT(clue.address));
+                graph.Erase(clue.address);
             } else {
                 batch.Write(CLUE_KEY_ADDR(clue.address), clue);
 
@@ -161,6 +199,7 @@ bool CClueViewDB::BatchWrite(CClueMap& mapClue, SeasonRankMap& mapSeason, const
 
                 CClueCountItem item(vInvitees.size(), vChildren.size());
                 batch.Write(CLUE_KEY_CHILD_COUNT(clue.address), item);
+                graph.Set(clue, vInvitees.size(), vChildren.size());
             }
         }
         CClueMap::iterator itOld = it++;
@@ -191,8 +230,10 @@ bool CClueViewDB::BatchWrite(CClueMap& mapClue, SeasonRankMap& mapSeason, const
         SeasonRankMap::iterator itold = it++;
         mapSeason.erase(itold);
     }
-    if (!hashBlockIn.IsNull())
+    if (!hashBlockIn.IsNull()) {
         batch.Write(CLUE_TABLE_BEST_BLOCK, hashBlockIn);
+        graph.SetBestBlock(hashBlockIn);
+    }
     return db.WriteBatch(batch);
 }
 
@@ -201,7 +242,7 @@ bool CClueViewDB::GetRankItem(const CTxDestination& dest, int nSeason, CRankItem
     return db.Read(CLUE_KEY_RANK_ITEM(nSeason, dest), item);
 }
 
-bool CClueViewDB::GetSeasonRank(int nSeason, std::list<CTopRank>& vRank)
+bool CClueViewDB::GetSeasonRank(int nSeason, CSeasonRank& vRank)
 {
     return db.Read(std::make_pair(CLUE_RANK_TOP, nSeason), vRank);
 }
@@ -11,6 +11,7 @@
 #include <boost/multiprecision/cpp_int.hpp>
 #include "txdestinationtool.h"
 #include "clue.h"
+#include "cluegraph.h"
 
 
 
@@ -81,9 +82,15 @@ class CClueViewDB: public CClueView
 {
 protected:
     CDBWrapper db;
+    //! In-memory copy of the family tree, serves the ancestor and children count queries
+    CClueGraph graph;
+    bool fMemory;
+
+    bool LoadGraph(bool fWipe);
 
 public:
     CClueViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    ~CClueViewDB();
 
     uint256 GetBestBlock() const override;
 
@@ -107,7 +114,7 @@ public:
     /** functions for statistic **/
     bool GetRankItem(const CTxDestination& dest, int nSeason, CRankItem& item) override;
 
-    bool GetSeasonRank(int nSeason, std::list<CTopRank>& vRank) override;
+    bool GetSeasonRank(int nSeason, CSeasonRank& vRank) override;
     CAmount GetTotalClue(int nSeason) override;
 
     bool Flush() override;
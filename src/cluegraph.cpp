@@ -0,0 +1,235 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "cluegraph.h"
+
+#include "chainparams.h"
+#include "clientversion.h"
+#include "clue.h"
+#include "hash.h"
+#include "random.h"
+#include "streams.h"
+#include "util.h"
+
+#include <boost/filesystem.hpp>
+
+uint32_t CClueGraph::Find(const CTxDestination& dest) const
+{
+    auto it = mapIds.find(dest);
+    return it == mapIds.end() ? NO_ID : it->second;
+}
+
+uint32_t CClueGraph::Intern(const CTxDestination& dest)
+{
+    auto it = mapIds.find(dest);
+    if (it != mapIds.end())
+        return it->second;
+
+    uint32_t id = vDest.size();
+    mapIds.insert(std::make_pair(dest, id));
+    vDest.push_back(dest);
+    vParent.push_back(NO_ID);
+    vInviter.push_back(NO_ID);
+    vChildren.push_back(0);
+    vInvitees.push_back(0);
+    vFlags.push_back(0);
+    return id;
+}
+
+void CClueGraph::Clear()
+{
+    LOCK(cs);
+    mapIds.clear();
+    vDest.clear();
+    vParent.clear();
+    vInviter.clear();
+    vChildren.clear();
+    vInvitees.clear();
+    vFlags.clear();
+    hashBlock.SetNull();
+}
+
+void CClueGraph::Set(const CClue& clue, uint32_t nInvitees, uint32_t nChildren)
+{
+    LOCK(cs);
+    uint32_t id = Intern(clue.address);
+    vParent[id] = IsNullTxDestination(clue.parent) ? NO_ID : Intern(clue.parent);
+    vInviter[id] = IsNullTxDestination(clue.inviter) ? NO_ID : Intern(clue.inviter);
+    vChildren[id] = nChildren;
+    vInvitees[id] = nInvitees;
+    vFlags[id] = CLUED;
+    if (vParent[id] == NO_ID && vInviter[id] == NO_ID && !clue.txid.IsNull())
+        vFlags[id] |= ROOT;
+}
+
+void CClueGraph::Erase(const CTxDestination& dest)
+{
+    LOCK(cs);
+    uint32_t id = Find(dest);
+    if (id == NO_ID)
+        return;
+    vParent[id] = NO_ID;
+    vInviter[id] = NO_ID;
+    vChildren[id] = 0;
+    vInvitees[id] = 0;
+    vFlags[id] = 0;
+}
+
+void CClueGraph::SetBestBlock(const uint256& hashBlockIn)
+{
+    LOCK(cs);
+    hashBlock = hashBlockIn;
+}
+
+uint256 CClueGraph::GetBestBlock() const
+{
+    LOCK(cs);
+    return hashBlock;
+}
+
+bool CClueGraph::HaveClue(const CTxDestination& dest) const
+{
+    LOCK(cs);
+    return IsClued(Find(dest));
+}
+
+bool CClueGraph::GetParent(const CTxDestination& dest, CTxDestination& parent, const bool fInvite) const
+{
+    LOCK(cs);
+    uint32_t id = Find(dest);
+    if (!IsClued(id))
+        return false;
+    uint32_t idParent = fInvite ? vInviter[id] : vParent[id];
+    if (idParent == NO_ID)
+        SetTxDestinationNull(parent);
+    else
+        parent = vDest[idParent];
+    return true;
+}
+
+bool CClueGraph::GetParents(const CTxDestination& dest, std::vector<CTxDestination>& vParents, const bool fInvite, size_t nMaxDepth) const
+{
+    LOCK(cs);
+    uint32_t id = Find(dest);
+    while (true) {
+        if (!IsClued(id))
+            return false;
+        uint32_t idParent = fInvite ? vInviter[id] : vParent[id];
+        if (idParent == NO_ID)
+            return vFlags[id] & ROOT;
+        vParents.push_back(vDest[idParent]);
+        if (vParents.size() >= nMaxDepth)
+            return true;
+        id = idParent;
+    }
+}
+
+uint32_t CClueGraph::ChildrenSize(const CTxDestination& dest, const bool fInvite) const
+{
+    LOCK(cs);
+    uint32_t id = Find(dest);
+    if (!IsClued(id))
+        return 0;
+    return fInvite ? vInvitees[id] : vChildren[id];
+}
+
+size_t CClueGraph::Size() const
+{
+    LOCK(cs);
+    return vDest.size();
+}
+
+bool CClueGraph::Write(const boost::filesystem::path& path) const
+{
+    // Generate random temporary filename
+    unsigned short randv = 0;
+    GetRandBytes((unsigned char*)&randv, sizeof(randv));
+    boost::filesystem::path pathTmp = path;
+    pathTmp += strprintf(".%04x", randv);
+
+    // serialize graph, checksum data up to that point, then append csum
+    CDataStream ssGraph(SER_DISK, CLIENT_VERSION);
+    ssGraph << FLATDATA(Params().MessageStart());
+    {
+        LOCK(cs);
+        ssGraph << *this;
+    }
+    uint256 hash = Hash(ssGraph.begin(), ssGraph.end());
+    ssGraph << hash;
+
+    FILE* file = fopen(pathTmp.string().c_str(), "wb");
+    CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull())
+        return error("%s: Failed to open file %s", __func__, pathTmp.string());
+
+    try {
+        fileout << ssGraph;
+    } catch (const std::exception& e) {
+        return error("%s: Serialize or I/O error - %s", __func__, e.what());
+    }
+    FileCommit(fileout.Get());
+    fileout.fclose();
+
+    if (!RenameOver(pathTmp, path))
+        return error("%s: Rename-into-place failed", __func__);
+
+    return true;
+}
+
+bool CClueGraph::Read(const boost::filesystem::path& path)
+{
+    FILE* file = fopen(path.string().c_str(), "rb");
+    CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return false;
+
+    // use file size to size memory buffer
+    uint64_t fileSize = boost::filesystem::file_size(path);
+    uint64_t dataSize = 0;
+    // Don't try to resize to a negative number if file is small
+    if (fileSize >= sizeof(uint256))
+        dataSize = fileSize - sizeof(uint256);
+    std::vector<unsigned char> vchData;
+    vchData.resize(dataSize);
+    uint256 hashIn;
+
+    try {
+        filein.read((char*)&vchData[0], dataSize);
+        filein >> hashIn;
+    } catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+    }
+    filein.fclose();
+
+    CDataStream ssGraph(vchData, SER_DISK, CLIENT_VERSION);
+
+    // verify stored checksum matches input data
+    uint256 hashTmp = Hash(ssGraph.begin(), ssGraph.end());
+    if (hashIn != hashTmp)
+        return error("%s: Checksum mismatch, data corrupted", __func__);
+
+    LOCK(cs);
+    unsigned char pchMsgTmp[4];
+    try {
+        ssGraph >> FLATDATA(pchMsgTmp);
+        if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp)))
+            return error("%s: Invalid network magic number", __func__);
+        ssGraph >> *this;
+    } catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+    }
+
+    size_t nSize = vDest.size();
+    if (vParent.size() != nSize || vInviter.size() != nSize || vChildren.size() != nSize ||
+            vInvitees.size() != nSize || vFlags.size() != nSize)
+        return error("%s: Inconsistent column sizes", __func__);
+
+    mapIds.clear();
+    for (uint32_t id = 0; id < nSize; id++) {
+        if ((vParent[id] != NO_ID && vParent[id] >= nSize) || (vInviter[id] != NO_ID && vInviter[id] >= nSize))
+            return error("%s: Link out of range", __func__);
+        mapIds.insert(std::make_pair(vDest[id], id));
+    }
+    return true;
+}
@@ -0,0 +1,98 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef VDS_CLUEGRAPH_H
+#define VDS_CLUEGRAPH_H
+
+#include "serialize.h"
+#include "sync.h"
+#include "txdestinationtool.h"
+#include "uint256.h"
+
+#include <map>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+class CClue;
+
+/**
+ * Compact in-memory copy of the clue family tree as stored in CClueViewDB.
+ *
+ * Every destination ever seen is interned to a dense id. Parent and inviter
+ * links as well as both children counts live in flat columns indexed by id,
+ * so an ancestor chain or a children count is a handful of array reads
+ * instead of one LevelDB lookup per level.
+ *
+ * The graph is kept in step with the database in CClueViewDB::BatchWrite and
+ * persisted as a single snapshot tagged with the clue best block, which is
+ * rebuilt from the database when it does not match on startup.
+ */
+class CClueGraph
+{
+public:
+    static const uint32_t NO_ID = 0xffffffff;
+
+private:
+    mutable CCriticalSection cs;
+
+    std::map<CTxDestination, uint32_t> mapIds;
+    std::vector<CTxDestination> vDest;
+    std::vector<uint32_t> vParent;
+    std::vector<uint32_t> vInviter;
+    std::vector<uint32_t> vChildren;
+    std::vector<uint32_t> vInvitees;
+    std::vector<uint8_t> vFlags;
+    uint256 hashBlock;
+
+    enum {
+        CLUED = (1 << 0), //!< destination currently has a clue
+        ROOT = (1 << 1),  //!< clue without parent and inviter
+    };
+
+    uint32_t Find(const CTxDestination& dest) const;
+    uint32_t Intern(const CTxDestination& dest);
+    bool IsClued(uint32_t id) const { return id != NO_ID && (vFlags[id] & CLUED); }
+
+public:
+    CClueGraph() {}
+
+    void Clear();
+
+    /** Insert or replace a clue and its children counts */
+    void Set(const CClue& clue, uint32_t nInvitees, uint32_t nChildren);
+    /** Drop the clue of dest; its id stays interned */
+    void Erase(const CTxDestination& dest);
+
+    void SetBestBlock(const uint256& hashBlockIn);
+    uint256 GetBestBlock() const;
+
+    bool HaveClue(const CTxDestination& dest) const;
+    /** Same contract as CClueViewDB::GetParent: true for any clued dest, parent is null for a root */
+    bool GetParent(const CTxDestination& dest, CTxDestination& parent, const bool fInvite) const;
+    /** Same contract as CClueViewCache::GetParents, stops once vParents holds nMaxDepth entries */
+    bool GetParents(const CTxDestination& dest, std::vector<CTxDestination>& vParents, const bool fInvite, size_t nMaxDepth) const;
+    uint32_t ChildrenSize(const CTxDestination& dest, const bool fInvite) const;
+
+    size_t Size() const;
+
+    bool Write(const boost::filesystem::path& path) const;
+    bool Read(const boost::filesystem::path& path);
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(hashBlock);
+        READWRITE(vDest);
+        READWRITE(vParent);
+        READWRITE(vInviter);
+        READWRITE(vChildren);
+        READWRITE(vInvitees);
+        READWRITE(vFlags);
+    }
+};
+
+#endif // VDS_CLUEGRAPH_H
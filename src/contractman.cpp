@@ -5,6 +5,7 @@
 #include "contract.h"
 #include "streams.h"
 #include "validation.h"
+#include "qtum/contractcallpool.h"
 #include "boost/foreach.hpp"
 #include "cpp-ethereum/libdevcrypto/Common.h"
 
@@ -101,7 +102,7 @@ bool CContractMan::InitContracts()
 std::vector<ResultExecute> CContractMan::CallContract(const uint160& addrContract, std::vector<unsigned char> opcode,
         const dev::Address& sender, uint64_t gasLimit)
 {
-    return ::CallContract(dev::Address(addrContract.GetHex()), opcode, sender, gasLimit);
+    return CallContractReadOnly(dev::Address(addrContract.GetHex()), opcode, sender, gasLimit);
 }
 
 bool CContractMan::AddContract(const std::string& name, const uint160& contractAddress,
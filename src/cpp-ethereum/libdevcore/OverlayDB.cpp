@@ -32,6 +32,74 @@ namespace dev
 
 h256 const EmptyTrie = sha3(rlp(""));
 
+bool OverlayDBCache::lookup(h256 const& _h, std::string& o_value)
+{
+	Guard l(x_cache);
+	auto it = m_index.find(_h);
+	if (it == m_index.end())
+	{
+		m_misses++;
+		return false;
+	}
+	m_hits++;
+	m_lru.splice(m_lru.begin(), m_lru, it->second);
+	o_value = it->second->second;
+	return true;
+}
+
+void OverlayDBCache::insert(h256 const& _h, std::string const& _value)
+{
+	Guard l(x_cache);
+	if (!m_maxBytes || m_index.count(_h))
+		return;
+	m_lru.emplace_front(_h, _value);
+	m_index[_h] = m_lru.begin();
+	m_bytes += _value.size() + c_entryOverhead;
+	evict();
+}
+
+void OverlayDBCache::remove(h256 const& _h)
+{
+	Guard l(x_cache);
+	auto it = m_index.find(_h);
+	if (it == m_index.end())
+		return;
+	m_bytes -= it->second->second.size() + c_entryOverhead;
+	m_lru.erase(it->second);
+	m_index.erase(it);
+}
+
+void OverlayDBCache::clear()
+{
+	Guard l(x_cache);
+	m_lru.clear();
+	m_index.clear();
+	m_bytes = 0;
+}
+
+void OverlayDBCache::setMaxBytes(size_t _maxBytes)
+{
+	Guard l(x_cache);
+	m_maxBytes = _maxBytes;
+	evict();
+}
+
+OverlayDBCache::Stats OverlayDBCache::stats() const
+{
+	Guard l(x_cache);
+	return Stats{m_hits, m_misses, m_index.size(), m_bytes, m_maxBytes};
+}
+
+void OverlayDBCache::evict()
+{
+	while (m_bytes > m_maxBytes && !m_lru.empty())
+	{
+		m_bytes -= m_lru.back().second.size() + c_entryOverhead;
+		m_index.erase(m_lru.back().first);
+		m_lru.pop_back();
+	}
+}
+
 OverlayDB::~OverlayDB()
 {
 	if (m_db.use_count() == 1 && m_db.get())
@@ -117,11 +185,24 @@ void OverlayDB::rollback()
 	m_main.clear();
 }
 
+std::string OverlayDB::lookupDisk(h256 const& _h) const
+{
+	std::string ret;
+	if (!m_db)
+		return ret;
+	if (m_cache && m_cache->lookup(_h, ret))
+		return ret;
+	m_db->Get(m_readOptions, ldb::Slice((char const*)_h.data(), 32), &ret);
+	if (m_cache && !ret.empty())
+		m_cache->insert(_h, ret);
+	return ret;
+}
+
 std::string OverlayDB::lookup(h256 const& _h) const
 {
 	std::string ret = MemoryDB::lookup(_h);
-	if (ret.empty() && m_db)
-		m_db->Get(m_readOptions, ldb::Slice((char const*)_h.data(), 32), &ret);
+	if (ret.empty())
+		ret = lookupDisk(_h);
 	return ret;
 }
 
@@ -129,10 +210,7 @@ bool OverlayDB::exists(h256 const& _h) const
 {
 	if (MemoryDB::exists(_h))
 		return true;
-	std::string ret;
-	if (m_db)
-		m_db->Get(m_readOptions, ldb::Slice((char const*)_h.data(), 32), &ret);
-	return !ret.empty();
+	return !lookupDisk(_h).empty();
 }
 
 void OverlayDB::kill(h256 const& _h)
@@ -161,6 +239,8 @@ bool OverlayDB::deepkill(h256 const& _h)
 	kill(_h);
 
 	//kill in overlayDB
+	if (m_cache)
+		m_cache->remove(_h);
 	ldb::Status s = m_db->Delete(m_writeOptions, ldb::Slice((char const*)_h.data(), 32));
 	if (s.ok())
 		return true;
@@ -21,8 +21,11 @@
 
 #pragma once
 
+#include <list>
 #include <memory>
+#include <unordered_map>
 #include <libdevcore/db.h>
+#include <libdevcore/Guards.h>
 #include <libdevcore/Common.h>
 #include <libdevcore/Log.h>
 #include <libdevcore/MemoryDB.h>
@@ -30,6 +33,45 @@
 namespace dev
 {
 
+/// qtum: Bounded LRU cache of nodes read from a disk database, keyed by node hash.
+/// Nodes are content addressed, so one cache can be shared by any number of databases.
+class OverlayDBCache
+{
+public:
+	struct Stats
+	{
+		uint64_t hits;
+		uint64_t misses;
+		size_t entries;
+		size_t bytes;
+		size_t maxBytes;
+	};
+
+	explicit OverlayDBCache(size_t _maxBytes): m_maxBytes(_maxBytes) {}
+
+	bool lookup(h256 const& _h, std::string& o_value);
+	void insert(h256 const& _h, std::string const& _value);
+	void remove(h256 const& _h);
+	void clear();
+
+	void setMaxBytes(size_t _maxBytes);
+	Stats stats() const;
+
+	/// Approximate memory used by an entry besides its value.
+	static const size_t c_entryOverhead = 128;
+
+private:
+	void evict();
+
+	mutable Mutex x_cache;
+	std::list<std::pair<h256, std::string>> m_lru;	///< Most recently used first.
+	std::unordered_map<h256, std::list<std::pair<h256, std::string>>::iterator> m_index;
+	size_t m_bytes = 0;
+	size_t m_maxBytes;
+	uint64_t m_hits = 0;
+	uint64_t m_misses = 0;
+};
+
 class OverlayDB: public MemoryDB
 {
 public:
@@ -48,10 +90,18 @@ public:
 
 	bytes lookupAux(h256 const& _h) const;
 
+	/// qtum: Cache nodes read from the disk database in @a _cache, shared with copies made afterwards.
+	void setCache(std::shared_ptr<OverlayDBCache> const& _cache) { m_cache = _cache; }
+	std::shared_ptr<OverlayDBCache> const& cache() const { return m_cache; }
+
 private:
 	using MemoryDB::clear;
 
+	/// Node @a _h from the disk database, through the cache if any.
+	std::string lookupDisk(h256 const& _h) const;
+
 	std::shared_ptr<ldb::DB> m_db;
+	std::shared_ptr<OverlayDBCache> m_cache;	///< qtum
 
 	ldb::ReadOptions m_readOptions;
 	ldb::WriteOptions m_writeOptions;
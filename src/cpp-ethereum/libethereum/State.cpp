@@ -162,6 +162,9 @@ Account const* State::account(Address const& _a) const
 
 Account* State::account(Address const& _addr)
 {
+	if (m_accessLog) // qtum
+		m_accessLog->insert(_addr);
+
 	auto it = m_cache.find(_addr);
 	if (it != m_cache.end())
 		return &it->second;
@@ -211,6 +214,9 @@ void State::commit(CommitBehaviour _commitBehaviour)
 {
 	if (_commitBehaviour == CommitBehaviour::RemoveEmptyAccounts)
 		removeEmptyAccounts();
+	if (m_accessLog) // qtum
+		for (auto const& i: m_cache)
+			m_accessLog->insert(i.first);
 	m_touched += dev::eth::commit(m_cache, m_state);
 	m_changeLog.clear();
 	m_cache.clear();
@@ -411,6 +417,8 @@ map<h256, pair<u256, u256>> State::storage(Address const& _id) const
 
 h256 State::storageRoot(Address const& _id) const
 {
+	if (m_accessLog) // qtum
+		m_accessLog->insert(_id);
 	string s = m_state.at(_id);
 	if (s.size())
 	{
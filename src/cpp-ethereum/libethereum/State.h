@@ -294,6 +294,9 @@ public:
 	/// Resets any uncommitted changes to the cache.
 	void setRoot(h256 const& _root);
 
+	/// qtum: Record every address looked up in or committed to the state tree into @a _log, null stops recording.
+	void setAccessLog(AddressHash* _log) { m_accessLog = _log; }
+
 	/// Get the account start nonce. May be required.
 	u256 const& accountStartNonce() const { return m_accountStartNonce; }
 	u256 const& requireAccountStartNonce() const;
@@ -332,6 +335,7 @@ protected: // qtum
 	mutable std::vector<Address> m_unchangedCacheEntries;	///< Tracks entries in m_cache that can potentially be purged if it grows too large.
 	mutable std::set<Address> m_nonExistingAccountsCache;	///< Tracks addresses that are known to not exist.
 	AddressHash m_touched;						///< Tracks all addresses touched so far.
+	AddressHash* m_accessLog = nullptr;			///< qtum: Receives the addresses accessed, see setAccessLog().
 
 	u256 m_accountStartNonce;
 
@@ -28,6 +28,7 @@
 #include <libdevcore/SHA3.h>
 #include <libethcore/BlockHeader.h>
 #include "VMFace.h"
+#include "VMCodeCache.h"
 
 namespace dev
 {
@@ -81,7 +82,6 @@ private:
 	static std::array<InstructionMetric, 256> c_metrics;
 	static void initMetrics();
 	static u256 exp256(u256 _base, u256 _exponent);
-	void copyCode(int);
 	const void* const* c_jumpTable = 0;
 	bool m_caseInit = false;
 	
@@ -97,9 +97,9 @@ private:
 	// space for memory
 	bytes m_mem;
 
-	// space for code and pointer to data
-	bytes m_codeSpace;
-	byte* m_code = nullptr;
+	// analyzed code, shared with other VMs through AnalyzedCodeCache, and pointer to data
+	std::shared_ptr<AnalyzedCode const> m_analyzed;
+	byte const* m_code = nullptr;
 
 	// space for stack and pointer to data
 	u256 m_stackSpace[1025];
@@ -116,7 +116,7 @@ private:
 #endif
 
 	// constant pool
-	u256 m_pool[256];
+	u256 const* m_pool = nullptr;
 
 	// interpreter state
 	Instruction m_OP;                   // current operator
@@ -154,7 +154,6 @@ private:
 	void reportStackUse();
 
 	std::vector<uint64_t> m_beginSubs;
-	std::vector<uint64_t> m_jumpDests;
 	int64_t verifyJumpDest(u256 const& _dest, bool _throw = true);
 
 	int poolConstant(const u256&);
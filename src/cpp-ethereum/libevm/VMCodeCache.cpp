@@ -0,0 +1,94 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file VMCodeCache.cpp
+ * @date 2019
+ */
+
+#include "VMCodeCache.h"
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+shared_ptr<AnalyzedCode const> AnalyzedCodeCache::get(h256 const& _hash, size_t _codeSize)
+{
+	Guard g(x_cache);
+	auto it = m_cache.find(_hash);
+	// the size guards against callers passing a hash that does not belong to the code
+	if (it == m_cache.end() || it->second->jumpDests.size() != _codeSize)
+	{
+		++m_misses;
+		return nullptr;
+	}
+	++m_hits;
+	return it->second;
+}
+
+void AnalyzedCodeCache::store(h256 const& _hash, shared_ptr<AnalyzedCode const> const& _code)
+{
+	size_t usage = _code->memoryUsage();
+	Guard g(x_cache);
+	if (usage > m_maxSize || m_cache.count(_hash))
+		return;
+	while (m_size + usage > m_maxSize)
+		removeRandomElement();
+	m_cache[_hash] = _code;
+	m_size += usage;
+}
+
+void AnalyzedCodeCache::clear()
+{
+	Guard g(x_cache);
+	m_cache.clear();
+	m_size = 0;
+}
+
+void AnalyzedCodeCache::setMaxSize(size_t _bytes)
+{
+	Guard g(x_cache);
+	m_maxSize = _bytes;
+	while (m_size > m_maxSize)
+		removeRandomElement();
+}
+
+size_t AnalyzedCodeCache::size() const
+{
+	Guard g(x_cache);
+	return m_size;
+}
+
+uint64_t AnalyzedCodeCache::hits() const
+{
+	Guard g(x_cache);
+	return m_hits;
+}
+
+uint64_t AnalyzedCodeCache::misses() const
+{
+	Guard g(x_cache);
+	return m_misses;
+}
+
+void AnalyzedCodeCache::removeRandomElement()
+{
+	if (m_cache.empty())
+		return;
+	auto it = m_cache.lower_bound(h256::random());
+	if (it == m_cache.end())
+		it = m_cache.begin();
+	m_size -= it->second->memoryUsage();
+	m_cache.erase(it);
+}
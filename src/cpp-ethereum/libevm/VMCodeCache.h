@@ -0,0 +1,81 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file VMCodeCache.h
+ * @date 2019
+ */
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <vector>
+#include <libdevcore/Common.h>
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/Guards.h>
+
+namespace dev
+{
+namespace eth
+{
+
+/**
+ * @brief Code prepared for the interpreter by VM::optimize().
+ * It depends on nothing but the code, so it is shared read-only by every VM executing the same code.
+ */
+struct AnalyzedCode
+{
+	bytes code;                  ///< Code with synthetic ops disabled and constant jumps resolved, extended by 33 zero bytes.
+	std::vector<bool> jumpDests; ///< Whether each position of the original code is a JUMPDEST.
+	u256 pool[256];              ///< Constants of the PUSHC instructions.
+
+	size_t memoryUsage() const { return sizeof(AnalyzedCode) + code.capacity() + jumpDests.capacity() / 8; }
+};
+
+/**
+ * @brief Thread-safe cache of analyzed code by code hash, bounded by memory usage.
+ * If the cache is full, random elements are removed.
+ */
+class AnalyzedCodeCache
+{
+public:
+	std::shared_ptr<AnalyzedCode const> get(h256 const& _hash, size_t _codeSize);
+	void store(h256 const& _hash, std::shared_ptr<AnalyzedCode const> const& _code);
+	void clear();
+
+	/// Limit the memory used by the cache, 0 disables it.
+	void setMaxSize(size_t _bytes);
+	size_t size() const;
+	uint64_t hits() const;
+	uint64_t misses() const;
+
+	static AnalyzedCodeCache& instance() { static AnalyzedCodeCache cache; return cache; }
+
+private:
+	/// Removes a random element from the cache.
+	void removeRandomElement();
+
+	static const size_t c_defaultMaxSize = 32 * 1024 * 1024;
+	mutable Mutex x_cache;
+	std::map<h256, std::shared_ptr<AnalyzedCode const>> m_cache;
+	size_t m_size = 0;
+	size_t m_maxSize = c_defaultMaxSize;
+	uint64_t m_hits = 0;
+	uint64_t m_misses = 0;
+};
+
+}
+}
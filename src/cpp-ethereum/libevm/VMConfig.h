@@ -25,7 +25,7 @@ namespace eth
 // interpreter configuration macros for optimizations and tracing
 //
 // EVM_SWITCH_DISPATCH    - dispatch via loop and switch
-// EVM_JUMP_DISPATCH      - dispatch via a jump table - available only on GCC
+// EVM_JUMP_DISPATCH      - dispatch via a jump table - available only on GCC and Clang
 //
 // EVM_USE_CONSTANT_POOL  - 256 constants unpacked and ready to assign to stack
 //
@@ -35,7 +35,7 @@ namespace eth
 
 #ifndef EVM_JUMP_DISPATCH
 	#ifdef __GNUC__
-		#define EVM_JUMP_DISPATCH false
+		#define EVM_JUMP_DISPATCH true
 	#else
 		#define EVM_JUMP_DISPATCH false
 	#endif
@@ -219,16 +219,16 @@ namespace eth
 			&&NUMBER,  \
 			&&DIFFICULTY,  \
 			&&GASLIMIT,  \
+			&&INVALID,  \
+			&&INVALID,  \
+			&&INVALID,  \
+			&&INVALID,  \
 			&&JUMPTO,  \
 			&&JUMPIF,  \
 			&&JUMPV,  \
 			&&JUMPSUB,  \
 			&&JUMPSUBV,  \
 			&&RETURNSUB,  \
-			&&BEGINSUB,  \
-			&&BEGINDATA,  \
-			&&INVALID,  \
-			&&INVALID,  \
 			&&POP,           /* 50, */  \
 			&&MLOAD,  \
 			&&MSTORE,  \
@@ -241,8 +241,8 @@ namespace eth
 			&&MSIZE,  \
 			&&GAS,  \
 			&&JUMPDEST,  \
-			&&BEGINDATA,  \
 			&&BEGINSUB,  \
+			&&BEGINDATA,  \
 			&&INVALID,  \
 			&&INVALID,  \
 			&&PUSH1,         /* 60, */  \
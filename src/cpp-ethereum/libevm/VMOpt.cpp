@@ -49,30 +49,40 @@ void VM::initMetrics()
 	done = true;
 }
 
-void VM::copyCode(int _extraBytes)
-{
-	// Copy code so that it can be safely modified and extend code by
-	// _extraBytes zero bytes to allow reading virtual data at the end
-	// of the code without bounds checks.
-	auto extendedSize = m_ext->code.size() + _extraBytes;
-	m_codeSpace.reserve(extendedSize);
-	m_codeSpace = m_ext->code;
-	m_codeSpace.resize(extendedSize);
-	m_code = m_codeSpace.data();
-}
-
 void VM::optimize()
 {
-	copyCode(33);
-
 	size_t const nBytes = m_ext->code.size();
 
+	// the analysis depends only on the code, reuse it when the same code ran before
+	auto& cache = AnalyzedCodeCache::instance();
+	if (m_ext->codeHash)
+		m_analyzed = cache.get(m_ext->codeHash, nBytes);
+	if (m_analyzed)
+	{
+		m_code = m_analyzed->code.data();
+		m_pool = m_analyzed->pool;
+		return;
+	}
+
+	// Copy code so that it can be safely modified and extend code by
+	// 33 zero bytes to allow reading virtual data at the end
+	// of the code without bounds checks.
+	auto analyzed = make_shared<AnalyzedCode>();
+	analyzed->code.reserve(nBytes + 33);
+	analyzed->code = m_ext->code;
+	analyzed->code.resize(nBytes + 33);
+	analyzed->jumpDests.resize(nBytes);
+	m_analyzed = analyzed;
+	byte* code = analyzed->code.data();
+	m_code = code;
+	m_pool = analyzed->pool;
+
 	// build a table of jump destinations for use in verifyJumpDest
 	
 	TRACE_STR(1, "Build JUMPDEST table")
 	for (size_t pc = 0; pc < nBytes; ++pc)
 	{
-		Instruction op = Instruction(m_code[pc]);
+		Instruction op = Instruction(code[pc]);
 		TRACE_OP(2, pc, op);
 				
 		// make synthetic ops in user code trigger invalid instruction if run
@@ -83,12 +93,12 @@ void VM::optimize()
 		)
 		{
 			TRACE_OP(1, pc, op);
-			m_code[pc] = (byte)Instruction::BAD;
+			code[pc] = (byte)Instruction::BAD;
 		}
 
 		if (op == Instruction::JUMPDEST)
 		{
-			m_jumpDests.push_back(pc);
+			analyzed->jumpDests[pc] = true;
 		}
 		else if (
 			(byte)Instruction::PUSH1 <= (byte)op &&
@@ -109,7 +119,7 @@ void VM::optimize()
 		else if (op == Instruction::JUMPV || op == Instruction::JUMPSUBV)
 		{
 			++pc;
-			pc += 4 * m_code[pc];  // number of 4-byte dests followed by table
+			pc += 4 * code[pc];  // number of 4-byte dests followed by table
 		}
 		else if (op == Instruction::BEGINSUB)
 		{
@@ -165,7 +175,7 @@ void VM::optimize()
 				}
 				return table[hash] == val;
 			}
-		} constantPool(m_pool);
+		} constantPool(analyzed->pool);
 		#define CONST_POOL_HASH_INIT() constantPool.hashInit()
 		#define CONST_POOL_HASH_BYTE(b) constantPool.hashByte(b)
 		#define CONST_POOL_GET_HASH() constantPool.getHash()
@@ -181,7 +191,7 @@ void VM::optimize()
 	for (size_t pc = 0; pc < nBytes; ++pc)
 	{
 		u256 val = 0;
-		Instruction op = Instruction(m_code[pc]);
+		Instruction op = Instruction(code[pc]);
 
 		if ((byte)Instruction::PUSH1 <= (byte)op && (byte)op <= (byte)Instruction::PUSH32)
 		{
@@ -190,10 +200,10 @@ void VM::optimize()
 
 			// decode pushed bytes to integral value
 			CONST_POOL_HASH_INIT();
-			val = m_code[pc+1];
+			val = code[pc+1];
 			for (uint64_t i = pc+2, n = nPush; --n; ++i) {
-				val = (val << 8) | m_code[i];
-				CONST_POOL_HASH_BYTE(m_code[i]);
+				val = (val << 8) | code[i];
+				CONST_POOL_HASH_BYTE(code[i]);
 			}
 
 		#ifdef EVM_USE_CONSTANT_POOL
@@ -205,9 +215,9 @@ void VM::optimize()
 				byte hash = CONST_POOL_GET_HASH();
 				if (CONST_POOL_INSERT_VAL(hash, val))
 				{
-					m_code[pc] = (byte)Instruction::PUSHC;
-					m_code[pc+1] = hash;
-					m_code[pc+2] = nPush - 1;
+					code[pc] = (byte)Instruction::PUSHC;
+					code[pc+1] = hash;
+					code[pc+2] = nPush - 1;
 					TRACE_VAL(1, "constant pooled", val);
 				}
 				TRACE_POST_OPT(1, pc, op);
@@ -216,18 +226,17 @@ void VM::optimize()
 
 		#ifdef EVM_REPLACE_CONST_JUMP	
 			// replace JUMP or JUMPI to constant location with JUMPC or JUMPCI
-			// verifyJumpDest is M = log(number of jump destinations)
-			// outer loop is N = number of bytes in code array
-			// so complexity is N log M, worst case is N log N
+			// verifyJumpDest is a lookup in the JUMPDEST bitmap
+			// so complexity is linear in the number of bytes in code array
 			size_t i = pc + nPush + 1;
-			op = Instruction(m_code[i]);
+			op = Instruction(code[i]);
 			if (op == Instruction::JUMP)
 			{
 				TRACE_STR(1, "Replace const JUMPC")
 				TRACE_PRE_OPT(1, i, op);
 				
 				if (0 <= verifyJumpDest(val, false))
-					m_code[i] = byte(op = Instruction::JUMPC);
+					code[i] = byte(op = Instruction::JUMPC);
 				
 				TRACE_POST_OPT(1, i, op);
 			}
@@ -237,7 +246,7 @@ void VM::optimize()
 				TRACE_PRE_OPT(1, i, op);
 				
 				if (0 <= verifyJumpDest(val, false))
-					m_code[i] = byte(op = Instruction::JUMPCI);
+					code[i] = byte(op = Instruction::JUMPCI);
 				
 				TRACE_POST_OPT(1, ii, op);
 			}
@@ -249,6 +258,9 @@ void VM::optimize()
 	}
 	TRACE_STR(1, "Finished optimizations")
 #endif	
+
+	if (m_ext->codeHash)
+		cache.store(m_ext->codeHash, m_analyzed);
 }
 
 
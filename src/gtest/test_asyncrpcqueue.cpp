@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+
+#include "asyncrpcqueue.h"
+
+#include <ctime>
+
+class TestOperation : public AsyncRPCOperation {
+public:
+    TestOperation(std::string method, int priority, std::vector<AsyncRPCOperationId>& started, int sleepMs = 0) :
+        method_(method), started_(started), sleepMs_(sleepMs) {
+        setPriority(priority);
+    }
+
+    virtual std::string getMethod() const {
+        return method_;
+    }
+
+    virtual void main() {
+        set_state(OperationStatus::EXECUTING);
+        {
+            std::lock_guard<std::mutex> guard(started_lock_);
+            started_.push_back(getId());
+            int executing = ++executing_[method_];
+            most_executing_[method_] = std::max(most_executing_[method_], executing);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(sleepMs_));
+        {
+            std::lock_guard<std::mutex> guard(started_lock_);
+            --executing_[method_];
+        }
+        set_result(UniValue(UniValue::VSTR, method_));
+        set_state(OperationStatus::SUCCESS);
+    }
+
+    static std::mutex started_lock_;
+    static std::map<std::string, int> executing_;
+    static std::map<std::string, int> most_executing_;
+
+private:
+    std::string method_;
+    std::vector<AsyncRPCOperationId>& started_;
+    int sleepMs_;
+};
+
+std::mutex TestOperation::started_lock_;
+std::map<std::string, int> TestOperation::executing_;
+std::map<std::string, int> TestOperation::most_executing_;
+
+TEST(AsyncRPCQueue, HigherPriorityFirst) {
+    std::vector<AsyncRPCOperationId> started;
+    AsyncRPCQueue q;
+    std::shared_ptr<AsyncRPCOperation> low(new TestOperation("shield", ASYNC_RPC_PRIORITY_LOW, started));
+    std::shared_ptr<AsyncRPCOperation> normal1(new TestOperation("send", ASYNC_RPC_PRIORITY_NORMAL, started));
+    std::shared_ptr<AsyncRPCOperation> high(new TestOperation("send", ASYNC_RPC_PRIORITY_HIGH, started));
+    std::shared_ptr<AsyncRPCOperation> normal2(new TestOperation("send", ASYNC_RPC_PRIORITY_NORMAL, started));
+    q.addOperation(low);
+    q.addOperation(normal1);
+    q.addOperation(high);
+    q.addOperation(normal2);
+    ASSERT_EQ(q.getOperationCount(), 4U);
+
+    q.addWorker();
+    q.finishAndWait();
+
+    std::vector<AsyncRPCOperationId> expected {high->getId(), normal1->getId(), normal2->getId(), low->getId()};
+    EXPECT_EQ(started, expected);
+    EXPECT_EQ(q.getOperationCount(), 0U);
+}
+
+TEST(AsyncRPCQueue, MethodLimit) {
+    std::vector<AsyncRPCOperationId> started;
+    AsyncRPCQueue q;
+    q.setMethodLimit("batch", 2);
+    std::vector<std::shared_ptr<AsyncRPCOperation> > operations;
+    for (int i = 0; i < 3; i++) {
+        operations.emplace_back(new TestOperation("slow", ASYNC_RPC_PRIORITY_NORMAL, started, 100));
+    }
+    for (int i = 0; i < 4; i++) {
+        operations.emplace_back(new TestOperation("batch", ASYNC_RPC_PRIORITY_NORMAL, started, 50));
+    }
+    for (auto& operation : operations) {
+        q.addOperation(operation);
+    }
+
+    // The slow operations take one worker at a time, the others are left to the batch
+    for (int i = 0; i < 4; i++) {
+        q.addWorker();
+    }
+    q.finishAndWait();
+
+    EXPECT_EQ(started.size(), operations.size());
+    EXPECT_EQ(TestOperation::most_executing_["slow"], 1);
+    EXPECT_EQ(TestOperation::most_executing_["batch"], 2);
+    // The batch finished while the slow operations waited for each other
+    EXPECT_EQ(started.back(), operations[2]->getId());
+}
+
+TEST(AsyncRPCQueue, EvictFinishedOperations) {
+    std::vector<AsyncRPCOperationId> started;
+    AsyncRPCQueue q;
+    q.setExpiry(60);
+    std::shared_ptr<AsyncRPCOperation> done(new TestOperation("send", ASYNC_RPC_PRIORITY_NORMAL, started));
+    std::shared_ptr<AsyncRPCOperation> cancelled(new TestOperation("send", ASYNC_RPC_PRIORITY_NORMAL, started));
+    q.addOperation(done);
+    q.addOperation(cancelled);
+    cancelled->cancel();
+    q.addWorker();
+    q.finishAndWait();
+    ASSERT_TRUE(done->isSuccess());
+
+    AsyncRPCOperationTiming timing;
+    ASSERT_TRUE(q.getOperationTiming(done->getId(), timing));
+    EXPECT_GE(timing.queue_secs, 0);
+    EXPECT_GE(timing.execution_secs, 0);
+    EXPECT_FALSE(q.getOperationTiming(cancelled->getId(), timing));
+    UniValue timings = q.getMethodTimings("send");
+    EXPECT_EQ(find_value(timings["execution"].get_obj(), "count").get_int(), 1);
+
+    // Kept until the expiry, cancelled operations count from when they are first seen
+    int64_t now = (int64_t)time(NULL);
+    q.evictFinishedOperations(now + 30);
+    EXPECT_EQ(q.getOperationForId(done->getId()), done);
+    EXPECT_EQ(q.getOperationForId(cancelled->getId()), cancelled);
+    q.evictFinishedOperations(now + 61);
+    EXPECT_FALSE(q.getOperationForId(done->getId()));
+    EXPECT_EQ(q.getOperationForId(cancelled->getId()), cancelled);
+    EXPECT_FALSE(q.getOperationTiming(done->getId(), timing));
+    q.evictFinishedOperations(now + 91);
+    EXPECT_FALSE(q.getOperationForId(cancelled->getId()));
+
+    // Timings outlive the operations
+    timings = q.getMethodTimings("send");
+    EXPECT_EQ(find_value(timings["execution"].get_obj(), "count").get_int(), 1);
+}
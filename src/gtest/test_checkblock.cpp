@@ -2,6 +2,9 @@
 #include <gmock/gmock.h>
 
 #include "consensus/validation.h"
+#include "keystore.h"
+#include "script/standard.h"
+#include "transaction_builder.h"
 #include "validation.h"
 #include "vds/Proof.hpp"
 
@@ -218,3 +221,86 @@ TEST_F(ContextualCheckBlockTest, BlockSaplingRulesRejectOtherTx)
         ExpectInvalidBlockFromTx(CTransaction(mtx), 100, "bad-sapling-tx-version-group-id");
     }
 }
+
+// Test that Sapling proofs and binding signatures verified on the check queue
+// are rejected for the same reason as when they are verified inline.
+TEST_F(ContextualCheckBlockTest, SaplingCheckQueueRejectReason)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    auto consensusParams = Params().GetConsensus();
+
+    auto sk = libzcash::SaplingSpendingKey::random();
+    auto expsk = sk.expanded_spending_key();
+    auto fvk = sk.full_viewing_key();
+    libzcash::diversifier_t d = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    auto pk = *fvk.in_viewing_key().address(d);
+
+    libzcash::SaplingNote note(pk, 50000);
+    SaplingMerkleTree tree;
+    tree.append(note.cm().get());
+    auto builder = TransactionBuilder(consensusParams, 1);
+    ASSERT_TRUE(builder.AddSaplingSpend(expsk, note, tree.root(), tree.witness()));
+    builder.AddSaplingOutput(fvk.ovk, pk, 25000, {});
+    auto maybe_tx = builder.Build();
+    ASSERT_TRUE(static_cast<bool>(maybe_tx));
+    CMutableTransaction mtxValid(maybe_tx.get());
+
+    int nScriptCheckThreadsOld = nScriptCheckThreads;
+    auto checkBlock = [&](const CMutableTransaction& mtx, const std::string& reason) {
+        CBlock block;
+        block.vtx.push_back(MakeTransactionRef(GetFirstBlockCoinbaseTx()));
+        block.vtx.push_back(MakeTransactionRef(mtx));
+        CBlockIndex indexPrev {Params().GenesisBlock()};
+
+        // Inline, then through the queue
+        for (int nThreads : {0, 1}) {
+            SCOPED_TRACE(nThreads);
+            nScriptCheckThreads = nThreads;
+            MockCValidationState state;
+            if (reason.empty()) {
+                EXPECT_TRUE(ContextualCheckBlock(block, state, &indexPrev));
+            } else {
+                EXPECT_CALL(state, DoS(100, false, REJECT_INVALID, reason, false)).Times(1);
+                EXPECT_FALSE(ContextualCheckBlock(block, state, &indexPrev));
+            }
+        }
+        nScriptCheckThreads = nScriptCheckThreadsOld;
+    };
+
+    {
+        SCOPED_TRACE("Valid");
+        checkBlock(mtxValid, "");
+    }
+
+    {
+        SCOPED_TRACE("InvalidSpendProof");
+        CMutableTransaction mtx = mtxValid;
+        mtx.vShieldedSpend[0].zkproof[0] ^= 1;
+        checkBlock(mtx, "bad-txns-sapling-spend-description-invalid");
+    }
+
+    {
+        // Without spends, whose signatures would fail first on the changed sighash
+        SCOPED_TRACE("InvalidOutputProof");
+        CBasicKeyStore keystore;
+        CKey tsk;
+        tsk.MakeNewKey(true);
+        keystore.AddKey(tsk);
+        auto shieldingBuilder = TransactionBuilder(consensusParams, 1, &keystore);
+        shieldingBuilder.AddTransparentInput(COutPoint(), GetScriptForDestination(tsk.GetPubKey().GetID()), 50000);
+        shieldingBuilder.AddSaplingOutput(fvk.ovk, pk, 40000, {});
+        auto maybe_shielding = shieldingBuilder.Build();
+        ASSERT_TRUE(static_cast<bool>(maybe_shielding));
+        CMutableTransaction mtx(maybe_shielding.get());
+        checkBlock(mtx, "");
+        mtx.vShieldedOutput[0].zkproof[0] ^= 1;
+        checkBlock(mtx, "bad-txns-sapling-output-description-invalid");
+    }
+
+    {
+        SCOPED_TRACE("InvalidBindingSig");
+        CMutableTransaction mtx = mtxValid;
+        mtx.bindingSig[0] ^= 1;
+        checkBlock(mtx, "bad-txns-sapling-binding-signature-invalid");
+    }
+}
@@ -18,6 +18,7 @@
 
 #include <stdexcept>
 
+#include "arith_uint256.h"
 #include "utilstrencodings.h"
 #include "version.h"
 #include "serialize.h"
@@ -235,3 +236,53 @@ TEST(merkletree, EmptyrootSapling)
     ASSERT_TRUE(SaplingMerkleTree::empty_root() == expected);
 }
 
+
+template<typename Tree, typename Hash>
+void test_append_batch(size_t max_size, size_t step, size_t threads)
+{
+    for (size_t initial = 0; initial <= max_size; initial += step) {
+        for (size_t count = 0; initial + count <= max_size; count += step) {
+            Tree expected, tree;
+            for (size_t i = 0; i < initial; i++) {
+                Hash obj(ArithToUint256(arith_uint256(i + 1)));
+                expected.append(obj);
+                tree.append(obj);
+            }
+            // The cached root has to go when the tree changes
+            ASSERT_TRUE(tree.root() == expected.root());
+
+            std::vector<Hash> objs;
+            for (size_t i = 0; i < count; i++) {
+                objs.push_back(Hash(ArithToUint256(arith_uint256(initial + i + 1))));
+                expected.append(objs.back());
+            }
+            tree.append_batch(objs, threads);
+
+            ASSERT_TRUE(tree == expected);
+            ASSERT_EQ(tree.size(), expected.size());
+            ASSERT_TRUE(tree.root() == expected.root());
+
+            CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+            ss << tree;
+            Tree deserialized;
+            ss >> deserialized;
+            ASSERT_TRUE(deserialized.root() == expected.root());
+        }
+    }
+}
+
+TEST(merkletree, AppendBatch)
+{
+    typedef libzcash::IncrementalMerkleTree<INCREMENTAL_MERKLE_TREE_DEPTH_TESTING, libzcash::SHA256Compress> TestingTree;
+    typedef libzcash::IncrementalMerkleTree<INCREMENTAL_MERKLE_TREE_DEPTH, libzcash::SHA256Compress> Tree;
+
+    // Every split of the testing tree, then large levels hashed on several threads
+    test_append_batch<TestingTree, libzcash::SHA256Compress>(16, 1, 1);
+    test_append_batch<Tree, libzcash::SHA256Compress>(3000, 499, 4);
+    test_append_batch<SaplingTestingMerkleTree, libzcash::PedersenHash>(16, 3, 2);
+
+    TestingTree tree;
+    std::vector<libzcash::SHA256Compress> objs(17);
+    ASSERT_THROW(tree.append_batch(objs), std::runtime_error);
+    ASSERT_TRUE(tree.size() == 0);
+}
@@ -12,9 +12,11 @@
 #include "crypto/common.h"
 #include "addrman.h"
 #include "amount.h"
+#include "asyncrpcqueue.h"
 #ifdef ENABLE_MINING
 #include "base58.h"
 #endif
+#include "blockstore.h"
 #include "checkpoints.h"
 #include "compat/sanity.h"
 #include "consensus/validation.h"
@@ -28,6 +30,7 @@
 #include "net.h"
 #include "net_processing.h"
 #include "policy/policy.h"
+#include "qtum/contractcallpool.h"
 #include "rpc/server.h"
 #include "rpc/register.h"
 #include "script/standard.h"
@@ -43,6 +46,8 @@
 #include "wallet/wallet.h"
 #include "wallet/walletdb.h"
 #include "wallet/rpcwallet.h"
+#include "wallet/saplingdecrypt.h"
+#include "wallet/saplingwitness.h"
 #include "wallet/wallet_ismine.h"
 #endif
 
@@ -51,10 +56,12 @@
 #include "masternodeconfig.h"
 #include "masternodeman.h"
 #include "masternode-payments.h"
+#include "masternode-sigverify.h"
 #include "masternode-sync.h"
 #include "messagesigner.h"
 #include "netfulfilledman.h"
 #include "flat-database.h"
+#include "snapshot-database.h"
 #include <stdint.h>
 #include <stdio.h>
 
@@ -238,9 +245,9 @@ void PrepareShutdown()
     g_connman.reset();
 
     // STORE DATA CACHES INTO SERIALIZED DAT FILES
-    CFlatDB<CMasternodeMan> flatdb1("mncache.dat", "magicMasternodeCache");
+    CSnapshotDB<CMasternodeMan> flatdb1("mncache.dat", "magicMasternodeCache");
     flatdb1.Dump(mnodeman);
-    CFlatDB<CMasternodePayments> flatdb2("mnpayments.dat", "magicMasternodePaymentsCache");
+    CSnapshotDB<CMasternodePayments> flatdb2("mnpayments.dat", "magicMasternodePaymentsCache");
     flatdb2.Dump(mnpayments);
     //CFlatDB<CGovernanceManager> flatdb3("governance.dat", "magicGovernanceCache");
     //flatdb3.Dump(governance);
@@ -273,6 +280,12 @@ void PrepareShutdown()
         // CValidationInterface callbacks, flush them...
         GetMainSignals().FlushBackgroundCallbacks();
 
+        if (pContractCallPool) {
+            UnregisterValidationInterface(pContractCallPool);
+            delete pContractCallPool;
+            pContractCallPool = nullptr;
+        }
+
         delete pcoinsTip;
         pcoinsTip = nullptr;
 
@@ -280,6 +293,10 @@ void PrepareShutdown()
         pcoinscatcher = nullptr;
         delete pcoinsdbview;
         pcoinsdbview = nullptr;
+        delete pclueTip;
+        pclueTip = nullptr;
+        delete pcluedbview;
+        pcluedbview = nullptr;
         delete pblocktree;
         pblocktree = nullptr;
         delete pstorageresult;
@@ -429,6 +446,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-?", _("This help message"));
     strUsage += HelpMessageOpt("-alerts", strprintf(_("Receive and display P2P network alerts (default: %u)"), DEFAULT_ALERTS));
     strUsage += HelpMessageOpt("-alertnotify=<cmd>", _("Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)"));
+    strUsage += HelpMessageOpt("-blockfilemaps=<n>", strprintf(_("Keep up to <n> block and undo files mapped into memory for reading blocks and indexed transactions, 0 reads them from the files, which reports disk errors instead of terminating on them (default: %u)"), DEFAULT_BLOCKFILE_MAPS));
     strUsage += HelpMessageOpt("-blocknotify=<cmd>", _("Execute command when the best block changes (%s in cmd is replaced by block hash)"));
     strUsage += HelpMessageOpt("-checkblocks=<n>", strprintf(_("How many blocks to check at startup (default: %u, 0 = all)"), 288));
     strUsage += HelpMessageOpt("-checklevel=<n>", strprintf(_("How thorough the block verification of -checkblocks is (0-4, default: %u)"), 3));
@@ -443,10 +461,17 @@ std::string HelpMessage(HelpMessageMode mode)
                                FormatVersion(CLIENT_VERSION)));
     strUsage += HelpMessageOpt("-exportdir=<dir>", _("Specify directory to be used when exporting data"));
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
+    strUsage += HelpMessageOpt("-contractstatecache=<n>", strprintf(_("Set the size in megabytes of the cache for contract state read from disk, shared by block connection and contract calls (0 to disable, default: %d)"), DEFAULT_CONTRACT_STATE_CACHE));
+    strUsage += HelpMessageOpt("-receiptcache=<n>", strprintf(_("Set the size in megabytes of the cache for contract receipts, including those not written to disk yet (default: %d)"), DEFAULT_RECEIPT_CACHE));
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file") + " " + _("on startup"));
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
                                -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
+    strUsage += HelpMessageOpt("-contractexecthreads=<n>", strprintf(_("Set the number of threads executing the contract transactions of a block speculatively in parallel (%u to %d, 0 = sequential execution, <0 = leave that many cores free, default: %d)"),
+                               -GetNumCores(), MAX_CONTRACT_EXEC_THREADS, DEFAULT_CONTRACT_EXEC_THREADS));
+    strUsage += HelpMessageOpt("-contractcallthreads=<n>", strprintf(_("Set the number of read-only contract calls executed at once on a snapshot of the tip, without holding the chain lock (0 = execute calls under the chain lock, default: %d)"), DEFAULT_CONTRACT_CALL_THREADS));
+    strUsage += HelpMessageOpt("-contractcalltimeout=<n>", strprintf(_("Abort read-only contract calls running longer than <n> milliseconds (0 = no limit, default: %d)"), DEFAULT_CONTRACT_CALL_TIMEOUT));
+    strUsage += HelpMessageOpt("-contractcallmaxgas=<n>", strprintf(_("Limit the gas of read-only contract calls to <n> (0 = block gas limit, default: %u)"), DEFAULT_CONTRACT_CALL_MAX_GAS));
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(_("Specify pid file (default: %s)"), "vdsd.pid"));
 #endif
@@ -475,12 +500,20 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-maxconnections=<n>", strprintf(_("Maintain at most <n> connections to peers (default: %u)"), DEFAULT_MAX_PEER_CONNECTIONS));
     strUsage += HelpMessageOpt("-maxreceivebuffer=<n>", strprintf(_("Maximum per-connection receive buffer, <n>*1000 bytes (default: %u)"), 5000));
     strUsage += HelpMessageOpt("-maxsendbuffer=<n>", strprintf(_("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)"), 1000));
+    strUsage += HelpMessageOpt("-mnsigverifythreads=<n>", strprintf(_("Set the number of threads verifying masternode broadcast, ping and payment vote signatures (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
+                               -GetNumCores(), MAX_MNSIGVERIFY_THREADS, DEFAULT_MNSIGVERIFY_THREADS));
+    strUsage += HelpMessageOpt("-msgprepthreads=<n>", strprintf(_("Set the number of threads deserializing received transactions and blocks ahead of message processing (0 to %d, default: %d)"), MAX_MSG_PREPARE_THREADS, DEFAULT_MSG_PREPARE_THREADS));
     strUsage += HelpMessageOpt("-onion=<ip:port>", strprintf(_("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: %s)"), "-proxy"));
     strUsage += HelpMessageOpt("-onlynet=<net>", _("Only connect to nodes in network <net> (ipv4, ipv6 or onion)"));
     strUsage += HelpMessageOpt("-permitbaremultisig", strprintf(_("Relay non-P2SH multisig (default: %u)"), 1));
     strUsage += HelpMessageOpt("-port=<port>", strprintf(_("Listen for connections on <port> (default: %u or testnet: %u)"), 8233, 18233));
     strUsage += HelpMessageOpt("-proxy=<ip:port>", _("Connect through SOCKS5 proxy"));
     strUsage += HelpMessageOpt("-proxyrandomize", strprintf(_("Randomize credentials for every proxy connection. This enables Tor stream isolation (default: %u)"), 1));
+#ifdef HAVE_SYS_EPOLL_H
+    strUsage += HelpMessageOpt("-socketevents=<mode>", strprintf(_("Socket events mode, either 'epoll' or 'select' (default: %s)"), "epoll"));
+#else
+    strUsage += HelpMessageOpt("-socketevents=<mode>", strprintf(_("Socket events mode, only 'select' is supported on this platform (default: %s)"), "select"));
+#endif
     strUsage += HelpMessageOpt("-seednode=<ip>", _("Connect to a node to retrieve peer addresses, and disconnect"));
     strUsage += HelpMessageOpt("-timeout=<n>", strprintf(_("Specify connection timeout in milliseconds (minimum: 1, default: %d)"), DEFAULT_CONNECT_TIMEOUT));
     strUsage += HelpMessageOpt("-torcontrol=<ip>:<port>", strprintf(_("Tor control port to use if onion listening enabled (default: %s)"), DEFAULT_TOR_CONTROL));
@@ -505,6 +538,8 @@ std::string HelpMessage(HelpMessageMode mode)
                                    FormatMoney(CWallet::minTxFee.GetFeePerK())));
     strUsage += HelpMessageOpt("-paytxfee=<amt>", strprintf(_("Fee (in BTC/kB) to add to transactions you send (default: %s)"), FormatMoney(payTxFee.GetFeePerK())));
     strUsage += HelpMessageOpt("-rescan", _("Rescan the blockchain for missing wallet transactions") + " " + _("on startup"));
+    strUsage += HelpMessageOpt("-saplingdecryptthreads=<n>", strprintf(_("Set the number of Sapling note trial decryption and witness update threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
+                               -GetNumCores(), MAX_SAPLING_DECRYPT_THREADS, DEFAULT_SAPLING_DECRYPT_THREADS));
     strUsage += HelpMessageOpt("-salvagewallet", _("Attempt to recover private keys from a corrupt wallet.dat") + " " + _("on startup"));
     strUsage += HelpMessageOpt("-sendfreetransactions", strprintf(_("Send transactions as zero-fee transactions if possible (default: %u)"), 0));
     strUsage += HelpMessageOpt("-spendzeroconfchange", strprintf(_("Spend unconfirmed change when sending transactions (default: %u)"), 1));
@@ -546,6 +581,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-dropmessagestest=<n>", "Randomly drop 1 of every <n> network messages");
         strUsage += HelpMessageOpt("-fuzzmessagestest=<n>", "Randomly fuzz 1 of every <n> network messages");
         strUsage += HelpMessageOpt("-flushwallet", strprintf("Run a thread to flush wallet periodically (default: %u)", 1));
+        strUsage += HelpMessageOpt("-paranoidblockreads", strprintf("Verify the proof of work of every block read from disk, not only of blocks that were not fully validated (default: %u)", DEFAULT_PARANOID_BLOCK_READS));
         strUsage += HelpMessageOpt("-stopafterblockimport", strprintf("Stop running after importing blocks from disk (default: %u)", 0));
     }
     string debugCategories = "addrman, alert, bench, coindb, db, estimatefee, http, libevent, lock, mempool, net, partitioncheck, pow, proxy, prune, "
@@ -597,8 +633,9 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-rpcservertimeout=<n>", strprintf("Timeout during HTTP requests (default: %d)", DEFAULT_HTTP_SERVER_TIMEOUT));
     }
 
-    // Disabled until we can lock notes and also tune performance of libsnark which by default uses multiple threads
-    //strUsage += HelpMessageOpt("-rpcasyncthreads=<n>", strprintf(_("Set the number of threads to service Async RPC calls (default: %d)"), 1));
+    strUsage += HelpMessageOpt("-rpcasyncthreads=<n>", strprintf(_("Set the number of threads to service Async RPC calls (default: %d)"), DEFAULT_ASYNC_RPC_THREADS));
+    strUsage += HelpMessageOpt("-rpcasynclimit=<method>:<n>", strprintf(_("Execute up to <n> Async RPC operations of <method> at once (default: %d). Notes are not locked, operations of the same method executing at once may conflict. This option can be specified multiple times"), DEFAULT_ASYNC_RPC_METHOD_LIMIT));
+    strUsage += HelpMessageOpt("-rpcasyncexpiry=<n>", strprintf(_("Forget finished Async RPC operations after <n> seconds, 0 to keep them until their result is retrieved (default: %d)"), DEFAULT_ASYNC_RPC_EXPIRY));
 
     return strUsage;
 }
@@ -688,6 +725,11 @@ void CleanupBlockRevFiles()
     }
 }
 
+void ThreadLoadNullifiers()
+{
+    pcoinsdbview->LoadNullifiers();
+}
+
 void ThreadImport(std::vector<boost::filesystem::path> vImportFiles)
 {
     const CChainParams& chainparams = Params();
@@ -1108,11 +1150,26 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             LogPrintf("%s: parameter interaction: -zapwallettxes=<mode> -> setting -rescan=1\n", __func__);
     }
 
+    SocketEventsMode socketEventsMode = DEFAULT_SOCKETEVENTS;
+    if (mapArgs.count("-socketevents")) {
+        std::string strSocketEvents = GetArg("-socketevents", "");
+        if (strSocketEvents == "select")
+            socketEventsMode = SOCKETEVENTS_SELECT;
+#ifdef HAVE_SYS_EPOLL_H
+        else if (strSocketEvents == "epoll")
+            socketEventsMode = SOCKETEVENTS_EPOLL;
+#endif
+        else
+            return InitError(strprintf(_("Unsupported -socketevents mode: '%s'"), strSocketEvents));
+    }
+
     // Make sure enough file descriptors are available
     int nBind = std::max((int) mapArgs.count("-bind") + (int) mapArgs.count("-whitebind"), 1);
     int nUserMaxConnections = GetArg("-maxconnections", DEFAULT_MAX_PEER_CONNECTIONS);
     int nMaxConnections = std::max(nUserMaxConnections, 0);
-    nMaxConnections = std::max(std::min(nMaxConnections, (int) (FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS)), 0);
+    // select() can only wait on descriptors below FD_SETSIZE, epoll is only bounded by the descriptor limit
+    if (socketEventsMode == SOCKETEVENTS_SELECT)
+        nMaxConnections = std::max(std::min(nMaxConnections, (int) (FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS)), 0);
     int nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS);
     if (nFD < MIN_CORE_FILEDESCRIPTORS)
         return InitError(_("Not enough file descriptors available."));
@@ -1168,6 +1225,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     mempool.setSanityCheck(GetBoolArg("-checkmempool", chainparams.DefaultConsistencyChecks()));
     fCheckBlockIndex = GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
     fCheckpointsEnabled = GetBoolArg("-checkpoints", true);
+    fParanoidBlockReads = GetBoolArg("-paranoidblockreads", DEFAULT_PARANOID_BLOCK_READS);
 
     // -par=0 means autodetect, but nScriptCheckThreads==0 means no concurrency
     nScriptCheckThreads = GetArg("-par", DEFAULT_SCRIPTCHECK_THREADS);
@@ -1354,9 +1412,12 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
-        for (int i = 0; i < nScriptCheckThreads - 1; i++)
+        for (int i = 0; i < nScriptCheckThreads - 1; i++) {
             threadGroup.create_thread(&ThreadScriptCheck);
+            threadGroup.create_thread(&ThreadSaplingCheck);
+        }
     }
+    StartContractExecThreads(threadGroup);
 
     // Start the lightweight task scheduler thread
     CScheduler::Function serviceLoop = boost::bind(&CScheduler::serviceQueue, &scheduler);
@@ -1603,12 +1664,17 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nTotalCache -= nCoinDBCache;
     nCoinCacheUsage = nTotalCache; // the rest goes to in-memory cache
+    int64_t nContractStateCache = std::max((int64_t)0, GetArg("-contractstatecache", DEFAULT_CONTRACT_STATE_CACHE)) << 20;
+    int64_t nReceiptCache = std::max((int64_t)0, GetArg("-receiptcache", DEFAULT_RECEIPT_CACHE)) << 20;
     LogPrintf("Cache configuration:\n");
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for clue infomation database\n", nClueDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for ad infomation database\n", nAdDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set\n", nCoinCacheUsage * (1.0 / 1024 / 1024));
+    LogPrintf("* Using %.1fMiB for contract state\n", nContractStateCache * (1.0 / 1024 / 1024));
+    LogPrintf("* Using %.1fMiB for contract receipts\n", nReceiptCache * (1.0 / 1024 / 1024));
+    blockFileCache.SetMaxFiles(std::max(0, (int)GetArg("-blockfilemaps", DEFAULT_BLOCKFILE_MAPS)));
 
     bool clearWitnessCaches = false;
 
@@ -1673,10 +1739,14 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                 const dev::h256 hashDB(dev::sha3(dev::rlp("")));
                 dev::eth::BaseState existsQtumstate = fStatus ? dev::eth::BaseState::PreExisting : dev::eth::BaseState::Empty;
                 globalState = std::unique_ptr<QtumState>(new QtumState(dev::u256(0), QtumState::openDB(dirQtum, hashDB, dev::WithExisting::Trust), dirQtum, existsQtumstate));
+                // Both tries are content addressed and can share one node cache
+                std::shared_ptr<dev::OverlayDBCache> stateCache = std::make_shared<dev::OverlayDBCache>(nContractStateCache);
+                globalState->db().setCache(stateCache);
+                globalState->dbUtxo().setCache(stateCache);
                 dev::eth::ChainParams cp((dev::eth::genesisInfo(dev::eth::Network::qtumMainNetwork)));
                 globalSealEngine = std::unique_ptr<dev::eth::SealEngineFace>(cp.createSealEngine());
 
-                pstorageresult = new StorageResults(qtumStateDir.string());
+                pstorageresult = new StorageResults(qtumStateDir.string(), nReceiptCache);
 
                 if (chainActive.Tip() != NULL) {
                     globalState->setRoot(uintToh256(chainActive.Tip()->hashStateRoot));
@@ -1705,6 +1775,26 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                     break;
                 }
 
+                // Address indexes from before the output index get it built once
+                bool fAddressOutputIndex = false;
+                if (fAddressIndex && (!pblocktree->ReadFlag("addressoutputindex", fAddressOutputIndex) || !fAddressOutputIndex)) {
+                    uiInterface.InitMessage(_("Building address output index..."));
+                    if (!pblocktree->BuildAddressOutputIndex()) {
+                        strLoadError = _("Error building address output index");
+                        break;
+                    }
+                }
+
+                // Likewise the log bloom index for blocks connected before it existed
+                bool fLogBloomIndex = false;
+                if (fLogEvents && (!pblocktree->ReadFlag("logbloomindex", fLogBloomIndex) || !fLogBloomIndex)) {
+                    uiInterface.InitMessage(_("Building log bloom index..."));
+                    if (!pblocktree->BuildLogBloomIndex(GetTxLogBloom)) {
+                        strLoadError = _("Error building log bloom index");
+                        break;
+                    }
+                }
+
                 // Check for changed -prune state.  What we are concerned about is a user who has pruned blocks
                 // in the past, but is now trying to run unpruned.
                 if (fHavePruned && !fPruneMode) {
@@ -1780,8 +1870,16 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     }
     LogPrintf(" block index %15dms\n", GetTimeMillis() - nStart);
 
+    // Nullifier lookups are answered from the chainstate until the set is built
+    threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "loadnf", &ThreadLoadNullifiers));
+
     // ********************************************************* Step 8: load wallet
 #ifdef ENABLE_WALLET
+    if (!fDisableWallet) {
+        int nSaplingThreads = StartSaplingDecryptThreads(threadGroup);
+        StartSaplingWitnessThreads(threadGroup, nSaplingThreads);
+    }
+
     if (!CWallet::InitLoadWallet())
         return false;
 
@@ -1823,6 +1921,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     // ********************************************************* Step 11a: setup PrivateSend
     threadGroup.create_thread(boost::bind(&ThreadCheckMasternodeSync, boost::ref(*g_connman)));
+    StartMasternodeSigVerifyThreads(threadGroup, *g_connman);
     fMasterNode = GetBoolArg("-masternode", false);
     // TODO: masternode should have no wallet
 
@@ -1876,7 +1975,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     strDBName = "mncache.dat";
     uiInterface.InitMessage(_("Loading masternode cache..."));
-    CFlatDB<CMasternodeMan> flatdb1(strDBName, "magicMasternodeCache");
+    CSnapshotDB<CMasternodeMan> flatdb1(strDBName, "magicMasternodeCache");
     if (!flatdb1.Load(mnodeman)) {
         return InitError(_("Failed to load masternode cache from") + "\n" + (pathDB / strDBName).string());
     }
@@ -1884,7 +1983,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     if (mnodeman.size()) {
         strDBName = "mnpayments.dat";
         uiInterface.InitMessage(_("Loading masternode payment cache..."));
-        CFlatDB<CMasternodePayments> flatdb2(strDBName, "magicMasternodePaymentsCache");
+        CSnapshotDB<CMasternodePayments> flatdb2(strDBName, "magicMasternodePaymentsCache");
         if (!flatdb2.Load(mnpayments)) {
             return InitError(_("Failed to load masternode payments cache from") + "\n" + (pathDB / strDBName).string());
         }
@@ -1906,6 +2005,17 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     // GetMainSignals().UpdatedBlockTip(chainActive.Tip());
     pdsNotificationInterface->InitializeCurrentBlockTip();
 
+    int nContractCallThreads = GetArg("-contractcallthreads", DEFAULT_CONTRACT_CALL_THREADS);
+    if (nContractCallThreads > 0) {
+        pContractCallPool = new CContractCallPool(nContractCallThreads, std::max((int64_t)0, GetArg("-contractcallmaxgas", DEFAULT_CONTRACT_CALL_MAX_GAS)),
+                                                  std::max((int64_t)0, GetArg("-contractcalltimeout", DEFAULT_CONTRACT_CALL_TIMEOUT)));
+        {
+            LOCK(cs_main);
+            pContractCallPool->UpdateSnapshot(chainActive.Tip());
+        }
+        RegisterValidationInterface(pContractCallPool);
+    }
+
     // ********************************************************* Step 11: start node
 
     if (!CheckDiskSpace())
@@ -1942,6 +2052,8 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     connOptions.uiInterface = &uiInterface;
     connOptions.nSendBufferMaxSize = 1000 * GetArg("-maxsendbuffer", DEFAULT_MAXSENDBUFFER);
     connOptions.nReceiveFloodSize = 1000 * GetArg("-maxreceivebuffer", DEFAULT_MAXRECEIVEBUFFER);
+    connOptions.socketEventsMode = socketEventsMode;
+    connOptions.nMessagePrepareThreads = std::max(0, std::min((int)GetArg("-msgprepthreads", DEFAULT_MSG_PREPARE_THREADS), MAX_MSG_PREPARE_THREADS));
 
     if (!connman.Start(scheduler, strNodeError, connOptions))
         return InitError(strNodeError);
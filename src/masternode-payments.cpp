@@ -4,6 +4,7 @@
 
 #include "activemasternode.h"
 #include "masternode-payments.h"
+#include "masternode-sigverify.h"
 #include "masternode-sync.h"
 #include "masternodeman.h"
 #include "messagesigner.h"
@@ -249,59 +250,69 @@ void CMasternodePayments::ProcessMessage(CNode* pfrom, std::string& strCommand,
             mapMasternodePaymentVotes[nHash].MarkAsNotVerified();
         }
 
-        int nFirstBlock = nCachedBlockHeight - GetStorageLimit();
-        if (vote.nBlockHeight < nFirstBlock || vote.nBlockHeight > nCachedBlockHeight + 20) {
-            LogPrint("mnpayments", "MASTERNODEPAYMENTVOTE -- vote out of range: nFirstBlock=%d, nBlockHeight=%d, nHeight=%d\n", nFirstBlock, vote.nBlockHeight, nCachedBlockHeight);
-            return;
-        }
+        // signatures are recovered in batches off this thread, unless the verifier is not running
+        if (mnsigverifier.Push(pfrom, vote)) return;
 
-        std::string strError = "";
-        if (!vote.IsValid(pfrom, nCachedBlockHeight, strError, connman)) {
-            LogPrint("mnpayments", "MASTERNODEPAYMENTVOTE -- invalid message, error: %s\n", strError);
-            return;
-        }
+        ProcessPaymentVote(pfrom, vote, connman);
+    }
+}
 
-        if (!CanVote(vote.vinMasternode.prevout, vote.nBlockHeight)) {
-            LogPrintf("MASTERNODEPAYMENTVOTE -- masternode already voted, masternode=%s\n", vote.vinMasternode.prevout.ToStringShort());
-            return;
-        }
+void CMasternodePayments::ProcessPaymentVote(CNode* pfrom, CMasternodePaymentVote& vote, CConnman& connman)
+{
+    uint256 nHash = vote.GetHash();
 
-        masternode_info_t mnInfo;
-        if (!mnodeman.GetMasternodeInfo(vote.vinMasternode.prevout, mnInfo)) {
-            // mn was not found, so we can't check vote, some info is probably missing
-            LogPrintf("MASTERNODEPAYMENTVOTE -- masternode is missing %s\n", vote.vinMasternode.prevout.ToStringShort());
-            mnodeman.AskForMN(pfrom, vote.vinMasternode.prevout, connman);
-            return;
-        }
+    int nFirstBlock = nCachedBlockHeight - GetStorageLimit();
+    if (vote.nBlockHeight < nFirstBlock || vote.nBlockHeight > nCachedBlockHeight + 20) {
+        LogPrint("mnpayments", "MASTERNODEPAYMENTVOTE -- vote out of range: nFirstBlock=%d, nBlockHeight=%d, nHeight=%d\n", nFirstBlock, vote.nBlockHeight, nCachedBlockHeight);
+        return;
+    }
 
-        int nDos = 0;
-        if (!vote.CheckSignature(mnInfo.pubKeyMasternode, nCachedBlockHeight, nDos)) {
-            if (nDos) {
-                LogPrintf("MASTERNODEPAYMENTVOTE -- ERROR: invalid signature\n");
-                Misbehaving(pfrom->GetId(), nDos);
-            } else {
-                // only warn about anything non-critical (i.e. nDos == 0) in debug mode
-                LogPrint("mnpayments", "MASTERNODEPAYMENTVOTE -- WARNING: invalid signature\n");
-            }
-            // Either our info or vote info could be outdated.
-            // In case our info is outdated, ask for an update,
-            mnodeman.AskForMN(pfrom, vote.vinMasternode.prevout, connman);
-            // but there is nothing we can do if vote info itself is outdated
-            // (i.e. it was signed by a mn which changed its key),
-            // so just quit here.
-            return;
-        }
+    std::string strError = "";
+    if (!vote.IsValid(pfrom, nCachedBlockHeight, strError, connman)) {
+        LogPrint("mnpayments", "MASTERNODEPAYMENTVOTE -- invalid message, error: %s\n", strError);
+        return;
+    }
 
-        CTxDestination address1;
-        ExtractDestination(vote.payee, address1);
+    if (!CanVote(vote.vinMasternode.prevout, vote.nBlockHeight)) {
+        LogPrintf("MASTERNODEPAYMENTVOTE -- masternode already voted, masternode=%s\n", vote.vinMasternode.prevout.ToStringShort());
+        return;
+    }
 
-        LogPrint("mnpayments", "MASTERNODEPAYMENTVOTE -- vote: address=%s, nBlockHeight=%d, nHeight=%d, prevout=%s, hash=%s new\n",
-                 EncodeDestination(address1), vote.nBlockHeight, nCachedBlockHeight, vote.vinMasternode.prevout.ToStringShort(), nHash.ToString());
+    masternode_info_t mnInfo;
+    if (!mnodeman.GetMasternodeInfo(vote.vinMasternode.prevout, mnInfo)) {
+        // mn was not found, so we can't check vote, some info is probably missing
+        LogPrintf("MASTERNODEPAYMENTVOTE -- masternode is missing %s\n", vote.vinMasternode.prevout.ToStringShort());
+        mnodeman.AskForMN(pfrom, vote.vinMasternode.prevout, connman);
+        return;
+    }
 
-        if (AddPaymentVote(vote)) {
-            vote.Relay(connman);
-            masternodeSync.BumpAssetLastTime("MASTERNODEPAYMENTVOTE");
-        }
+    int nDos = 0;
+    if (!vote.CheckSignature(mnInfo.pubKeyMasternode, nCachedBlockHeight, nDos)) {
+        if (nDos) {
+            LogPrintf("MASTERNODEPAYMENTVOTE -- ERROR: invalid signature\n");
+            Misbehaving(pfrom->GetId(), nDos);
+        } else {
+            // only warn about anything non-critical (i.e. nDos == 0) in debug mode
+            LogPrint("mnpayments", "MASTERNODEPAYMENTVOTE -- WARNING: invalid signature\n");
+        }
+        // Either our info or vote info could be outdated.
+        // In case our info is outdated, ask for an update,
+        mnodeman.AskForMN(pfrom, vote.vinMasternode.prevout, connman);
+        // but there is nothing we can do if vote info itself is outdated
+        // (i.e. it was signed by a mn which changed its key),
+        // so just quit here.
+        return;
+    }
+
+    CTxDestination address1;
+    ExtractDestination(vote.payee, address1);
+
+    LogPrint("mnpayments", "MASTERNODEPAYMENTVOTE -- vote: address=%s, nBlockHeight=%d, nHeight=%d, prevout=%s, hash=%s new\n",
+             EncodeDestination(address1), vote.nBlockHeight, nCachedBlockHeight, vote.vinMasternode.prevout.ToStringShort(), nHash.ToString());
+
+    if (AddPaymentVote(vote)) {
+        vote.Relay(connman);
+        masternodeSync.BumpAssetLastTime("MASTERNODEPAYMENTVOTE");
     }
 }
 
@@ -790,17 +801,22 @@ void CMasternodePaymentVote::Relay(CConnman& connman)
     connman.RelayInv(inv);
 }
 
-bool CMasternodePaymentVote::CheckSignature(const CPubKey& pubKeyMasternode, int nValidationHeight, int& nDos)
+uint256 CMasternodePaymentVote::GetSignatureHash() const
 {
-    // do not ban by default
-    nDos = 0;
-
     std::string strMessage = vinMasternode.prevout.ToStringShort() +
                              boost::lexical_cast<std::string>(nBlockHeight) +
                              ScriptToAsmStr(payee);
 
+    return CMessageSigner::GetMessageHash(strMessage);
+}
+
+bool CMasternodePaymentVote::CheckSignature(const CPubKey& pubKeyMasternode, int nValidationHeight, int& nDos)
+{
+    // do not ban by default
+    nDos = 0;
+
     std::string strError = "";
-    if (!CMessageSigner::VerifyMessage(pubKeyMasternode, vchSig, strMessage, strError)) {
+    if (!CHashSigner::VerifyHash(GetSignatureHash(), pubKeyMasternode, vchSig, strError)) {
         // Only ban for future block vote when we are already synced.
         // Otherwise it could be the case when MN which signed this vote is using another key now
         // and we have no idea about the old one.
@@ -28,6 +28,7 @@ static const int MIN_MASTERNODE_PAYMENT_PROTO_VERSION_2 = 70208;
 
 extern CCriticalSection cs_vecPayees;
 extern CCriticalSection cs_mapMasternodeBlocks;
+extern CCriticalSection cs_mapMasternodePaymentVotes;
 extern CCriticalSection cs_mapMasternodePayeeVotes;
 
 extern CMasternodePayments mnpayments;
@@ -163,6 +164,8 @@ public:
         ss << vinMasternode.prevout;
         return ss.GetHash();
     }
+    /// Hash of the message signed by the masternode key
+    uint256 GetSignatureHash() const;
 
     bool Sign();
     bool CheckSignature(const CPubKey& pubKeyMasternode, int nValidationHeight, int& nDos);
@@ -215,6 +218,38 @@ public:
         READWRITE(mapMasternodeBlocks);
     }
 
+    /// Sections of the mnpayments.dat snapshot, see CSnapshotDB
+    enum {
+        SNAPSHOT_SECTION_VOTES,
+        SNAPSHOT_SECTION_BLOCKS,
+        SNAPSHOT_SECTIONS
+    };
+
+    template <typename Stream>
+    void SerializeSection(Stream& s, int nSection)
+    {
+        if (nSection == SNAPSHOT_SECTION_VOTES) {
+            LOCK(cs_mapMasternodePaymentVotes);
+            s << mapMasternodePaymentVotes;
+        } else {
+            LOCK(cs_mapMasternodeBlocks);
+            s << mapMasternodeBlocks;
+        }
+    }
+
+    template <typename Stream>
+    bool UnserializeSection(Stream& s, int nSection)
+    {
+        if (nSection == SNAPSHOT_SECTION_VOTES) {
+            LOCK(cs_mapMasternodePaymentVotes);
+            s >> mapMasternodePaymentVotes;
+        } else {
+            LOCK(cs_mapMasternodeBlocks);
+            s >> mapMasternodeBlocks;
+        }
+        return true;
+    }
+
     void Clear();
 
     bool AddPaymentVote(const CMasternodePaymentVote& vote);
@@ -235,6 +270,8 @@ public:
 
     int GetMinMasternodePaymentsProto();
     void ProcessMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv, CConnman& connman);
+    /// Accept a payment vote received from pfrom, called by ProcessMessage or the signature verifier
+    void ProcessPaymentVote(CNode* pfrom, CMasternodePaymentVote& vote, CConnman& connman);
     std::string GetRequiredPaymentsString(int nBlockHeight);
     void FillBlockPayee(CMutableTransaction& txNew, int nBlockHeight, CAmount blockReward, CTxOut& txoutMasternodeRet);
     std::string ToString() const;
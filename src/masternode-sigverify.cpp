@@ -0,0 +1,183 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "masternode-sigverify.h"
+
+#include "checkqueue.h"
+#include "masternodeman.h"
+#include "messagesigner.h"
+#include "net.h"
+#include "util.h"
+
+#include <boost/thread.hpp>
+
+CMasternodeSigVerifier mnsigverifier;
+
+static CCheckQueue<CMasternodeSigCheck> sigcheckqueue(64);
+/** Number of running recovery threads, excluding the verifier thread */
+static int nSigCheckWorkers = 0;
+
+bool CMasternodeSigCheck::operator()()
+{
+    // Only fills the cache, the caller decides what a failure means
+    CKeyID keyID;
+    CHashSigner::RecoverKeyID(hash, *pvchSig, keyID);
+    return true;
+}
+
+bool CMasternodeSigVerifier::Push(Message&& message)
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    if (!fRunning || queue.size() >= MNSIGVERIFY_MAX_QUEUE)
+        return false;
+
+    // Keep the peer around until its message is processed
+    message.pfrom->AddRef();
+    queue.push_back(std::move(message));
+    cond.notify_one();
+    return true;
+}
+
+bool CMasternodeSigVerifier::Push(CNode* pfrom, const CMasternodeBroadcast& mnb)
+{
+    Message message(Message::BROADCAST, pfrom);
+    message.mnb = mnb;
+    return Push(std::move(message));
+}
+
+bool CMasternodeSigVerifier::Push(CNode* pfrom, const CMasternodePing& mnp)
+{
+    Message message(Message::PING, pfrom);
+    message.mnp = mnp;
+    return Push(std::move(message));
+}
+
+bool CMasternodeSigVerifier::Push(CNode* pfrom, const CMasternodePaymentVote& vote)
+{
+    Message message(Message::PAYMENT_VOTE, pfrom);
+    message.vote = vote;
+    return Push(std::move(message));
+}
+
+size_t CMasternodeSigVerifier::size()
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    return queue.size();
+}
+
+void CMasternodeSigVerifier::Start()
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    fRunning = true;
+}
+
+void CMasternodeSigVerifier::Process(std::vector<Message>& vBatch, CConnman& connman)
+{
+    // A batch is never left half done, the peers it references must be released
+    boost::this_thread::disable_interruption noInterrupt;
+
+    std::vector<CMasternodeSigCheck> vChecks;
+    vChecks.reserve(vBatch.size() * 2);
+    for (const Message& message : vBatch) {
+        switch (message.type) {
+        case Message::BROADCAST:
+            vChecks.emplace_back(message.mnb.GetSignatureHash(), message.mnb.vchSig);
+            if (message.mnb.lastPing != CMasternodePing())
+                vChecks.emplace_back(message.mnb.lastPing.GetSignatureHash(), message.mnb.lastPing.vchSig);
+            break;
+        case Message::PING:
+            vChecks.emplace_back(message.mnp.GetSignatureHash(), message.mnp.vchSig);
+            break;
+        case Message::PAYMENT_VOTE:
+            vChecks.emplace_back(message.vote.GetSignatureHash(), message.vote.vchSig);
+            break;
+        }
+    }
+
+    if (nSigCheckWorkers > 0 && vChecks.size() > 1) {
+        CCheckQueueControl<CMasternodeSigCheck> control(&sigcheckqueue);
+        control.Add(vChecks);
+        control.Wait();
+    } else {
+        for (CMasternodeSigCheck& check : vChecks)
+            check();
+    }
+
+    for (Message& message : vBatch) {
+        switch (message.type) {
+        case Message::BROADCAST:
+            mnodeman.ProcessBroadcast(message.pfrom, message.mnb, connman);
+            break;
+        case Message::PING:
+            mnodeman.ProcessPing(message.pfrom, message.mnp, connman);
+            break;
+        case Message::PAYMENT_VOTE:
+            mnpayments.ProcessPaymentVote(message.pfrom, message.vote, connman);
+            break;
+        }
+        message.pfrom->Release();
+    }
+}
+
+void CMasternodeSigVerifier::Thread(CConnman& connman)
+{
+    try {
+        while (true) {
+            std::vector<Message> vBatch;
+            {
+                boost::unique_lock<boost::mutex> lock(cs);
+                while (queue.empty())
+                    cond.wait(lock);
+                size_t nCount = std::min(queue.size(), MNSIGVERIFY_BATCH_SIZE);
+                vBatch.reserve(nCount);
+                for (size_t i = 0; i < nCount; i++) {
+                    vBatch.push_back(std::move(queue.front()));
+                    queue.pop_front();
+                }
+            }
+            LogPrint("masternode", "CMasternodeSigVerifier::Thread -- processing %u messages\n", vBatch.size());
+            Process(vBatch, connman);
+        }
+    } catch (const boost::thread_interrupted&) {
+        // Drop the rest while the peers still exist, later messages are no longer queued
+        boost::unique_lock<boost::mutex> lock(cs);
+        fRunning = false;
+        for (Message& message : queue)
+            message.pfrom->Release();
+        queue.clear();
+        throw;
+    }
+}
+
+static void ThreadMasternodeSigCheck()
+{
+    RenameThread("vds-mnsigcheck");
+    sigcheckqueue.Thread();
+}
+
+static void ThreadMasternodeSigVerify(CConnman& connman)
+{
+    RenameThread("vds-mnsigverify");
+    mnsigverifier.Thread(connman);
+}
+
+void StartMasternodeSigVerifyThreads(boost::thread_group& threadGroup, CConnman& connman)
+{
+    // -mnsigverifythreads=0 means autodetect, like -par
+    int nThreads = GetArg("-mnsigverifythreads", DEFAULT_MNSIGVERIFY_THREADS);
+    if (nThreads <= 0)
+        nThreads += GetNumCores();
+    if (nThreads > MAX_MNSIGVERIFY_THREADS)
+        nThreads = MAX_MNSIGVERIFY_THREADS;
+
+    LogPrintf("Using %u threads for masternode signature verification\n", std::max(nThreads, 1));
+    // The verifier thread joins the pool as the last worker
+    for (int i = 0; i < nThreads - 1; i++) {
+        threadGroup.create_thread(&ThreadMasternodeSigCheck);
+        nSigCheckWorkers++;
+    }
+
+    mnsigverifier.Start();
+    threadGroup.create_thread(boost::bind(&ThreadMasternodeSigVerify, boost::ref(connman)));
+}
@@ -0,0 +1,113 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MASTERNODE_SIGVERIFY_H
+#define MASTERNODE_SIGVERIFY_H
+
+#include "masternode.h"
+#include "masternode-payments.h"
+
+#include <deque>
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+class CConnman;
+class CMasternodeSigVerifier;
+class CNode;
+
+namespace boost
+{
+class thread_group;
+} // namespace boost
+
+/** Number of masternode signature recovery threads, 0 = as many as cores */
+static const int DEFAULT_MNSIGVERIFY_THREADS = 0;
+/** Maximum number of masternode signature recovery threads */
+static const int MAX_MNSIGVERIFY_THREADS = 16;
+/** Maximum number of messages whose signatures are recovered together */
+static const size_t MNSIGVERIFY_BATCH_SIZE = 1024;
+/** Messages received while this many are queued are checked by the message handler thread */
+static const size_t MNSIGVERIFY_MAX_QUEUE = 100000;
+
+extern CMasternodeSigVerifier mnsigverifier;
+
+/** Closure recovering the key of one signature into the recovered key cache of CHashSigner */
+class CMasternodeSigCheck
+{
+private:
+    uint256 hash;
+    const std::vector<unsigned char>* pvchSig;
+
+public:
+    CMasternodeSigCheck() : pvchSig(nullptr) {}
+    CMasternodeSigCheck(const uint256& hashIn, const std::vector<unsigned char>& vchSig) : hash(hashIn), pvchSig(&vchSig) {}
+
+    bool operator()();
+
+    void swap(CMasternodeSigCheck& check)
+    {
+        std::swap(hash, check.hash);
+        std::swap(pvchSig, check.pvchSig);
+    }
+};
+
+/**
+ * Signature verification pipeline for masternode broadcasts, pings and
+ * payment votes.
+ *
+ * The message handler thread queues parsed messages instead of checking them
+ * inline. The verifier thread takes them in batches, recovers the keys of all
+ * their signatures on the worker threads, then feeds the messages in arrival
+ * order through the regular CMasternodeMan/CMasternodePayments checks under
+ * their locks. Those find the recovered keys in the cache, so they only
+ * compare key ids.
+ */
+class CMasternodeSigVerifier
+{
+private:
+    struct Message {
+        enum Type {
+            BROADCAST,
+            PING,
+            PAYMENT_VOTE
+        } type;
+        CNode* pfrom;
+        CMasternodeBroadcast mnb;
+        CMasternodePing mnp;
+        CMasternodePaymentVote vote;
+
+        Message(Type typeIn, CNode* pfromIn) : type(typeIn), pfrom(pfromIn) {}
+    };
+
+    boost::mutex cs;
+    boost::condition_variable cond;
+    std::deque<Message> queue;
+    bool fRunning;
+
+    bool Push(Message&& message);
+    void Process(std::vector<Message>& vBatch, CConnman& connman);
+
+public:
+    CMasternodeSigVerifier() : fRunning(false) {}
+
+    /// Queue a message received from pfrom, returns false if the caller has to process it
+    bool Push(CNode* pfrom, const CMasternodeBroadcast& mnb);
+    bool Push(CNode* pfrom, const CMasternodePing& mnp);
+    bool Push(CNode* pfrom, const CMasternodePaymentVote& vote);
+
+    /// Number of queued messages
+    size_t size();
+
+    /// Accept messages, they are processed once Thread runs
+    void Start();
+    /// Process queued messages until interrupted
+    void Thread(CConnman& connman);
+};
+
+/** Start the verifier and its signature recovery threads (-mnsigverifythreads) */
+void StartMasternodeSigVerifyThreads(boost::thread_group& threadGroup, CConnman& connman);
+
+#endif
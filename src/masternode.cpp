@@ -567,19 +567,25 @@ bool CMasternodeBroadcast::Sign(const CKey& keyCollateralAddress)
     return true;
 }
 
+uint256 CMasternodeBroadcast::GetSignatureHash() const
+{
+    std::string strMessage = addr.ToString() + boost::lexical_cast<std::string>(sigTime) +
+                             pubKeyCollateralAddress.GetID().ToString() + pubKeyMasternode.GetID().ToString() +
+                             boost::lexical_cast<std::string>(nProtocolVersion);
+
+    return CMessageSigner::GetMessageHash(strMessage);
+}
+
 bool CMasternodeBroadcast::CheckSignature(int& nDos)
 {
-    std::string strMessage;
     std::string strError = "";
     nDos = 0;
 
-    strMessage = addr.ToString() + boost::lexical_cast<std::string>(sigTime) +
-                 pubKeyCollateralAddress.GetID().ToString() + pubKeyMasternode.GetID().ToString() +
-                 boost::lexical_cast<std::string>(nProtocolVersion);
+    uint256 hash = GetSignatureHash();
 
-    LogPrint("masternode", "CMasternodeBroadcast::CheckSignature -- strMessage: %s  pubKeyCollateralAddress address: %s  sig: %s\n", strMessage, EncodeDestination(pubKeyCollateralAddress.GetID()), EncodeBase64(&vchSig[0], vchSig.size()));
+    LogPrint("masternode", "CMasternodeBroadcast::CheckSignature -- hash: %s  pubKeyCollateralAddress address: %s  sig: %s\n", hash.ToString(), EncodeDestination(pubKeyCollateralAddress.GetID()), EncodeBase64(vchSig.data(), vchSig.size()));
 
-    if (!CMessageSigner::VerifyMessage(pubKeyCollateralAddress, vchSig, strMessage, strError)) {
+    if (!CHashSigner::VerifyHash(hash, pubKeyCollateralAddress, vchSig, strError)) {
         LogPrintf("CMasternodeBroadcast::CheckSignature -- Got bad Masternode announce signature, error: %s\n", strError);
         nDos = 100;
         return false;
@@ -632,14 +638,20 @@ bool CMasternodePing::Sign(const CKey& keyMasternode, const CPubKey& pubKeyMaste
     return true;
 }
 
-bool CMasternodePing::CheckSignature(CPubKey& pubKeyMasternode, int& nDos)
+uint256 CMasternodePing::GetSignatureHash() const
 {
     // TODO: add sentinel data
     std::string strMessage = vin.ToString() + blockHash.ToString() + boost::lexical_cast<std::string>(sigTime);
+
+    return CMessageSigner::GetMessageHash(strMessage);
+}
+
+bool CMasternodePing::CheckSignature(CPubKey& pubKeyMasternode, int& nDos)
+{
     std::string strError = "";
     nDos = 0;
 
-    if (!CMessageSigner::VerifyMessage(pubKeyMasternode, vchSig, strMessage, strError)) {
+    if (!CHashSigner::VerifyHash(GetSignatureHash(), pubKeyMasternode, vchSig, strError)) {
         LogPrintf("CMasternodePing::CheckSignature -- Got bad Masternode ping signature, masternode=%s, error: %s\n", vin.prevout.ToStringShort(), strError);
         nDos = 33;
         return false;
@@ -78,6 +78,8 @@ public:
         ss << sigTime;
         return ss.GetHash();
     }
+    /// Hash of the message signed by the masternode key
+    uint256 GetSignatureHash() const;
 
     bool IsExpired() const
     {
@@ -460,6 +462,7 @@ public:
         ss << sigTime;
         return ss.GetHash();
     }
+    /// Hash of the message signed by the collateral key
     uint256 GetSignatureHash() const;
 
     /// Create Masternode broadcast, needs to be relayed manually after that
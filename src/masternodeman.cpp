@@ -5,6 +5,7 @@
 #include "activemasternode.h"
 #include "addrman.h"
 #include "masternode-payments.h"
+#include "masternode-sigverify.h"
 #include "masternode-sync.h"
 #include "masternodeman.h"
 #include "messagesigner.h"
@@ -28,14 +29,6 @@ struct CompareLastPaidBlock {
     }
 };
 
-struct CompareScoreMN {
-    bool operator()(const std::pair<arith_uint256, CMasternode*>& t1,
-                    const std::pair<arith_uint256, CMasternode*>& t2) const
-    {
-        return (t1.first != t2.first) ? (t1.first < t2.first) : (t1.second->vin < t2.second->vin);
-    }
-};
-
 struct CompareScoreMN_Desc {
     bool operator()(const std::pair<arith_uint256, CMasternode*>& t1,
                     const std::pair<arith_uint256, CMasternode*>& t2) const
@@ -69,6 +62,7 @@ CMasternodeMan::CMasternodeMan()
       fMasternodesAdded(false),
       fMasternodesRemoved(false),
       vecDirtyGovernanceObjectHashes(),
+      mapRankingCache(MAX_RANKING_CACHE_SIZE),
       nLastWatchdogVoteTime(0),
       mapSeenMasternodeBroadcast(),
       mapSeenMasternodePing(),
@@ -84,6 +78,7 @@ bool CMasternodeMan::Add(CMasternode& mn)
     LogPrint("masternode", "CMasternodeMan::Add -- Adding new Masternode: addr=%s, %i now\n", mn.addr.ToString(), size() + 1);
     mapMasternodes[mn.vin.prevout] = mn;
     fMasternodesAdded = true;
+    mapRankingCache.Clear();
     return true;
 }
 
@@ -203,6 +198,7 @@ void CMasternodeMan::CheckAndRemove(CConnman& connman)
                 // and finally remove it from the list
                 mapMasternodes.erase(it++);
                 fMasternodesRemoved = true;
+                mapRankingCache.Clear();
             } else {
                 bool fAsk = (nAskForMnbRecovery > 0) &&
                             masternodeSync.IsSynced() &&
@@ -361,6 +357,7 @@ void CMasternodeMan::Clear()
     mWeAskedForMasternodeListEntry.clear();
     mapSeenMasternodeBroadcast.clear();
     mapSeenMasternodePing.clear();
+    mapRankingCache.Clear();
     nDsqCount = 0;
     nLastWatchdogVoteTime = 0;
 }
@@ -562,8 +559,9 @@ bool CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeight, bool f
     int nCountTenth = 0;
     arith_uint256 nHighest = 0;
     CMasternode* pBestMasternode = NULL;
+    masternode_ranking_ptr ranking = GetMasternodeRanking(blockHash);
     BOOST_FOREACH (PAIRTYPE(int, CMasternode*)& s, vecMasternodeLastPaid) {
-        arith_uint256 nScore = s.second->CalculateScore(blockHash);
+        arith_uint256 nScore = GetMasternodeScore(*s.second, ranking, blockHash);
         if (nScore > nHighest) {
             nHighest = nScore;
             pBestMasternode = s.second;
@@ -613,11 +611,12 @@ std::vector<CMasternode*> CMasternodeMan::GetWinnerList(int nBlockHeight, bool f
         return vecMasterNodeWinner;
     }
     std::vector<std::pair<arith_uint256, CMasternode*> > vecMasternodeScore;
+    masternode_ranking_ptr ranking = GetMasternodeRanking(blockHash);
 
     int nCountTenth = 0;
     BOOST_FOREACH (PAIRTYPE(int, CMasternode*)& s, vecMasternodeLastPaid) {
         if (nCountTenth < nRatioNetwork) {
-            arith_uint256 nScore = s.second->CalculateScore(blockHash);
+            arith_uint256 nScore = GetMasternodeScore(*s.second, ranking, blockHash);
             vecMasternodeScore.push_back(std::make_pair(nScore, s.second));
         } else {
             break;
@@ -727,27 +726,51 @@ masternode_info_t CMasternodeMan::FindRandomNotInVec(const std::vector<COutPoint
     return masternode_info_t();
 }
 
-bool CMasternodeMan::GetMasternodeScores(const uint256& nBlockHash, CMasternodeMan::score_pair_vec_t& vecMasternodeScoresRet, int nMinProtocol)
+CMasternodeMan::masternode_ranking_ptr CMasternodeMan::GetMasternodeRanking(const uint256& nBlockHash, int nMinProtocol)
 {
-    vecMasternodeScoresRet.clear();
-
-    if (!masternodeSync.IsMasternodeListSynced())
-        return false;
-
     AssertLockHeld(cs);
 
-    if (mapMasternodes.empty())
-        return false;
-
-    // calculate scores
-    for (auto& mnpair : mapMasternodes) {
-        if (mnpair.second.nProtocolVersion >= nMinProtocol) {
-            vecMasternodeScoresRet.push_back(std::make_pair(mnpair.second.CalculateScore(nBlockHash), &mnpair.second));
+    masternode_ranking_ptr ranking;
+    std::pair<uint256, int> key = std::make_pair(nBlockHash, nMinProtocol);
+    if (mapRankingCache.Get(key, ranking))
+        return ranking;
+
+    std::shared_ptr<masternode_ranking_t> rankingNew = std::make_shared<masternode_ranking_t>();
+    if (nMinProtocol > 0) {
+        // filter the ranking of all masternodes, so each block is hashed and sorted once
+        masternode_ranking_ptr rankingAll = GetMasternodeRanking(nBlockHash, 0);
+        for (const auto& scorePair : rankingAll->vecScores) {
+            CMasternode* pmn = Find(scorePair.second);
+            if (pmn && pmn->nProtocolVersion >= nMinProtocol) {
+                rankingNew->vecScores.push_back(scorePair);
+            }
         }
+    } else {
+        // calculate scores, one pass over the list
+        rankingNew->vecScores.reserve(mapMasternodes.size());
+        for (auto& mnpair : mapMasternodes) {
+            rankingNew->vecScores.push_back(std::make_pair(mnpair.second.CalculateScore(nBlockHash), mnpair.first));
+        }
+        // high to low, ties are broken by outpoint as the vin comparison did
+        sort(rankingNew->vecScores.rbegin(), rankingNew->vecScores.rend());
+    }
+
+    int nRank = 0;
+    for (const auto& scorePair : rankingNew->vecScores) {
+        rankingNew->mapRanks.insert(std::make_pair(scorePair.second, ++nRank));
     }
 
-    sort(vecMasternodeScoresRet.rbegin(), vecMasternodeScoresRet.rend(), CompareScoreMN());
-    return !vecMasternodeScoresRet.empty();
+    ranking = rankingNew;
+    mapRankingCache.Insert(key, ranking);
+    return ranking;
+}
+
+arith_uint256 CMasternodeMan::GetMasternodeScore(CMasternode& mn, const masternode_ranking_ptr& ranking, const uint256& nBlockHash)
+{
+    auto it = ranking->mapRanks.find(mn.vin.prevout);
+    if (it == ranking->mapRanks.end())
+        return mn.CalculateScore(nBlockHash);
+    return ranking->vecScores[it->second - 1].first;
 }
 
 bool CMasternodeMan::GetMasternodeRank(const COutPoint& outpoint, int& nRankRet, int nBlockHeight, int nMinProtocol)
@@ -766,20 +789,16 @@ bool CMasternodeMan::GetMasternodeRank(const COutPoint& outpoint, int& nRankRet,
 
     LOCK(cs);
 
-    score_pair_vec_t vecMasternodeScores;
-    if (!GetMasternodeScores(nBlockHash, vecMasternodeScores, nMinProtocol))
+    if (mapMasternodes.empty())
         return false;
 
-    int nRank = 0;
-    for (auto& scorePair : vecMasternodeScores) {
-        nRank++;
-        if (scorePair.second->vin.prevout == outpoint) {
-            nRankRet = nRank;
-            return true;
-        }
-    }
+    masternode_ranking_ptr ranking = GetMasternodeRanking(nBlockHash, nMinProtocol);
+    auto it = ranking->mapRanks.find(outpoint);
+    if (it == ranking->mapRanks.end())
+        return false;
 
-    return false;
+    nRankRet = it->second;
+    return true;
 }
 
 bool CMasternodeMan::GetMasternodeRanks(CMasternodeMan::rank_pair_vec_t& vecMasternodeRanksRet, int nBlockHeight, int nMinProtocol)
@@ -798,14 +817,18 @@ bool CMasternodeMan::GetMasternodeRanks(CMasternodeMan::rank_pair_vec_t& vecMast
 
     LOCK(cs);
 
-    score_pair_vec_t vecMasternodeScores;
-    if (!GetMasternodeScores(nBlockHash, vecMasternodeScores, nMinProtocol))
+    if (mapMasternodes.empty())
+        return false;
+
+    masternode_ranking_ptr ranking = GetMasternodeRanking(nBlockHash, nMinProtocol);
+    if (ranking->vecScores.empty())
         return false;
 
+    vecMasternodeRanksRet.reserve(ranking->vecScores.size());
     int nRank = 0;
-    for (auto& scorePair : vecMasternodeScores) {
+    for (const auto& scorePair : ranking->vecScores) {
         nRank++;
-        vecMasternodeRanksRet.push_back(std::make_pair(nRank, *(scorePair.second)));
+        vecMasternodeRanksRet.push_back(std::make_pair(nRank, *Find(scorePair.second)));
     }
 
     return true;
@@ -860,18 +883,10 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
 
         LogPrint("masternode", "MNANNOUNCE -- Masternode announce, masternode=%s\n", mnb.vin.prevout.ToStringShort());
 
-        int nDos = 0;
+        // signatures are recovered in batches off this thread, unless the verifier is not running
+        if (mnsigverifier.Push(pfrom, mnb)) return;
 
-        // use normal net
-        if (CheckMnbAndUpdateMasternodeList(pfrom, mnb, nDos, connman)) {
-            // use announced Masternode as a peer
-        } else if (nDos > 0) {
-            Misbehaving(pfrom->GetId(), nDos);
-        }
-
-        if (fMasternodesAdded) {
-            NotifyMasternodeUpdates(connman);
-        }
+        ProcessBroadcast(pfrom, mnb, connman);
     }
 
     else if (strCommand == NetMsgType::DSEG) { //Get Masternode list or specific entry
@@ -949,41 +964,68 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
 
         LogPrint("masternode", "MNPING -- Masternode ping, masternode=%s\n", mnp.vin.prevout.ToStringShort());
 
-        // Need LOCK2 here to ensure consistent locking order because the CheckAndUpdate call below locks cs_main
-        LOCK2(cs_main, cs);
-
-        if (mapSeenMasternodePing.count(nHash)) return; //seen
-        mapSeenMasternodePing.insert(std::make_pair(nHash, mnp));
+        {
+            // pings are relayed by every peer, only the first copy gets queued
+            LOCK(cs);
+            if (mapSeenMasternodePing.count(nHash)) return; //seen
+            mapSeenMasternodePing.insert(std::make_pair(nHash, mnp));
+        }
 
         LogPrint("masternode", "MNPING -- Masternode ping, masternode=%s new\n", mnp.vin.prevout.ToStringShort());
 
-        // see if we have this Masternode
-        CMasternode* pmn = Find(mnp.vin.prevout);
+        if (mnsigverifier.Push(pfrom, mnp)) return;
 
-        // if masternode uses sentinel ping instead of watchdog
-        // we shoud update nTimeLastWatchdogVote here if sentinel
-        // ping flag is actual
-        if (pmn && mnp.fSentinelIsCurrent)
-            UpdateWatchdogVoteTime(mnp.vin.prevout, mnp.sigTime);
+        ProcessPing(pfrom, mnp, connman);
+    }
+}
 
-        // too late, new MNANNOUNCE is required
-        if (pmn && pmn->IsNewStartRequired()) return;
+void CMasternodeMan::ProcessBroadcast(CNode* pfrom, const CMasternodeBroadcast& mnb, CConnman& connman)
+{
+    int nDos = 0;
 
-        int nDos = 0;
-        if (mnp.CheckAndUpdate(pmn, false, nDos/*, connman*/)) return;
+    // use normal net
+    if (CheckMnbAndUpdateMasternodeList(pfrom, mnb, nDos, connman)) {
+        // use announced Masternode as a peer
+    } else if (nDos > 0) {
+        Misbehaving(pfrom->GetId(), nDos);
+    }
 
-        if (nDos > 0) {
-            // if anything significant failed, mark that node
-            // Misbehaving(pfrom->GetId(), nDos);
-        } else if (pmn != NULL) {
-            // nothing significant failed, mn is a known one too
-            return;
-        }
+    if (fMasternodesAdded) {
+        NotifyMasternodeUpdates(connman);
+    }
+}
+
+void CMasternodeMan::ProcessPing(CNode* pfrom, CMasternodePing& mnp, CConnman& connman)
+{
+    // Need LOCK2 here to ensure consistent locking order because the CheckAndUpdate call below locks cs_main
+    LOCK2(cs_main, cs);
+
+    // see if we have this Masternode
+    CMasternode* pmn = Find(mnp.vin.prevout);
+
+    // if masternode uses sentinel ping instead of watchdog
+    // we shoud update nTimeLastWatchdogVote here if sentinel
+    // ping flag is actual
+    if (pmn && mnp.fSentinelIsCurrent)
+        UpdateWatchdogVoteTime(mnp.vin.prevout, mnp.sigTime);
 
-        // something significant is broken or mn is unknown,
-        // we might have to ask for a masternode entry once
-        AskForMN(pfrom, mnp.vin.prevout, connman);
+    // too late, new MNANNOUNCE is required
+    if (pmn && pmn->IsNewStartRequired()) return;
+
+    int nDos = 0;
+    if (mnp.CheckAndUpdate(pmn, false, nDos/*, connman*/)) return;
+
+    if (nDos > 0) {
+        // if anything significant failed, mark that node
+        // Misbehaving(pfrom->GetId(), nDos);
+    } else if (pmn != NULL) {
+        // nothing significant failed, mn is a known one too
+        return;
     }
+
+    // something significant is broken or mn is unknown,
+    // we might have to ask for a masternode entry once
+    AskForMN(pfrom, mnp.vin.prevout, connman);
 }
 
 // Verification of masternodes via unique direct requests.
@@ -1152,6 +1194,8 @@ void CMasternodeMan::UpdateMasternodeList(CMasternodeBroadcast mnb, CConnman& co
     } else {
         CMasternodeBroadcast mnbOld = mapSeenMasternodeBroadcast[CMasternodeBroadcast(*pmn).GetHash()].second;
         if (pmn->UpdateFromNewBroadcast(mnb, connman)) {
+            // protocol version may have changed
+            mapRankingCache.Clear();
             masternodeSync.BumpAssetLastTime("CMasternodeMan::UpdateMasternodeList - seen");
             mapSeenMasternodeBroadcast.erase(mnbOld.GetHash());
         }
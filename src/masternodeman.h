@@ -5,9 +5,12 @@
 #ifndef MASTERNODEMAN_H
 #define MASTERNODEMAN_H
 
+#include "cachemap.h"
 #include "masternode.h"
 #include "sync.h"
 
+#include <memory>
+
 using namespace std;
 
 class CMasternodeMan;
@@ -24,6 +27,14 @@ public:
     typedef std::pair<int, CMasternode> rank_pair_t;
     typedef std::vector<rank_pair_t> rank_pair_vec_t;
 
+    /// Masternodes sorted by score for one block hash, high to low
+    struct masternode_ranking_t {
+        std::vector<std::pair<arith_uint256, COutPoint> > vecScores;
+        /// 1-based rank of each outpoint in vecScores
+        std::map<COutPoint, int> mapRanks;
+    };
+    typedef std::shared_ptr<const masternode_ranking_t> masternode_ranking_ptr;
+
 
     // critical section to protect the inner data structures
     mutable CCriticalSection cs;
@@ -46,6 +57,8 @@ private:
     static const int MNB_RECOVERY_WAIT_SECONDS      = 60;
     static const int MNB_RECOVERY_RETRY_SECONDS     = 3 * 60 * 60;
 
+    static const int MAX_RANKING_CACHE_SIZE         = 16;
+
 
     // Keep track of current block height
     int nCachedBlockHeight;
@@ -75,13 +88,19 @@ private:
 
     std::vector<uint256> vecDirtyGovernanceObjectHashes;
 
+    /// Rankings by (block hash, min protocol), cleared whenever the list changes
+    CacheMap<std::pair<uint256, int>, masternode_ranking_ptr> mapRankingCache;
+
     int64_t nLastWatchdogVoteTime;
 
     friend class CMasternodeSync;
     /// Find an entry
     CMasternode* Find(const COutPoint& outpoint);
 
-    bool GetMasternodeScores(const uint256& nBlockHash, score_pair_vec_t& vecMasternodeScoresRet, int nMinProtocol = 0);
+    /// Score and sort the list once per block hash and protocol, later calls are served from the cache
+    masternode_ranking_ptr GetMasternodeRanking(const uint256& nBlockHash, int nMinProtocol = 0);
+    /// Score of a masternode from the cached ranking of all masternodes, computed if it is not ranked
+    arith_uint256 GetMasternodeScore(CMasternode& mn, const masternode_ranking_ptr& ranking, const uint256& nBlockHash);
 
 public:
     // Keep track of all broadcasts I've seen
@@ -119,11 +138,73 @@ public:
 
         READWRITE(mapSeenMasternodeBroadcast);
         READWRITE(mapSeenMasternodePing);
+        if (ser_action.ForRead()) {
+            mapRankingCache.Clear();
+        }
         if (ser_action.ForRead() && (strVersion != SERIALIZATION_VERSION_STRING)) {
             Clear();
         }
     }
 
+    /// Sections of the mncache.dat snapshot, see CSnapshotDB
+    enum {
+        SNAPSHOT_SECTION_STATE,
+        SNAPSHOT_SECTION_MASTERNODES,
+        SNAPSHOT_SECTION_SEEN_BROADCASTS,
+        SNAPSHOT_SECTION_SEEN_PINGS,
+        SNAPSHOT_SECTIONS
+    };
+
+    template <typename Stream>
+    void SerializeSection(Stream& s, int nSection)
+    {
+        LOCK(cs);
+        switch (nSection) {
+        case SNAPSHOT_SECTION_STATE:
+            s << SERIALIZATION_VERSION_STRING;
+            s << mAskedUsForMasternodeList << mWeAskedForMasternodeList << mWeAskedForMasternodeListEntry;
+            s << mMnbRecoveryRequests << mMnbRecoveryGoodReplies << nLastWatchdogVoteTime << nDsqCount;
+            break;
+        case SNAPSHOT_SECTION_MASTERNODES:
+            s << mapMasternodes;
+            break;
+        case SNAPSHOT_SECTION_SEEN_BROADCASTS:
+            s << mapSeenMasternodeBroadcast;
+            break;
+        case SNAPSHOT_SECTION_SEEN_PINGS:
+            s << mapSeenMasternodePing;
+            break;
+        }
+    }
+
+    template <typename Stream>
+    bool UnserializeSection(Stream& s, int nSection)
+    {
+        LOCK(cs);
+        switch (nSection) {
+        case SNAPSHOT_SECTION_STATE: {
+            std::string strVersion;
+            s >> strVersion;
+            if (strVersion != SERIALIZATION_VERSION_STRING)
+                return false;
+            s >> mAskedUsForMasternodeList >> mWeAskedForMasternodeList >> mWeAskedForMasternodeListEntry;
+            s >> mMnbRecoveryRequests >> mMnbRecoveryGoodReplies >> nLastWatchdogVoteTime >> nDsqCount;
+            break;
+        }
+        case SNAPSHOT_SECTION_MASTERNODES:
+            s >> mapMasternodes;
+            mapRankingCache.Clear();
+            break;
+        case SNAPSHOT_SECTION_SEEN_BROADCASTS:
+            s >> mapSeenMasternodeBroadcast;
+            break;
+        case SNAPSHOT_SECTION_SEEN_PINGS:
+            s >> mapSeenMasternodePing;
+            break;
+        }
+        return true;
+    }
+
     CMasternodeMan();
 
     /// Add an entry
@@ -192,6 +273,9 @@ public:
     std::pair<CAnonID, std::set<uint256> > PopScheduledMnbRequestConnection();
 
     void ProcessMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv, CConnman& connman);
+    /// Accept a masternode broadcast or ping received from pfrom, called by ProcessMessage or the signature verifier
+    void ProcessBroadcast(CNode* pfrom, const CMasternodeBroadcast& mnb, CConnman& connman);
+    void ProcessPing(CNode* pfrom, CMasternodePing& mnp, CConnman& connman);
     void ProcessMessage(CMnAnonNode* pfrom, std::string& strCommand, CDataStream& vRecv, CMasternodeMan* connman);
 
     void DoFullVerificationStep(CConnman& connman);
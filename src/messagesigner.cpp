@@ -6,9 +6,62 @@
 #include "hash.h"
 #include "validation.h" // For strMessageMagic
 #include "messagesigner.h"
+#include "random.h"
+#include "sync.h"
 #include "tinyformat.h"
 #include "utilstrencodings.h"
 
+#include <map>
+
+namespace
+{
+
+/**
+ * Public key recovery results, keyed by the hash of (message hash, signature).
+ * Masternode messages are relayed by every peer, and recovery is the expensive
+ * part of checking their signatures, so remember the recovered key id (or the
+ * failure to recover one) and compare ids on later checks.
+ */
+class CRecoveredKeyCache
+{
+private:
+    CCriticalSection cs;
+    std::map<uint256, CKeyID> mapKeyIDs;
+
+public:
+    static uint256 GetKey(const uint256& hash, const std::vector<unsigned char>& vchSig)
+    {
+        return Hash(hash.begin(), hash.end(), vchSig.begin(), vchSig.end());
+    }
+
+    bool Get(const uint256& key, CKeyID& keyIDRet)
+    {
+        LOCK(cs);
+        std::map<uint256, CKeyID>::const_iterator it = mapKeyIDs.find(key);
+        if (it == mapKeyIDs.end())
+            return false;
+        keyIDRet = it->second;
+        return true;
+    }
+
+    void Set(const uint256& key, const CKeyID& keyID)
+    {
+        LOCK(cs);
+        while (mapKeyIDs.size() >= MAX_RECOVERED_KEY_CACHE_SIZE) {
+            // Evict a random entry, so that peers can't predict which ones survive
+            std::map<uint256, CKeyID>::iterator it = mapKeyIDs.lower_bound(GetRandHash());
+            if (it == mapKeyIDs.end())
+                it = mapKeyIDs.begin();
+            mapKeyIDs.erase(it);
+        }
+        mapKeyIDs[key] = keyID;
+    }
+};
+
+CRecoveredKeyCache recoveredKeyCache;
+
+}
+
 bool CMessageSigner::GetKeysFromSecret(const std::string strSecret, CKey& keyRet, CPubKey& pubkeyRet)
 {
     CBitcoinSecret vchSecret;
@@ -30,13 +83,18 @@ bool CMessageSigner::SignMessage(const std::string strMessage, std::vector<unsig
     return CHashSigner::SignHash(ss.GetHash(), key, vchSigRet);
 }
 
-bool CMessageSigner::VerifyMessage(const CPubKey pubkey, const std::vector<unsigned char>& vchSig, const std::string strMessage, std::string& strErrorRet)
+uint256 CMessageSigner::GetMessageHash(const std::string& strMessage)
 {
     CHashWriter ss(SER_GETHASH, 0);
     ss << strMessageMagic;
     ss << strMessage;
 
-    return CHashSigner::VerifyHash(ss.GetHash(), pubkey, vchSig, strErrorRet);
+    return ss.GetHash();
+}
+
+bool CMessageSigner::VerifyMessage(const CPubKey pubkey, const std::vector<unsigned char>& vchSig, const std::string strMessage, std::string& strErrorRet)
+{
+    return CHashSigner::VerifyHash(GetMessageHash(strMessage), pubkey, vchSig, strErrorRet);
 }
 
 bool CHashSigner::SignHash(const uint256& hash, const CKey key, std::vector<unsigned char>& vchSigRet)
@@ -46,18 +104,31 @@ bool CHashSigner::SignHash(const uint256& hash, const CKey key, std::vector<unsi
 
 bool CHashSigner::VerifyHash(const uint256& hash, const CPubKey pubkey, const std::vector<unsigned char>& vchSig, std::string& strErrorRet)
 {
-    CPubKey pubkeyFromSig;
-    if(!pubkeyFromSig.RecoverCompact(hash, vchSig)) {
+    CKeyID keyIDFromSig;
+    if(!RecoverKeyID(hash, vchSig, keyIDFromSig)) {
         strErrorRet = "Error recovering public key.";
         return false;
     }
 
-    if(pubkeyFromSig.GetID() != pubkey.GetID()) {
+    if(keyIDFromSig != pubkey.GetID()) {
         strErrorRet = strprintf("Keys don't match: pubkey=%s, pubkeyFromSig=%s, hash=%s, vchSig=%s",
-                    pubkey.GetID().ToString(), pubkeyFromSig.GetID().ToString(), hash.ToString(),
-                    EncodeBase64(&vchSig[0], vchSig.size()));
+                    pubkey.GetID().ToString(), keyIDFromSig.ToString(), hash.ToString(),
+                    EncodeBase64(vchSig.data(), vchSig.size()));
         return false;
     }
 
     return true;
 }
+
+bool CHashSigner::RecoverKeyID(const uint256& hash, const std::vector<unsigned char>& vchSig, CKeyID& keyIDRet)
+{
+    uint256 key = CRecoveredKeyCache::GetKey(hash, vchSig);
+    if(!recoveredKeyCache.Get(key, keyIDRet)) {
+        // A null id marks signatures no key could be recovered from
+        CPubKey pubkeyFromSig;
+        keyIDRet = pubkeyFromSig.RecoverCompact(hash, vchSig) ? pubkeyFromSig.GetID() : CKeyID();
+        recoveredKeyCache.Set(key, keyIDRet);
+    }
+
+    return !keyIDRet.IsNull();
+}
@@ -7,6 +7,9 @@
 
 #include "key.h"
 
+/** Maximum number of (hash, signature) pairs whose recovered key id is remembered */
+static const size_t MAX_RECOVERED_KEY_CACHE_SIZE = 100000;
+
 /** Helper class for signing messages and checking their signatures
  */
 class CMessageSigner
@@ -16,6 +19,8 @@ public:
     static bool GetKeysFromSecret(const std::string strSecret, CKey& keyRet, CPubKey& pubkeyRet);
     /// Sign the message, returns true if successful
     static bool SignMessage(const std::string strMessage, std::vector<unsigned char>& vchSigRet, const CKey key);
+    /// Hash the message the way SignMessage/VerifyMessage do
+    static uint256 GetMessageHash(const std::string& strMessage);
     /// Verify the message signature, returns true if succcessful
     static bool VerifyMessage(const CPubKey pubkey, const std::vector<unsigned char>& vchSig, const std::string strMessage, std::string& strErrorRet);
 };
@@ -29,6 +34,9 @@ public:
     static bool SignHash(const uint256& hash, const CKey key, std::vector<unsigned char>& vchSigRet);
     /// Verify the hash signature, returns true if succcessful
     static bool VerifyHash(const uint256& hash, const CPubKey pubkey, const std::vector<unsigned char>& vchSig, std::string& strErrorRet);
+    /// Recover the id of the key that produced the signature, returns true if successful.
+    /// Results are cached by hash and signature, so a relayed duplicate is recovered only once.
+    static bool RecoverKeyID(const uint256& hash, const std::vector<unsigned char>& vchSig, CKeyID& keyIDRet);
 };
 
 #endif
@@ -16,6 +16,7 @@
 #include "consensus/consensus.h"
 #include "crypto/common.h"
 #include "hash.h"
+#include "primitives/block.h"
 #include "primitives/transaction.h"
 #include "netbase.h"
 #include "scheduler.h"
@@ -34,6 +35,10 @@
 #include <fcntl.h>
 #endif
 
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
 #ifdef USE_UPNP
 #include <miniupnpc/miniupnpc.h>
 #include <miniupnpc/miniwget.h>
@@ -47,6 +52,9 @@
 // Dump addresses to peers.dat and banlist.dat every 15 minutes (900s)
 #define DUMP_ADDRESSES_INTERVAL 900
 
+// Maximum number of socket events taken from epoll_wait at once
+#define MAX_EPOLL_EVENTS 1024
+
 // We add a random period time (0 to 1 seconds) to feeler connections to prevent synchronization.
 #define FEELER_SLEEP_WINDOW 1
 
@@ -405,6 +413,7 @@ CNode* CConnman::ConnectNode(CAddress addrConnect, const char* pszDest)
         GetNodeSignals().InitializeNode(pnode, *this);
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
+        RegisterSocketEvents(pnode);
         return pnode;
     } else if (!proxyConnectionFailed) {
         // If connecting to the node failed, and failure is not caused by a problem connecting to
@@ -750,6 +759,55 @@ int CNetMessage::readHeader(const char* pch, unsigned int nBytes)
     return nCopy;
 }
 
+bool CPreparedMessage::TryStart()
+{
+    int nExpected = PENDING;
+    return nState.compare_exchange_strong(nExpected, RUNNING);
+}
+
+void CPreparedMessage::Run(CNetMessage& msg, int nVersion)
+{
+    msg.SetVersion(nVersion);
+    CDataStream& vRecv = msg.vRecv;
+    nMessageSize = msg.hdr.nMessageSize;
+    hashChecksum = Hash(vRecv.begin(), vRecv.begin() + nMessageSize);
+    if (memcmp(hashChecksum.begin(), msg.hdr.pchChecksum, CMessageHeader::CHECKSUM_SIZE) == 0) {
+        // Transaction and block hashes are computed here too: CTransaction
+        // caches its hash on construction
+        try {
+            std::string strCommand = msg.hdr.GetCommand();
+            if (strCommand == NetMsgType::TX) {
+                CTransactionRef ptx;
+                vRecv >> ptx;
+                tx = ptx;
+            } else if (strCommand == NetMsgType::BLOCK) {
+                std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+                vRecv >> *pblock;
+                hashBlock = pblock->GetHash();
+                block = pblock;
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        nState = DONE;
+    }
+    cond.notify_all();
+}
+
+void CPreparedMessage::Finish(CNetMessage& msg, int nVersion)
+{
+    if (TryStart()) {
+        Run(msg, nVersion);
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    cond.wait(lock, [this] { return nState == DONE; });
+}
+
 int CNetMessage::readData(const char* pch, unsigned int nBytes)
 {
     unsigned int nRemaining = hdr.nMessageSize - nDataPos;
@@ -1019,7 +1077,7 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket)
         return;
     }
 
-    if (!IsSelectableSocket(hSocket)) {
+    if (!IsUsableSocket(hSocket)) {
         LogPrintf("connection from %s dropped: non-selectable socket\n", addr.ToString());
         CloseSocket(hSocket);
         return;
@@ -1066,72 +1124,225 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket)
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
+        RegisterSocketEvents(pnode);
     }
 }
 
-void CConnman::ThreadSocketHandler()
+void CConnman::DisconnectNodes()
 {
-    unsigned int nPrevNodeCount = 0;
-    while (!interruptNet) {
-        //
-        // Disconnect nodes
-        //
-        {
-            LOCK(cs_vNodes);
-            // Disconnect unused nodes
-            std::vector<CNode*> vNodesCopy = vNodes;
-            for (CNode* pnode : vNodesCopy) {
-                if (pnode->fDisconnect) {
+    {
+        LOCK(cs_vNodes);
+        // Disconnect unused nodes
+        std::vector<CNode*> vNodesCopy = vNodes;
+        for (CNode* pnode : vNodesCopy) {
+            if (pnode->fDisconnect) {
 
-                    // remove from vNodes
-                    vNodes.erase(remove(vNodes.begin(), vNodes.end(), pnode), vNodes.end());
+                // remove from vNodes
+                vNodes.erase(remove(vNodes.begin(), vNodes.end(), pnode), vNodes.end());
 
-                    // release outbound grant (if any)
-                    pnode->grantOutbound.Release();
-                    pnode->grantMasternodeOutbound.Release();
+                // release outbound grant (if any)
+                pnode->grantOutbound.Release();
+                pnode->grantMasternodeOutbound.Release();
 
-                    // close socket and cleanup
-                    pnode->CloseSocketDisconnect();
+                // close socket and cleanup
+                UnregisterSocketEvents(pnode);
+                pnode->CloseSocketDisconnect();
 
-                    // hold in disconnected pool until all refs are released
-                    pnode->Release();
-                    vNodesDisconnected.push_back(pnode);
-                }
+                // hold in disconnected pool until all refs are released
+                pnode->Release();
+                vNodesDisconnected.push_back(pnode);
             }
         }
-        {
-            // Delete disconnected nodes
-            std::list<CNode*> vNodesDisconnectedCopy = vNodesDisconnected;
-            for (CNode* pnode : vNodesDisconnectedCopy) {
-                // wait until threads are done using it
-                if (pnode->GetRefCount() <= 0) {
-                    bool fDelete = false;
-                    {
-                        TRY_LOCK(pnode->cs_inventory, lockInv);
-                        if (lockInv) {
-                            TRY_LOCK(pnode->cs_vSend, lockSend);
-                            if (lockSend) {
-                                fDelete = true;
-                            }
+    }
+    {
+        // Delete disconnected nodes
+        std::list<CNode*> vNodesDisconnectedCopy = vNodesDisconnected;
+        for (CNode* pnode : vNodesDisconnectedCopy) {
+            // wait until threads are done using it
+            if (pnode->GetRefCount() <= 0) {
+                bool fDelete = false;
+                {
+                    TRY_LOCK(pnode->cs_inventory, lockInv);
+                    if (lockInv) {
+                        TRY_LOCK(pnode->cs_vSend, lockSend);
+                        if (lockSend) {
+                            fDelete = true;
                         }
                     }
-                    if (fDelete) {
-                        vNodesDisconnected.remove(pnode);
-                        DeleteNode(pnode);
-                    }
                 }
+                if (fDelete) {
+                    vNodesDisconnected.remove(pnode);
+                    DeleteNode(pnode);
+                }
+            }
+        }
+    }
+}
+
+void CConnman::NotifyNumConnectionsChanged()
+{
+    size_t vNodesSize;
+    {
+        LOCK(cs_vNodes);
+        vNodesSize = vNodes.size();
+    }
+    if (vNodesSize != nPrevNodeCount) {
+        nPrevNodeCount = vNodesSize;
+        if (clientInterface)
+            clientInterface->NotifyNumConnectionsChanged(nPrevNodeCount);
+    }
+}
+
+bool CConnman::SocketRecvData(CNode* pnode)
+{
+    // typical socket buffer is 8K-64K
+    char pchBuf[0x10000];
+    int nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+    if (nBytes > 0) {
+        bool notify = false;
+        if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
+            pnode->CloseSocketDisconnect();
+        RecordBytesRecv(nBytes);
+        if (notify) {
+            size_t nSizeAdded = 0;
+            auto it(pnode->vRecvMsg.begin());
+            for (; it != pnode->vRecvMsg.end(); ++it) {
+                if (!it->complete())
+                    break;
+                // vRecv may be consumed by a preparation thread before the message is taken
+                nSizeAdded += it->hdr.nMessageSize + CMessageHeader::HEADER_SIZE;
+                QueueMessagePreparation(pnode, *it);
+            }
+            {
+                LOCK(pnode->cs_vProcessMsg);
+                pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
+                pnode->nProcessQueueSize += nSizeAdded;
+                pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
             }
+            WakeMessageHandler();
         }
-        size_t vNodesSize;
+        // a full buffer means the socket may hold more
+        return nBytes == (int)sizeof(pchBuf) && pnode->hSocket != INVALID_SOCKET;
+    } else if (nBytes == 0) {
+        // socket closed gracefully
+        if (!pnode->fDisconnect)
+            LogPrint("net", "socket closed\n");
+        pnode->CloseSocketDisconnect();
+    } else if (nBytes < 0) {
+        // error
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS) {
+            if (!pnode->fDisconnect)
+                LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
+            pnode->CloseSocketDisconnect();
+        }
+    }
+    return false;
+}
+
+void CConnman::QueueMessagePreparation(CNode* pnode, CNetMessage& msg)
+{
+    // The receive version is final once the handshake is done, before that
+    // there is nothing worth preparing anyway
+    if (threadsMessagePreparation.empty() || !pnode->fSuccessfullyConnected)
+        return;
+    std::string strCommand = msg.hdr.GetCommand();
+    if (strCommand != NetMsgType::TX && strCommand != NetMsgType::BLOCK)
+        return;
+
+    msg.prepared = std::make_shared<CPreparedMessage>();
+    pnode->AddRef();
+    {
+        std::lock_guard<std::mutex> lock(mutexMsgPrepare);
+        queueMsgPrepare.push_back(MessagePreparation{pnode, &msg, msg.prepared, pnode->GetRecvVersion()});
+    }
+    condMsgPrepare.notify_one();
+}
+
+void CConnman::ThreadMessagePreparation()
+{
+    while (true) {
+        MessagePreparation job;
         {
-            LOCK(cs_vNodes);
-            vNodesSize = vNodes.size();
+            std::unique_lock<std::mutex> lock(mutexMsgPrepare);
+            condMsgPrepare.wait(lock, [this] { return flagInterruptMsgPrepare || !queueMsgPrepare.empty(); });
+            if (flagInterruptMsgPrepare)
+                return;
+            job = queueMsgPrepare.front();
+            queueMsgPrepare.pop_front();
         }
-        if (vNodesSize != nPrevNodeCount) {
-            nPrevNodeCount = vNodesSize;
-            if (clientInterface)
-                clientInterface->NotifyNumConnectionsChanged(nPrevNodeCount);
+        // The message handler may have taken the message over already, then
+        // it may also be gone
+        if (job.prepared->TryStart())
+            job.prepared->Run(*job.pmsg, job.nVersion);
+        job.pnode->Release();
+    }
+}
+
+void CConnman::InactivityCheck(CNode* pnode)
+{
+    int64_t nTime = GetSystemTimeInSeconds();
+    if (nTime - pnode->nTimeConnected > 60) {
+        if (pnode->nLastRecv == 0 || pnode->nLastSend == 0) {
+            LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
+            pnode->fDisconnect = true;
+        } else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL) {
+            LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
+            pnode->fDisconnect = true;
+        } else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90 * 60)) {
+            LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
+            pnode->fDisconnect = true;
+        } else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros()) {
+            LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
+            pnode->fDisconnect = true;
         }
+    }
+}
+
+void CConnman::RegisterSocketEvents(CNode* pnode)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if (epollfd == -1 || pnode->hSocket == INVALID_SOCKET)
+        return;
+
+    // Registered once for everything, edge triggered: the socket handler only
+    // hears about a socket when its state changes and tracks the rest itself
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.ptr = pnode;
+    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, pnode->hSocket, &event) == SOCKET_ERROR) {
+        LogPrintf("epoll_ctl failed for peer=%d: %s\n", pnode->id, NetworkErrorString(WSAGetLastError()));
+        pnode->fDisconnect = true;
+    }
+#endif
+}
+
+void CConnman::UnregisterSocketEvents(CNode* pnode)
+{
+    if (setNodesReceivable.erase(pnode))
+        pnode->Release();
+#ifdef HAVE_SYS_EPOLL_H
+    if (epollfd != -1 && pnode->hSocket != INVALID_SOCKET)
+        epoll_ctl(epollfd, EPOLL_CTL_DEL, pnode->hSocket, NULL);
+#endif
+}
+
+void CConnman::ThreadSocketHandler()
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if (socketEventsMode == SOCKETEVENTS_EPOLL) {
+        SocketHandlerEpoll();
+        return;
+    }
+#endif
+    SocketHandlerSelect();
+}
+
+void CConnman::SocketHandlerSelect()
+{
+    while (!interruptNet) {
+        DisconnectNodes();
+        NotifyNumConnectionsChanged();
 
         //
         // Find which sockets have data to receive
@@ -1229,50 +1440,8 @@ void CConnman::ThreadSocketHandler()
             //
             if (pnode->hSocket == INVALID_SOCKET)
                 continue;
-            if (FD_ISSET(pnode->hSocket, &fdsetRecv) || FD_ISSET(pnode->hSocket, &fdsetError)) {
-                {
-                    {
-                        // typical socket buffer is 8K-64K
-                        char pchBuf[0x10000];
-                        int nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
-                        if (nBytes > 0) {
-                            bool notify = false;
-                            if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
-                                pnode->CloseSocketDisconnect();
-                            RecordBytesRecv(nBytes);
-                            if (notify) {
-                                size_t nSizeAdded = 0;
-                                auto it(pnode->vRecvMsg.begin());
-                                for (; it != pnode->vRecvMsg.end(); ++it) {
-                                    if (!it->complete())
-                                        break;
-                                    nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
-                                }
-                                {
-                                    LOCK(pnode->cs_vProcessMsg);
-                                    pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
-                                    pnode->nProcessQueueSize += nSizeAdded;
-                                    pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
-                                }
-                                WakeMessageHandler();
-                            }
-                        } else if (nBytes == 0) {
-                            // socket closed gracefully
-                            if (!pnode->fDisconnect)
-                                LogPrint("net", "socket closed\n");
-                            pnode->CloseSocketDisconnect();
-                        } else if (nBytes < 0) {
-                            // error
-                            int nErr = WSAGetLastError();
-                            if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS) {
-                                if (!pnode->fDisconnect)
-                                    LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
-                                pnode->CloseSocketDisconnect();
-                            }
-                        }
-                    }
-                }
-            }
+            if (FD_ISSET(pnode->hSocket, &fdsetRecv) || FD_ISSET(pnode->hSocket, &fdsetError))
+                SocketRecvData(pnode);
 
             //
             // Send
@@ -1290,26 +1459,127 @@ void CConnman::ThreadSocketHandler()
             //
             // Inactivity checking
             //
-            int64_t nTime = GetSystemTimeInSeconds();
-            if (nTime - pnode->nTimeConnected > 60) {
-                if (pnode->nLastRecv == 0 || pnode->nLastSend == 0) {
-                    LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
-                    pnode->fDisconnect = true;
-                } else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL) {
-                    LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
-                    pnode->fDisconnect = true;
-                } else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90 * 60)) {
-                    LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
-                    pnode->fDisconnect = true;
-                } else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros()) {
-                    LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
-                    pnode->fDisconnect = true;
+            InactivityCheck(pnode);
+        }
+        ReleaseNodeVector(vNodesCopy);
+    }
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+void CConnman::SocketHandlerEpoll()
+{
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    int64_t nLastSweep = 0;
+    int nTimeout = 50; // frequency to check paused nodes and disconnects
+
+    while (!interruptNet) {
+        DisconnectNodes();
+        NotifyNumConnectionsChanged();
+
+        int nEvents = epoll_wait(epollfd, events, MAX_EPOLL_EVENTS, nTimeout);
+        if (interruptNet)
+            return;
+
+        if (nEvents == SOCKET_ERROR) {
+            int nErr = WSAGetLastError();
+            if (nErr != WSAEINTR) {
+                LogPrintf("socket epoll_wait error %s\n", NetworkErrorString(nErr));
+                if (!interruptNet.sleep_for(std::chrono::milliseconds(50)))
+                    return;
+            }
+            nEvents = 0;
+        }
+
+        for (int i = 0; i < nEvents; i++) {
+            //
+            // Accept new connections
+            //
+            const ListenSocket* pListenSocket = nullptr;
+            for (const ListenSocket& hListenSocket : vhListenSocket) {
+                if (&hListenSocket == events[i].data.ptr)
+                    pListenSocket = &hListenSocket;
+            }
+            if (pListenSocket) {
+                AcceptConnection(*pListenSocket);
+                continue;
+            }
+
+            // Nodes are only removed from vNodes on this thread, after
+            // unregistering them, so the pointer is still valid
+            CNode* pnode = static_cast<CNode*>(events[i].data.ptr);
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP)) {
+                if (setNodesReceivable.insert(pnode).second)
+                    pnode->AddRef();
+            }
+
+            //
+            // Send
+            //
+            if ((events[i].events & EPOLLOUT) && pnode->hSocket != INVALID_SOCKET) {
+                LOCK(pnode->cs_vSend);
+                if (!pnode->vSendMsg.empty()) {
+                    size_t nBytes = SocketSendData(pnode);
+                    if (nBytes) {
+                        RecordBytesSent(nBytes);
+                    }
                 }
             }
         }
-        ReleaseNodeVector(vNodesCopy);
+
+        //
+        // Receive
+        //
+        // Same policy as with select(): drain pending sends first and leave
+        // paused nodes alone. Skipped nodes stay receivable since no new edge
+        // is coming for the data they already have.
+        nTimeout = 50;
+        std::vector<CNode*> vNodesReceivable(setNodesReceivable.begin(), setNodesReceivable.end());
+        for (CNode* pnode : vNodesReceivable) {
+            if (interruptNet)
+                return;
+            if (pnode->fPauseRecv)
+                continue;
+            {
+                LOCK(pnode->cs_vSend);
+                if (!pnode->vSendMsg.empty())
+                    continue;
+            }
+            if (pnode->hSocket != INVALID_SOCKET && SocketRecvData(pnode)) {
+                // one read per node per round keeps busy peers from starving the others
+                nTimeout = 0;
+            } else {
+                setNodesReceivable.erase(pnode);
+                pnode->Release();
+            }
+        }
+
+        //
+        // Inactivity checking
+        //
+        int64_t nNow = GetTimeMillis();
+        if (nNow - nLastSweep >= 1000) {
+            nLastSweep = nNow;
+            std::vector<CNode*> vNodesCopy = CopyNodeVector();
+            for (CNode* pnode : vNodesCopy) {
+                if (pnode->hSocket == INVALID_SOCKET)
+                    continue;
+                // Safety net, pending data is normally sent on the EPOLLOUT edge
+                {
+                    LOCK(pnode->cs_vSend);
+                    if (!pnode->vSendMsg.empty()) {
+                        size_t nBytes = SocketSendData(pnode);
+                        if (nBytes) {
+                            RecordBytesSent(nBytes);
+                        }
+                    }
+                }
+                InactivityCheck(pnode);
+            }
+            ReleaseNodeVector(vNodesCopy);
+        }
     }
 }
+#endif
 
 void CConnman::WakeMessageHandler()
 {
@@ -1847,7 +2117,7 @@ bool CConnman::BindListenPort(const CService& addrBind, std::string& strError, b
         LogPrintf("%s\n", strError);
         return false;
     }
-    if (!IsSelectableSocket(hListenSocket)) {
+    if (!IsUsableSocket(hListenSocket)) {
         strError = "Error: Couldn't create a listenable socket for incoming connections";
         LogPrintf("%s\n", strError);
         return false;
@@ -1999,6 +2269,10 @@ CConnman::CConnman()
     nBestHeight = 0;
     clientInterface = NULL;
     flagInterruptMsgProc = false;
+    flagInterruptMsgPrepare = false;
+    nPrevNodeCount = 0;
+    socketEventsMode = SOCKETEVENTS_SELECT;
+    epollfd = -1;
 
     privkey = EC_KEY_new_by_curve_name(NID_secp256k1);
     EC_KEY_generate_key(privkey);
@@ -2090,6 +2364,34 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
         GetNodeSignals().InitializeNode(pnodeLocalHost, *this);
     }
 
+    socketEventsMode = connOptions.socketEventsMode;
+#ifdef HAVE_SYS_EPOLL_H
+    if (socketEventsMode == SOCKETEVENTS_EPOLL) {
+        epollfd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollfd == -1) {
+            LogPrintf("epoll_create1 failed: %s, falling back to select()\n", NetworkErrorString(WSAGetLastError()));
+            socketEventsMode = SOCKETEVENTS_SELECT;
+        }
+        // Listen sockets are level triggered, AcceptConnection takes one connection at a time
+        for (ListenSocket& hListenSocket : vhListenSocket) {
+            if (epollfd == -1)
+                break;
+            struct epoll_event event;
+            event.events = EPOLLIN;
+            event.data.ptr = &hListenSocket;
+            if (epoll_ctl(epollfd, EPOLL_CTL_ADD, hListenSocket.socket, &event) == SOCKET_ERROR) {
+                LogPrintf("epoll_ctl failed for listen socket: %s, falling back to select()\n", NetworkErrorString(WSAGetLastError()));
+                close(epollfd);
+                epollfd = -1;
+                socketEventsMode = SOCKETEVENTS_SELECT;
+            }
+        }
+    }
+#endif
+    // Connections past FD_SETSIZE are only accepted when select() is not used
+    fSelectableSocketsOnly = socketEventsMode == SOCKETEVENTS_SELECT;
+    LogPrintf("Using %s for socket events\n", socketEventsMode == SOCKETEVENTS_EPOLL ? "epoll" : "select");
+
     //
     // Start threads
     //
@@ -2102,6 +2404,14 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
         fMsgProcWake = false;
     }
 
+    // Deserialize transactions and blocks ahead of the message handler
+    {
+        std::unique_lock<std::mutex> lock(mutexMsgPrepare);
+        flagInterruptMsgPrepare = false;
+    }
+    for (int i = 0; i < connOptions.nMessagePrepareThreads; i++)
+        threadsMessagePreparation.emplace_back(&TraceThread<std::function<void()> >, "msgprep", std::function<void()>(std::bind(&CConnman::ThreadMessagePreparation, this)));
+
     // Send and receive from sockets, accept connections
     threadSocketHandler = std::thread(&TraceThread<std::function<void()> >, "net", std::function<void()>(std::bind(&CConnman::ThreadSocketHandler, this)));
 
@@ -2156,6 +2466,12 @@ void CConnman::Interrupt()
     }
     condMsgProc.notify_all();
 
+    {
+        std::lock_guard<std::mutex> lock(mutexMsgPrepare);
+        flagInterruptMsgPrepare = true;
+    }
+    condMsgPrepare.notify_all();
+
     interruptNet();
     InterruptSocks5(true);
 
@@ -2176,6 +2492,12 @@ void CConnman::Stop()
         threadDNSAddressSeed.join();
     if (threadSocketHandler.joinable())
         threadSocketHandler.join();
+    for (std::thread& thread : threadsMessagePreparation)
+        thread.join();
+    threadsMessagePreparation.clear();
+    for (const MessagePreparation& job : queueMsgPrepare)
+        job.pnode->Release();
+    queueMsgPrepare.clear();
 
     if (semMasternodeOutbound)
         for (int i = 0; i < MAX_OUTBOUND_MASTERNODE_CONNECTIONS; i++)
@@ -2194,6 +2516,15 @@ void CConnman::Stop()
         if (hListenSocket.socket != INVALID_SOCKET)
             if (!CloseSocket(hListenSocket.socket))
                 LogPrintf("CloseSocket(hListenSocket) failed with error %s\n", NetworkErrorString(WSAGetLastError()));
+    for (CNode* pnode : setNodesReceivable)
+        pnode->Release();
+    setNodesReceivable.clear();
+#ifdef HAVE_SYS_EPOLL_H
+    if (epollfd != -1) {
+        close(epollfd);
+        epollfd = -1;
+    }
+#endif
 
     // clean up some globals (to help leak detection)
     for (CNode* pnode : vNodes) {
@@ -2594,6 +2925,8 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     pfilter = new CBloomFilter();
     nLastBlockTime = 0;
     nLastTXTime = 0;
+    nGetTxsBudget = MAX_GETTXS_BURST;
+    nGetTxsBudgetTime = GetTimeMillis();
     nPingNonceSent = 0;
     nPingUsecStart = 0;
     nPingUsecTime = 0;
@@ -24,6 +24,9 @@
 
 #include <atomic>
 #include <deque>
+#include <exception>
+#include <mutex>
+#include <set>
 #include <stdint.h>
 #include <thread>
 #include <memory>
@@ -40,6 +43,9 @@
 #include <boost/signals2/signal.hpp>
 
 class CAddrMan;
+class CBlock;
+class CNetMessage;
+class CPreparedMessage;
 class CScheduler;
 class CNode;
 
@@ -58,6 +64,12 @@ static const int WARNING_INTERVAL = 10 * 60;
 static const int FEELER_INTERVAL = 120;
 /** The maximum number of entries in an 'inv' protocol message */
 static const unsigned int MAX_INV_SZ = 50000;
+/** Bytes of transactions a peer may fetch with 'gettxs' per second */
+static const int64_t GETTXS_BYTES_PER_SECOND = 1000000;
+/** Bytes of transactions a peer may fetch with 'gettxs' at once after idling */
+static const int64_t MAX_GETTXS_BURST = 8 * GETTXS_BYTES_PER_SECOND;
+/** Bytes of budget every id looked up for 'gettxs' costs at least, found or not */
+static const int64_t GETTXS_MIN_TX_SIZE = 100;
 /** The maximum number of new addresses to accumulate before announcing. */
 static const unsigned int MAX_ADDR_TO_SEND = 1000;
 /** Maximum length of incoming protocol messages (no message over 3 MiB is currently acceptable). */
@@ -93,6 +105,22 @@ static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
 
+/** Default number of threads deserializing transactions and blocks ahead of ProcessMessages */
+static const int DEFAULT_MSG_PREPARE_THREADS = 2;
+/** Maximum number of message preparation threads */
+static const int MAX_MSG_PREPARE_THREADS = 8;
+
+/** How the socket handler waits for socket events (-socketevents) */
+enum SocketEventsMode {
+    SOCKETEVENTS_SELECT = 0,
+    SOCKETEVENTS_EPOLL = 1,
+};
+#ifdef HAVE_SYS_EPOLL_H
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SOCKETEVENTS_EPOLL;
+#else
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SOCKETEVENTS_SELECT;
+#endif
+
 static const ServiceFlags REQUIRED_SERVICES = NODE_NETWORK;
 
 // NOTE: When adjusting this, update rpcnet:setban's help ("24h")
@@ -132,6 +160,8 @@ public:
         CClientUIInterface* uiInterface = nullptr;
         unsigned int nSendBufferMaxSize = 0;
         unsigned int nReceiveFloodSize = 0;
+        SocketEventsMode socketEventsMode = SOCKETEVENTS_SELECT;
+        int nMessagePrepareThreads = 0;
     };
     CConnman();
     ~CConnman();
@@ -416,6 +446,18 @@ private:
     void ThreadMessageHandler();
     void AcceptConnection(const ListenSocket& hListenSocket);
     void ThreadSocketHandler();
+    void DisconnectNodes();
+    void NotifyNumConnectionsChanged();
+    void SocketHandlerSelect();
+#ifdef HAVE_SYS_EPOLL_H
+    void SocketHandlerEpoll();
+#endif
+    void RegisterSocketEvents(CNode* pnode);
+    void UnregisterSocketEvents(CNode* pnode);
+    bool SocketRecvData(CNode* pnode);
+    void InactivityCheck(CNode* pnode);
+    void QueueMessagePreparation(CNode* pnode, CNetMessage& msg);
+    void ThreadMessagePreparation();
     void ThreadDNSAddressSeed();
     void ThreadMnbRequestConnections();
 
@@ -491,6 +533,17 @@ private:
     std::vector<CNode*> vNodes;
     std::list<CNode*> vNodesDisconnected;
     mutable CCriticalSection cs_vNodes;
+    unsigned int nPrevNodeCount;
+
+    SocketEventsMode socketEventsMode;
+    /** epoll instance all node and listen sockets are registered with, -1 when select() is used */
+    int epollfd;
+    /**
+     * Nodes that may have unread data. Edge triggered epoll only reports new
+     * data once, so nodes stay here (holding a reference) until a read comes
+     * back short, even while their receive is paused. Socket handler thread only.
+     */
+    std::set<CNode*> setNodesReceivable;
     std::atomic<NodeId> nLastNodeId;
 
     /** Services this instance offers */
@@ -514,6 +567,19 @@ private:
     std::mutex mutexMsgProc;
     std::atomic<bool> flagInterruptMsgProc;
 
+    struct MessagePreparation {
+        CNode* pnode;
+        CNetMessage* pmsg;
+        std::shared_ptr<CPreparedMessage> prepared;
+        int nVersion;
+    };
+    /** Messages waiting for a preparation thread, each holding a reference to its node */
+    std::deque<MessagePreparation> queueMsgPrepare;
+    std::condition_variable condMsgPrepare;
+    std::mutex mutexMsgPrepare;
+    bool flagInterruptMsgPrepare;
+    std::vector<std::thread> threadsMessagePreparation;
+
     CThreadInterrupt interruptNet;
 
     std::thread threadDNSAddressSeed;
@@ -633,6 +699,46 @@ public:
 
 
 
+/**
+ * Transaction or block payload of a received message, checksummed and
+ * deserialized by the message preparation threads while the message waits in
+ * vProcessMsg. ProcessMessages uses the result or, if no thread has started
+ * on it yet, prepares the message itself.
+ */
+class CPreparedMessage
+{
+private:
+    enum State {
+        PENDING,
+        RUNNING,
+        DONE
+    };
+    std::atomic<int> nState;
+    std::mutex mutex;
+    std::condition_variable cond;
+
+public:
+    //! Payload size, msg.vRecv is consumed by a successful Run
+    unsigned int nMessageSize;
+    //! Hash of the payload, compared with the header checksum
+    uint256 hashChecksum;
+    //! Deserialized payload, only set if the checksum matched
+    std::shared_ptr<const CTransaction> tx;
+    std::shared_ptr<const CBlock> block;
+    uint256 hashBlock;
+    //! Exception thrown while deserializing, rethrown by ProcessMessages
+    std::exception_ptr error;
+
+    CPreparedMessage() : nState(PENDING), nMessageSize(0) {}
+
+    //! Claim the message for preparation, false if another thread did
+    bool TryStart();
+    //! Prepare msg after a successful TryStart, consumes msg.vRecv
+    void Run(CNetMessage& msg, int nVersion);
+    //! Prepare msg on the calling thread, or wait for the thread that is
+    void Finish(CNetMessage& msg, int nVersion);
+};
+
 class CNetMessage
 {
 public:
@@ -647,6 +753,8 @@ public:
 
     int64_t nTime;                  // time (in microseconds) of message receipt.
 
+    std::shared_ptr<CPreparedMessage> prepared; // set if queued for preparation
+
     CNetMessage(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn) : hdrbuf(nTypeIn, nVersionIn), hdr(pchMessageStartIn), vRecv(nTypeIn, nVersionIn)
     {
         hdrbuf.resize(24);
@@ -734,7 +842,8 @@ public:
     CSemaphoreGrant grantMasternodeOutbound;
     CCriticalSection cs_filter;
     CBloomFilter* pfilter;
-    int nRefCount;
+    // Also taken by the masternode signature verifier, outside of cs_vNodes
+    std::atomic_int nRefCount;
     NodeId id;
 
     std::atomic_bool fPauseRecv;
@@ -774,6 +883,10 @@ public:
     std::atomic<int64_t> nLastBlockTime;
     std::atomic<int64_t> nLastTXTime;
 
+    // Bytes left to answer 'gettxs' with, refilled over time
+    int64_t nGetTxsBudget;
+    int64_t nGetTxsBudgetTime;
+
     std::vector<uint256> vAdToAnnonunce;
 
     // Ping time measurement:
@@ -1265,25 +1265,79 @@ bool processGetTXSMessage(CNode* pfrom, CDataStream& vRecv, CConnman& connman)
 {
     std::vector<uint256> txids;
     vRecv >> txids;
-    std::map<uint256, CTransactionRef> txidMap;
-    Consensus::Params params = Params().GetConsensus();
-    for (uint256 txid : txids) {
-        if (txidMap.find(txid) != txidMap.end())
-            continue;
-
-        CTransactionRef tx;
-        uint256 hashBlock;
-        if (!GetTransaction(txid, tx, params, hashBlock, true)) {
-            vector<CInv> vNotFound;
-            vNotFound.push_back(CInv(MSG_TX, txid));
-            connman.PushMessage(pfrom, NetMsgType::NOTFOUND, vNotFound);
-            continue;
+    if (txids.size() > MAX_TX_BATCH_SZ) {
+        LOCK(cs_main);
+        Misbehaving(pfrom->GetId(), 20);
+        return error("message gettxs size() = %u", txids.size());
+    }
+
+    int64_t nNow = GetTimeMillis();
+    pfrom->nGetTxsBudget = std::min(MAX_GETTXS_BURST, pfrom->nGetTxsBudget + (nNow - pfrom->nGetTxsBudgetTime) * GETTXS_BYTES_PER_SECOND / 1000);
+    pfrom->nGetTxsBudgetTime = nNow;
+
+    // Answered with the transactions found, the ids not found and the ids over
+    // the budget of the peer, which it may ask for again later. Every id looked
+    // up costs at least GETTXS_MIN_TX_SIZE and ids are looked up in chunks no
+    // larger than the budget left pays for, so the budget bounds disk reads as
+    // well as bandwidth. Only the mempool and the tx index are searched, the
+    // slow path through the coins database needs cs_main.
+    std::vector<CTransactionRef> vtxFound;
+    std::vector<uint256> vNotFound;
+    std::vector<uint256> vDeferred;
+    std::set<uint256> setAnswered;
+    std::vector<uint256> vChunk;
+    std::vector<CTransactionRef> vtx;
+    std::vector<uint256> vHashBlock;
+    size_t nPos = 0;
+    while (nPos < txids.size()) {
+        // The first id is always looked up and a transaction found for it sent,
+        // a large one can't be deferred forever
+        if (pfrom->nGetTxsBudget <= 0 && nPos > 0)
+            break;
+        size_t nChunk = std::max<int64_t>(1, pfrom->nGetTxsBudget / GETTXS_MIN_TX_SIZE);
+        vChunk.clear();
+        while (nPos < txids.size() && vChunk.size() < nChunk) {
+            if (setAnswered.insert(txids[nPos]).second)
+                vChunk.push_back(txids[nPos]);
+            nPos++;
+        }
+        GetTransactions(vChunk, vtx, vHashBlock, Params().GetConsensus(), false);
+
+        for (size_t i = 0; i < vChunk.size(); i++) {
+            if (!vtx[i]) {
+                pfrom->nGetTxsBudget -= GETTXS_MIN_TX_SIZE;
+                vNotFound.push_back(vChunk[i]);
+                continue;
+            }
+            int64_t nSize = std::max(GETTXS_MIN_TX_SIZE, (int64_t)GetSerializeSize(*vtx[i], SER_NETWORK, PROTOCOL_VERSION));
+            if (nSize > pfrom->nGetTxsBudget && !vtxFound.empty()) {
+                vDeferred.push_back(vChunk[i]);
+                continue;
+            }
+            pfrom->nGetTxsBudget -= nSize;
+            vtxFound.push_back(vtx[i]);
         }
+    }
+    for (; nPos < txids.size(); nPos++) {
+        if (setAnswered.insert(txids[nPos]).second)
+            vDeferred.push_back(txids[nPos]);
+    }
 
-        txidMap.insert(std::make_pair(txid, tx));
-        connman.PushMessage(pfrom, NetMsgType::TX, tx);
+    if (pfrom->nVersion >= TXS_VERSION) {
+        connman.PushMessage(pfrom, NetMsgType::TXS, vtxFound, vNotFound, vDeferred);
+        return true;
     }
 
+    // Older peers get every transaction on its own, and whatever was over the budget as not found
+    for (const CTransactionRef& tx : vtxFound)
+        connman.PushMessage(pfrom, NetMsgType::TX, *tx);
+    std::vector<CInv> vInvNotFound;
+    for (const uint256& txid : vNotFound)
+        vInvNotFound.push_back(CInv(MSG_TX, txid));
+    for (const uint256& txid : vDeferred)
+        vInvNotFound.push_back(CInv(MSG_TX, txid));
+    if (!vInvNotFound.empty())
+        connman.PushMessage(pfrom, NetMsgType::NOTFOUND, vInvNotFound);
     return true;
 }
 
@@ -1325,26 +1379,19 @@ bool processGetClueTopRecord(CNode* pfrom, CDataStream& vRecv, CConnman& connman
         return true;
     }
 
-    std::list<CTopRank> vRank;
+    int nPosition = -1;
     {
         LOCK(cs_main);
         CClueViewCache view(pclueTip);
 
-        view.GetSeasonRank(nSeason, vRank);
+        const CSeasonRank* pRank = view.GetSeasonRank(nSeason);
+        if (pRank)
+            nPosition = pRank->Position(addr);
     }
 
-    int i = 0;
-    bool fInrank = false;
-    for (const auto& rank : vRank) {
-        i += 1;
-        if (rank.address == addr) {
-            fInrank = true;
-            break;
-        }
-    }
     output << addr;
     output << nSeason;
-    output << (fInrank ? i : -1);
+    output << nPosition;
     connman.PushMessage(pfrom, NetMsgType::CLUETOPRECORD, output);
     return true;
 }
@@ -1407,12 +1454,12 @@ bool processAddressRemoveMessage(CNode* pfrom, CDataStream& vRecv)
     return true;
 }
 
-bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv, int64_t nTimeReceived, CConnman& connman, std::atomic<bool>& interruptMsgProc)
+bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv, int64_t nTimeReceived, CConnman& connman, std::atomic<bool>& interruptMsgProc, const CPreparedMessage* prepared)
 {
     const CChainParams& chainparams = Params();
     RandAddSeedPerfmon();
 
-    LogPrint("net", "received: %s (%u bytes) peer=%d\n", SanitizeString(strCommand), vRecv.size(), pfrom->id);
+    LogPrint("net", "received: %s (%u bytes) peer=%d\n", SanitizeString(strCommand), prepared ? prepared->nMessageSize : vRecv.size(), pfrom->id);
 
     if (mapArgs.count("-dropmessagestest") && GetRand(atoi(mapArgs["-dropmessagestest"])) == 0) {
         LogPrintf("dropmessagestest DROPPING RECV MESSAGE\n");
@@ -1887,7 +1934,10 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
 
         // Read data and assign inv type
         if (strCommand == NetMsgType::TX) {
-            vRecv >> ptx;
+            if (prepared && prepared->tx)
+                ptx = prepared->tx;
+            else
+                vRecv >> ptx;
             tx = ptx;
         }
 
@@ -2142,10 +2192,19 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     }
 
     else if (strCommand == NetMsgType::BLOCK && !fImporting && !fReindex) { // Ignore blocks received while importing
-        CBlock block;
-        vRecv >> block;
+        std::shared_ptr<const CBlock> shared_pblock;
+        uint256 hash;
+        if (prepared && prepared->block) {
+            shared_pblock = prepared->block;
+            hash = prepared->hashBlock;
+        } else {
+            std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+            vRecv >> *pblock;
+            shared_pblock = pblock;
+            hash = pblock->GetHash();
+        }
 
-        CInv inv(MSG_BLOCK, block.GetHash());
+        CInv inv(MSG_BLOCK, hash);
         LogPrint("net", "received block %s peer=%d\n", inv.hash.ToString(), pfrom->id);
 
         pfrom->AddInventoryKnown(inv);
@@ -2155,7 +2214,6 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         // Such an unrequested block may still be processed, subject to the
         // conditions in AcceptBlock().
         bool forceProcessing = pfrom->fWhitelisted && !IsInitialBlockDownload();
-        const uint256 hash(block.GetHash());
         {
             LOCK(cs_main);
             // Also always process if we requested the block explicitly, as we may
@@ -2166,13 +2224,12 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             mapBlockSource.emplace(hash, pfrom->GetId());
         }
         bool fNewBlock = false;
-        std::shared_ptr<const CBlock> shared_pblock = std::make_shared<const CBlock>(block);
         ProcessNewBlock(chainparams, shared_pblock, forceProcessing, nullptr, &fNewBlock);
         if (fNewBlock)
             pfrom->nLastBlockTime = GetTime();
         else {
             LOCK(cs_main);
-            mapBlockSource.erase(shared_pblock->GetHash());
+            mapBlockSource.erase(hash);
         }
     }
 
@@ -2803,13 +2860,17 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, std::atomic<bool>& interru
             return false;
         // Just take one message
         msgs.splice(msgs.begin(), pfrom->vProcessMsg, pfrom->vProcessMsg.begin());
-        pfrom->nProcessQueueSize -= msgs.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
+        pfrom->nProcessQueueSize -= msgs.front().hdr.nMessageSize + CMessageHeader::HEADER_SIZE;
         pfrom->fPauseRecv = pfrom->nProcessQueueSize > connman.GetReceiveFloodSize();
         fMoreWork = !pfrom->vProcessMsg.empty();
     }
 
     CNetMessage& msg(msgs.front());
 
+    // Take over the preparation if no thread started on it, or wait for the one that did
+    if (msg.prepared)
+        msg.prepared->Finish(msg, pfrom->GetRecvVersion());
+
     msg.SetVersion(pfrom->GetRecvVersion());
     // Scan for message start
     if (memcmp(msg.hdr.pchMessageStart, chainparams.MessageStart(), MESSAGE_START_SIZE) != 0) {
@@ -2831,7 +2892,7 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, std::atomic<bool>& interru
 
     // Checksum
     CDataStream& vRecv = msg.vRecv;
-    uint256 hash = Hash(vRecv.begin(), vRecv.begin() + nMessageSize);
+    uint256 hash = msg.prepared ? msg.prepared->hashChecksum : Hash(vRecv.begin(), vRecv.begin() + nMessageSize);
     if (memcmp(hash.begin(), hdr.pchChecksum, CMessageHeader::CHECKSUM_SIZE) != 0) {
         LogPrintf("%s(%s, %u bytes): CHECKSUM ERROR expected %s was %s\n", __func__,
                   SanitizeString(strCommand), nMessageSize,
@@ -2843,7 +2904,9 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, std::atomic<bool>& interru
     // Process message
     bool fRet = false;
     try {
-        fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, connman, interruptMsgProc);
+        if (msg.prepared && msg.prepared->error)
+            std::rethrow_exception(msg.prepared->error);
+        fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, connman, interruptMsgProc, msg.prepared.get());
         if (interruptMsgProc)
             return false;
         if (!pfrom->vRecvGetData.empty())
@@ -20,6 +20,8 @@
 
 extern int nConnectTimeout;
 extern bool fNameLookup;
+//! Only use sockets select() can wait on, cleared when connections are polled with epoll
+extern bool fSelectableSocketsOnly;
 
 //! -timeout default
 static const int DEFAULT_CONNECT_TIMEOUT = 5000;
@@ -67,6 +69,8 @@ bool SetSocketNonBlocking(SOCKET& hSocket, bool fNonBlocking);
  * Convert milliseconds to a struct timeval for e.g. select.
  */
 struct timeval MillisToTimeval(int64_t nTimeout);
+/** Whether a socket can be used for a peer connection, see fSelectableSocketsOnly */
+bool IsUsableSocket(SOCKET hSocket);
 void InterruptSocks5(bool interrupt);
 
 #endif // VDS_NETBASE_H
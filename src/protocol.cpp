@@ -84,6 +84,7 @@ const char* VIBQUEUE = "vibqueue";
 
 const char* IM = "im";
 const char* GETTXS = "gettxs";
+const char* TXS = "txs";
 const char* CLUE_PRE_CREATE_TREE = "clprecreate";
 const char* PRE_CREATE_CLUE = "precreatecl";
 const char* GETTOPCLUELIST = "gettopcllist";
@@ -192,6 +193,7 @@ static const char* ppszTypeName[] = {
     NetMsgType::GETTX2,
     NetMsgType::STX2,
     NetMsgType::GETTXS,
+    NetMsgType::TXS,
 
     // ad
     NetMsgType::GETADMSG,
@@ -270,6 +270,7 @@ extern const char* GETVIBQUEUE;
 extern const char* VIBQUEUE;
 extern const char* IM;
 extern const char* GETTXS;
+extern const char* TXS;
 extern const char* CLUE_PRE_CREATE_TREE;
 extern const char* PRE_CREATE_CLUE;
 extern const char* GETTOPCLUELIST;
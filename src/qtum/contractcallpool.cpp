@@ -0,0 +1,188 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <qtum/contractcallpool.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <qtum/qtumDGP.h>
+#include <timedata.h>
+#include <util.h>
+#include <utiltime.h>
+#include <validation.h>
+
+#include <libethashseal/GenesisInfo.h>
+#include <libethereum/ChainParams.h>
+
+CContractCallPool* pContractCallPool = nullptr;
+
+/** Number of executed opcodes between checks of the time budget */
+static const uint64_t CONTRACT_CALL_TIMEOUT_CHECK_OPS = 1024;
+
+CContractCallPool::CContractCallPool(int nThreads, uint64_t nMaxGasIn, int64_t nTimeoutIn) :
+    semCalls(std::max(nThreads, 1)), nMaxGas(nMaxGasIn), nTimeout(nTimeoutIn)
+{
+}
+
+std::unique_ptr<dev::eth::SealEngineFace> CContractCallPool::TakeSealEngine()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(csSealEngines);
+        if (!vSealEngines.empty()) {
+            std::unique_ptr<dev::eth::SealEngineFace> sealEngine = std::move(vSealEngines.back());
+            vSealEngines.pop_back();
+            return sealEngine;
+        }
+    }
+    dev::eth::ChainParams cp((dev::eth::genesisInfo(dev::eth::Network::qtumMainNetwork)));
+    return std::unique_ptr<dev::eth::SealEngineFace>(cp.createSealEngine());
+}
+
+void CContractCallPool::ReturnSealEngine(std::unique_ptr<dev::eth::SealEngineFace> sealEngine)
+{
+    sealEngine->deleteAddresses.clear();
+    boost::unique_lock<boost::mutex> lock(csSealEngines);
+    vSealEngines.push_back(std::move(sealEngine));
+}
+
+void CContractCallPool::UpdateSnapshot(const CBlockIndex* pindex)
+{
+    AssertLockHeld(cs_main);
+    if (!pindex || !globalState)
+        return;
+
+    // Same environment as CallContract(), apart from the time which is taken per call
+    CBlock block;
+    if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus()) || block.vtx.empty() || block.vtx[0]->vout.empty()) {
+        LogPrintf("%s: failed to read block %s\n", __func__, pindex->GetBlockHash().ToString());
+        return;
+    }
+    UpdateSnapshot(pindex, block);
+}
+
+void CContractCallPool::UpdateSnapshot(const CBlockIndex* pindex, const CBlock& block)
+{
+    AssertLockHeld(cs_main);
+    if (!globalState || block.vtx.empty() || block.vtx[0]->vout.empty())
+        return;
+
+    std::shared_ptr<Snapshot> next = std::make_shared<Snapshot>();
+    QtumDGP qtumDGP(globalState.get(), fGettingValuesDGP);
+    next->blockGasLimit = qtumDGP.getBlockGasLimit(pindex->nHeight + 1);
+    next->schedule = qtumDGP.getGasSchedule(pindex->nHeight + 1);
+    next->nHeight = pindex->nHeight;
+    next->state = globalState->fork();
+
+    dev::eth::EnvInfo& env = next->envInfo;
+    env.setNumber(dev::u256(pindex->nHeight + 1));
+    env.setDifficulty(dev::u256(block.nBits));
+    dev::eth::LastHashes lh;
+    lh.resize(256);
+    const CBlockIndex* tip = pindex;
+    for (int i = 0; i < 256; i++) {
+        if (!tip)
+            break;
+        lh[i] = uintToh256(*tip->phashBlock);
+        tip = tip->pprev;
+    }
+    env.setLastHashes(std::move(lh));
+    env.setGasLimit(next->blockGasLimit);
+    env.setAuthor(ByteCodeExec::EthAddrFromScript(block.vtx[0]->vout[0].scriptPubKey));
+
+    boost::unique_lock<boost::mutex> lock(csSnapshot);
+    snapshot = std::move(next);
+}
+
+std::shared_ptr<const CContractCallPool::Snapshot> CContractCallPool::GetSnapshot() const
+{
+    boost::unique_lock<boost::mutex> lock(csSnapshot);
+    return snapshot;
+}
+
+size_t CContractCallPool::GetIdleSealEngines() const
+{
+    boost::unique_lock<boost::mutex> lock(csSealEngines);
+    return vSealEngines.size();
+}
+
+void CContractCallPool::UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload)
+{
+    if (fInitialDownload && GetSnapshot())
+        return;
+
+    // The notification may arrive after further blocks were connected, globalState is at the tip
+    LOCK(cs_main);
+    UpdateSnapshot(chainActive.Tip());
+}
+
+bool CContractCallPool::Call(const dev::Address& addrContract, const std::vector<unsigned char>& data, const dev::Address& sender, uint64_t gasLimit, Result& result)
+{
+    std::shared_ptr<const Snapshot> pinned = GetSnapshot();
+    if (!pinned)
+        return false;
+
+    CSemaphoreGrant grant(semCalls);
+
+    result.results.clear();
+    result.nHeight = pinned->nHeight;
+    result.fAddressInUse = false;
+    result.fTimedOut = false;
+
+    uint64_t gasMax = pinned->blockGasLimit - 1;
+    if (nMaxGas > 0 && nMaxGas < gasMax)
+        gasMax = nMaxGas;
+    if (gasLimit == 0 || gasLimit > gasMax)
+        gasLimit = gasMax;
+
+    dev::Address senderAddress = sender == dev::Address() ? dev::Address("ffffffffffffffffffffffffffffffffffffffff") : sender;
+    QtumTransaction callTransaction(0, 1, dev::u256(gasLimit), addrContract, data, dev::u256(0));
+    callTransaction.forceSender(senderAddress);
+    callTransaction.setVersion(VersionVM::GetEVMDefault());
+
+    std::unique_ptr<QtumState> state = pinned->state->fork();
+    if (!state->addressInUse(addrContract)) {
+        dev::eth::ExecutionResult execRes;
+        execRes.excepted = dev::eth::TransactionException::Unknown;
+        result.results.push_back(ResultExecute{execRes, dev::eth::TransactionReceipt(dev::h256(), dev::u256(), dev::eth::LogEntries()), CTransaction()});
+        return true;
+    }
+    result.fAddressInUse = true;
+
+    dev::eth::EnvInfo envInfo(pinned->envInfo);
+    envInfo.setTimestamp(dev::u256(GetAdjustedTime()));
+
+    // Running out of time is reported like running out of gas, which reverts the call
+    OnOpFunc onOp;
+    if (nTimeout > 0) {
+        int64_t nDeadline = GetTimeMillis() + nTimeout;
+        bool* pfTimedOut = &result.fTimedOut;
+        onOp = [nDeadline, pfTimedOut](uint64_t steps, uint64_t, dev::eth::Instruction, dev::bigint, dev::bigint, dev::bigint, dev::eth::VM*, dev::eth::ExtVMFace const*) {
+            if (steps % CONTRACT_CALL_TIMEOUT_CHECK_OPS == 0 && GetTimeMillis() > nDeadline) {
+                *pfTimedOut = true;
+                BOOST_THROW_EXCEPTION(dev::eth::OutOfGas());
+            }
+        };
+    }
+
+    std::unique_ptr<dev::eth::SealEngineFace> sealEngine = TakeSealEngine();
+    sealEngine->setQtumSchedule(pinned->schedule);
+    try {
+        result.results.push_back(state->execute(envInfo, *sealEngine, callTransaction, dev::eth::Permanence::Reverted, onOp));
+    } catch (...) {
+        ReturnSealEngine(std::move(sealEngine));
+        throw;
+    }
+    ReturnSealEngine(std::move(sealEngine));
+    return true;
+}
+
+std::vector<ResultExecute> CallContractReadOnly(const dev::Address& addrContract, const std::vector<unsigned char>& data, const dev::Address& sender, uint64_t gasLimit)
+{
+    CContractCallPool::Result result;
+    if (pContractCallPool && pContractCallPool->Call(addrContract, data, sender, gasLimit, result))
+        return result.results;
+
+    LOCK(cs_main);
+    return CallContract(addrContract, data, sender, gasLimit);
+}
@@ -0,0 +1,96 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef VDS_QTUM_CONTRACTCALLPOOL_H
+#define VDS_QTUM_CONTRACTCALLPOOL_H
+
+#include <qtum/qtumstate.h>
+#include <sync.h>
+#include <validationinterface.h>
+
+#include <memory>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+class CBlock;
+class CBlockIndex;
+
+/** Default for -contractcallthreads, the number of read-only contract calls executed at once */
+static const int DEFAULT_CONTRACT_CALL_THREADS = 4;
+/** Default for -contractcalltimeout, in milliseconds, 0 = no limit */
+static const int64_t DEFAULT_CONTRACT_CALL_TIMEOUT = 3000;
+/** Default for -contractcallmaxgas, 0 = the block gas limit */
+static const uint64_t DEFAULT_CONTRACT_CALL_MAX_GAS = 0;
+
+/**
+ * Read-only contract calls that do not take cs_main.
+ *
+ * On every new tip the pool pins a snapshot: a fork of globalState at the
+ * state roots of the tip, together with the EVM environment and gas schedule
+ * CallContract() would use. Calls are executed with Permanence::Reverted on
+ * their own fork of that snapshot, so any number of them can run while blocks
+ * are being connected. Trie nodes are never deleted from the state databases,
+ * so a snapshot stays readable after the tip moves on.
+ *
+ * Each call is bounded by -contractcallmaxgas and -contractcalltimeout, and at
+ * most -contractcallthreads calls execute at once; callers beyond that wait.
+ */
+class CContractCallPool : public CValidationInterface
+{
+public:
+    struct Snapshot {
+        std::unique_ptr<QtumState> state;
+        dev::eth::EnvInfo envInfo;
+        dev::eth::EVMSchedule schedule;
+        uint64_t blockGasLimit;
+        int nHeight;
+    };
+
+    struct Result {
+        std::vector<ResultExecute> results;
+        int nHeight;        //!< height of the tip the call was executed at
+        bool fAddressInUse; //!< the contract exists, otherwise results report Unknown
+        bool fTimedOut;     //!< execution was aborted by -contractcalltimeout, results report OutOfGas
+    };
+
+private:
+    mutable boost::mutex csSnapshot;
+    std::shared_ptr<const Snapshot> snapshot;
+
+    mutable boost::mutex csSealEngines;
+    std::vector<std::unique_ptr<dev::eth::SealEngineFace>> vSealEngines;
+
+    CSemaphore semCalls;
+    uint64_t nMaxGas;
+    int64_t nTimeout;
+
+    std::unique_ptr<dev::eth::SealEngineFace> TakeSealEngine();
+    void ReturnSealEngine(std::unique_ptr<dev::eth::SealEngineFace> sealEngine);
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload) override;
+
+public:
+    CContractCallPool(int nThreads, uint64_t nMaxGasIn, int64_t nTimeoutIn);
+
+    /** Pin the contract state at pindex, which must be the tip */
+    void UpdateSnapshot(const CBlockIndex* pindex);
+    /** Pin the contract state at pindex, with block being its block */
+    void UpdateSnapshot(const CBlockIndex* pindex, const CBlock& block);
+    std::shared_ptr<const Snapshot> GetSnapshot() const;
+
+    /** Number of seal engines kept for reuse */
+    size_t GetIdleSealEngines() const;
+
+    /** Execute a call on the latest snapshot, false if there is none yet */
+    bool Call(const dev::Address& addrContract, const std::vector<unsigned char>& data, const dev::Address& sender, uint64_t gasLimit, Result& result);
+};
+
+extern CContractCallPool* pContractCallPool;
+
+/** Execute a read-only call on the contract call pool, falling back to CallContract under cs_main */
+std::vector<ResultExecute> CallContractReadOnly(const dev::Address& addrContract, const std::vector<unsigned char>& data, const dev::Address& sender = dev::Address(), uint64_t gasLimit = 0);
+
+#endif // VDS_QTUM_CONTRACTCALLPOOL_H
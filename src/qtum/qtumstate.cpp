@@ -21,6 +21,81 @@ QtumState::QtumState() : dev::eth::State(dev::Invalid256, dev::OverlayDB(), dev:
     stateUTXO = SecureTrieDB<Address, OverlayDB>(&dbUTXO);
 }
 
+std::unique_ptr<QtumState> QtumState::fork() const
+{
+    std::unique_ptr<QtumState> ret(new QtumState());
+    ret->m_accountStartNonce = m_accountStartNonce;
+    ret->m_db = m_db;
+    ret->m_state = SecureTrieDB<Address, OverlayDB>(&ret->m_db, m_state.root(), Verification::Skip);
+    ret->dbUTXO = dbUTXO;
+    ret->stateUTXO = SecureTrieDB<Address, OverlayDB>(&ret->dbUTXO, stateUTXO.root(), Verification::Skip);
+    return ret;
+}
+
+void QtumState::setAccessLog(QtumAccessLog* _log)
+{
+    State::setAccessLog(_log ? &_log->accounts : nullptr);
+    accessLogUTXO = _log ? &_log->utxos : nullptr;
+}
+
+void QtumState::keepChanged(QtumAccessLog& _log, h256 const& _root, h256 const& _rootUTXO) const
+{
+    SecureTrieDB<Address, OverlayDB> before(const_cast<OverlayDB*>(&m_db), _root, Verification::Skip);
+    for (auto it = _log.accounts.begin(); it != _log.accounts.end();) {
+        if (before.at(*it) == m_state.at(*it))
+            it = _log.accounts.erase(it);
+        else
+            ++it;
+    }
+    SecureTrieDB<Address, OverlayDB> beforeUTXO(const_cast<OverlayDB*>(&dbUTXO), _rootUTXO, Verification::Skip);
+    for (auto it = _log.utxos.begin(); it != _log.utxos.end();) {
+        if (beforeUTXO.at(*it) == stateUTXO.at(*it))
+            it = _log.utxos.erase(it);
+        else
+            ++it;
+    }
+}
+
+QtumStateDelta QtumState::values(QtumAccessLog const& _log) const
+{
+    QtumStateDelta ret;
+    ret.accounts.reserve(_log.accounts.size());
+    for (Address const& a : _log.accounts)
+        ret.accounts.emplace_back(a, m_state.at(a));
+    ret.utxos.reserve(_log.utxos.size());
+    for (Address const& a : _log.utxos)
+        ret.utxos.emplace_back(a, stateUTXO.at(a));
+    return ret;
+}
+
+void QtumState::applyDelta(QtumStateDelta const& _delta)
+{
+    for (auto const& i : _delta.accounts) {
+        if (i.second.empty())
+            m_state.remove(i.first);
+        else
+            m_state.insert(i.first, bytesConstRef(&i.second));
+        m_cache.erase(i.first);
+        m_nonExistingAccountsCache.erase(i.first);
+        m_touched.insert(i.first);
+    }
+    for (auto const& i : _delta.utxos) {
+        if (i.second.empty())
+            stateUTXO.remove(i.first);
+        else
+            stateUTXO.insert(i.first, bytesConstRef(&i.second));
+        cacheUTXO.erase(i.first);
+    }
+}
+
+void QtumState::importNodes(QtumState const& _fork)
+{
+    for (auto const& i : _fork.m_db.get())
+        m_db.insert(i.first, bytesConstRef(&i.second));
+    for (auto const& i : _fork.dbUTXO.get())
+        dbUTXO.insert(i.first, bytesConstRef(&i.second));
+}
+
 ResultExecute QtumState::execute(EnvInfo const& _envInfo, SealEngineFace const& _sealEngine, QtumTransaction const& _t, Permanence _p, OnOpFunc const& _onOp)
 {
 
@@ -82,6 +157,9 @@ ResultExecute QtumState::execute(EnvInfo const& _envInfo, SealEngineFace const&
                 printfErrorLog(res.excepted);
             }
 
+            if (accessLogUTXO)
+                for (auto const& i : cacheUTXO)
+                    accessLogUTXO->insert(i.first);
             qtum::commit(cacheUTXO, stateUTXO, m_cache);
             cacheUTXO.clear();
             bool removeEmptyAccounts = _envInfo.number() >= _sealEngine.chainParams().u256Param("EIP158ForkBlock");
@@ -93,7 +171,7 @@ ResultExecute QtumState::execute(EnvInfo const& _envInfo, SealEngineFace const&
         res.excepted = dev::eth::toTransactionException(_e);
         res.gasUsed = _t.gas();
         const Consensus::Params& consensusParams = Params().GetConsensus();
-        if (chainActive.Height() < consensusParams.nFixUTXOCacheHFHeight  && _p != Permanence::Reverted) {
+        if (_p != Permanence::Reverted && chainActive.Height() < consensusParams.nFixUTXOCacheHFHeight) {
             deleteAccounts(_sealEngine.deleteAddresses);
             commit(CommitBehaviour::RemoveEmptyAccounts);
         } else {
@@ -158,6 +236,9 @@ Vin const* QtumState::vin(dev::Address const& _a) const
 
 Vin* QtumState::vin(dev::Address const& _addr)
 {
+    if (accessLogUTXO)
+        accessLogUTXO->insert(_addr);
+
     auto it = cacheUTXO.find(_addr);
     if (it == cacheUTXO.end()) {
         std::string stateBack = stateUTXO.at(_addr);
@@ -279,6 +360,27 @@ void QtumState::printfErrorLog(const dev::eth::TransactionException er)
     clog(ExecutiveWarnChannel) << "VM exception:" << ss.str();
 }
 
+static bool intersect(AddressHash const& _a, AddressHash const& _b)
+{
+    AddressHash const& small = _a.size() <= _b.size() ? _a : _b;
+    AddressHash const& large = _a.size() <= _b.size() ? _b : _a;
+    for (Address const& a : small)
+        if (large.count(a))
+            return true;
+    return false;
+}
+
+bool QtumAccessLog::intersects(QtumAccessLog const& _o) const
+{
+    return intersect(accounts, _o.accounts) || intersect(utxos, _o.utxos);
+}
+
+void QtumAccessLog::insert(QtumAccessLog const& _o)
+{
+    accounts.insert(_o.accounts.begin(), _o.accounts.end());
+    utxos.insert(_o.utxos.begin(), _o.utxos.end());
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////
 CTransaction CondensingTX::createCondensingTX()
 {
@@ -56,6 +56,22 @@ namespace qtum{
 
 class CondensingTX;
 
+/** Addresses looked up in or committed to the account trie and the UTXO trie of a QtumState */
+struct QtumAccessLog{
+    dev::AddressHash accounts;
+    dev::AddressHash utxos;
+
+    bool intersects(QtumAccessLog const& _o) const;
+    void insert(QtumAccessLog const& _o);
+    void clear() { accounts.clear(); utxos.clear(); }
+};
+
+/** Raw trie values of a set of addresses, an empty value stands for an absent entry */
+struct QtumStateDelta{
+    std::vector<std::pair<dev::Address, std::string>> accounts;
+    std::vector<std::pair<dev::Address, std::string>> utxos;
+};
+
 class QtumState : public dev::eth::State {
     
 public:
@@ -78,6 +94,25 @@ public:
 
 	dev::OverlayDB& dbUtxo() { return dbUTXO; }
 
+    /// Fork sharing our databases and current roots but none of our caches. Changes made
+    /// to the fork stay in its own overlays until imported with importNodes() and applyDelta().
+    std::unique_ptr<QtumState> fork() const;
+
+    /// Record every account and UTXO entry looked up or committed into _log, null stops recording
+    void setAccessLog(QtumAccessLog* _log);
+
+    /// Drop from _log the addresses whose trie values are the same at the current roots and at the given ones
+    void keepChanged(QtumAccessLog& _log, dev::h256 const& _root, dev::h256 const& _rootUTXO) const;
+
+    /// Trie values of the addresses in _log at the current roots
+    QtumStateDelta values(QtumAccessLog const& _log) const;
+
+    /// Write trie values into the state, as a commit of the same changes would have done
+    void applyDelta(QtumStateDelta const& _delta);
+
+    /// Copy the trie nodes held in the overlays of a fork, so that values taken from it resolve here
+    void importNodes(QtumState const& _fork);
+
     virtual ~QtumState(){}
 
     friend CondensingTX;
@@ -113,6 +148,8 @@ private:
 	dev::eth::SecureTrieDB<dev::Address, dev::OverlayDB> stateUTXO;
 
 	std::unordered_map<dev::Address, Vin> cacheUTXO;
+
+    dev::AddressHash* accessLogUTXO = nullptr;
 };
 
 
@@ -0,0 +1,232 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <qtum/speculativeexec.h>
+
+#include <checkqueue.h>
+#include <util.h>
+
+#include <libethashseal/GenesisInfo.h>
+#include <libethereum/ChainParams.h>
+
+#include <boost/thread.hpp>
+
+static CCheckQueue<CContractExecCheck> contractexecqueue(16);
+/** Serializes users of contractexecqueue */
+static boost::mutex csContractExecQueue;
+/** Number of running worker threads, excluding the calling thread */
+static int nContractExecWorkers = 0;
+/** Idle seal engines, an execution records deleted addresses in its engine so every thread needs its own */
+static std::vector<std::unique_ptr<dev::eth::SealEngineFace>> vSealEngines;
+static boost::mutex csSealEngines;
+
+/** Take an idle seal engine, there are never more than threads executing at once */
+static std::unique_ptr<dev::eth::SealEngineFace> TakeSealEngine()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(csSealEngines);
+        if (!vSealEngines.empty()) {
+            std::unique_ptr<dev::eth::SealEngineFace> sealEngine = std::move(vSealEngines.back());
+            vSealEngines.pop_back();
+            return sealEngine;
+        }
+    }
+    dev::eth::ChainParams cp((dev::eth::genesisInfo(dev::eth::Network::qtumMainNetwork)));
+    return std::unique_ptr<dev::eth::SealEngineFace>(cp.createSealEngine());
+}
+
+static void ReturnSealEngine(std::unique_ptr<dev::eth::SealEngineFace> sealEngine)
+{
+    sealEngine->deleteAddresses.clear();
+    boost::unique_lock<boost::mutex> lock(csSealEngines);
+    vSealEngines.push_back(std::move(sealEngine));
+}
+
+static bool SameTransactions(const std::vector<QtumTransaction>& a, const std::vector<QtumTransaction>& b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i] != b[i] || a[i].sender() != b[i].sender() || a[i].gas() != b[i].gas() || a[i].gasPrice() != b[i].gasPrice() ||
+                a[i].getHashWith() != b[i].getHashWith() || a[i].getNVout() != b[i].getNVout() ||
+                a[i].getVersion().toRaw() != b[i].getVersion().toRaw())
+            return false;
+    }
+    return true;
+}
+
+SpeculativeTx::ReceiptRoot SpeculativeTx::InferReceiptRoot(const dev::h256& receiptRoot, const dev::h256& rootBefore, const dev::h256& rootAfter)
+{
+    if (receiptRoot == rootAfter)
+        return ROOT_AFTER;
+    if (receiptRoot == rootBefore)
+        return ROOT_BEFORE;
+    return ROOT_KEEP;
+}
+
+bool CContractExecCheck::operator()()
+{
+    QtumState& fork = *pTx->fork;
+    std::unique_ptr<dev::eth::SealEngineFace> sealEngine = TakeSealEngine();
+    sealEngine->setQtumSchedule(pSealEngine->getQtumSchedule());
+    fork.setAccessLog(&pTx->reads);
+    try {
+        // Same steps as ByteCodeExec::performByteCode
+        for (QtumTransaction& tx : pTx->txs) {
+            if (tx.getVersion().toRaw() != VersionVM::GetEVMDefault().toRaw()) {
+                fork.setAccessLog(nullptr);
+                ReturnSealEngine(std::move(sealEngine));
+                return true;
+            }
+            dev::h256 rootBefore = fork.rootHash();
+            if (!tx.isCreation() && !fork.addressInUse(tx.receiveAddress())) {
+                dev::eth::ExecutionResult execRes;
+                execRes.excepted = dev::eth::TransactionException::Unknown;
+                pTx->results.push_back(ResultExecute{execRes, dev::eth::TransactionReceipt(dev::h256(), dev::u256(), dev::eth::LogEntries()), CTransaction()});
+                pTx->receiptRoots.push_back(SpeculativeTx::ROOT_KEEP);
+            } else {
+                pTx->results.push_back(fork.execute(*pEnvInfo, *sealEngine, tx, dev::eth::Permanence::Committed, OnOpFunc()));
+                pTx->receiptRoots.push_back(SpeculativeTx::InferReceiptRoot(pTx->results.back().txRec.stateRoot(), rootBefore, fork.rootHash()));
+            }
+
+            QtumAccessLog changed = pTx->reads;
+            fork.keepChanged(changed, pTx->root, pTx->rootUTXO);
+            pTx->writes.insert(changed);
+            pTx->deltas.push_back(fork.values(pTx->writes));
+        }
+        pTx->fDone = true;
+    } catch (const std::exception& e) {
+        LogPrint("qtum", "%s: speculative execution failed: %s\n", __func__, e.what());
+    } catch (...) {
+        LogPrint("qtum", "%s: speculative execution failed\n", __func__);
+    }
+    fork.setAccessLog(nullptr);
+    ReturnSealEngine(std::move(sealEngine));
+    return true;
+}
+
+SpeculativeExec::~SpeculativeExec()
+{
+    if (fSequential)
+        state.setAccessLog(nullptr);
+}
+
+void SpeculativeExec::Add(size_t nTx, const std::vector<QtumTransaction>& txs)
+{
+    mapTxs[nTx].txs = txs;
+}
+
+void SpeculativeExec::Run()
+{
+    boost::unique_lock<boost::mutex> lock(csContractExecQueue);
+    std::vector<CContractExecCheck> vChecks;
+    vChecks.reserve(mapTxs.size());
+    for (auto& it : mapTxs) {
+        SpeculativeTx& tx = it.second;
+        tx.fork = state.fork();
+        tx.root = state.rootHash();
+        tx.rootUTXO = state.rootHashUTXO();
+        vChecks.emplace_back(tx, envInfo, sealEngine);
+    }
+
+    if (nContractExecWorkers > 0 && vChecks.size() > 1) {
+        CCheckQueueControl<CContractExecCheck> control(&contractexecqueue);
+        control.Add(vChecks);
+        control.Wait();
+    } else {
+        for (CContractExecCheck& check : vChecks)
+            check();
+    }
+}
+
+bool SpeculativeExec::Apply(size_t nTx, const std::vector<QtumTransaction>& txs, std::vector<ResultExecute>& result)
+{
+    auto it = mapTxs.find(nTx);
+    if (it == mapTxs.end())
+        return false;
+
+    SpeculativeTx& tx = it->second;
+    if (!tx.fDone || !SameTransactions(tx.txs, txs) || tx.reads.intersects(written)) {
+        LogPrint("qtum", "%s: executing block transaction %u sequentially\n", __func__, nTx);
+        mapTxs.erase(it);
+        return false;
+    }
+
+    // Replaying the values of every execution keeps the intermediate state roots of the receipts
+    state.importNodes(*tx.fork);
+    for (size_t i = 0; i < tx.results.size(); i++) {
+        dev::h256 rootBefore = state.rootHash();
+        state.applyDelta(tx.deltas[i]);
+
+        const ResultExecute& res = tx.results[i];
+        if (tx.receiptRoots[i] == SpeculativeTx::ROOT_KEEP) {
+            result.push_back(res);
+        } else {
+            dev::h256 root = tx.receiptRoots[i] == SpeculativeTx::ROOT_BEFORE ? rootBefore : state.rootHash();
+            result.push_back(ResultExecute{res.execRes, dev::eth::TransactionReceipt(root, res.txRec.gasUsed(), res.txRec.log()), res.tx});
+        }
+    }
+    written.insert(tx.writes);
+    mapTxs.erase(it);
+    return true;
+}
+
+void SpeculativeExec::BeginSequential()
+{
+    // Only block transactions still waiting to be applied care about what is written
+    if (mapTxs.empty())
+        return;
+    fSequential = true;
+    logSequential.clear();
+    rootSequential = state.rootHash();
+    rootUTXOSequential = state.rootHashUTXO();
+    state.setAccessLog(&logSequential);
+}
+
+void SpeculativeExec::EndSequential()
+{
+    if (!fSequential)
+        return;
+    fSequential = false;
+    state.setAccessLog(nullptr);
+    state.keepChanged(logSequential, rootSequential, rootUTXOSequential);
+    written.insert(logSequential);
+}
+
+bool SpeculativeExecEnabled()
+{
+    return nContractExecWorkers > 0;
+}
+
+static void ThreadContractExec()
+{
+    RenameThread("vds-contractexec");
+    contractexecqueue.Thread();
+}
+
+void StartContractExecThreads(boost::thread_group& threadGroup, int nThreads)
+{
+    // The calling thread joins the pool as the last worker
+    for (int i = 0; i < nThreads - 1; i++) {
+        threadGroup.create_thread(&ThreadContractExec);
+        nContractExecWorkers++;
+    }
+}
+
+void StartContractExecThreads(boost::thread_group& threadGroup)
+{
+    // Unlike -par, 0 disables speculative execution
+    int nThreads = GetArg("-contractexecthreads", DEFAULT_CONTRACT_EXEC_THREADS);
+    if (nThreads == 0)
+        return;
+    if (nThreads < 0)
+        nThreads += GetNumCores();
+    if (nThreads > MAX_CONTRACT_EXEC_THREADS)
+        nThreads = MAX_CONTRACT_EXEC_THREADS;
+    if (nThreads <= 1)
+        return;
+
+    LogPrintf("Using %u threads for speculative contract execution\n", nThreads);
+    StartContractExecThreads(threadGroup, nThreads);
+}
@@ -0,0 +1,127 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef VDS_QTUM_SPECULATIVEEXEC_H
+#define VDS_QTUM_SPECULATIVEEXEC_H
+
+#include <qtum/qtumstate.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace boost
+{
+class thread_group;
+} // namespace boost
+
+/** Number of speculative contract execution threads, 0 = execute sequentially */
+static const int DEFAULT_CONTRACT_EXEC_THREADS = 0;
+/** Maximum number of speculative contract execution threads */
+static const int MAX_CONTRACT_EXEC_THREADS = 16;
+
+/** Contract executions of one block transaction, run ahead of time on a fork of the state */
+struct SpeculativeTx {
+    enum ReceiptRoot {
+        ROOT_KEEP,   //!< receipt carries no state root
+        ROOT_BEFORE, //!< receipt carries the state root from before the execution
+        ROOT_AFTER,  //!< receipt carries the state root after the execution
+    };
+
+    std::vector<QtumTransaction> txs;
+    std::unique_ptr<QtumState> fork;
+    dev::h256 root;
+    dev::h256 rootUTXO;
+
+    bool fDone = false;
+    QtumAccessLog reads;  //!< everything looked up or committed
+    QtumAccessLog writes; //!< addresses whose values differ from the fork base after any execution
+    std::vector<ResultExecute> results;
+    std::vector<ReceiptRoot> receiptRoots;
+    std::vector<QtumStateDelta> deltas; //!< per execution, values of all of writes so far
+
+    /** Which state root a receipt carries, given the roots around its execution; AFTER when they are the same */
+    static ReceiptRoot InferReceiptRoot(const dev::h256& receiptRoot, const dev::h256& rootBefore, const dev::h256& rootAfter);
+};
+
+/** Closure executing the contract transactions of one block transaction on its fork */
+class CContractExecCheck
+{
+private:
+    SpeculativeTx* pTx;
+    const dev::eth::EnvInfo* pEnvInfo;
+    const dev::eth::SealEngineFace* pSealEngine; //!< source of the schedule, executions run on an engine of their own
+
+public:
+    CContractExecCheck() : pTx(nullptr), pEnvInfo(nullptr), pSealEngine(nullptr) {}
+    CContractExecCheck(SpeculativeTx& tx, const dev::eth::EnvInfo& envInfo, const dev::eth::SealEngineFace& sealEngine) :
+        pTx(&tx), pEnvInfo(&envInfo), pSealEngine(&sealEngine) {}
+
+    bool operator()();
+
+    void swap(CContractExecCheck& check)
+    {
+        std::swap(pTx, check.pTx);
+        std::swap(pEnvInfo, check.pEnvInfo);
+        std::swap(pSealEngine, check.pSealEngine);
+    }
+};
+
+/**
+ * Optimistic concurrent execution of the contract transactions of a block.
+ *
+ * Every block transaction added is executed up front on its own fork of the
+ * state, in parallel on the contract execution threads, recording which
+ * account and UTXO trie entries it looked up. While the block is connected in
+ * order, Apply() commits a speculative result only if no block transaction
+ * committed before it changed an entry it looked up; its values are then
+ * exactly those a sequential execution would have produced. Otherwise the
+ * caller executes the transaction again on the state, bracketed by
+ * BeginSequential() and EndSequential() so that its changes are tracked too.
+ *
+ * Conflicts are detected per account, so transactions calling the same
+ * contract always end up executed sequentially.
+ */
+class SpeculativeExec
+{
+private:
+    QtumState& state;
+    dev::eth::EnvInfo envInfo;
+    const dev::eth::SealEngineFace& sealEngine;
+
+    std::map<size_t, SpeculativeTx> mapTxs;
+    QtumAccessLog written; //!< entries changed by the block transactions committed so far
+
+    bool fSequential = false;
+    QtumAccessLog logSequential;
+    dev::h256 rootSequential;
+    dev::h256 rootUTXOSequential;
+
+public:
+    SpeculativeExec(QtumState& stateIn, const dev::eth::EnvInfo& envInfoIn, const dev::eth::SealEngineFace& sealEngineIn) :
+        state(stateIn), envInfo(envInfoIn), sealEngine(sealEngineIn) {}
+    ~SpeculativeExec();
+
+    /** Queue the contract transactions of block transaction nTx */
+    void Add(size_t nTx, const std::vector<QtumTransaction>& txs);
+    size_t Size() const { return mapTxs.size(); }
+
+    /** Execute everything queued, on the contract execution threads when running */
+    void Run();
+
+    /** Commit the speculative results of block transaction nTx into the state if they are still valid */
+    bool Apply(size_t nTx, const std::vector<QtumTransaction>& txs, std::vector<ResultExecute>& result);
+
+    void BeginSequential();
+    void EndSequential();
+};
+
+/** Whether blocks should be connected with speculative contract execution (-contractexecthreads) */
+bool SpeculativeExecEnabled();
+/** Start the speculative contract execution threads (-contractexecthreads) */
+void StartContractExecThreads(boost::thread_group& threadGroup);
+/** Start a fixed number of speculative contract execution threads */
+void StartContractExecThreads(boost::thread_group& threadGroup, int nThreads);
+
+#endif // VDS_QTUM_SPECULATIVEEXEC_H
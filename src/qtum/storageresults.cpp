@@ -1,6 +1,76 @@
 #include <qtum/storageresults.h>
 
-StorageResults::StorageResults(std::string const& _path){
+#include "streams.h"
+#include "clientversion.h"
+
+/** Receipts are stored under the raw transaction hash, earlier versions used its hex */
+static std::string ResultKey(dev::h256 const& hashTx)
+{
+    return std::string((const char*)hashTx.data(), dev::h256::size);
+}
+
+template <typename Stream, unsigned N>
+static void WriteHash(Stream& s, dev::FixedHash<N> const& h)
+{
+    s.write((const char*)h.data(), N);
+}
+
+template <typename Stream, unsigned N>
+static void ReadHash(Stream& s, dev::FixedHash<N>& h)
+{
+    s.read((char*)h.data(), N);
+}
+
+/** Compact encoding of the receipts of a transaction, one after the other */
+static std::string EncodeReceipts(std::vector<TransactionReceiptInfo> const& receipts)
+{
+    CDataStream s(SER_DISK, CLIENT_VERSION);
+    WriteCompactSize(s, receipts.size());
+    for (TransactionReceiptInfo const& r : receipts) {
+        s << r.blockHash << VARINT(r.blockNumber) << r.transactionHash << VARINT(r.transactionIndex);
+        WriteHash(s, r.from);
+        WriteHash(s, r.to);
+        s << VARINT(r.cumulativeGasUsed) << VARINT(r.gasUsed);
+        WriteHash(s, r.contractAddress);
+        s << VARINT((uint32_t)r.excepted);
+        WriteCompactSize(s, r.logs.size());
+        for (dev::eth::LogEntry const& log : r.logs) {
+            WriteHash(s, log.address);
+            WriteCompactSize(s, log.topics.size());
+            for (dev::h256 const& topic : log.topics)
+                WriteHash(s, topic);
+            s << log.data;
+        }
+    }
+    return std::string(s.begin(), s.end());
+}
+
+static std::vector<TransactionReceiptInfo> DecodeReceipts(std::string const& value)
+{
+    CDataStream s(value.data(), value.data() + value.size(), SER_DISK, CLIENT_VERSION);
+    std::vector<TransactionReceiptInfo> receipts(ReadCompactSize(s));
+    for (TransactionReceiptInfo& r : receipts) {
+        s >> r.blockHash >> VARINT(r.blockNumber) >> r.transactionHash >> VARINT(r.transactionIndex);
+        ReadHash(s, r.from);
+        ReadHash(s, r.to);
+        s >> VARINT(r.cumulativeGasUsed) >> VARINT(r.gasUsed);
+        ReadHash(s, r.contractAddress);
+        uint32_t excepted;
+        s >> VARINT(excepted);
+        r.excepted = static_cast<dev::eth::TransactionException>(excepted);
+        r.logs.resize(ReadCompactSize(s));
+        for (dev::eth::LogEntry& log : r.logs) {
+            ReadHash(s, log.address);
+            log.topics.resize(ReadCompactSize(s));
+            for (dev::h256& topic : log.topics)
+                ReadHash(s, topic);
+            s >> log.data;
+        }
+    }
+    return receipts;
+}
+
+StorageResults::StorageResults(std::string const& _path, size_t _maxBytes) : m_maxBytes(_maxBytes){
 	path = _path + "/resultsDB";
     options.create_if_missing = true;
     leveldb::Status status = leveldb::DB::Open(options, path, &db);
@@ -10,133 +80,213 @@ StorageResults::StorageResults(std::string const& _path){
 
 StorageResults::~StorageResults()
 {
+    flush();
     delete db;
     db = NULL;
 }
 
 void StorageResults::addResult(dev::h256 hashTx, std::vector<TransactionReceiptInfo>& result){
-	m_cache_result.insert(std::make_pair(hashTx, result));
+    LOCK(cs);
+	m_cache_result[hashTx] = result;
 }
 
 void StorageResults::clearCacheResult(){
+    LOCK(cs);
     m_cache_result.clear();
 }
 
 void StorageResults::wipeResults(){
+    LOCK(cs);
+    m_cache_result.clear();
+    m_dirty.clear();
+    m_dirtyBytes = 0;
+    m_lru.clear();
+    m_index.clear();
+    m_cleanBytes = 0;
+    m_generation++;
     LogPrintf("Wiping LevelDB in %s\n", path);
     leveldb::Status result = leveldb::DestroyDB(path, leveldb::Options());
 }
 
 void StorageResults::deleteResults(std::vector<CTransactionRef> const& txs){
-
+    LOCK(cs);
+    m_generation++;
+    leveldb::WriteBatch batch;
     for(CTransactionRef tx : txs){
         dev::h256 hashTx = uintToh256(tx->GetHash());
         m_cache_result.erase(hashTx);
 
-        std::string keyTemp = hashTx.hex();
-	    leveldb::Slice key(keyTemp);
-        leveldb::Status status = db->Delete(leveldb::WriteOptions(), key);
-        assert(status.ok());
+        auto it = m_dirty.find(hashTx);
+        if (it != m_dirty.end()) {
+            m_dirtyBytes -= it->second.size() + c_entryOverhead;
+            m_dirty.erase(it);
+        }
+        auto itClean = m_index.find(hashTx);
+        if (itClean != m_index.end()) {
+            m_cleanBytes -= itClean->second->second.size() + c_entryOverhead;
+            m_lru.erase(itClean->second);
+            m_index.erase(itClean);
+        }
+
+        batch.Delete(ResultKey(hashTx));
+        batch.Delete(hashTx.hex());
     }
+    leveldb::Status status = db->Write(leveldb::WriteOptions(), &batch);
+    assert(status.ok());
 }
 
 std::vector<TransactionReceiptInfo> StorageResults::getResult(dev::h256 const& hashTx){
+    uint64_t generation;
+    {
+        LOCK(cs);
+        auto it = m_dirty.find(hashTx);
+        if (it != m_dirty.end()) {
+            m_hits++;
+            return DecodeReceipts(it->second);
+        }
+        auto itClean = m_index.find(hashTx);
+        if (itClean != m_index.end()) {
+            m_hits++;
+            m_lru.splice(m_lru.begin(), m_lru, itClean->second);
+            return DecodeReceipts(itClean->second->second);
+        }
+        m_misses++;
+        generation = m_generation;
+    }
+
+    // Read without the lock, a receipt is only written before it leaves m_dirty
+    std::string value;
+    bool legacy = false;
     std::vector<TransactionReceiptInfo> result;
-	auto it = m_cache_result.find(hashTx);
-	if (it == m_cache_result.end()){
-		if(readResult(hashTx, result))
-			m_cache_result.insert(std::make_pair(hashTx, result));
-    } else {
-		result = it->second;
+    if (!readResult(hashTx, value, legacy))
+        return result;
+    try {
+        result = legacy ? decodeLegacy(value) : DecodeReceipts(value);
+    } catch (const std::exception& e) {
+        LogPrintf("StorageResults: failed to decode receipts of %s: %s\n", hashTx.hex(), e.what());
+        return std::vector<TransactionReceiptInfo>();
+    }
+    if (legacy)
+        value = EncodeReceipts(result);
+
+    LOCK(cs);
+    // Receipts deleted meanwhile, e.g. by a reorg, must not come back through the cache
+    if (m_maxBytes > 0 && generation == m_generation && !m_dirty.count(hashTx) && !m_index.count(hashTx)) {
+        m_lru.emplace_front(hashTx, std::move(value));
+        m_index[hashTx] = m_lru.begin();
+        m_cleanBytes += m_lru.front().second.size() + c_entryOverhead;
+        evict();
     }
 	return result;
 }
 
-void StorageResults::commitResults(){
-    if(m_cache_result.size()){
-
+bool StorageResults::commitResults(){
+    bool fFlush;
+    {
+        LOCK(cs);
         for (auto const& i: m_cache_result){
-            std::string valueTemp;
-            std::string keyTemp = i.first.hex();
-            leveldb::Slice key(keyTemp);
-            leveldb::Status status = db->Get(leveldb::ReadOptions(), key, &valueTemp);
-
-            if(status.IsNotFound()){
-
-                TransactionReceiptInfoSerialized tris;
-
-                for(size_t j = 0; j < i.second.size(); j++){
-                    tris.blockHashes.push_back(uintToh256(i.second[j].blockHash));
-                    tris.blockNumbers.push_back(i.second[j].blockNumber);
-                    tris.transactionHashes.push_back(uintToh256(i.second[j].transactionHash));
-                    tris.transactionIndexes.push_back(i.second[j].transactionIndex);
-                    tris.senders.push_back(i.second[j].from);
-                    tris.receivers.push_back(i.second[j].to);
-                    tris.cumulativeGasUsed.push_back(dev::u256(i.second[j].cumulativeGasUsed));
-                    tris.gasUsed.push_back(dev::u256(i.second[j].gasUsed));
-                    tris.contractAddresses.push_back(i.second[j].contractAddress);
-                    tris.logs.push_back(logEntriesSerialization(i.second[j].logs));
-                    tris.excepted.push_back(uint32_t(static_cast<int>(i.second[j].excepted)));
-                }
-
-                dev::RLPStream streamRLP(11);
-                streamRLP << tris.blockHashes << tris.blockNumbers << tris.transactionHashes << tris.transactionIndexes << tris.senders;
-                streamRLP << tris.receivers << tris.cumulativeGasUsed << tris.gasUsed << tris.contractAddresses << tris.logs << tris.excepted;
-
-                dev::bytes data = streamRLP.out();
-                std::string stringData(data.begin(), data.end());
-                leveldb::Slice value(stringData);
-                status = db->Put(leveldb::WriteOptions(), key, value);
-                assert(status.ok());
+            std::string value = EncodeReceipts(i.second);
+            auto it = m_dirty.find(i.first);
+            if (it != m_dirty.end()) {
+                m_dirtyBytes -= it->second.size() + c_entryOverhead;
+                it->second = std::move(value);
+            } else {
+                it = m_dirty.emplace(i.first, std::move(value)).first;
             }
+            m_dirtyBytes += it->second.size() + c_entryOverhead;
         }
         m_cache_result.clear();
+        evict();
+        fFlush = m_dirtyBytes > m_maxBytes / 2;
     }
+    // Dirty receipts are not evicted, write them early rather than grow past the cache size
+    if (fFlush)
+        return flush();
+    return true;
 }
 
-bool StorageResults::readResult(dev::h256 const& _key, std::vector<TransactionReceiptInfo>& _result){
+bool StorageResults::flush(){
+    LOCK(cs);
+    if (m_dirty.empty())
+        return true;
 
-    std::string value;
-    std::string keyTemp = _key.hex();;
-    leveldb::Slice key(keyTemp);
-    leveldb::Status s = db->Get(leveldb::ReadOptions(), key, &value);
-
-	if(!s.IsNotFound() && s.ok()){
-        
-        TransactionReceiptInfoSerialized tris;
-
-		dev::RLP state(value);
-        tris.blockHashes = state[0].toVector<dev::h256>();
-		tris.blockNumbers = state[1].toVector<uint32_t>();
-		tris.transactionHashes = state[2].toVector<dev::h256>();
-        tris.transactionIndexes = state[3].toVector<uint32_t>();
-        tris.senders = state[4].toVector<dev::h160>();
-        tris.receivers = state[5].toVector<dev::h160>();
-        tris.cumulativeGasUsed = state[6].toVector<dev::u256>();
-        tris.gasUsed = state[7].toVector<dev::u256>();
-        tris.contractAddresses = state[8].toVector<dev::h160>();
-        tris.logs = state[9].toVector<logEntriesSerializ>();
-        if(state.itemCount() == 11)
-            tris.excepted = state[10].toVector<uint32_t>();
-
-        for(size_t j = 0; j < tris.blockHashes.size(); j++){
-            TransactionReceiptInfo tri{h256Touint(tris.blockHashes[j]), tris.blockNumbers[j], h256Touint(tris.transactionHashes[j]), tris.transactionIndexes[j], tris.senders[j],
-                                       tris.receivers[j], uint64_t(tris.cumulativeGasUsed[j]), uint64_t(tris.gasUsed[j]), tris.contractAddresses[j], logEntriesDeserialize(tris.logs[j]), 
-                                       state.itemCount() == 11 ? static_cast<dev::eth::TransactionException>(tris.excepted[j]) : dev::eth::TransactionException::NoInformation
-                                    };
-            _result.push_back(tri);
+    leveldb::WriteBatch batch;
+    for (auto const& i: m_dirty)
+        batch.Put(ResultKey(i.first), i.second);
+    leveldb::Status status = db->Write(leveldb::WriteOptions(), &batch);
+    if (!status.ok()) {
+        LogPrintf("StorageResults: failed to write receipts: %s\n", status.ToString());
+        return false;
+    }
+
+    // Receipts of recent blocks are the most likely to be asked for
+    for (auto& i: m_dirty) {
+        auto itClean = m_index.find(i.first);
+        if (itClean != m_index.end()) {
+            m_cleanBytes -= itClean->second->second.size() + c_entryOverhead;
+            m_lru.erase(itClean->second);
+            m_index.erase(itClean);
         }
-		return true;
-	}
-	return false;
+        m_cleanBytes += i.second.size() + c_entryOverhead;
+        m_lru.emplace_front(i.first, std::move(i.second));
+        m_index[i.first] = m_lru.begin();
+    }
+    m_dirty.clear();
+    m_dirtyBytes = 0;
+    evict();
+    return true;
 }
 
-logEntriesSerializ StorageResults::logEntriesSerialization(dev::eth::LogEntries const& _logs){
-	logEntriesSerializ result;
-	for(dev::eth::LogEntry i : _logs){
-		result.push_back(std::make_pair(i.address, std::make_pair(i.topics, i.data)));
-	}
-	return result;
+StorageResults::Stats StorageResults::stats() const{
+    LOCK(cs);
+    return Stats{m_hits, m_misses, m_dirty.size() + m_lru.size(), m_dirty.size(), m_dirtyBytes + m_cleanBytes, m_maxBytes};
+}
+
+void StorageResults::evict(){
+    AssertLockHeld(cs);
+    while (!m_lru.empty() && m_dirtyBytes + m_cleanBytes > m_maxBytes) {
+        m_cleanBytes -= m_lru.back().second.size() + c_entryOverhead;
+        m_index.erase(m_lru.back().first);
+        m_lru.pop_back();
+    }
+}
+
+bool StorageResults::readResult(dev::h256 const& _key, std::string& _value, bool& _legacy){
+    leveldb::Status s = db->Get(leveldb::ReadOptions(), ResultKey(_key), &_value);
+    _legacy = false;
+    if (s.IsNotFound()) {
+        s = db->Get(leveldb::ReadOptions(), _key.hex(), &_value);
+        _legacy = true;
+    }
+    return s.ok();
+}
+
+std::vector<TransactionReceiptInfo> StorageResults::decodeLegacy(std::string const& value){
+    std::vector<TransactionReceiptInfo> _result;
+    TransactionReceiptInfoSerialized tris;
+
+    dev::RLP state(value);
+    tris.blockHashes = state[0].toVector<dev::h256>();
+    tris.blockNumbers = state[1].toVector<uint32_t>();
+    tris.transactionHashes = state[2].toVector<dev::h256>();
+    tris.transactionIndexes = state[3].toVector<uint32_t>();
+    tris.senders = state[4].toVector<dev::h160>();
+    tris.receivers = state[5].toVector<dev::h160>();
+    tris.cumulativeGasUsed = state[6].toVector<dev::u256>();
+    tris.gasUsed = state[7].toVector<dev::u256>();
+    tris.contractAddresses = state[8].toVector<dev::h160>();
+    tris.logs = state[9].toVector<logEntriesSerializ>();
+    if(state.itemCount() == 11)
+        tris.excepted = state[10].toVector<uint32_t>();
+
+    for(size_t j = 0; j < tris.blockHashes.size(); j++){
+        TransactionReceiptInfo tri{h256Touint(tris.blockHashes[j]), tris.blockNumbers[j], h256Touint(tris.transactionHashes[j]), tris.transactionIndexes[j], tris.senders[j],
+                                   tris.receivers[j], uint64_t(tris.cumulativeGasUsed[j]), uint64_t(tris.gasUsed[j]), tris.contractAddresses[j], logEntriesDeserialize(tris.logs[j]), 
+                                   state.itemCount() == 11 ? static_cast<dev::eth::TransactionException>(tris.excepted[j]) : dev::eth::TransactionException::NoInformation
+                                };
+        _result.push_back(tri);
+    }
+    return _result;
 }
 
 dev::eth::LogEntries StorageResults::logEntriesDeserialize(logEntriesSerializ const& _logs){
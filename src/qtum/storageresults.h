@@ -2,8 +2,11 @@
 #include <primitives/transaction.h>
 #include <libethereum/State.h>
 #include <libethereum/Transaction.h>
+#include "sync.h"
 #include "util.h"
 
+#include <list>
+
 using logEntriesSerializ = std::vector<std::pair<dev::Address, std::pair<dev::h256s, dev::bytes>>>;
 
 struct TransactionReceiptInfo {
@@ -34,10 +37,19 @@ struct TransactionReceiptInfoSerialized {
     std::vector<uint32_t> excepted;
 };
 
+/**
+ * Contract receipts by transaction hash.
+ *
+ * Receipts of the block being connected are staged until the block is,
+ * then they are kept dirty in memory and written in one batch when the
+ * chainstate is flushed, or earlier if they take half the cache. Written
+ * receipts stay cached until the cache size is reached. Receipts are read
+ * under a lock of their own, so readers do not need cs_main.
+ */
 class StorageResults {
 public:
 
-    StorageResults(std::string const& _path);
+    StorageResults(std::string const& _path, size_t _maxBytes);
     ~StorageResults();
 
     void addResult(dev::h256 hashTx, std::vector<TransactionReceiptInfo>& result);
@@ -46,20 +58,42 @@ public:
 
     std::vector<TransactionReceiptInfo> getResult(dev::h256 const& hashTx);
 
-    void commitResults();
+    /// The block of the staged receipts was connected, false if writing them early failed
+    bool commitResults();
 
+    /// Drop the staged receipts of a block that was not connected
     void clearCacheResult();
 
+    /// Write the receipts of connected blocks to disk
+    bool flush();
+
+    struct Stats
+    {
+        uint64_t hits;
+        uint64_t misses;
+        size_t entries;
+        size_t dirty;
+        size_t bytes;
+        size_t maxBytes;
+    };
+
+    Stats stats() const;
+
     void wipeResults();
 
-private:
+    /// Approximate memory used by a cached entry besides its value
+    static const size_t c_entryOverhead = 128;
 
-    bool readResult(dev::h256 const& _key, std::vector<TransactionReceiptInfo>& _result);
+private:
 
-    logEntriesSerializ logEntriesSerialization(dev::eth::LogEntries const& _logs);
+    bool readResult(dev::h256 const& _key, std::string& _value, bool& _legacy);
 
     dev::eth::LogEntries logEntriesDeserialize(logEntriesSerializ const& _logs);
 
+    std::vector<TransactionReceiptInfo> decodeLegacy(std::string const& _value);
+
+    void evict();
+
     std::string path;
 
     leveldb::DB* db;
@@ -67,4 +101,18 @@ private:
     leveldb::Options options;
 
     std::unordered_map<dev::h256, std::vector<TransactionReceiptInfo>> m_cache_result;
+
+    mutable CCriticalSection cs;
+    /// Encoded receipts of connected blocks not written yet
+    std::unordered_map<dev::h256, std::string> m_dirty;
+    size_t m_dirtyBytes = 0;
+    /// Encoded receipts on disk, most recently used first
+    std::list<std::pair<dev::h256, std::string>> m_lru;
+    std::unordered_map<dev::h256, std::list<std::pair<dev::h256, std::string>>::iterator> m_index;
+    size_t m_cleanBytes = 0;
+    size_t m_maxBytes;
+    /// Bumped whenever receipts are deleted, a read from disk that raced with it is not cached
+    uint64_t m_generation = 0;
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
 };
@@ -20,6 +20,7 @@
 #include "util.h"
 #include "utilstrencodings.h"
 #include "hash.h"
+#include "qtum/contractcallpool.h"
 #include <key_io.h>
 #include <stdint.h>
 
@@ -560,8 +561,6 @@ UniValue callcontract(const JSONRPCRequest& request)
             "4. gasLimit             (string, optional) The gas limit for executing the contract\n"
         );
 
-    LOCK(cs_main);
-
     std::string strAddr = request.params[0].get_str();
     std::string data = request.params[1].get_str();
 
@@ -572,8 +571,6 @@ UniValue callcontract(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Incorrect address");
 
     dev::Address addrAccount(strAddr);
-    if (!globalState->addressInUse(addrAccount))
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Address does not exist");
 
     dev::Address senderAddress;
     if (request.params.size() == 3) {
@@ -594,14 +591,30 @@ UniValue callcontract(const JSONRPCRequest& request)
     }
 
 
-    std::vector<ResultExecute> execResults = CallContract(addrAccount, ParseHex(data), senderAddress, gasLimit);
+    // Executed on a snapshot of the tip without holding cs_main when the contract call pool is running
+    CContractCallPool::Result callResult;
+    if (!pContractCallPool || !pContractCallPool->Call(addrAccount, ParseHex(data), senderAddress, gasLimit, callResult)) {
+        LOCK(cs_main);
+        if (!globalState->addressInUse(addrAccount))
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Address does not exist");
+        callResult.results = CallContract(addrAccount, ParseHex(data), senderAddress, gasLimit);
+        callResult.nHeight = chainActive.Height();
+        callResult.fAddressInUse = true;
+        callResult.fTimedOut = false;
+    }
+    if (!callResult.fAddressInUse)
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Address does not exist");
+    std::vector<ResultExecute>& execResults = callResult.results;
 
     if (fRecordLogOpcodes) {
+        LOCK(cs_main);
         writeVMlog(execResults);
     }
 
     UniValue result(UniValue::VOBJ);
     result.push_back(Pair("address", strAddr));
+    result.push_back(Pair("height", callResult.nHeight));
+    result.push_back(Pair("timedOut", callResult.fTimedOut));
     result.push_back(Pair("executionResult", executionResultToJSON(execResults[0].execRes)));
     result.push_back(Pair("transactionReceipt", transactionReceiptToJSON(execResults[0].txRec)));
 
@@ -783,6 +796,14 @@ void parseParam(const UniValue& val, std::vector<boost::optional<dev::h256>>& h2
     });
 }
 
+/** Bloom bits a log with topic among its topics sets, see dev::eth::LogEntry::bloom */
+static dev::eth::LogBloom TopicLogBloom(const dev::h256& topic)
+{
+    dev::eth::LogBloom bloom;
+    bloom.shiftBloom<3>(dev::sha3(topic.ref()));
+    return bloom;
+}
+
 class WaitForLogsParams
 {
 public:
@@ -867,11 +888,21 @@ UniValue waitforlogs(const JSONRPCRequest& request_)
     auto& addresses = params.addresses;
     auto& filterTopics = params.topics;
 
+    // A matching log has all the filter topics
+    std::vector<dev::h2048> blooms;
+    for (const auto& topic : filterTopics) {
+        if (topic) {
+            if (blooms.empty())
+                blooms.push_back(dev::h2048());
+            blooms[0] |= TopicLogBloom(topic.get());
+        }
+    }
+
     while (curheight == 0) {
         {
             LOCK(cs_main);
             curheight = pblocktree->ReadHeightIndex(params.fromBlock, params.toBlock, params.minconf,
-                                                    hashesToBlock, addresses);
+                                                    hashesToBlock, addresses, blooms);
         }
 
         // if curheight >= fromBlock. Blockchain extended with new log entries. Return next block height to client.
@@ -1041,7 +1072,14 @@ UniValue searchlogs(const JSONRPCRequest& request)
 
     std::vector<std::vector < uint256>> hashesToBlock;
 
-    curheight = pblocktree->ReadHeightIndex(params.fromBlock, params.toBlock, params.minconf, hashesToBlock, params.addresses);
+    // A matching receipt has one of the filter topics
+    std::vector<dev::h2048> blooms;
+    for (const auto& topic : params.topics) {
+        if (topic)
+            blooms.push_back(TopicLogBloom(topic.get()));
+    }
+
+    curheight = pblocktree->ReadHeightIndex(params.fromBlock, params.toBlock, params.minconf, hashesToBlock, params.addresses, blooms);
 
     if (curheight == -1) {
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Incorrect params");
@@ -1110,8 +1148,7 @@ UniValue gettransactionreceipt(const JSONRPCRequest& request)
     if (!fLogEvents)
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Events indexing disabled");
 
-    LOCK(cs_main);
-
+    // Receipts are read under their own lock
     std::string hashTemp = request.params[0].get_str();
     if (hashTemp.size() != 64) {
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Incorrect hash");
@@ -1247,6 +1284,18 @@ UniValue gettxoutsetinfo(const JSONRPCRequest& request)
             "  \"bytes_serialized\": n,  (numeric) The serialized size\n"
             "  \"hash_serialized\": \"hash\",   (string) The serialized hash\n"
             "  \"total_amount\": x.xxx          (numeric) The total amount\n"
+            "  \"shielded_index\": {           (json object) The in memory Sapling state\n"
+            "    \"nullifiers_loaded\": true|false, (boolean) Whether the nullifier set was loaded, it is on the first lookup\n"
+            "    \"nullifiers\": n,            (numeric) The number of nullifiers in the set\n"
+            "    \"nullifiers_usage\": n,      (numeric) Memory used by the set and its filter in bytes\n"
+            "    \"nullifier_lookups\": n,     (numeric) The number of nullifier lookups\n"
+            "    \"nullifier_filtered\": n,    (numeric) Lookups answered by the bloom filter\n"
+            "    \"nullifier_hits\": n,        (numeric) Lookups that found a spent nullifier\n"
+            "    \"anchors\": n,               (numeric) The number of cached anchors\n"
+            "    \"anchors_usage\": n,         (numeric) Memory used by the anchor cache in bytes\n"
+            "    \"anchor_lookups\": n,        (numeric) The number of anchor lookups\n"
+            "    \"anchor_hits\": n            (numeric) Lookups answered by the cache\n"
+            "  }\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("gettxoutsetinfo", "")
@@ -1266,6 +1315,21 @@ UniValue gettxoutsetinfo(const JSONRPCRequest& request)
         ret.push_back(Pair("disk_size", stats.nDiskSize));
         ret.push_back(Pair("total_amount", ValueFromAmount(stats.nTotalAmount)));
     }
+
+    CShieldedIndexStats shieldedStats;
+    pcoinsdbview->GetShieldedIndexStats(shieldedStats);
+    UniValue shielded(UniValue::VOBJ);
+    shielded.push_back(Pair("nullifiers_loaded", shieldedStats.fNullifiersLoaded));
+    shielded.push_back(Pair("nullifiers", shieldedStats.nNullifiers));
+    shielded.push_back(Pair("nullifiers_usage", shieldedStats.nNullifierUsage));
+    shielded.push_back(Pair("nullifier_lookups", shieldedStats.nNullifierLookups));
+    shielded.push_back(Pair("nullifier_filtered", shieldedStats.nNullifierFiltered));
+    shielded.push_back(Pair("nullifier_hits", shieldedStats.nNullifierHits));
+    shielded.push_back(Pair("anchors", shieldedStats.nAnchors));
+    shielded.push_back(Pair("anchors_usage", shieldedStats.nAnchorUsage));
+    shielded.push_back(Pair("anchor_lookups", shieldedStats.nAnchorLookups));
+    shielded.push_back(Pair("anchor_hits", shieldedStats.nAnchorHits));
+    ret.push_back(Pair("shielded_index", shielded));
     return ret;
 }
 
@@ -1377,6 +1441,142 @@ UniValue verifychain(const JSONRPCRequest& request)
     return CVerifyDB().VerifyDB(Params(), pcoinsTip, pclueTip, nCheckLevel, nCheckDepth);
 }
 
+UniValue getclueseasonrank(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 3)
+        throw runtime_error(
+            "getclueseasonrank season ( start count )\n"
+            "\nReturns a window of the clue ranking of a season.\n"
+            "\nArguments:\n"
+            "1. season       (numeric, required) The season index\n"
+            "2. start        (numeric, optional, default=1) The first rank position to return\n"
+            "3. count        (numeric, optional, default=20) The number of positions to return\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"rank\" : n,            (numeric) The rank position, starting at 1\n"
+            "    \"address\" : \"xxx\",   (string) The ranked address\n"
+            "    \"value\" : x.xxx,       (numeric) The clue value in " + CURRENCY_UNIT + "\n"
+            "    \"invitees\" : n,        (numeric) The number of invitees\n"
+            "    \"weight\" : x.xxx       (numeric) The rank weight\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getclueseasonrank", "1 1 10")
+            + HelpExampleRpc("getclueseasonrank", "1, 1, 10")
+        );
+
+    int nSeason = request.params[0].get_int();
+    if (nSeason < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid season");
+
+    int start = 1;
+    if (request.params.size() > 1) {
+        start = request.params[1].get_int();
+        if (start <= 0)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid start, min=1");
+    }
+
+    int count = 20;
+    if (request.params.size() > 2) {
+        count = request.params[2].get_int();
+        if (count <= 0)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid count");
+    }
+
+    LOCK(cs_main);
+
+    UniValue result(UniValue::VARR);
+    const CSeasonRank* pRank = pclueTip->GetSeasonRank(nSeason);
+    if (!pRank || (size_t)start > pRank->size())
+        return result;
+
+    int nPosition = start;
+    for (CSeasonRank::const_iterator it = std::next(pRank->begin(), start - 1); it != pRank->end() && nPosition < start + count; it++, nPosition++) {
+        UniValue entry(UniValue::VOBJ);
+        entry.push_back(Pair("rank", nPosition));
+        entry.push_back(Pair("address", EncodeDestination(it->address)));
+        entry.push_back(Pair("value", ValueFromAmount(it->item.nValue)));
+        entry.push_back(Pair("invitees", it->item.nInvitees));
+        entry.push_back(Pair("weight", it->item.dWeight));
+        result.push_back(entry);
+    }
+    return result;
+}
+
+UniValue getcontractstatecacheinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw runtime_error(
+            "getcontractstatecacheinfo\n"
+            "\nReturns statistics of the cache of contract state read from disk (see -contractstatecache).\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"hits\" : n,         (numeric) Lookups served from the cache\n"
+            "  \"misses\" : n,       (numeric) Lookups that went to disk\n"
+            "  \"entries\" : n,      (numeric) Number of trie nodes cached\n"
+            "  \"usage\" : n,        (numeric) Approximate memory used, in bytes\n"
+            "  \"maxsize\" : n       (numeric) Size limit, in bytes\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getcontractstatecacheinfo", "")
+            + HelpExampleRpc("getcontractstatecacheinfo", "")
+        );
+
+    LOCK(cs_main);
+
+    const std::shared_ptr<dev::OverlayDBCache>& cache = globalState->db().cache();
+    if (!cache)
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Contract state is not loaded");
+    dev::OverlayDBCache::Stats stats = cache->stats();
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("hits", stats.hits));
+    ret.push_back(Pair("misses", stats.misses));
+    ret.push_back(Pair("entries", (uint64_t)stats.entries));
+    ret.push_back(Pair("usage", (uint64_t)stats.bytes));
+    ret.push_back(Pair("maxsize", (uint64_t)stats.maxBytes));
+    return ret;
+}
+
+UniValue getreceiptcacheinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw runtime_error(
+            "getreceiptcacheinfo\n"
+            "\nReturns statistics of the cache of contract receipts (see -receiptcache).\n"
+            "requires -logevents to be enabled\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"hits\" : n,         (numeric) Lookups served from the cache\n"
+            "  \"misses\" : n,       (numeric) Lookups that went to disk\n"
+            "  \"entries\" : n,      (numeric) Number of transactions whose receipts are cached\n"
+            "  \"dirty\" : n,        (numeric) Of these, the ones not written to disk yet\n"
+            "  \"usage\" : n,        (numeric) Approximate memory used, in bytes\n"
+            "  \"maxsize\" : n       (numeric) Size limit, in bytes\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getreceiptcacheinfo", "")
+            + HelpExampleRpc("getreceiptcacheinfo", "")
+        );
+
+    if (!fLogEvents)
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Events indexing disabled");
+
+    // Receipts are read under their own lock
+    StorageResults::Stats stats = pstorageresult->stats();
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("hits", stats.hits));
+    ret.push_back(Pair("misses", stats.misses));
+    ret.push_back(Pair("entries", (uint64_t)stats.entries));
+    ret.push_back(Pair("dirty", (uint64_t)stats.dirty));
+    ret.push_back(Pair("usage", (uint64_t)stats.bytes));
+    ret.push_back(Pair("maxsize", (uint64_t)stats.maxBytes));
+    return ret;
+}
+
 /** Implementation of IsSuperMajority with better feedback */
 static UniValue SoftForkMajorityDesc(int minVersion, CBlockIndex* pindex, int nRequired, const Consensus::Params& consensusParams)
 {
@@ -1704,6 +1904,9 @@ static const CRPCCommand commands[] = {
     { "blockchain",         "gettxout",               &gettxout,               true,  {"txid", "n", "include_mempool"} },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true,  {} },
     { "blockchain",         "verifychain",            &verifychain,            true,  {"checklevel", "nblocks"} },
+    { "blockchain",         "getclueseasonrank",      &getclueseasonrank,      true,  {"season", "start", "count"} },
+    { "blockchain",         "getcontractstatecacheinfo", &getcontractstatecacheinfo, true, {} },
+    { "blockchain",         "getreceiptcacheinfo",    &getreceiptcacheinfo,    true,  {} },
 #ifdef VDEBUG
     { "blockchain",         "callcontract",           &callcontract,           true,  {"address", "data"} }, // qtum
 
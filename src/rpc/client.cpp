@@ -120,6 +120,8 @@ static const CRPCConvertParam vRPCConvertParams[] = {
     { "getblockheader", 1, "verbose" },
     { "gettransaction", 1, "include_watchonly" },
     { "getrawtransaction", 1, "verbose" },
+    { "getrawtransactions", 0, "txids" },
+    { "getrawtransactions", 1, "verbose" },
     { "createrawtransaction", 0, "inputs" },
     { "createrawtransaction", 1, "outputs" },
     { "createrawtransaction", 2, "locktime" },
@@ -139,6 +141,9 @@ static const CRPCConvertParam vRPCConvertParams[] = {
     { "importaddress", 3, "p2sh" },
     { "verifychain", 0, "checklevel" },
     { "verifychain", 1, "nblocks" },
+    { "getclueseasonrank", 0, "season" },
+    { "getclueseasonrank", 1, "start" },
+    { "getclueseasonrank", 2, "count" },
     { "keypoolrefill", 0, "newsize" },
     { "getrawmempool", 0, "verbose" },
     { "estimatefee", 0, "nblocks" },
@@ -163,6 +168,7 @@ static const CRPCConvertParam vRPCConvertParams[] = {
     { "v_sendmany", 2, "minconf"},
     { "v_sendmany", 3, "fee"},
     { "v_getoperationstatus", 0, "operationid"},
+    { "v_getoperationstatus", 1, "timing"},
     { "v_getoperationresult", 0, "operationid"},
     { "v_importkey", 2, "startHeight"},
     { "listbid", 0, "count"},
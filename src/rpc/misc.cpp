@@ -831,7 +831,7 @@ UniValue getutxoatheight(const JSONRPCRequest& request)
     if (request.fHelp || request.params.size() != 1)
         throw std::runtime_error(
             "getutxoatheight\n"
-            "\nReturns the utxos for an address (requires addressindex to be enabled). \n"
+            "\nReturns the utxos of addresses at a block height (requires addressindex to be enabled). \n"
             "\nArguments:\n"
             "{\n"
             "  \"addresses\"\n"
@@ -839,22 +839,30 @@ UniValue getutxoatheight(const JSONRPCRequest& request)
             "      \"address\"  (string) The base58check encoded address\n"
             "      ,...\n"
             "    ]\n"
-            "  \"start\" (number) The start block height\n"
-            "  \"end\" (number) The end block height\n"
-            "  \"limit\" (number) The amount limit\n"
+            "  \"start\" (number, optional) Only outputs created at or after this height\n"
+            "  \"end\" (number, optional, default=chain height) The height the outputs are unspent at\n"
+            "  \"limit\" (number, optional) Only outputs of at least this many satoshis\n"
+            "  \"count\" (number, optional) Return at most this many outputs and a cursor for the next page\n"
+            "  \"cursor\" (string, optional) The cursor returned with the previous page\n"
             "}\n"
             "\nResult\n"
             "[\n"
             "  {\n"
             "    \"txid\"  (string) The output txid\n"
-            "    \"outputIndex\"  (number) The output index\n"
-            "    \"script\"  (string) The script hex encoded\n"
-            "    \"satoshis\"  (number) The number of duffs of the output\n"
+            "    \"vout\"  (number) The output index\n"
+            "    \"value\"  (number) The number of satoshis of the output\n"
+            "    \"amount\"  (string) The amount of the output\n"
             "    \"height\"  (number) The block height\n"
             "  }\n"
             "]\n"
+            "\nResult (with count)\n"
+            "{\n"
+            "  \"utxos\": [...]  (array) The outputs, as above\n"
+            "  \"cursor\": \"xxxx\"  (string) Pass this to get the next page, null after the last one\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getutxoatheight", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}'")
+            + HelpExampleCli("getutxoatheight", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"], \"end\": 10000, \"count\": 1000}'")
             + HelpExampleRpc("getutxoatheight", "{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}")
         );
 
@@ -865,71 +873,104 @@ UniValue getutxoatheight(const JSONRPCRequest& request)
     }
 
     int start = 0;
-    int end = 0;
+    int end = -1;
     CAmount valueLimit = 0;
+    size_t count = 0;
+    bool fCursor = false;
+    CAddressOutputKey cursor;
     if (request.params[0].isObject()) {
         UniValue startValue = find_value(request.params[0].get_obj(), "start");
         UniValue endValue = find_value(request.params[0].get_obj(), "end");
         UniValue limit = find_value(request.params[0].get_obj(), "limit");
-        if (startValue.isNum() && endValue.isNum()) {
+        UniValue countValue = find_value(request.params[0].get_obj(), "count");
+        UniValue cursorValue = find_value(request.params[0].get_obj(), "cursor");
+        if (startValue.isNum()) {
             start = startValue.get_int();
+        }
+        if (endValue.isNum()) {
             end = endValue.get_int();
         }
 
         if (limit.isNum()) {
             valueLimit = limit.get_int64();
         }
+
+        if (countValue.isNum()) {
+            if (countValue.get_int() <= 0)
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "count must be positive");
+            count = countValue.get_int();
+        }
+        if (cursorValue.isStr()) {
+            std::string strCursor = cursorValue.get_str();
+            if (!IsHex(strCursor))
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+            try {
+                CDataStream ssCursor(ParseHex(strCursor), SER_DISK, CLIENT_VERSION);
+                ssCursor >> cursor;
+            } catch (const std::exception&) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+            }
+            fCursor = true;
+        }
     }
 
+    if (end < 0) {
+        LOCK(cs_main);
+        end = chainActive.Height();
+    }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    // Continue with the address the cursor points into
+    std::vector<std::pair<uint160, int> >::const_iterator it = addresses.begin();
+    if (fCursor) {
+        while (it != addresses.end() && !(it->first == cursor.hashBytes && it->second == (int)cursor.type))
+            it++;
+        if (it == addresses.end())
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Cursor does not match the addresses");
+    }
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
+    std::vector<CUtxo> vTxOut;
+    CAddressOutputKey keyLast;
+    bool fMore = false;
+    for (; it != addresses.end(); it++) {
+        const CAddressOutputKey* pkeyAfter = fCursor ? &cursor : nullptr;
+        fCursor = false;
+        do {
+            // Outputs spent in the mempool are left out, keep reading until the page is full
+            size_t maxResults = count ? count - vTxOut.size() : std::numeric_limits<size_t>::max();
+            if (!GetAddressUTXOAtHeight(it->first, it->second, start, end, valueLimit, pkeyAfter, maxResults, vTxOut, keyLast, fMore)) {
                 throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
             }
-        }
+            pkeyAfter = &keyLast;
+        } while (fMore && vTxOut.size() < count);
+
+        if (count && vTxOut.size() >= count)
+            break;
     }
 
     UniValue result(UniValue::VARR);
+    for (const CUtxo& txout : vTxOut) {
+        UniValue output(UniValue::VOBJ);
+        output.push_back(Pair("txid", txout.txid.GetHex()));
+        output.push_back(Pair("vout", (int)txout.n));
+        output.push_back(Pair("value", txout.nValue));
+        output.push_back(Pair("amount", FormatMoney(txout.nValue)));
+        output.push_back(Pair("height", txout.nHeight));
+        result.push_back(output);
+    }
 
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it = addressIndex.begin(); it != addressIndex.end(); it++) {
-        int height = it->first.blockHeight;
-        uint256 txid = it->first.txhash;
-
-        if (it->second >= valueLimit) {
-            CSpentIndexKey key(txid, it->first.index);
-            CSpentIndexValue value;
-
-            if (!GetSpentIndex(key, value)) {
-                UniValue output(UniValue::VOBJ);
-                output.push_back(Pair("txid", txid.GetHex()));
-                output.push_back(Pair("vout", it->first.index));
-                output.push_back(Pair("value", it->second));
-                output.push_back(Pair("amount", FormatMoney(it->second)));
-                output.push_back(Pair("height", height));
-                result.push_back(output);
-                continue;
-            }
+    if (!count)
+        return result;
 
-            if (value.blockHeight > end && end >= 0) {
-                UniValue output(UniValue::VOBJ);
-                output.push_back(Pair("txid", txid.GetHex()));
-                output.push_back(Pair("vout", it->first.index));
-                output.push_back(Pair("value", it->second));
-                output.push_back(Pair("amount", FormatMoney(it->second)));
-                output.push_back(Pair("height", height));
-                result.push_back(output);
-            }
-        }
+    UniValue page(UniValue::VOBJ);
+    page.push_back(Pair("utxos", result));
+    if (it != addresses.end() && (fMore || it + 1 != addresses.end())) {
+        CDataStream ssCursor(SER_DISK, CLIENT_VERSION);
+        ssCursor << keyLast;
+        page.push_back(Pair("cursor", HexStr(ssCursor.begin(), ssCursor.end())));
+    } else {
+        page.push_back(Pair("cursor", NullUniValue));
     }
-
-    return result;
+    return page;
 }
 
 UniValue setmocktime(const JSONRPCRequest& request)
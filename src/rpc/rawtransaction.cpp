@@ -301,6 +301,78 @@ UniValue getrawtransaction(const JSONRPCRequest& request)
     return result;
 }
 
+UniValue getrawtransactions(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw runtime_error(
+            "getrawtransactions [\"txid\",...] ( verbose )\n"
+            "\nReturn the raw data of up to " + std::to_string(MAX_TX_BATCH_SZ) + " transactions, like getrawtransaction does for one.\n"
+            "Transactions are looked up together and every block is read once, which is much faster than asking for them one by one.\n"
+
+            "\nArguments:\n"
+            "1. \"txids\"       (string, required) A json array of transaction ids\n"
+            "    [\n"
+            "      \"txid\"     (string) A transaction id\n"
+            "      ,...\n"
+            "    ]\n"
+            "2. verbose       (bool, optional, default=false) If false, return strings, otherwise return json objects\n"
+
+            "\nResult:\n"
+            "[                 (array) One entry per txid, in the same order\n"
+            "  \"data\"          (string) The serialized, hex-encoded data, or an object as described in getrawtransaction if verbose\n"
+            "                  is set. null if there is no information available about the transaction\n"
+            "  ,...\n"
+            "]\n"
+
+            "\nExamples:\n"
+            + HelpExampleCli("getrawtransactions", "\"[\\\"mytxid\\\",\\\"othertxid\\\"]\"")
+            + HelpExampleCli("getrawtransactions", "\"[\\\"mytxid\\\",\\\"othertxid\\\"]\" true")
+            + HelpExampleRpc("getrawtransactions", "[\"mytxid\",\"othertxid\"], true")
+        );
+
+    UniValue txids = request.params[0].get_array();
+    if (txids.size() > MAX_TX_BATCH_SZ)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Too many transactions, at most %u", MAX_TX_BATCH_SZ));
+    std::vector<uint256> hashes;
+    for (unsigned int i = 0; i < txids.size(); i++)
+        hashes.push_back(ParseHashV(txids[i], "txid"));
+
+    bool fVerbose = false;
+    if (request.params.size() > 1) {
+        if (request.params[1].isNum()) {
+            fVerbose = request.params[1].get_int() != 0;
+        } else if (request.params[1].isBool()) {
+            fVerbose = request.params[1].isTrue();
+        } else {
+            throw JSONRPCError(RPC_TYPE_ERROR, "Invalid type provided. Verbose parameter must be a boolean.");
+        }
+    }
+
+    // Looked up without cs_main, only the verbose details need the chain
+    std::vector<CTransactionRef> vtx;
+    std::vector<uint256> vHashBlock;
+    GetTransactions(hashes, vtx, vHashBlock, Params().GetConsensus(), true);
+
+    UniValue result(UniValue::VARR);
+    LOCK(cs_main);
+    for (size_t i = 0; i < vtx.size(); i++) {
+        if (!vtx[i]) {
+            result.push_back(NullUniValue);
+            continue;
+        }
+        string strHex = EncodeHexTx(*vtx[i]);
+        if (!fVerbose) {
+            result.push_back(strHex);
+            continue;
+        }
+        UniValue entry(UniValue::VOBJ);
+        entry.push_back(Pair("hex", strHex));
+        TxToJSON(*vtx[i], vHashBlock[i], entry);
+        result.push_back(entry);
+    }
+    return result;
+}
+
 UniValue gettxoutproof(const JSONRPCRequest& request)
 {
     if (request.fHelp || (request.params.size() != 1 && request.params.size() != 2))
@@ -1000,6 +1072,7 @@ static const CRPCCommand commands[] = {
     //  category              name                      actor (function)         okSafeMode
     //  --------------------- ------------------------  -----------------------  ----------
     { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      true,  {"txid", "verbose"} },
+    { "rawtransactions",    "getrawtransactions",     &getrawtransactions,     true,  {"txids", "verbose"} },
     { "rawtransactions",    "createrawtransaction",   &createrawtransaction,   true,  {"inputs", "outputs", "locktime"} },
     { "rawtransactions",    "decoderawtransaction",   &decoderawtransaction,   true,  {"hexstring"} },
     { "rawtransactions",    "decodescript",           &decodescript,           true,  {"hexstring"} },
@@ -307,7 +307,19 @@ bool StartRPC()
     LogPrint("rpc", "Starting RPC\n");
     fRPCRunning = true;
     g_rpcSignals.Started();
-    getAsyncRPCQueue()->addWorker();
+    std::shared_ptr<AsyncRPCQueue> q = getAsyncRPCQueue();
+    for (const std::string& strLimit : mapMultiArgs["-rpcasynclimit"]) {
+        size_t pos = strLimit.rfind(':');
+        int nLimit = 0;
+        if (pos == std::string::npos || !ParseInt32(strLimit.substr(pos + 1), &nLimit) || nLimit < 1)
+            return InitError(strprintf(_("Invalid -rpcasynclimit=<method>:<n> '%s'"), strLimit));
+        q->setMethodLimit(strLimit.substr(0, pos), nLimit);
+    }
+    q->setExpiry(GetArg("-rpcasyncexpiry", DEFAULT_ASYNC_RPC_EXPIRY));
+    int nThreads = std::max((int)GetArg("-rpcasyncthreads", DEFAULT_ASYNC_RPC_THREADS), 1);
+    LogPrint("rpc", "Starting %d async rpc workers\n", nThreads);
+    for (int i = 0; i < nThreads; i++)
+        q->addWorker();
     return true;
 }
 
@@ -0,0 +1,228 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "shieldedindex.h"
+
+#include "hash.h"
+#include "memusage.h"
+#include "random.h"
+
+#include <limits>
+
+/** Smallest table, grows by doubling */
+static const size_t NULLIFIER_SET_MIN_CAPACITY = 64;
+/** Slots per filter word */
+static const size_t NULLIFIER_FILTER_RATIO = 8;
+
+CNullifierSet::CNullifierSet() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())),
+                                 nSize(0), fHasNull(false), nErased(0), nLookups(0), nFiltered(0), nHits(0)
+{
+    Rehash(NULLIFIER_SET_MIN_CAPACITY);
+}
+
+uint64_t CNullifierSet::FilterBits(uint64_t hash)
+{
+    // The word is picked by the upper half, the slot by the lowest bits
+    return (1ULL << ((hash >> 8) & 63)) | (1ULL << ((hash >> 14) & 63)) |
+           (1ULL << ((hash >> 20) & 63)) | (1ULL << ((hash >> 26) & 63));
+}
+
+size_t CNullifierSet::Find(const uint256& nf, uint64_t hash) const
+{
+    const size_t mask = vSlots.size() - 1;
+    size_t pos = hash & mask;
+    while (!vSlots[pos].IsNull() && vSlots[pos] != nf)
+        pos = (pos + 1) & mask;
+    return pos;
+}
+
+void CNullifierSet::Rehash(size_t nCapacity)
+{
+    std::vector<uint256> vOld;
+    vOld.swap(vSlots);
+    vSlots.assign(nCapacity, uint256());
+    vFilter.assign(nCapacity / NULLIFIER_FILTER_RATIO, 0);
+    nErased = 0;
+
+    const size_t mask = nCapacity - 1;
+    for (const uint256& nf : vOld) {
+        if (nf.IsNull())
+            continue;
+        uint64_t hash = Hash(nf);
+        size_t pos = hash & mask;
+        while (!vSlots[pos].IsNull())
+            pos = (pos + 1) & mask;
+        vSlots[pos] = nf;
+        FilterWord(hash) |= FilterBits(hash);
+    }
+}
+
+void CNullifierSet::RebuildFilter()
+{
+    std::fill(vFilter.begin(), vFilter.end(), 0);
+    for (const uint256& nf : vSlots) {
+        if (nf.IsNull())
+            continue;
+        uint64_t hash = Hash(nf);
+        FilterWord(hash) |= FilterBits(hash);
+    }
+    nErased = 0;
+}
+
+bool CNullifierSet::contains(const uint256& nf)
+{
+    nLookups++;
+    bool found;
+    if (nf.IsNull()) {
+        found = fHasNull;
+    } else {
+        uint64_t hash = Hash(nf);
+        uint64_t bits = FilterBits(hash);
+        if ((FilterWord(hash) & bits) != bits) {
+            nFiltered++;
+            return false;
+        }
+        found = !vSlots[Find(nf, hash)].IsNull();
+    }
+    if (found)
+        nHits++;
+    return found;
+}
+
+bool CNullifierSet::insert(const uint256& nf)
+{
+    if (nf.IsNull()) {
+        bool fInserted = !fHasNull;
+        fHasNull = true;
+        return fInserted;
+    }
+
+    // Keep the load below two thirds so runs stay short
+    if ((nSize + 1) * 3 > vSlots.size() * 2)
+        Rehash(vSlots.size() * 2);
+
+    uint64_t hash = Hash(nf);
+    size_t pos = Find(nf, hash);
+    if (!vSlots[pos].IsNull())
+        return false;
+    vSlots[pos] = nf;
+    nSize++;
+    FilterWord(hash) |= FilterBits(hash);
+    return true;
+}
+
+bool CNullifierSet::erase(const uint256& nf)
+{
+    if (nf.IsNull()) {
+        bool fErased = fHasNull;
+        fHasNull = false;
+        return fErased;
+    }
+
+    const size_t mask = vSlots.size() - 1;
+    size_t hole = Find(nf, Hash(nf));
+    if (vSlots[hole].IsNull())
+        return false;
+
+    // Move back every later entry of the run that may live in the hole,
+    // i.e. whose home slot is not between the hole and the entry
+    for (size_t pos = (hole + 1) & mask; !vSlots[pos].IsNull(); pos = (pos + 1) & mask) {
+        size_t home = Hash(vSlots[pos]) & mask;
+        if (((pos - home) & mask) >= ((pos - hole) & mask)) {
+            vSlots[hole] = vSlots[pos];
+            hole = pos;
+        }
+    }
+    vSlots[hole].SetNull();
+    nSize--;
+
+    // Stale bits only cost filter hits, rebuild once they add up
+    if (++nErased * 4 > nSize)
+        RebuildFilter();
+    return true;
+}
+
+void CNullifierSet::reserve(size_t n)
+{
+    size_t nCapacity = vSlots.size();
+    while (n * 3 > nCapacity * 2)
+        nCapacity *= 2;
+    if (nCapacity != vSlots.size())
+        Rehash(nCapacity);
+}
+
+void CNullifierSet::clear()
+{
+    vSlots.assign(NULLIFIER_SET_MIN_CAPACITY, uint256());
+    vFilter.assign(NULLIFIER_SET_MIN_CAPACITY / NULLIFIER_FILTER_RATIO, 0);
+    nSize = 0;
+    fHasNull = false;
+    nErased = 0;
+}
+
+size_t CNullifierSet::DynamicMemoryUsage() const
+{
+    return memusage::DynamicUsage(vSlots) + memusage::DynamicUsage(vFilter);
+}
+
+CSaplingAnchorCache::CSaplingAnchorCache(size_t nMaxSizeIn) : nMaxSize(nMaxSizeIn), nUsage(0), nLookups(0), nHits(0)
+{
+}
+
+bool CSaplingAnchorCache::get(const uint256& rt, SaplingMerkleTree& tree)
+{
+    nLookups++;
+    auto it = mapTrees.find(rt);
+    if (it == mapTrees.end())
+        return false;
+    nHits++;
+    listTrees.splice(listTrees.begin(), listTrees, it->second);
+    tree = it->second->second;
+    return true;
+}
+
+void CSaplingAnchorCache::insert(const uint256& rt, const SaplingMerkleTree& tree)
+{
+    if (nMaxSize == 0)
+        return;
+
+    auto it = mapTrees.find(rt);
+    if (it != mapTrees.end()) {
+        listTrees.splice(listTrees.begin(), listTrees, it->second);
+        return;
+    }
+
+    listTrees.emplace_front(rt, tree);
+    mapTrees.emplace(rt, listTrees.begin());
+    nUsage += tree.DynamicMemoryUsage();
+    while (listTrees.size() > nMaxSize) {
+        nUsage -= listTrees.back().second.DynamicMemoryUsage();
+        mapTrees.erase(listTrees.back().first);
+        listTrees.pop_back();
+    }
+}
+
+void CSaplingAnchorCache::erase(const uint256& rt)
+{
+    auto it = mapTrees.find(rt);
+    if (it == mapTrees.end())
+        return;
+    nUsage -= it->second->second.DynamicMemoryUsage();
+    listTrees.erase(it->second);
+    mapTrees.erase(it);
+}
+
+void CSaplingAnchorCache::clear()
+{
+    listTrees.clear();
+    mapTrees.clear();
+    nUsage = 0;
+}
+
+size_t CSaplingAnchorCache::DynamicMemoryUsage() const
+{
+    // List nodes hold the entry and two pointers
+    return nUsage + memusage::DynamicUsage(mapTrees) +
+           listTrees.size() * memusage::MallocUsage(sizeof(list_type::value_type) + 2 * sizeof(void*));
+}
@@ -0,0 +1,119 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef VDS_SHIELDEDINDEX_H
+#define VDS_SHIELDEDINDEX_H
+
+#include "coins.h"
+#include "uint256.h"
+#include "vds/IncrementalMerkleTree.hpp"
+
+#include <list>
+#include <stdint.h>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+
+/** Number of recent Sapling anchors kept in memory by the coin database */
+static const size_t DEFAULT_ANCHOR_CACHE_SIZE = 256;
+
+/**
+ * Set of Sapling nullifiers with a bloom filter in front.
+ *
+ * The table holds the nullifiers themselves in open addressing slots with
+ * linear probing, a null slot is empty. Erasing shifts the following entries
+ * of the run back, so there are no tombstones. The filter is blocked: every
+ * nullifier sets four bits of a single 64 bit word, one word per eight slots,
+ * which keeps it small enough to stay in cache and answers most lookups of
+ * unknown nullifiers without touching the table. Bits of erased nullifiers
+ * stay set until the filter is rebuilt.
+ */
+class CNullifierSet
+{
+private:
+    //! Salt, an attacker must not be able to pick nullifiers sharing a run
+    const uint64_t k0, k1;
+    std::vector<uint256> vSlots;
+    std::vector<uint64_t> vFilter;
+    size_t nSize;
+    //! Whether the null nullifier is in the set, it cannot be stored in a slot
+    bool fHasNull;
+    //! Nullifiers erased since the filter was built
+    size_t nErased;
+
+    uint64_t Hash(const uint256& nf) const { return SipHashUint256(k0, k1, nf); }
+    static uint64_t FilterBits(uint64_t hash);
+    uint64_t& FilterWord(uint64_t hash) { return vFilter[(hash >> 32) & (vFilter.size() - 1)]; }
+    const uint64_t& FilterWord(uint64_t hash) const { return vFilter[(hash >> 32) & (vFilter.size() - 1)]; }
+    size_t Find(const uint256& nf, uint64_t hash) const;
+    void Rehash(size_t nCapacity);
+    void RebuildFilter();
+
+public:
+    uint64_t nLookups;
+    //! Lookups the filter answered
+    uint64_t nFiltered;
+    //! Lookups that found the nullifier
+    uint64_t nHits;
+
+    CNullifierSet();
+
+    bool contains(const uint256& nf);
+    //! Returns false if nf was already in the set
+    bool insert(const uint256& nf);
+    //! Returns false if nf was not in the set
+    bool erase(const uint256& nf);
+    //! Make room for n nullifiers without rehashing
+    void reserve(size_t n);
+    void clear();
+
+    size_t size() const { return nSize + (fHasNull ? 1 : 0); }
+    size_t DynamicMemoryUsage() const;
+};
+
+/** Bounded LRU cache of Sapling commitment trees by anchor */
+class CSaplingAnchorCache
+{
+private:
+    typedef std::list<std::pair<uint256, SaplingMerkleTree> > list_type;
+
+    const size_t nMaxSize;
+    list_type listTrees;
+    boost::unordered_map<uint256, list_type::iterator, SaltedOutpointHasher> mapTrees;
+    size_t nUsage;
+
+public:
+    uint64_t nLookups;
+    uint64_t nHits;
+
+    explicit CSaplingAnchorCache(size_t nMaxSizeIn = DEFAULT_ANCHOR_CACHE_SIZE);
+
+    bool get(const uint256& rt, SaplingMerkleTree& tree);
+    //! Add or refresh the tree of rt as the most recently used one
+    void insert(const uint256& rt, const SaplingMerkleTree& tree);
+    void erase(const uint256& rt);
+    void clear();
+
+    size_t size() const { return listTrees.size(); }
+    size_t DynamicMemoryUsage() const;
+};
+
+/** Size and hit rates of the in memory shielded state, reported by gettxoutsetinfo */
+struct CShieldedIndexStats {
+    bool fNullifiersLoaded;
+    uint64_t nNullifiers;
+    uint64_t nNullifierUsage;
+    uint64_t nNullifierLookups;
+    uint64_t nNullifierFiltered;
+    uint64_t nNullifierHits;
+    uint64_t nAnchors;
+    uint64_t nAnchorUsage;
+    uint64_t nAnchorLookups;
+    uint64_t nAnchorHits;
+
+    CShieldedIndexStats() : fNullifiersLoaded(false), nNullifiers(0), nNullifierUsage(0), nNullifierLookups(0), nNullifierFiltered(0),
+                            nNullifierHits(0), nAnchors(0), nAnchorUsage(0), nAnchorLookups(0), nAnchorHits(0) {}
+};
+
+#endif // VDS_SHIELDEDINDEX_H
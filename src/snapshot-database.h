@@ -0,0 +1,377 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef SNAPSHOT_DATABASE_H
+#define SNAPSHOT_DATABASE_H
+
+#include "flat-database.h"
+
+#include <boost/filesystem.hpp>
+
+/** Version of the sectioned snapshot format written by CSnapshotDB */
+static const uint32_t SNAPSHOT_FORMAT_VERSION = 1;
+/** First bytes of every snapshot file, files without them are read as CFlatDB files */
+static const unsigned char SNAPSHOT_FILE_MAGIC[8] = {'v', 'd', 's', 's', 'n', 'a', 'p', 0};
+
+/**
+*   Sectioned Dumping and Loading
+*   -----------------------------
+*
+*   Like CFlatDB, but T is split into a fixed number of sections, each one
+*   serialized and checksummed on its own:
+*
+*   header:  file magic, format version, hash of the magic message, network
+*            magic, section count, then per section its offset, size and
+*            checksum, then a checksum of the header itself. All fields have
+*            a fixed size, so the header can be rewritten in place.
+*   data:    section payloads, at the offsets recorded in the header.
+*
+*   Sections are read and deserialized one at a time, so loading never holds
+*   more than one section next to the deserialized object. Dumps compare the
+*   checksums of the sections with the ones on disk, append the changed ones
+*   and rewrite the header; the file is only rewritten as a whole once stale
+*   sections make up most of it.
+*
+*   T provides SNAPSHOT_SECTIONS, SerializeSection(s, n) and
+*   UnserializeSection(s, n), the latter returning false if the data was
+*   written by an incompatible version of T.
+*/
+template<typename T>
+class CSnapshotDB
+{
+private:
+
+    enum ReadResult {
+        Ok,
+        FileError,
+        NotSnapshot,
+        HashReadError,
+        IncorrectHash,
+        IncorrectMagicMessage,
+        IncorrectMagicNumber,
+        IncorrectFormat
+    };
+
+    struct SectionIndex {
+        uint64_t nOffset;
+        uint64_t nSize;
+        uint256 hash;
+
+        SectionIndex() : nOffset(0), nSize(0) {}
+
+        ADD_SERIALIZE_METHODS;
+
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action)
+        {
+            READWRITE(nOffset);
+            READWRITE(nSize);
+            READWRITE(hash);
+        }
+    };
+
+    boost::filesystem::path pathDB;
+    std::string strFilename;
+    std::string strMagicMessage;
+
+    static size_t GetHeaderSize()
+    {
+        return sizeof(SNAPSHOT_FILE_MAGIC) + 4 + 32 + 4 + 4 + T::SNAPSHOT_SECTIONS * (8 + 8 + 32) + 32;
+    }
+
+    uint256 GetMagicMessageHash() const
+    {
+        return Hash(strMagicMessage.begin(), strMagicMessage.end());
+    }
+
+    static uint256 ReadHeaderChecksum(const CDataStream& ssHeader)
+    {
+        uint256 hash;
+        memcpy(hash.begin(), &ssHeader[ssHeader.size() - sizeof(uint256)], sizeof(uint256));
+        return hash;
+    }
+
+    ReadResult ReadHeader(FILE* file, std::vector<SectionIndex>& vIndex)
+    {
+        CDataStream ssHeader(SER_DISK, CLIENT_VERSION);
+        ssHeader.resize(GetHeaderSize());
+        size_t nRead = fread(&ssHeader[0], 1, ssHeader.size(), file);
+        if (nRead < sizeof(SNAPSHOT_FILE_MAGIC) || memcmp(&ssHeader[0], SNAPSHOT_FILE_MAGIC, sizeof(SNAPSHOT_FILE_MAGIC)))
+            return NotSnapshot;
+
+        // a torn header is left by a dump that did not finish, the sections it pointed to are gone
+        if (nRead != ssHeader.size() || Hash(ssHeader.begin(), ssHeader.end() - sizeof(uint256)) != ReadHeaderChecksum(ssHeader)) {
+            error("%s: Header checksum mismatch", __func__);
+            return IncorrectFormat;
+        }
+
+        unsigned char pchFileMagic[sizeof(SNAPSHOT_FILE_MAGIC)];
+        uint32_t nVersion;
+        uint256 hashMagicMessage;
+        unsigned char pchMsgTmp[4];
+        uint32_t nSections;
+        ssHeader >> FLATDATA(pchFileMagic) >> nVersion >> hashMagicMessage >> FLATDATA(pchMsgTmp) >> nSections;
+
+        if (nVersion != SNAPSHOT_FORMAT_VERSION) {
+            error("%s: Unsupported snapshot version %u", __func__, nVersion);
+            return IncorrectFormat;
+        }
+
+        if (hashMagicMessage != GetMagicMessageHash()) {
+            error("%s: Invalid magic message", __func__);
+            return IncorrectMagicMessage;
+        }
+
+        if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp))) {
+            error("%s: Invalid network magic number", __func__);
+            return IncorrectMagicNumber;
+        }
+
+        if (nSections != (uint32_t)T::SNAPSHOT_SECTIONS) {
+            error("%s: Unexpected number of sections %u", __func__, nSections);
+            return IncorrectFormat;
+        }
+
+        vIndex.resize(nSections);
+        for (SectionIndex& index : vIndex)
+            ssHeader >> index;
+
+        return Ok;
+    }
+
+    bool WriteHeader(FILE* file, const std::vector<SectionIndex>& vIndex)
+    {
+        CDataStream ssHeader(SER_DISK, CLIENT_VERSION);
+        ssHeader << FLATDATA(SNAPSHOT_FILE_MAGIC) << SNAPSHOT_FORMAT_VERSION << GetMagicMessageHash();
+        ssHeader << FLATDATA(Params().MessageStart()) << (uint32_t)vIndex.size();
+        for (const SectionIndex& index : vIndex)
+            ssHeader << index;
+        ssHeader << Hash(ssHeader.begin(), ssHeader.end());
+        assert(ssHeader.size() == GetHeaderSize());
+
+        return fseek(file, 0, SEEK_SET) == 0 && fwrite(ssHeader.data(), 1, ssHeader.size(), file) == ssHeader.size();
+    }
+
+    ReadResult Read(T& objToLoad)
+    {
+        int64_t nStart = GetTimeMillis();
+        // open input file, and associate with CAutoFile
+        FILE *file = fopen(pathDB.string().c_str(), "rb");
+        CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+        {
+            error("%s: Failed to open file %s", __func__, pathDB.string());
+            return FileError;
+        }
+
+        std::vector<SectionIndex> vIndex;
+        ReadResult result = ReadHeader(filein.Get(), vIndex);
+        if (result != Ok)
+            return result;
+
+        uint64_t nFileSize = boost::filesystem::file_size(pathDB);
+        for (int i = 0; i < T::SNAPSHOT_SECTIONS; i++) {
+            const SectionIndex& index = vIndex[i];
+            if (index.nOffset < GetHeaderSize() || index.nOffset > nFileSize || index.nSize > nFileSize - index.nOffset) {
+                error("%s: Section %d is out of bounds, data corrupted", __func__, i);
+                objToLoad.Clear();
+                return IncorrectHash;
+            }
+
+            CDataStream ssSection(SER_DISK, CLIENT_VERSION);
+            ssSection.resize(index.nSize);
+            if (fseek(filein.Get(), index.nOffset, SEEK_SET) != 0 ||
+                (index.nSize && fread(&ssSection[0], 1, index.nSize, filein.Get()) != index.nSize)) {
+                error("%s: I/O error reading section %d", __func__, i);
+                objToLoad.Clear();
+                return HashReadError;
+            }
+
+            if (Hash(ssSection.begin(), ssSection.end()) != index.hash) {
+                error("%s: Checksum mismatch in section %d, data corrupted", __func__, i);
+                objToLoad.Clear();
+                return IncorrectHash;
+            }
+
+            try {
+                if (!objToLoad.UnserializeSection(ssSection, i)) {
+                    objToLoad.Clear();
+                    error("%s: Data was written by an incompatible version", __func__);
+                    return IncorrectFormat;
+                }
+            }
+            catch (std::exception &e) {
+                objToLoad.Clear();
+                error("%s: Deserialize or I/O error - %s", __func__, e.what());
+                return IncorrectFormat;
+            }
+        }
+
+        LogPrintf("Loaded info from %s  %dms\n", strFilename, GetTimeMillis() - nStart);
+        LogPrintf("     %s\n", objToLoad.ToString());
+        LogPrintf("%s: Cleaning....\n", __func__);
+        objToLoad.CheckAndRemove();
+        LogPrintf("     %s\n", objToLoad.ToString());
+
+        return Ok;
+    }
+
+    bool WriteSections(FILE* file, uint64_t nEnd, std::vector<CDataStream>& vSections, std::vector<SectionIndex>& vIndex, const std::vector<bool>& vWrite)
+    {
+        if (fseek(file, nEnd, SEEK_SET) != 0)
+            return false;
+        for (int i = 0; i < T::SNAPSHOT_SECTIONS; i++) {
+            if (!vWrite[i])
+                continue;
+            vIndex[i].nOffset = nEnd;
+            if (fwrite(vSections[i].data(), 1, vSections[i].size(), file) != vSections[i].size())
+                return false;
+            nEnd += vSections[i].size();
+        }
+        return true;
+    }
+
+    bool Write(T& objToSave)
+    {
+        int64_t nStart = GetTimeMillis();
+
+        std::vector<CDataStream> vSections;
+        vSections.reserve(T::SNAPSHOT_SECTIONS);
+        std::vector<SectionIndex> vIndex(T::SNAPSHOT_SECTIONS);
+        uint64_t nLiveSize = GetHeaderSize();
+        for (int i = 0; i < T::SNAPSHOT_SECTIONS; i++) {
+            vSections.emplace_back(SER_DISK, CLIENT_VERSION);
+            objToSave.SerializeSection(vSections[i], i);
+            vIndex[i].nSize = vSections[i].size();
+            vIndex[i].hash = Hash(vSections[i].begin(), vSections[i].end());
+            nLiveSize += vIndex[i].nSize;
+        }
+
+        // sections with the checksum they have on disk are kept where they are
+        std::vector<SectionIndex> vIndexOld;
+        std::vector<bool> vWrite(T::SNAPSHOT_SECTIONS, true);
+        uint64_t nFileSize = 0;
+        uint64_t nAppendSize = 0;
+        FILE* file = fopen(pathDB.string().c_str(), "r+b");
+        ReadResult readResult = file ? ReadHeader(file, vIndexOld) : FileError;
+        if (readResult == IncorrectMagicMessage || readResult == IncorrectMagicNumber) {
+            fclose(file);
+            LogPrintf("%s: File format is unknown or invalid, please fix it manually\n", __func__);
+            return false;
+        }
+        if (readResult == Ok) {
+            nFileSize = boost::filesystem::file_size(pathDB);
+            for (int i = 0; i < T::SNAPSHOT_SECTIONS; i++) {
+                if (vIndexOld[i].hash == vIndex[i].hash && vIndexOld[i].nSize == vIndex[i].nSize) {
+                    vIndex[i].nOffset = vIndexOld[i].nOffset;
+                    vWrite[i] = false;
+                } else {
+                    nAppendSize += vIndex[i].nSize;
+                }
+            }
+        } else {
+            vIndexOld.clear();
+        }
+
+        if (!vIndexOld.empty() && nAppendSize == 0) {
+            fclose(file);
+            LogPrintf("%s is up to date  %dms\n", strFilename, GetTimeMillis() - nStart);
+            return true;
+        }
+
+        // append the changed sections, unless the file would then be mostly stale data
+        if (!vIndexOld.empty() && nFileSize + nAppendSize <= 2 * nLiveSize) {
+            bool fOk = WriteSections(file, nFileSize, vSections, vIndex, vWrite) && fflush(file) == 0;
+            if (fOk) {
+                // the header only points to the new sections once they are on disk
+                FileCommit(file);
+                fOk = WriteHeader(file, vIndex) && fflush(file) == 0;
+            }
+            if (fOk)
+                FileCommit(file);
+            fclose(file);
+            if (!fOk)
+                return error("%s: I/O error writing to %s", __func__, pathDB.string());
+
+            LogPrintf("Written changed sections to %s  %dms\n", strFilename, GetTimeMillis() - nStart);
+            LogPrintf("     %s\n", objToSave.ToString());
+            return true;
+        }
+
+        if (file)
+            fclose(file);
+
+        // write everything to a new file, then replace the old one
+        boost::filesystem::path pathTmp = pathDB;
+        pathTmp += ".new";
+        file = fopen(pathTmp.string().c_str(), "wb");
+        if (!file)
+            return error("%s: Failed to open file %s", __func__, pathTmp.string());
+
+        vWrite.assign(T::SNAPSHOT_SECTIONS, true);
+        bool fOk = WriteSections(file, GetHeaderSize(), vSections, vIndex, vWrite) && WriteHeader(file, vIndex) && fflush(file) == 0;
+        if (fOk)
+            FileCommit(file);
+        fclose(file);
+        if (!fOk || !RenameOver(pathTmp, pathDB))
+            return error("%s: I/O error writing to %s", __func__, pathTmp.string());
+
+        LogPrintf("Written info to %s  %dms\n", strFilename, GetTimeMillis() - nStart);
+        LogPrintf("     %s\n", objToSave.ToString());
+
+        return true;
+    }
+
+public:
+    CSnapshotDB(std::string strFilenameIn, std::string strMagicMessageIn)
+    {
+        pathDB = GetDataDir() / strFilenameIn;
+        strFilename = strFilenameIn;
+        strMagicMessage = strMagicMessageIn;
+    }
+
+    bool Load(T& objToLoad)
+    {
+        LogPrintf("Reading info from %s...\n", strFilename);
+        ReadResult readResult = Read(objToLoad);
+        if (readResult == NotSnapshot)
+        {
+            // written by an older version, the next dump converts it
+            LogPrintf("%s is not a snapshot, reading it as a flat file\n", strFilename);
+            return CFlatDB<T>(strFilename, strMagicMessage).Load(objToLoad);
+        }
+        if (readResult == FileError)
+            LogPrintf("Missing file %s, will try to recreate\n", strFilename);
+        else if (readResult != Ok)
+        {
+            LogPrintf("Error reading %s: ", strFilename);
+            if(readResult == IncorrectFormat)
+            {
+                LogPrintf("%s: Magic is ok but data has invalid format, will try to recreate\n", __func__);
+            }
+            else {
+                LogPrintf("%s: File format is unknown or invalid, please fix it manually\n", __func__);
+                // program should exit with an error
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool Dump(T& objToSave)
+    {
+        int64_t nStart = GetTimeMillis();
+
+        LogPrintf("Writting info to %s...\n", strFilename);
+        if (!Write(objToSave))
+            return false;
+        LogPrintf("%s dump finished  %dms\n", strFilename, GetTimeMillis() - nStart);
+
+        return true;
+    }
+
+};
+
+
+#endif
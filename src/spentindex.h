@@ -9,6 +9,10 @@
 #include "uint256.h"
 #include "amount.h"
 #include "script/script.h"
+
+#include <limits>
+#include <vector>
+
 struct CSpentIndexKey {
     uint256 txid;
     unsigned int outputIndex;
@@ -336,5 +340,78 @@ struct CAddressIndexIteratorHeightKey {
     }
 };
 
+/** Spent height of outputs in the address output index that are still unspent, sorts after every real height */
+static const int ADDRESS_OUTPUT_UNSPENT = std::numeric_limits<int>::max();
+
+/**
+ * Output to an address in the address output index. Outputs are ordered by
+ * the height they were spent at, so the outputs unspent at a height are a
+ * single range scan starting at the next height.
+ */
+struct CAddressOutputKey {
+    unsigned int type;
+    uint160 hashBytes;
+    int spentHeight;
+    int blockHeight;
+    uint256 txhash;
+    size_t index;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 65;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+        // Heights are stored big-endian for key sorting in LevelDB
+        ser_writedata32be(s, spentHeight);
+        ser_writedata32be(s, blockHeight);
+        txhash.Serialize(s);
+        ser_writedata32(s, index);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        type = ser_readdata8(s);
+        hashBytes.Unserialize(s);
+        spentHeight = ser_readdata32be(s);
+        blockHeight = ser_readdata32be(s);
+        txhash.Unserialize(s);
+        index = ser_readdata32(s);
+    }
+
+    CAddressOutputKey(unsigned int addressType, uint160 addressHash, int spent, int height,
+                      uint256 txid, size_t indexValue) {
+        type = addressType;
+        hashBytes = addressHash;
+        spentHeight = spent;
+        blockHeight = height;
+        txhash = txid;
+        index = indexValue;
+    }
+
+    CAddressOutputKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        type = 0;
+        hashBytes.SetNull();
+        spentHeight = ADDRESS_OUTPUT_UNSPENT;
+        blockHeight = 0;
+        txhash.SetNull();
+        index = 0;
+    }
+
+    bool IsUnspent() const {
+        return spentHeight == ADDRESS_OUTPUT_UNSPENT;
+    }
+};
+
+/** Address output index updates moving an output to another spent height, spending it or undoing that */
+inline void MoveAddressOutput(std::vector<std::pair<CAddressOutputKey, CAmount> >& vect, const CAddressOutputKey& key, int spentHeight, CAmount value)
+{
+    vect.push_back(std::make_pair(key, -1));
+    vect.push_back(std::make_pair(CAddressOutputKey(key.type, key.hashBytes, spentHeight, key.blockHeight, key.txhash, key.index), value));
+}
 
 #endif // VDS_SPENTINDEX_H
@@ -0,0 +1,195 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "random.h"
+#include "script/standard.h"
+#include "spentindex.h"
+#include "test/test_bitcoin.h"
+#include "txdb.h"
+#include "validation.h"
+
+#include <set>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(addressoutputindex_tests, TestingSetup)
+
+static uint160 RandomHash160()
+{
+    uint160 hash;
+    GetRandBytes(hash.begin(), hash.size());
+    return hash;
+}
+
+/** Transactions of the outputs to an address unspent at a height */
+static std::set<uint256> Unspent(const uint160& hash, int height, int start = 0, int type = TX_PUBKEYHASH)
+{
+    std::vector<std::pair<CAddressOutputKey, CAmount> > outputs;
+    bool fMore = true;
+    BOOST_CHECK(pblocktree->ReadAddressOutputIndex(hash, type, start, height, 0, nullptr, std::numeric_limits<size_t>::max(), outputs, fMore));
+    BOOST_CHECK(!fMore);
+    std::set<uint256> txids;
+    for (const auto& output : outputs)
+        txids.insert(output.first.txhash);
+    BOOST_CHECK_EQUAL(txids.size(), outputs.size());
+    return txids;
+}
+
+BOOST_AUTO_TEST_CASE(spent_heights)
+{
+    uint160 hash = RandomHash160();
+    uint256 txA = GetRandHash();
+    uint256 txB = GetRandHash();
+    CAddressOutputKey keyA(TX_PUBKEYHASH, hash, ADDRESS_OUTPUT_UNSPENT, 10, txA, 0);
+    CAddressOutputKey keyB(TX_PUBKEYHASH, hash, ADDRESS_OUTPUT_UNSPENT, 10, txB, 1);
+
+    // Block 10 pays the address twice, and another address and another type of the same hash once
+    std::vector<std::pair<CAddressOutputKey, CAmount> > vect;
+    vect.push_back(std::make_pair(keyA, 5));
+    vect.push_back(std::make_pair(keyB, 7));
+    vect.push_back(std::make_pair(CAddressOutputKey(TX_PUBKEYHASH, RandomHash160(), ADDRESS_OUTPUT_UNSPENT, 10, GetRandHash(), 0), 9));
+    vect.push_back(std::make_pair(CAddressOutputKey(TX_SCRIPTHASH, hash, ADDRESS_OUTPUT_UNSPENT, 10, GetRandHash(), 0), 11));
+    BOOST_REQUIRE(pblocktree->UpdateAddressOutputIndex(vect));
+
+    // Block 12 spends the first output, as ConnectBlock records it
+    vect.clear();
+    MoveAddressOutput(vect, keyA, 12, 5);
+    BOOST_REQUIRE(pblocktree->UpdateAddressOutputIndex(vect));
+
+    std::set<uint256> both = {txA, txB};
+    std::set<uint256> onlyB = {txB};
+    BOOST_CHECK(Unspent(hash, 9).empty());
+    BOOST_CHECK(Unspent(hash, 10) == both);
+    BOOST_CHECK(Unspent(hash, 11) == both);
+    BOOST_CHECK(Unspent(hash, 12) == onlyB);
+    BOOST_CHECK(Unspent(hash, 13) == onlyB);
+    // Unspent outputs are kept at ADDRESS_OUTPUT_UNSPENT, after every real height
+    BOOST_CHECK(Unspent(hash, ADDRESS_OUTPUT_UNSPENT - 1) == onlyB);
+    BOOST_CHECK(Unspent(hash, 11, 11).empty());
+    BOOST_CHECK_EQUAL(Unspent(hash, 11, 0, TX_SCRIPTHASH).size(), 1U);
+
+    std::vector<std::pair<CAddressOutputKey, CAmount> > outputs;
+    bool fMore = false;
+    BOOST_CHECK(pblocktree->ReadAddressOutputIndex(hash, TX_PUBKEYHASH, 0, 11, 0, nullptr, 10, outputs, fMore));
+    BOOST_REQUIRE_EQUAL(outputs.size(), 2U);
+    for (const auto& output : outputs) {
+        BOOST_CHECK_EQUAL(output.first.spentHeight, output.first.txhash == txA ? 12 : ADDRESS_OUTPUT_UNSPENT);
+        BOOST_CHECK_EQUAL(output.first.IsUnspent(), output.first.txhash == txB);
+        BOOST_CHECK_EQUAL(output.second, output.first.txhash == txA ? 5 : 7);
+    }
+
+    // DisconnectBlock of block 12 makes the output unspent again
+    vect.clear();
+    MoveAddressOutput(vect, CAddressOutputKey(TX_PUBKEYHASH, hash, 12, 10, txA, 0), ADDRESS_OUTPUT_UNSPENT, 5);
+    BOOST_REQUIRE(pblocktree->UpdateAddressOutputIndex(vect));
+    BOOST_CHECK(Unspent(hash, 12) == both);
+    BOOST_CHECK(Unspent(hash, 11) == both);
+
+    // and of block 10 removes both outputs
+    vect.clear();
+    vect.push_back(std::make_pair(keyA, -1));
+    vect.push_back(std::make_pair(keyB, -1));
+    BOOST_REQUIRE(pblocktree->UpdateAddressOutputIndex(vect));
+    BOOST_CHECK(Unspent(hash, 11).empty());
+    BOOST_CHECK(Unspent(hash, 12).empty());
+}
+
+BOOST_AUTO_TEST_CASE(build_from_spent_index)
+{
+    uint160 hash = RandomHash160();
+    uint256 txA = GetRandHash();
+    uint256 txB = GetRandHash();
+    uint256 txSpend = GetRandHash();
+
+    // Receiving entries for two outputs, the first spent at height 8
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    addressIndex.push_back(std::make_pair(CAddressIndexKey(TX_PUBKEYHASH, hash, 5, 1, txA, 0, false), 5));
+    addressIndex.push_back(std::make_pair(CAddressIndexKey(TX_PUBKEYHASH, hash, 6, 1, txB, 1, false), 7));
+    addressIndex.push_back(std::make_pair(CAddressIndexKey(TX_PUBKEYHASH, hash, 8, 1, txSpend, 0, true), -5));
+    BOOST_REQUIRE(pblocktree->WriteAddressIndex(addressIndex));
+    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
+    spentIndex.push_back(std::make_pair(CSpentIndexKey(txA, 0), CSpentIndexValue(txSpend, 0, 8, 5, TX_PUBKEYHASH, hash)));
+    BOOST_REQUIRE(pblocktree->UpdateSpentIndex(spentIndex));
+
+    bool fBuilt = false;
+    BOOST_CHECK(!pblocktree->ReadFlag("addressoutputindex", fBuilt) || !fBuilt);
+    BOOST_REQUIRE(pblocktree->BuildAddressOutputIndex());
+    BOOST_CHECK(pblocktree->ReadFlag("addressoutputindex", fBuilt) && fBuilt);
+
+    std::set<uint256> both = {txA, txB};
+    std::set<uint256> onlyA = {txA};
+    std::set<uint256> onlyB = {txB};
+    BOOST_CHECK(Unspent(hash, 4).empty());
+    BOOST_CHECK(Unspent(hash, 5) == onlyA);
+    BOOST_CHECK(Unspent(hash, 7) == both);
+    BOOST_CHECK(Unspent(hash, 8) == onlyB);
+    BOOST_CHECK(Unspent(hash, 1000) == onlyB);
+
+    // The spending entry is not an output of its own
+    std::vector<std::pair<CAddressOutputKey, CAmount> > outputs;
+    bool fMore = false;
+    BOOST_CHECK(pblocktree->ReadAddressOutputIndex(hash, TX_PUBKEYHASH, 0, 7, 0, nullptr, 10, outputs, fMore));
+    BOOST_REQUIRE_EQUAL(outputs.size(), 2U);
+    for (const auto& output : outputs) {
+        BOOST_CHECK(output.first.txhash != txSpend);
+        BOOST_CHECK_EQUAL(output.first.spentHeight, output.first.txhash == txA ? 8 : ADDRESS_OUTPUT_UNSPENT);
+        BOOST_CHECK_EQUAL(output.first.blockHeight, output.first.txhash == txA ? 5 : 6);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(paging)
+{
+    bool fAddressIndexOld = fAddressIndex;
+    fAddressIndex = true;
+
+    // Ten outputs created at heights 1 to 10, the even ones spent at 20 to 29
+    uint160 hash = RandomHash160();
+    std::vector<std::pair<CAddressOutputKey, CAmount> > vect;
+    for (int i = 0; i < 10; i++) {
+        int spentHeight = i % 2 ? ADDRESS_OUTPUT_UNSPENT : 20 + i;
+        vect.push_back(std::make_pair(CAddressOutputKey(TX_PUBKEYHASH, hash, spentHeight, i + 1, GetRandHash(), i), i + 1));
+    }
+    BOOST_REQUIRE(pblocktree->UpdateAddressOutputIndex(vect));
+
+    std::vector<CUtxo> vAll;
+    CAddressOutputKey keyLast;
+    bool fMore = true;
+    BOOST_CHECK(GetAddressUTXOAtHeight(hash, TX_PUBKEYHASH, 0, 23, 0, nullptr, std::numeric_limits<size_t>::max(), vAll, keyLast, fMore));
+    BOOST_CHECK(!fMore);
+    // Spent at 24, 26 and 28, and never spent
+    BOOST_REQUIRE_EQUAL(vAll.size(), 8U);
+
+    // Pages continue after the last key returned, the last one tells there is nothing more
+    for (size_t nPage : {1, 3, 4, 8}) {
+        std::vector<CUtxo> vPaged;
+        const CAddressOutputKey* pkeyAfter = nullptr;
+        size_t nPages = 0;
+        do {
+            std::vector<CUtxo> vPage;
+            BOOST_CHECK(GetAddressUTXOAtHeight(hash, TX_PUBKEYHASH, 0, 23, 0, pkeyAfter, nPage, vPage, keyLast, fMore));
+            BOOST_CHECK(vPage.size() == nPage || !fMore);
+            vPaged.insert(vPaged.end(), vPage.begin(), vPage.end());
+            pkeyAfter = &keyLast;
+            nPages++;
+        } while (fMore && nPages <= vAll.size());
+        BOOST_CHECK_EQUAL(nPages, (vAll.size() + nPage - 1) / nPage);
+        BOOST_REQUIRE_EQUAL(vPaged.size(), vAll.size());
+        for (size_t i = 0; i < vAll.size(); i++) {
+            BOOST_CHECK(vPaged[i].txid == vAll[i].txid);
+            BOOST_CHECK_EQUAL(vPaged[i].nHeight, vAll[i].nHeight);
+        }
+    }
+
+    // The value limit applies before the page is cut
+    std::vector<CUtxo> vPage;
+    BOOST_CHECK(GetAddressUTXOAtHeight(hash, TX_PUBKEYHASH, 0, 23, 9, nullptr, 2, vPage, keyLast, fMore));
+    BOOST_REQUIRE_EQUAL(vPage.size(), 2U);
+    BOOST_CHECK(!fMore);
+    for (const CUtxo& txout : vPage)
+        BOOST_CHECK(txout.nValue >= 9);
+
+    fAddressIndex = fAddressIndexOld;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,162 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockstore.h"
+
+#include "chainparams.h"
+#include "clientversion.h"
+#include "random.h"
+#include "test/test_bitcoin.h"
+#include "validation.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockstore_tests, TestingSetup)
+
+static CBlock RandomBlock(int nTxs)
+{
+    CBlock block;
+    block.nTime = GetTime();
+    block.nNonce = GetRandHash();
+    for (int i = 0; i < nTxs; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(GetRandHash(), i);
+        tx.vout.resize(1);
+        tx.vout[0].nValue = i;
+        block.vtx.push_back(MakeTransactionRef(tx));
+    }
+    block.hashMerkleRoot = block.BuildMerkleTree();
+    return block;
+}
+
+static CDiskBlockPos WriteToNewFile(const CBlock& block, int nFile)
+{
+    CDiskBlockPos pos(nFile, 0);
+    BOOST_CHECK(WriteBlockToDisk(block, pos, Params().MessageStart()));
+    return pos;
+}
+
+static CDiskBlockPos Append(const CBlock& block, int nFile)
+{
+    FILE* file = OpenBlockFile(CDiskBlockPos(nFile, 0));
+    BOOST_REQUIRE(file);
+    fseek(file, 0, SEEK_END);
+    CDiskBlockPos pos(nFile, ftell(file));
+    fclose(file);
+    BOOST_CHECK(WriteBlockToDisk(block, pos, Params().MessageStart()));
+    return pos;
+}
+
+BOOST_AUTO_TEST_CASE(read_mapped_records)
+{
+    CBlockFileCache cache(2);
+    CBlock block1 = RandomBlock(10);
+    CDiskBlockPos pos1 = WriteToNewFile(block1, 100);
+
+    CBlockFileReader reader;
+    BOOST_REQUIRE(cache.OpenRecord(pos1, "blk", 0, reader, SER_DISK, CLIENT_VERSION));
+    CBlock read;
+    reader >> read;
+    BOOST_CHECK(read.GetHash() == block1.GetHash());
+    BOOST_CHECK(read.vtx.size() == 10);
+    BOOST_CHECK_EQUAL(reader.size(), 0U);
+    BOOST_CHECK_THROW(reader >> read, std::ios_base::failure);
+
+    // A record written after the file was mapped remaps it, the old reader stays valid
+    CBlockFileReader old;
+    BOOST_REQUIRE(cache.OpenRecord(pos1, "blk", 0, old, SER_DISK, CLIENT_VERSION));
+    CBlock block2 = RandomBlock(3);
+    CDiskBlockPos pos2 = Append(block2, 100);
+    BOOST_REQUIRE(cache.OpenRecord(pos2, "blk", 0, reader, SER_DISK, CLIENT_VERSION));
+    reader >> read;
+    BOOST_CHECK(read.GetHash() == block2.GetHash());
+    BOOST_CHECK_EQUAL(cache.nMaps, 2U);
+    cache.Clear();
+    old >> read;
+    BOOST_CHECK(read.GetHash() == block1.GetHash());
+
+    // Positions that are not at the start of a record are left to the file reader
+    BOOST_CHECK(!cache.OpenRecord(CDiskBlockPos(100, pos1.nPos + 1), "blk", 0, reader, SER_DISK, CLIENT_VERSION));
+    BOOST_CHECK(!cache.OpenRecord(CDiskBlockPos(100, 0), "blk", 0, reader, SER_DISK, CLIENT_VERSION));
+    BOOST_CHECK(!cache.OpenRecord(pos1, "blk", 1 << 20, reader, SER_DISK, CLIENT_VERSION));
+    BOOST_CHECK(!cache.OpenRecord(CDiskBlockPos(101, 8), "blk", 0, reader, SER_DISK, CLIENT_VERSION));
+}
+
+BOOST_AUTO_TEST_CASE(bounded_and_forgotten)
+{
+    CBlockFileCache cache(2);
+    std::vector<CDiskBlockPos> positions;
+    for (int nFile = 100; nFile < 103; nFile++)
+        positions.push_back(WriteToNewFile(RandomBlock(1), nFile));
+
+    CBlockFileReader reader;
+    for (const CDiskBlockPos& pos : positions)
+        BOOST_CHECK(cache.OpenRecord(pos, "blk", 0, reader, SER_DISK, CLIENT_VERSION));
+    BOOST_CHECK_EQUAL(cache.nMaps, 3U);
+
+    // The first file was evicted, the last two are still mapped
+    BOOST_CHECK(cache.OpenRecord(positions[2], "blk", 0, reader, SER_DISK, CLIENT_VERSION));
+    BOOST_CHECK(cache.OpenRecord(positions[0], "blk", 0, reader, SER_DISK, CLIENT_VERSION));
+    BOOST_CHECK_EQUAL(cache.nMaps, 4U);
+
+    cache.Forget(102);
+    BOOST_CHECK(cache.OpenRecord(positions[2], "blk", 0, reader, SER_DISK, CLIENT_VERSION));
+    BOOST_CHECK_EQUAL(cache.nMaps, 5U);
+
+    cache.SetMaxFiles(0);
+    BOOST_CHECK(!cache.OpenRecord(positions[2], "blk", 0, reader, SER_DISK, CLIENT_VERSION));
+}
+
+BOOST_AUTO_TEST_CASE(truncated_file)
+{
+    CBlockFileCache cache(2);
+    CBlock block1 = RandomBlock(4);
+    CBlock block2 = RandomBlock(4);
+    CDiskBlockPos pos1 = WriteToNewFile(block1, 100);
+    CDiskBlockPos pos2 = Append(block2, 100);
+    CBlockFileReader reader;
+    BOOST_REQUIRE(cache.OpenRecord(pos2, "blk", 0, reader, SER_DISK, CLIENT_VERSION));
+    BOOST_CHECK_EQUAL(cache.nMaps, 1U);
+
+    // Records cut off behind the mapping are left to the file reader instead of faulting
+    boost::filesystem::path path = GetBlockPosFilename(pos2, "blk");
+    boost::filesystem::resize_file(path, pos2.nPos + 10);
+    BOOST_CHECK(!cache.OpenRecord(pos2, "blk", 0, reader, SER_DISK, CLIENT_VERSION));
+    boost::filesystem::resize_file(path, pos2.nPos - 8);
+    BOOST_CHECK(!cache.OpenRecord(pos2, "blk", 0, reader, SER_DISK, CLIENT_VERSION));
+
+    BOOST_CHECK_EQUAL(cache.nMaps, 2U);
+
+    // What is left of the file is mapped again
+    BOOST_REQUIRE(cache.OpenRecord(pos1, "blk", 0, reader, SER_DISK, CLIENT_VERSION));
+    CBlock read;
+    reader >> read;
+    BOOST_CHECK(read.GetHash() == block1.GetHash());
+    BOOST_CHECK_EQUAL(cache.nMaps, 3U);
+}
+
+BOOST_AUTO_TEST_CASE(read_block_from_disk)
+{
+    CBlock block = RandomBlock(5);
+    CDiskBlockPos pos = WriteToNewFile(block, 100);
+    uint256 hash = block.GetHash();
+    CBlockIndex index;
+    index.phashBlock = &hash;
+    index.nFile = pos.nFile;
+    index.nDataPos = pos.nPos;
+    index.nStatus = BLOCK_HAVE_DATA | BLOCK_VALID_TRANSACTIONS;
+
+    // Mapped and unmapped reads see the same block
+    for (int nMaps : {DEFAULT_BLOCKFILE_MAPS, 0}) {
+        blockFileCache.SetMaxFiles(nMaps);
+        CBlock read;
+        BOOST_CHECK(ReadBlockFromDisk(read, &index, Params().GetConsensus()));
+        BOOST_CHECK(read.GetHash() == hash);
+        BOOST_CHECK(read.vtx.size() == 5);
+    }
+    blockFileCache.SetMaxFiles(DEFAULT_BLOCKFILE_MAPS);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
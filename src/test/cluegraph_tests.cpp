@@ -0,0 +1,138 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "cluegraph.h"
+#include "clue.h"
+#include "clientversion.h"
+#include "streams.h"
+#include "util.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(cluegraph_tests, BasicTestingSetup)
+
+static CTxDestination MakeDest(unsigned char n)
+{
+    uint160 hash;
+    *hash.begin() = n;
+    return CKeyID(hash);
+}
+
+BOOST_AUTO_TEST_CASE(cluegraph_ancestors)
+{
+    CClueGraph graph;
+    CTxDestination root = MakeDest(1), a = MakeDest(2), b = MakeDest(3), c = MakeDest(4);
+    uint256 txid = GetRandHash();
+
+    graph.Set(CClue(root, txid, CNoDestination()), 1, 1);
+    graph.Set(CClue(a, txid, root, root), 1, 1);
+    graph.Set(CClue(b, txid, root, a), 0, 1);
+    graph.Set(CClue(c, txid, a, b), 0, 0);
+
+    BOOST_CHECK(graph.HaveClue(c));
+    BOOST_CHECK(!graph.HaveClue(MakeDest(5)));
+    BOOST_CHECK_EQUAL(graph.ChildrenSize(a, false), 1U);
+    BOOST_CHECK_EQUAL(graph.ChildrenSize(a, true), 1U);
+    BOOST_CHECK_EQUAL(graph.ChildrenSize(MakeDest(5), false), 0U);
+
+    std::vector<CTxDestination> vParents;
+    BOOST_CHECK(graph.GetParents(c, vParents, false, 10));
+    BOOST_CHECK(vParents == std::vector<CTxDestination>({b, a, root}));
+
+    vParents.clear();
+    BOOST_CHECK(graph.GetParents(c, vParents, true, 10));
+    BOOST_CHECK(vParents == std::vector<CTxDestination>({a, root}));
+
+    vParents.clear();
+    BOOST_CHECK(graph.GetParents(c, vParents, false, 2));
+    BOOST_CHECK_EQUAL(vParents.size(), 2U);
+
+    CTxDestination parent;
+    BOOST_CHECK(graph.GetParent(root, parent, false));
+    BOOST_CHECK(IsNullTxDestination(parent));
+
+    // A chain through an erased clue is broken
+    graph.Erase(a);
+    BOOST_CHECK(!graph.HaveClue(a));
+    vParents.clear();
+    BOOST_CHECK(!graph.GetParents(c, vParents, false, 10));
+}
+
+BOOST_AUTO_TEST_CASE(cluegraph_snapshot)
+{
+    CClueGraph graph;
+    CTxDestination root = MakeDest(1), a = MakeDest(2);
+    graph.Set(CClue(root, GetRandHash(), CNoDestination()), 1, 1);
+    graph.Set(CClue(a, GetRandHash(), root, root), 0, 0);
+    uint256 hashBlock = GetRandHash();
+    graph.SetBestBlock(hashBlock);
+
+    boost::filesystem::path path = GetDataDir() / "cluegraph_test.dat";
+    BOOST_CHECK(graph.Write(path));
+
+    CClueGraph graphRead;
+    BOOST_CHECK(graphRead.Read(path));
+    BOOST_CHECK(graphRead.GetBestBlock() == hashBlock);
+    BOOST_CHECK_EQUAL(graphRead.Size(), graph.Size());
+    BOOST_CHECK_EQUAL(graphRead.ChildrenSize(root, false), 1U);
+    std::vector<CTxDestination> vParents;
+    BOOST_CHECK(graphRead.GetParents(a, vParents, true, 10));
+    BOOST_CHECK(vParents == std::vector<CTxDestination>({root}));
+
+    boost::filesystem::remove(path);
+}
+
+static CRankItem MakeRankItem(double dWeight, int32_t nInvitees)
+{
+    CRankItem item;
+    item.dWeight = dWeight;
+    item.nInvitees = nInvitees;
+    item.nValue = nInvitees * COIN;
+    return item;
+}
+
+BOOST_AUTO_TEST_CASE(clue_season_rank)
+{
+    CSeasonRank rank;
+    for (unsigned char i = 1; i <= 10; i++)
+        rank.Update(MakeDest(i), MakeRankItem(i, 1));
+
+    BOOST_CHECK_EQUAL(rank.size(), 10U);
+    BOOST_CHECK_EQUAL(rank.Position(MakeDest(10)), 1);
+    BOOST_CHECK_EQUAL(rank.Position(MakeDest(1)), 10);
+    BOOST_CHECK_EQUAL(rank.Position(MakeDest(11)), -1);
+
+    // Moving an address up and back down again restores the order
+    rank.Update(MakeDest(1), MakeRankItem(100, 1));
+    BOOST_CHECK_EQUAL(rank.Position(MakeDest(1)), 1);
+    BOOST_CHECK_EQUAL(rank.Position(MakeDest(10)), 2);
+    rank.Update(MakeDest(1), MakeRankItem(1, 1));
+    BOOST_CHECK_EQUAL(rank.Position(MakeDest(1)), 10);
+
+    // Ties on weight are broken by invitees
+    rank.Update(MakeDest(5), MakeRankItem(6, 2));
+    BOOST_CHECK_EQUAL(rank.Position(MakeDest(5)), 5);
+    BOOST_CHECK_EQUAL(rank.Position(MakeDest(6)), 6);
+
+    rank.Erase(MakeDest(10));
+    BOOST_CHECK_EQUAL(rank.Position(MakeDest(9)), 1);
+
+    rank.Truncate(3);
+    BOOST_CHECK_EQUAL(rank.size(), 3U);
+    BOOST_CHECK_EQUAL(rank.Position(MakeDest(4)), -1);
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << rank;
+    CSeasonRank rankRead;
+    ss >> rankRead;
+    BOOST_CHECK_EQUAL(rankRead.size(), 3U);
+    CSeasonRank::const_iterator it = rank.begin(), itRead = rankRead.begin();
+    for (; it != rank.end(); it++, itRead++)
+        BOOST_CHECK(it->address == itRead->address);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,221 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <qtum/contractcallpool.h>
+
+#include <chain.h>
+#include <primitives/block.h>
+#include <random.h>
+#include <test/test_bitcoin.h>
+#include <validation.h>
+
+#include <libethashseal/Ethash.h>
+
+#include <atomic>
+#include <deque>
+#include <thread>
+
+#include <boost/test/unit_test.hpp>
+
+// Returns storage slot 0
+static const dev::bytes GETTER_CODE = {
+    0x60, 0x00, 0x54,       // PUSH1 0 SLOAD
+    0x60, 0x00, 0x52,       // PUSH1 0 MSTORE
+    0x60, 0x20, 0x60, 0x00, // PUSH1 32 PUSH1 0
+    0xf3,                   // RETURN
+};
+
+// Never returns
+static const dev::bytes LOOP_CODE = {
+    0x5b,             // JUMPDEST
+    0x60, 0x00, 0x56, // PUSH1 0 JUMP
+};
+
+static dev::Address RandomAddress()
+{
+    return dev::Address(uintToh256(GetRandHash()));
+}
+
+struct ContractCallPoolSetup : public TestingSetup {
+    dev::Address getter;
+    dev::Address loop;
+    std::deque<uint256> vHashes;
+    std::vector<std::unique_ptr<CBlockIndex> > vIndexes;
+    CBlock block;
+
+    ContractCallPoolSetup()
+    {
+        dev::eth::Ethash::init();
+        std::string path = (pathTemp / "stateQtum").string();
+        globalState.reset(new QtumState(dev::u256(0), QtumState::openDB(path, dev::sha3(dev::rlp("")), dev::WithExisting::Kill), path, dev::eth::BaseState::Empty));
+
+        getter = RandomAddress();
+        globalState->createContract(getter);
+        globalState->setNewCode(getter, dev::bytes(GETTER_CODE));
+        loop = RandomAddress();
+        globalState->createContract(loop);
+        globalState->setNewCode(loop, dev::bytes(LOOP_CODE));
+        SetValue(1);
+
+        CMutableTransaction coinbase;
+        coinbase.vin.resize(1);
+        coinbase.vout.resize(1);
+        coinbase.vout[0].scriptPubKey = CScript() << OP_TRUE;
+        block.vtx.push_back(MakeTransactionRef(std::move(coinbase)));
+    }
+
+    ~ContractCallPoolSetup()
+    {
+        globalState.reset();
+    }
+
+    /** Store value in the getter and commit it, as connecting a block would */
+    void SetValue(int value)
+    {
+        globalState->setStorage(getter, dev::u256(0), dev::u256(value));
+        globalState->commit(dev::eth::State::CommitBehaviour::KeepEmptyAccounts);
+        globalState->db().commit();
+        globalState->dbUtxo().commit();
+    }
+
+    /** Snapshot the state as the tip at the next height */
+    void ConnectTip(CContractCallPool& pool)
+    {
+        vHashes.push_back(GetRandHash());
+        vIndexes.emplace_back(new CBlockIndex());
+        CBlockIndex* pindex = vIndexes.back().get();
+        pindex->phashBlock = &vHashes.back();
+        pindex->nHeight = vIndexes.size();
+        pindex->pprev = vIndexes.size() > 1 ? vIndexes[vIndexes.size() - 2].get() : nullptr;
+        LOCK(cs_main);
+        pool.UpdateSnapshot(pindex, block);
+    }
+};
+
+/** Value returned by the getter, -1 if the call failed. Called from several threads, so no checks in here. */
+static int GetValue(CContractCallPool& pool, const dev::Address& contract)
+{
+    CContractCallPool::Result result;
+    if (!pool.Call(contract, dev::bytes(), dev::Address(), 0, result) || result.results.size() != 1 || !result.fAddressInUse)
+        return -1;
+    const dev::eth::ExecutionResult& execRes = result.results[0].execRes;
+    if (execRes.excepted != dev::eth::TransactionException::None || execRes.output.size() != 32)
+        return -1;
+    return int(dev::u256(dev::h256(execRes.output)));
+}
+
+BOOST_FIXTURE_TEST_SUITE(contractcallpool_tests, ContractCallPoolSetup)
+
+BOOST_AUTO_TEST_CASE(snapshot_isolation)
+{
+    CContractCallPool pool(4, 0, 0);
+    CContractCallPool::Result result;
+    BOOST_CHECK(!pool.Call(getter, dev::bytes(), dev::Address(), 0, result));
+
+    ConnectTip(pool);
+    BOOST_CHECK_EQUAL(GetValue(pool, getter), 1);
+    std::shared_ptr<const CContractCallPool::Snapshot> first = pool.GetSnapshot();
+    BOOST_REQUIRE(first);
+    BOOST_CHECK_EQUAL(first->nHeight, 1);
+
+    // The state moves on while calls run, they keep seeing the tip they started at
+    std::atomic<bool> fStop(false);
+    std::atomic<int> nWrong(0);
+    std::atomic<int> nFailed(0);
+    std::atomic<int> nCalls(0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 3; i++) {
+        threads.emplace_back([&] {
+            while (!fStop) {
+                int value = GetValue(pool, getter);
+                if (value < 0)
+                    nFailed++;
+                else if (value != 1)
+                    nWrong++;
+                nCalls++;
+            }
+        });
+    }
+    for (int value = 2; value < 20; value++)
+        SetValue(value);
+    while (nCalls < 100)
+        std::this_thread::yield();
+    fStop = true;
+    for (std::thread& thread : threads)
+        thread.join();
+    BOOST_CHECK_EQUAL(nFailed, 0);
+    BOOST_CHECK_EQUAL(nWrong, 0);
+
+    // Until the next snapshot
+    ConnectTip(pool);
+    dev::h256 root = globalState->rootHash();
+    BOOST_CHECK_EQUAL(GetValue(pool, getter), 19);
+    BOOST_CHECK_EQUAL(pool.GetSnapshot()->nHeight, 2);
+    BOOST_CHECK(pool.GetSnapshot()->envInfo.lastHashes()[1] == uintToh256(vHashes[0]));
+
+    // A snapshot held on to stays readable after the tip moved on
+    BOOST_CHECK(first->state->storage(getter, dev::u256(0)) == dev::u256(1));
+    BOOST_CHECK(pool.GetSnapshot()->state->storage(getter, dev::u256(0)) == dev::u256(19));
+
+    // Calls are reverted, the snapshot is left as it was
+    BOOST_CHECK(pool.GetSnapshot()->state->rootHash() == root);
+    BOOST_CHECK(pool.Call(RandomAddress(), dev::bytes(), dev::Address(), 0, result));
+    BOOST_CHECK(!result.fAddressInUse);
+    BOOST_REQUIRE_EQUAL(result.results.size(), 1U);
+    BOOST_CHECK(result.results[0].execRes.excepted == dev::eth::TransactionException::Unknown);
+}
+
+BOOST_AUTO_TEST_CASE(seal_engine_reuse)
+{
+    CContractCallPool pool(2, 0, 50);
+    ConnectTip(pool);
+    BOOST_CHECK_EQUAL(pool.GetIdleSealEngines(), 0U);
+
+    // One call at a time takes the same engine again
+    CContractCallPool::Result first;
+    BOOST_REQUIRE(pool.Call(getter, dev::bytes(), dev::Address(), 0, first));
+    for (int i = 0; i < 10; i++) {
+        CContractCallPool::Result result;
+        BOOST_REQUIRE(pool.Call(getter, dev::bytes(), dev::Address(), 0, result));
+        BOOST_REQUIRE_EQUAL(result.results.size(), 1U);
+        BOOST_CHECK(result.results[0].execRes.output == first.results[0].execRes.output);
+        BOOST_CHECK(result.results[0].execRes.gasUsed == first.results[0].execRes.gasUsed);
+        BOOST_CHECK_EQUAL(pool.GetIdleSealEngines(), 1U);
+    }
+
+    // Concurrent calls never hold more engines than the calls they are limited to
+    std::atomic<int> nWrong(0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; i++) {
+        threads.emplace_back([&] {
+            for (int j = 0; j < 10; j++) {
+                if (GetValue(pool, getter) != 1)
+                    nWrong++;
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+    BOOST_CHECK_EQUAL(nWrong, 0);
+    BOOST_CHECK(pool.GetIdleSealEngines() >= 1U && pool.GetIdleSealEngines() <= 2U);
+    size_t nIdle = pool.GetIdleSealEngines();
+
+    // Calls aborted by the timeout or out of gas give their engine back
+    CContractCallPool::Result result;
+    BOOST_REQUIRE(pool.Call(loop, dev::bytes(), dev::Address(), 0, result));
+    BOOST_CHECK(result.fTimedOut);
+    BOOST_REQUIRE_EQUAL(result.results.size(), 1U);
+    BOOST_CHECK(result.results[0].execRes.excepted == dev::eth::TransactionException::OutOfGas);
+    BOOST_REQUIRE(pool.Call(loop, dev::bytes(), dev::Address(), 30000, result));
+    BOOST_CHECK(!result.fTimedOut);
+    BOOST_CHECK(result.results[0].execRes.excepted == dev::eth::TransactionException::OutOfGas);
+    BOOST_CHECK_EQUAL(pool.GetIdleSealEngines(), nIdle);
+
+    // and the engines still execute as before
+    BOOST_REQUIRE(pool.Call(getter, dev::bytes(), dev::Address(), 0, result));
+    BOOST_CHECK(result.results[0].execRes.output == first.results[0].execRes.output);
+    BOOST_CHECK(result.results[0].execRes.gasUsed == first.results[0].execRes.gasUsed);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
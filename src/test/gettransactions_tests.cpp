@@ -0,0 +1,122 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chainparams.h"
+#include "clientversion.h"
+#include "random.h"
+#include "test/test_bitcoin.h"
+#include "txdb.h"
+#include "txmempool.h"
+#include "validation.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(gettransactions_tests, TestingSetup)
+
+static CBlock RandomBlock(int nTxs)
+{
+    CBlock block;
+    block.nTime = GetTime();
+    block.nNonce = GetRandHash();
+    for (int i = 0; i < nTxs; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(GetRandHash(), i);
+        tx.vout.resize(1);
+        tx.vout[0].nValue = i;
+        block.vtx.push_back(MakeTransactionRef(tx));
+    }
+    block.hashMerkleRoot = block.BuildMerkleTree();
+    return block;
+}
+
+/** Write block at the end of block file nFile and return where it went */
+static CDiskBlockPos Append(const CBlock& block, int nFile)
+{
+    CDiskBlockPos pos(nFile, 0);
+    FILE* file = OpenBlockFile(pos);
+    BOOST_REQUIRE(file);
+    fseek(file, 0, SEEK_END);
+    pos.nPos = ftell(file);
+    fclose(file);
+    BOOST_CHECK(WriteBlockToDisk(block, pos, Params().MessageStart()));
+    return pos;
+}
+
+static void IndexTransactions(const CBlock& block, const CDiskBlockPos& pos)
+{
+    CDiskTxPos txpos(pos, GetSizeOfCompactSize(block.vtx.size()));
+    std::vector<std::pair<uint256, CDiskTxPos> > vPos;
+    for (const auto& tx : block.vtx) {
+        vPos.push_back(std::make_pair(tx->GetHash(), txpos));
+        txpos.nTxOffset += ::GetSerializeSize(*tx, SER_DISK, CLIENT_VERSION);
+    }
+    BOOST_REQUIRE(pblocktree->WriteTxIndex(vPos));
+}
+
+BOOST_AUTO_TEST_CASE(get_transactions)
+{
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    bool fTxIndexOld = fTxIndex;
+    fTxIndex = true;
+
+    CBlock block1 = RandomBlock(4);
+    CBlock block2 = RandomBlock(3);
+    IndexTransactions(block1, Append(block1, 100));
+    IndexTransactions(block2, Append(block2, 100));
+
+    CMutableTransaction txMempool;
+    txMempool.vin.resize(1);
+    txMempool.vin[0].prevout = COutPoint(GetRandHash(), 0);
+    txMempool.vout.resize(1);
+    txMempool.vout[0].nValue = 1;
+    TestMemPoolEntryHelper entry;
+    mempool.addUnchecked(txMempool.GetHash(), entry.FromTx(txMempool));
+
+    const CTransactionRef& txGenesis = Params().GenesisBlock().vtx[0];
+    std::vector<uint256> hashes = {
+        block2.vtx[2]->GetHash(), block1.vtx[1]->GetHash(), GetRandHash(), txMempool.GetHash(),
+        txGenesis->GetHash(), block1.vtx[1]->GetHash(), block1.vtx[3]->GetHash(), block2.vtx[0]->GetHash()};
+    std::vector<CTransactionRef> expected = {
+        block2.vtx[2], block1.vtx[1], nullptr, MakeTransactionRef(txMempool),
+        txGenesis, block1.vtx[1], block1.vtx[3], block2.vtx[0]};
+    std::vector<uint256> expectedBlock = {
+        block2.GetHash(), block1.GetHash(), uint256(), uint256(),
+        consensusParams.hashGenesisBlock, block1.GetHash(), block1.GetHash(), block2.GetHash()};
+
+    // Results follow the request, duplicates are answered at every position
+    std::vector<CTransactionRef> vtx;
+    std::vector<uint256> vHashBlock;
+    GetTransactions(hashes, vtx, vHashBlock, consensusParams);
+    BOOST_REQUIRE_EQUAL(vtx.size(), hashes.size());
+    BOOST_REQUIRE_EQUAL(vHashBlock.size(), hashes.size());
+    for (size_t i = 0; i < hashes.size(); i++) {
+        BOOST_CHECK_EQUAL(!vtx[i], !expected[i]);
+        if (vtx[i])
+            BOOST_CHECK(vtx[i]->GetHash() == hashes[i]);
+        BOOST_CHECK(vHashBlock[i] == expectedBlock[i]);
+
+        // The same answer as a single lookup
+        CTransactionRef tx;
+        uint256 hashBlock;
+        BOOST_CHECK_EQUAL(GetTransaction(hashes[i], tx, consensusParams, hashBlock), !!expected[i]);
+        if (vtx[i] && tx) {
+            BOOST_CHECK(tx->GetHash() == vtx[i]->GetHash());
+            BOOST_CHECK(hashBlock == vHashBlock[i]);
+        }
+    }
+
+    // Without the index only the mempool is searched
+    fTxIndex = false;
+    GetTransactions(hashes, vtx, vHashBlock, consensusParams);
+    for (size_t i = 0; i < hashes.size(); i++) {
+        BOOST_CHECK_EQUAL(!!vtx[i], hashes[i] == txMempool.GetHash());
+        BOOST_CHECK(vHashBlock[i].IsNull());
+    }
+
+    fTxIndex = fTxIndexOld;
+    mempool.clear();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,102 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txdb.h"
+
+#include "test/test_bitcoin.h"
+#include "validation.h"
+
+#include <libdevcore/SHA3.h>
+#include <libevm/ExtVMFace.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(logbloom_tests, BasicTestingSetup)
+
+static dev::h2048 TopicBloom(const dev::h256& topic)
+{
+    dev::h2048 bloom;
+    bloom.shiftBloom<3>(dev::sha3(topic.ref()));
+    return bloom;
+}
+
+// Three blocks with a contract call each, the first two log a topic, the third nothing
+static void WriteBlocks(CBlockTreeDB& db, const dev::h160& address, const dev::h256& topic1, const dev::h256& topic2)
+{
+    const dev::h256 topics[] = {topic1, topic2, dev::h256()};
+    for (unsigned int i = 0; i < 3; i++) {
+        uint256 hash = ArithToUint256(arith_uint256(i + 1));
+        BOOST_CHECK(db.WriteHeightIndex(CHeightTxIndexKey(10 + i, address), std::vector<uint256>(1, hash)));
+
+        dev::eth::LogEntries logs;
+        if (topics[i])
+            logs.push_back(dev::eth::LogEntry(address, dev::h256s(1, topics[i]), dev::bytes()));
+        dev::h2048 bloom = dev::eth::bloom(logs);
+        std::vector<std::pair<uint256, dev::h2048> > txBlooms;
+        if (bloom)
+            txBlooms.push_back(std::make_pair(hash, bloom));
+        BOOST_CHECK(db.WriteLogBloomIndex(10 + i, bloom, txBlooms));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(read_height_index_blooms)
+{
+    CBlockTreeDB db(1 << 20, true);
+    dev::h160 address(dev::sha3("contract"), dev::h160::AlignRight);
+    dev::h256 topic1 = dev::sha3("topic1");
+    dev::h256 topic2 = dev::sha3("topic2");
+    WriteBlocks(db, address, topic1, topic2);
+    std::set<dev::h160> addresses;
+
+    std::vector<std::vector<uint256> > blocks;
+    BOOST_CHECK_EQUAL(db.ReadHeightIndex(10, 12, 0, blocks, addresses), 12);
+    BOOST_CHECK_EQUAL(blocks.size(), 3U);
+
+    // Only the receipts that may log the topic are read
+    blocks.clear();
+    BOOST_CHECK_EQUAL(db.ReadHeightIndex(10, 12, 0, blocks, addresses, std::vector<dev::h2048>(1, TopicBloom(topic2))), 12);
+    BOOST_REQUIRE_EQUAL(blocks.size(), 1U);
+    BOOST_CHECK(blocks[0] == std::vector<uint256>(1, ArithToUint256(arith_uint256(2))));
+
+    // Either topic
+    std::vector<dev::h2048> blooms;
+    blooms.push_back(TopicBloom(topic1));
+    blooms.push_back(TopicBloom(topic2));
+    blocks.clear();
+    BOOST_CHECK_EQUAL(db.ReadHeightIndex(10, 12, 0, blocks, addresses, blooms), 12);
+    BOOST_CHECK_EQUAL(blocks.size(), 2U);
+
+    // Both topics, no block logs them together but the range is still reported as iterated
+    blocks.clear();
+    BOOST_CHECK_EQUAL(db.ReadHeightIndex(10, 12, 0, blocks, addresses, std::vector<dev::h2048>(1, TopicBloom(topic1) | TopicBloom(topic2))), 12);
+    BOOST_CHECK(blocks.empty());
+
+    // Other contracts are still filtered out by the height index
+    addresses.insert(dev::h160(dev::sha3("other"), dev::h160::AlignRight));
+    blocks.clear();
+    BOOST_CHECK_EQUAL(db.ReadHeightIndex(10, 12, 0, blocks, addresses, blooms), 12);
+    BOOST_CHECK(blocks.empty());
+}
+
+BOOST_AUTO_TEST_CASE(erase_log_bloom_index)
+{
+    CBlockTreeDB db(1 << 20, true);
+    dev::h160 address(dev::sha3("contract"), dev::h160::AlignRight);
+    dev::h256 topic1 = dev::sha3("topic1");
+    dev::h256 topic2 = dev::sha3("topic2");
+    WriteBlocks(db, address, topic1, topic2);
+    std::set<dev::h160> addresses;
+
+    // A disconnected block no longer matches, even with its height index entry left behind
+    BOOST_CHECK(db.EraseLogBloomIndex(11));
+    std::vector<std::vector<uint256> > blocks;
+    BOOST_CHECK_EQUAL(db.ReadHeightIndex(10, 11, 0, blocks, addresses, std::vector<dev::h2048>(1, TopicBloom(topic2))), 10);
+    BOOST_CHECK(blocks.empty());
+
+    blocks.clear();
+    BOOST_CHECK_EQUAL(db.ReadHeightIndex(10, 12, 0, blocks, addresses, std::vector<dev::h2048>(1, TopicBloom(topic1))), 12);
+    BOOST_CHECK_EQUAL(blocks.size(), 1U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
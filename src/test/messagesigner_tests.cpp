@@ -0,0 +1,51 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "messagesigner.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(messagesigner_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(messagesigner_cached_recovery)
+{
+    CKey key1, key2;
+    key1.MakeNewKey(true);
+    key2.MakeNewKey(true);
+    const std::string strMessage = "masternode ping";
+    std::string strError;
+
+    std::vector<unsigned char> vchSig;
+    BOOST_CHECK(CMessageSigner::SignMessage(strMessage, vchSig, key1));
+
+    // Repeated checks are answered from the cache and must agree with the first one
+    for (int i = 0; i < 3; i++) {
+        BOOST_CHECK(CMessageSigner::VerifyMessage(key1.GetPubKey(), vchSig, strMessage, strError));
+        BOOST_CHECK(!CMessageSigner::VerifyMessage(key2.GetPubKey(), vchSig, strMessage, strError));
+        BOOST_CHECK(strError.find("Keys don't match") == 0);
+        BOOST_CHECK(!CMessageSigner::VerifyMessage(key1.GetPubKey(), vchSig, strMessage + "!", strError));
+    }
+
+    CKeyID keyID;
+    BOOST_CHECK(CHashSigner::RecoverKeyID(CMessageSigner::GetMessageHash(strMessage), vchSig, keyID));
+    BOOST_CHECK(keyID == key1.GetPubKey().GetID());
+
+    // The cache is keyed by signature too, another signature of the same message is checked on its own
+    std::vector<unsigned char> vchSigBad(vchSig);
+    vchSigBad[0] = 0;
+    for (int i = 0; i < 2; i++) {
+        BOOST_CHECK(!CHashSigner::RecoverKeyID(CMessageSigner::GetMessageHash(strMessage), vchSigBad, keyID));
+        BOOST_CHECK(!CMessageSigner::VerifyMessage(key1.GetPubKey(), vchSigBad, strMessage, strError));
+        BOOST_CHECK_EQUAL(strError, "Error recovering public key.");
+    }
+
+    std::vector<unsigned char> vchSig2;
+    BOOST_CHECK(CMessageSigner::SignMessage(strMessage, vchSig2, key2));
+    BOOST_CHECK(CMessageSigner::VerifyMessage(key2.GetPubKey(), vchSig2, strMessage, strError));
+    BOOST_CHECK(CMessageSigner::VerifyMessage(key1.GetPubKey(), vchSig, strMessage, strError));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,93 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "net.h"
+
+#include "chainparams.h"
+#include "hash.h"
+#include "primitives/transaction.h"
+#include "protocol.h"
+#include "streams.h"
+#include "test/test_bitcoin.h"
+#include "version.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(netmessage_tests, BasicTestingSetup)
+
+// A complete message as the socket handler hands it to ProcessMessages
+static void ReadNetMessage(CNetMessage& msg, const char* pszCommand, const CDataStream& payload, const uint256& checksum)
+{
+    CMessageHeader hdr(Params().MessageStart(), pszCommand, payload.size());
+    memcpy(hdr.pchChecksum, checksum.begin(), CMessageHeader::CHECKSUM_SIZE);
+    CDataStream ssHeader(SER_NETWORK, PROTOCOL_VERSION);
+    ssHeader << hdr;
+    BOOST_CHECK_EQUAL(msg.readHeader(&ssHeader[0], ssHeader.size()), (int)ssHeader.size());
+    BOOST_CHECK_EQUAL(msg.readData(&payload[0], payload.size()), (int)payload.size());
+    BOOST_CHECK(msg.complete());
+}
+
+static CTransaction MakeTransaction()
+{
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vout.resize(1);
+    mtx.vout[0].nValue = 42;
+    return CTransaction(mtx);
+}
+
+BOOST_AUTO_TEST_CASE(prepared_transaction)
+{
+    CTransaction tx = MakeTransaction();
+    CDataStream ssTx(SER_NETWORK, PROTOCOL_VERSION);
+    ssTx << tx;
+    uint256 checksum = Hash(ssTx.begin(), ssTx.end());
+
+    CNetMessage msg(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION);
+    ReadNetMessage(msg, NetMsgType::TX, ssTx, checksum);
+    msg.prepared = std::make_shared<CPreparedMessage>();
+    msg.prepared->Finish(msg, PROTOCOL_VERSION);
+    BOOST_CHECK(msg.prepared->hashChecksum == checksum);
+    BOOST_CHECK_EQUAL(msg.prepared->nMessageSize, ssTx.size());
+    BOOST_CHECK(!msg.prepared->error);
+    BOOST_CHECK(msg.prepared->tx && msg.prepared->tx->GetHash() == tx.GetHash());
+
+    // Done once, a preparation thread coming late leaves it alone
+    BOOST_CHECK(!msg.prepared->TryStart());
+    msg.prepared->Finish(msg, PROTOCOL_VERSION);
+}
+
+BOOST_AUTO_TEST_CASE(prepared_bad_checksum)
+{
+    CDataStream ssTx(SER_NETWORK, PROTOCOL_VERSION);
+    ssTx << MakeTransaction();
+
+    // Nothing is deserialized, ProcessMessages rejects the message
+    CNetMessage msg(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION);
+    ReadNetMessage(msg, NetMsgType::TX, ssTx, uint256());
+    msg.prepared = std::make_shared<CPreparedMessage>();
+    BOOST_CHECK(msg.prepared->TryStart());
+    msg.prepared->Run(msg, PROTOCOL_VERSION);
+    BOOST_CHECK(msg.prepared->hashChecksum == Hash(ssTx.begin(), ssTx.end()));
+    BOOST_CHECK(!msg.prepared->tx);
+    BOOST_CHECK(!msg.prepared->error);
+}
+
+BOOST_AUTO_TEST_CASE(prepared_truncated)
+{
+    CDataStream ssTx(SER_NETWORK, PROTOCOL_VERSION);
+    ssTx << MakeTransaction();
+    CDataStream ssShort(ssTx.begin(), ssTx.begin() + ssTx.size() / 2, SER_NETWORK, PROTOCOL_VERSION);
+
+    // The exception is kept for ProcessMessages to rethrow
+    CNetMessage msg(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION);
+    ReadNetMessage(msg, NetMsgType::TX, ssShort, Hash(ssShort.begin(), ssShort.end()));
+    msg.prepared = std::make_shared<CPreparedMessage>();
+    msg.prepared->Finish(msg, PROTOCOL_VERSION);
+    BOOST_CHECK(!msg.prepared->tx);
+    BOOST_CHECK(msg.prepared->error);
+    BOOST_CHECK_THROW(std::rethrow_exception(msg.prepared->error), std::ios_base::failure);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,55 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <libdevcore/OverlayDB.h>
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(overlaydbcache_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(overlaydbcache_lru)
+{
+    const size_t nEntry = 100 + dev::OverlayDBCache::c_entryOverhead;
+    dev::OverlayDBCache cache(3 * nEntry);
+    std::string value;
+
+    for (unsigned i = 1; i <= 3; i++)
+        cache.insert(dev::h256(i), std::string(100, 'a' + i));
+    BOOST_CHECK_EQUAL(cache.stats().entries, 3U);
+    BOOST_CHECK_EQUAL(cache.stats().bytes, 3 * nEntry);
+
+    // Touch 1 so that 2 is the least recently used entry
+    BOOST_CHECK(cache.lookup(dev::h256(1), value));
+    BOOST_CHECK(value == std::string(100, 'b'));
+
+    cache.insert(dev::h256(4), std::string(100, 'e'));
+    BOOST_CHECK_EQUAL(cache.stats().entries, 3U);
+    BOOST_CHECK(!cache.lookup(dev::h256(2), value));
+    BOOST_CHECK(cache.lookup(dev::h256(1), value));
+    BOOST_CHECK(cache.lookup(dev::h256(3), value));
+    BOOST_CHECK(cache.lookup(dev::h256(4), value));
+
+    dev::OverlayDBCache::Stats stats = cache.stats();
+    BOOST_CHECK_EQUAL(stats.hits, 4U);
+    BOOST_CHECK_EQUAL(stats.misses, 1U);
+
+    cache.remove(dev::h256(3));
+    BOOST_CHECK(!cache.lookup(dev::h256(3), value));
+    BOOST_CHECK_EQUAL(cache.stats().bytes, 2 * nEntry);
+
+    // Shrinking evicts from the least recently used end
+    cache.setMaxBytes(nEntry);
+    BOOST_CHECK_EQUAL(cache.stats().entries, 1U);
+    BOOST_CHECK(cache.lookup(dev::h256(4), value));
+
+    // A disabled cache keeps nothing
+    cache.setMaxBytes(0);
+    cache.insert(dev::h256(5), std::string(10, 'f'));
+    BOOST_CHECK_EQUAL(cache.stats().entries, 0U);
+    BOOST_CHECK(!cache.lookup(dev::h256(5), value));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -65,6 +65,14 @@ BOOST_AUTO_TEST_CASE(rpc_rawparams)
     BOOST_CHECK_THROW(CallRPC("getrawtransaction not_hex"), runtime_error);
     BOOST_CHECK_THROW(CallRPC("getrawtransaction a3b807410df0b60fcb9736768df5823938b2f838694939ba45f3c0a1bff150ed not_int"), runtime_error);
 
+    BOOST_CHECK_THROW(CallRPC("getrawtransactions"), runtime_error);
+    BOOST_CHECK_THROW(CallRPC("getrawtransactions not_array"), runtime_error);
+    BOOST_CHECK_THROW(CallRPC("getrawtransactions [\"not_hex\"]"), runtime_error);
+    BOOST_CHECK_THROW(CallRPC("getrawtransactions [] not_int"), runtime_error);
+    BOOST_CHECK_NO_THROW(r = CallRPC("getrawtransactions [\"a3b807410df0b60fcb9736768df5823938b2f838694939ba45f3c0a1bff150ed\"] true"));
+    BOOST_CHECK_EQUAL(r.size(), 1U);
+    BOOST_CHECK(r[0].isNull());
+
     BOOST_CHECK_THROW(CallRPC("createrawtransaction"), runtime_error);
     BOOST_CHECK_THROW(CallRPC("createrawtransaction null null"), runtime_error);
     BOOST_CHECK_THROW(CallRPC("createrawtransaction not_array"), runtime_error);
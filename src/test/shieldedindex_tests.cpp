@@ -0,0 +1,189 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "shieldedindex.h"
+
+#include "arith_uint256.h"
+#include "random.h"
+#include "test/test_bitcoin.h"
+#include "txdb.h"
+
+#include <set>
+#include <thread>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(shieldedindex_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(nullifier_set)
+{
+    CNullifierSet set;
+    std::set<uint256> reference;
+
+    // Enough to grow the table several times and erase from the middle of runs
+    std::vector<uint256> nullifiers;
+    for (int i = 0; i < 5000; i++)
+        nullifiers.push_back(GetRandHash());
+    nullifiers.push_back(uint256());
+
+    for (const uint256& nf : nullifiers) {
+        BOOST_CHECK(set.insert(nf));
+        reference.insert(nf);
+    }
+    BOOST_CHECK(!set.insert(nullifiers[42]));
+    BOOST_CHECK_EQUAL(set.size(), reference.size());
+
+    for (size_t i = 0; i < nullifiers.size(); i += 3) {
+        BOOST_CHECK(set.erase(nullifiers[i]));
+        reference.erase(nullifiers[i]);
+    }
+    BOOST_CHECK(!set.erase(nullifiers[0]));
+    BOOST_CHECK_EQUAL(set.size(), reference.size());
+
+    for (const uint256& nf : nullifiers)
+        BOOST_CHECK_EQUAL(set.contains(nf), reference.count(nf) == 1);
+
+    // Unknown nullifiers are mostly answered by the filter
+    set.nLookups = set.nFiltered = set.nHits = 0;
+    for (int i = 0; i < 1000; i++)
+        BOOST_CHECK(!set.contains(GetRandHash()));
+    BOOST_CHECK_EQUAL(set.nHits, 0U);
+    BOOST_CHECK(set.nFiltered > 900);
+
+    set.clear();
+    BOOST_CHECK_EQUAL(set.size(), 0U);
+    BOOST_CHECK(!set.contains(nullifiers[1]));
+}
+
+BOOST_AUTO_TEST_CASE(anchor_cache)
+{
+    CSaplingAnchorCache cache(2);
+    SaplingMerkleTree tree;
+    std::vector<uint256> roots;
+    for (int i = 0; i < 3; i++) {
+        tree.append(ArithToUint256(arith_uint256(i + 1)));
+        roots.push_back(tree.root());
+    }
+
+    SaplingMerkleTree found;
+    cache.insert(roots[0], SaplingMerkleTree());
+    cache.insert(roots[1], SaplingMerkleTree());
+    // Using the first makes the second the least recently used
+    BOOST_CHECK(cache.get(roots[0], found));
+    cache.insert(roots[2], tree);
+    BOOST_CHECK_EQUAL(cache.size(), 2U);
+    BOOST_CHECK(!cache.get(roots[1], found));
+    BOOST_CHECK(cache.get(roots[2], found));
+    BOOST_CHECK(found.root() == roots[2]);
+
+    cache.erase(roots[2]);
+    BOOST_CHECK(!cache.get(roots[2], found));
+    BOOST_CHECK_EQUAL(cache.nLookups, 4U);
+    BOOST_CHECK_EQUAL(cache.nHits, 2U);
+}
+
+static void WriteNullifier(CCoinsViewDB& view, const uint256& nf, bool fSpent)
+{
+    CCoinsMap mapCoins;
+    CAnchorsSaplingMap mapAnchors;
+    CNullifiersMap mapNullifiers;
+    CNullifiersCacheEntry& entry = mapNullifiers[nf];
+    entry.entered = fSpent;
+    entry.flags = CNullifiersCacheEntry::DIRTY;
+    BOOST_CHECK(view.BatchWrite(mapCoins, uint256(), uint256(), mapAnchors, mapNullifiers));
+}
+
+BOOST_AUTO_TEST_CASE(coins_view_nullifiers)
+{
+    CCoinsViewDB view(1 << 20, true);
+    uint256 nf1 = GetRandHash();
+    uint256 nf2 = GetRandHash();
+
+    // Until the set is loaded, lookups are answered by the database
+    WriteNullifier(view, nf1, true);
+    BOOST_CHECK(view.GetNullifier(nf1, SAPLING));
+    BOOST_CHECK(!view.GetNullifier(nf2, SAPLING));
+    CShieldedIndexStats stats;
+    view.GetShieldedIndexStats(stats);
+    BOOST_CHECK(!stats.fNullifiersLoaded);
+    BOOST_CHECK_EQUAL(stats.nNullifierLookups, 0U);
+
+    // Written before the set is loaded, found by the load
+    view.LoadNullifiers();
+    BOOST_CHECK(view.GetNullifier(nf1, SAPLING));
+    BOOST_CHECK(!view.GetNullifier(nf2, SAPLING));
+
+    // Written after, kept up to date
+    WriteNullifier(view, nf2, true);
+    WriteNullifier(view, nf1, false);
+    BOOST_CHECK(!view.GetNullifier(nf1, SAPLING));
+    BOOST_CHECK(view.GetNullifier(nf2, SAPLING));
+
+    view.GetShieldedIndexStats(stats);
+    BOOST_CHECK(stats.fNullifiersLoaded);
+    BOOST_CHECK_EQUAL(stats.nNullifiers, 1U);
+    BOOST_CHECK_EQUAL(stats.nNullifierLookups, 4U);
+    BOOST_CHECK_EQUAL(stats.nNullifierHits, 2U);
+}
+
+BOOST_AUTO_TEST_CASE(coins_view_nullifiers_written_while_loading)
+{
+    CCoinsViewDB view(1 << 20, true);
+    std::vector<uint256> vNullifiers;
+    for (int i = 0; i < 1000; i++) {
+        vNullifiers.push_back(GetRandHash());
+        WriteNullifier(view, vNullifiers.back(), true);
+    }
+
+    // Whichever writes the load sees, the set ends up as the database
+    std::thread loader([&view] { view.LoadNullifiers(); });
+    for (size_t i = 0; i < vNullifiers.size(); i += 2)
+        WriteNullifier(view, vNullifiers[i], false);
+    uint256 nfNew = GetRandHash();
+    WriteNullifier(view, nfNew, true);
+    loader.join();
+
+    CShieldedIndexStats stats;
+    view.GetShieldedIndexStats(stats);
+    BOOST_CHECK(stats.fNullifiersLoaded);
+    BOOST_CHECK_EQUAL(stats.nNullifiers, vNullifiers.size() / 2 + 1);
+    for (size_t i = 0; i < vNullifiers.size(); i++)
+        BOOST_CHECK_EQUAL(view.GetNullifier(vNullifiers[i], SAPLING), i % 2 == 1);
+    BOOST_CHECK(view.GetNullifier(nfNew, SAPLING));
+}
+
+BOOST_AUTO_TEST_CASE(coins_view_anchors)
+{
+    CCoinsViewDB view(1 << 20, true);
+    SaplingMerkleTree tree;
+    tree.append(ArithToUint256(arith_uint256(1)));
+    uint256 rt = tree.root();
+
+    CCoinsMap mapCoins;
+    CAnchorsSaplingMap mapAnchors;
+    CNullifiersMap mapNullifiers;
+    CAnchorsSaplingCacheEntry& entry = mapAnchors[rt];
+    entry.entered = true;
+    entry.tree = tree;
+    entry.flags = CAnchorsSaplingCacheEntry::DIRTY;
+    BOOST_CHECK(view.BatchWrite(mapCoins, uint256(), rt, mapAnchors, mapNullifiers));
+
+    // Freshly written anchors are served from memory
+    SaplingMerkleTree found;
+    BOOST_CHECK(view.GetSaplingAnchorAt(rt, found));
+    BOOST_CHECK(found.root() == rt);
+    CShieldedIndexStats stats;
+    view.GetShieldedIndexStats(stats);
+    BOOST_CHECK_EQUAL(stats.nAnchors, 1U);
+    BOOST_CHECK_EQUAL(stats.nAnchorHits, 1U);
+
+    // Disconnecting drops them from the cache too
+    CAnchorsSaplingCacheEntry& erased = mapAnchors[rt];
+    erased.entered = false;
+    erased.flags = CAnchorsSaplingCacheEntry::DIRTY;
+    BOOST_CHECK(view.BatchWrite(mapCoins, uint256(), SaplingMerkleTree::empty_root(), mapAnchors, mapNullifiers));
+    BOOST_CHECK(!view.GetSaplingAnchorAt(rt, found));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
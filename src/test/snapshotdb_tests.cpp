@@ -0,0 +1,165 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "snapshot-database.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+struct SnapshotTestObject {
+    std::map<int, std::string> mapFirst;
+    std::map<int, std::string> mapSecond;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(mapFirst);
+        READWRITE(mapSecond);
+    }
+
+    enum {
+        SNAPSHOT_SECTIONS = 2
+    };
+
+    template <typename Stream>
+    void SerializeSection(Stream& s, int nSection)
+    {
+        s << (nSection == 0 ? mapFirst : mapSecond);
+    }
+
+    template <typename Stream>
+    bool UnserializeSection(Stream& s, int nSection)
+    {
+        s >> (nSection == 0 ? mapFirst : mapSecond);
+        return true;
+    }
+
+    void Clear()
+    {
+        mapFirst.clear();
+        mapSecond.clear();
+    }
+
+    void CheckAndRemove() {}
+
+    std::string ToString() const
+    {
+        return strprintf("first: %d, second: %d", mapFirst.size(), mapSecond.size());
+    }
+};
+
+SnapshotTestObject MakeObject(int nFirst, int nSecond)
+{
+    SnapshotTestObject obj;
+    for (int i = 0; i < nFirst; i++)
+        obj.mapFirst[i] = std::string(100, 'a' + i % 26);
+    for (int i = 0; i < nSecond; i++)
+        obj.mapSecond[i] = std::string(10, 'A' + i % 26);
+    return obj;
+}
+
+void CheckEqual(const SnapshotTestObject& a, const SnapshotTestObject& b)
+{
+    BOOST_CHECK(a.mapFirst == b.mapFirst);
+    BOOST_CHECK(a.mapSecond == b.mapSecond);
+}
+}
+
+BOOST_FIXTURE_TEST_SUITE(snapshotdb_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(snapshotdb_roundtrip_and_incremental_dump)
+{
+    boost::filesystem::path path = GetDataDir() / "snapshot.dat";
+    CSnapshotDB<SnapshotTestObject> db("snapshot.dat", "magicSnapshotTest");
+
+    SnapshotTestObject obj = MakeObject(1000, 10);
+    BOOST_CHECK(db.Dump(obj));
+    uint64_t nSize = boost::filesystem::file_size(path);
+
+    SnapshotTestObject loaded;
+    BOOST_CHECK(db.Load(loaded));
+    CheckEqual(obj, loaded);
+
+    // Nothing changed, nothing is written
+    BOOST_CHECK(db.Dump(obj));
+    BOOST_CHECK_EQUAL(boost::filesystem::file_size(path), nSize);
+
+    // Only the changed small section is appended
+    obj.mapSecond[10] = "changed";
+    CDataStream ssSecond(SER_DISK, CLIENT_VERSION);
+    ssSecond << obj.mapSecond;
+    BOOST_CHECK(db.Dump(obj));
+    BOOST_CHECK_EQUAL(boost::filesystem::file_size(path), nSize + ssSecond.size());
+
+    loaded.Clear();
+    BOOST_CHECK(db.Load(loaded));
+    CheckEqual(obj, loaded);
+
+    // Stale sections never make up most of the file
+    for (int i = 0; i < 20; i++) {
+        obj.mapFirst[i] = "changed";
+        BOOST_CHECK(db.Dump(obj));
+        BOOST_CHECK(boost::filesystem::file_size(path) <= 2 * nSize + 2 * ssSecond.size());
+    }
+
+    loaded.Clear();
+    BOOST_CHECK(db.Load(loaded));
+    CheckEqual(obj, loaded);
+}
+
+BOOST_AUTO_TEST_CASE(snapshotdb_converts_flat_file)
+{
+    boost::filesystem::path path = GetDataDir() / "converted.dat";
+    SnapshotTestObject obj = MakeObject(10, 10);
+    BOOST_CHECK(CFlatDB<SnapshotTestObject>("converted.dat", "magicSnapshotTest").Dump(obj));
+
+    CSnapshotDB<SnapshotTestObject> db("converted.dat", "magicSnapshotTest");
+    SnapshotTestObject loaded;
+    BOOST_CHECK(db.Load(loaded));
+    CheckEqual(obj, loaded);
+
+    BOOST_CHECK(db.Dump(loaded));
+    unsigned char pchMagic[sizeof(SNAPSHOT_FILE_MAGIC)] = {};
+    FILE* file = fopen(path.string().c_str(), "rb");
+    BOOST_CHECK(fread(pchMagic, 1, sizeof(pchMagic), file) == sizeof(pchMagic));
+    fclose(file);
+    BOOST_CHECK(memcmp(pchMagic, SNAPSHOT_FILE_MAGIC, sizeof(pchMagic)) == 0);
+
+    loaded.Clear();
+    BOOST_CHECK(db.Load(loaded));
+    CheckEqual(obj, loaded);
+}
+
+BOOST_AUTO_TEST_CASE(snapshotdb_rejects_corruption)
+{
+    boost::filesystem::path path = GetDataDir() / "corrupt.dat";
+    CSnapshotDB<SnapshotTestObject> db("corrupt.dat", "magicSnapshotTest");
+    SnapshotTestObject obj = MakeObject(10, 10);
+    BOOST_CHECK(db.Dump(obj));
+
+    // A snapshot of something else is left alone
+    SnapshotTestObject loaded;
+    CSnapshotDB<SnapshotTestObject> dbOther("corrupt.dat", "magicOtherTest");
+    BOOST_CHECK(!dbOther.Load(loaded));
+    BOOST_CHECK(!dbOther.Dump(obj));
+
+    // Flip a byte of the last section
+    uint64_t nSize = boost::filesystem::file_size(path);
+    FILE* file = fopen(path.string().c_str(), "r+b");
+    BOOST_CHECK(fseek(file, nSize - 1, SEEK_SET) == 0);
+    int ch = fgetc(file);
+    BOOST_CHECK(fseek(file, nSize - 1, SEEK_SET) == 0);
+    fputc(ch ^ 1, file);
+    fclose(file);
+
+    BOOST_CHECK(!db.Load(loaded));
+    BOOST_CHECK(loaded.mapFirst.empty() && loaded.mapSecond.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
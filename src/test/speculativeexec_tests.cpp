@@ -0,0 +1,206 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <qtum/speculativeexec.h>
+
+#include <random.h>
+#include <test/test_bitcoin.h>
+#include <util.h>
+#include <validation.h>
+
+#include <libethashseal/Ethash.h>
+#include <libethashseal/GenesisInfo.h>
+#include <libethereum/ChainParams.h>
+
+#include <boost/test/unit_test.hpp>
+
+// Token with a balance per address in storage, transfer(to, amount) without any checks:
+//   bal[caller] -= amount; bal[to] += amount
+static const dev::bytes TOKEN_CODE = {
+    0x60, 0x20, 0x35,       // PUSH1 32 CALLDATALOAD   amount
+    0x80, 0x33, 0x54,       // DUP1 CALLER SLOAD
+    0x03, 0x33, 0x55,       // SUB CALLER SSTORE
+    0x60, 0x00, 0x35,       // PUSH1 0 CALLDATALOAD    to
+    0x80, 0x54, 0x82, 0x01, // DUP1 SLOAD DUP3 ADD
+    0x90, 0x55, 0x00,       // SWAP1 SSTORE STOP
+};
+
+static dev::Address RandomAddress()
+{
+    return dev::Address(uintToh256(GetRandHash()));
+}
+
+static QtumTransaction Transfer(const dev::Address& token, const dev::Address& sender)
+{
+    dev::bytes data(64);
+    dev::Address to = RandomAddress();
+    std::copy(to.asArray().begin(), to.asArray().end(), data.begin() + 12);
+    data[63] = 1;
+    QtumTransaction tx(0, 1, 100000, token, data, dev::u256(0));
+    tx.forceSender(sender);
+    tx.setHashWith(uintToh256(GetRandHash()));
+    tx.setNVout(0);
+    tx.setVersion(VersionVM::GetEVMDefault());
+    return tx;
+}
+
+struct SpeculativeExecSetup : public TestingSetup {
+    std::unique_ptr<QtumState> state;
+    std::unique_ptr<dev::eth::SealEngineFace> sealEngine;
+    dev::eth::EnvInfo envInfo;
+    std::vector<dev::Address> vTokens;
+    dev::h256 root;
+    dev::h256 rootUTXO;
+
+    SpeculativeExecSetup()
+    {
+        dev::eth::Ethash::init();
+        dev::eth::ChainParams cp((dev::eth::genesisInfo(dev::eth::Network::qtumMainNetwork)));
+        sealEngine.reset(cp.createSealEngine());
+        sealEngine->setQtumSchedule(dev::eth::EIP158Schedule);
+
+        std::string path = (pathTemp / "stateQtum").string();
+        state.reset(new QtumState(dev::u256(0), QtumState::openDB(path, dev::sha3(dev::rlp("")), dev::WithExisting::Kill), path, dev::eth::BaseState::Empty));
+        for (int i = 0; i < 3; i++) {
+            vTokens.push_back(RandomAddress());
+            state->createContract(vTokens.back());
+            state->setNewCode(vTokens.back(), dev::bytes(TOKEN_CODE));
+        }
+        state->commit(dev::eth::State::CommitBehaviour::KeepEmptyAccounts);
+        Commit();
+        root = state->rootHash();
+        rootUTXO = state->rootHashUTXO();
+
+        envInfo.setNumber(1);
+        envInfo.setTimestamp(GetTime());
+        envInfo.setGasLimit(10 * 100000);
+        envInfo.setAuthor(RandomAddress());
+        envInfo.setLastHashes(dev::eth::LastHashes(256));
+    }
+
+    ~SpeculativeExecSetup()
+    {
+        state.reset();
+    }
+
+    void Commit()
+    {
+        state->db().commit();
+        state->dbUtxo().commit();
+        sealEngine->deleteAddresses.clear();
+    }
+
+    // Same steps as ByteCodeExec::performByteCode
+    void ExecuteSequential(const std::vector<QtumTransaction>& txs, std::vector<ResultExecute>& result)
+    {
+        for (const QtumTransaction& tx : txs) {
+            if (!tx.isCreation() && !state->addressInUse(tx.receiveAddress())) {
+                dev::eth::ExecutionResult execRes;
+                execRes.excepted = dev::eth::TransactionException::Unknown;
+                result.push_back(ResultExecute{execRes, dev::eth::TransactionReceipt(dev::h256(), dev::u256(), dev::eth::LogEntries()), CTransaction()});
+                continue;
+            }
+            result.push_back(state->execute(envInfo, *sealEngine, tx));
+        }
+    }
+};
+
+static void CheckSameResults(const std::vector<ResultExecute>& a, const std::vector<ResultExecute>& b)
+{
+    BOOST_REQUIRE_EQUAL(a.size(), b.size());
+    for (size_t i = 0; i < a.size(); i++) {
+        BOOST_CHECK(a[i].execRes.excepted == b[i].execRes.excepted);
+        BOOST_CHECK(a[i].execRes.gasUsed == b[i].execRes.gasUsed);
+        BOOST_CHECK(a[i].txRec.stateRoot() == b[i].txRec.stateRoot());
+        BOOST_CHECK(a[i].txRec.rlp() == b[i].txRec.rlp());
+        BOOST_CHECK(a[i].tx.GetHash() == b[i].tx.GetHash());
+    }
+}
+
+BOOST_FIXTURE_TEST_SUITE(speculativeexec_tests, SpeculativeExecSetup)
+
+BOOST_AUTO_TEST_CASE(receipt_root_inference)
+{
+    dev::h256 before = uintToh256(GetRandHash());
+    dev::h256 after = uintToh256(GetRandHash());
+    BOOST_CHECK(SpeculativeTx::InferReceiptRoot(after, before, after) == SpeculativeTx::ROOT_AFTER);
+    BOOST_CHECK(SpeculativeTx::InferReceiptRoot(before, before, after) == SpeculativeTx::ROOT_BEFORE);
+    BOOST_CHECK(SpeculativeTx::InferReceiptRoot(dev::h256(), before, after) == SpeculativeTx::ROOT_KEEP);
+    // An execution that changed nothing carries the root after it
+    BOOST_CHECK(SpeculativeTx::InferReceiptRoot(before, before, before) == SpeculativeTx::ROOT_AFTER);
+}
+
+BOOST_AUTO_TEST_CASE(same_as_sequential)
+{
+    dev::Address sender = RandomAddress();
+    std::vector<std::vector<QtumTransaction> > vBlockTxs = {
+        {Transfer(vTokens[0], sender)},
+        {Transfer(vTokens[1], RandomAddress())},
+        // Conflicts with the first, through the same token and sender
+        {Transfer(vTokens[0], sender)},
+        // Call of an address without code, its receipt keeps a null root
+        {Transfer(RandomAddress(), RandomAddress())},
+        // Several executions, each receipt with its own intermediate root
+        {Transfer(vTokens[2], RandomAddress()), Transfer(vTokens[2], RandomAddress())},
+        // Conflicts with the second, through the same token
+        {Transfer(vTokens[2], RandomAddress()), Transfer(vTokens[1], RandomAddress())},
+    };
+
+    std::vector<std::vector<ResultExecute> > vSequential(vBlockTxs.size());
+    for (size_t i = 0; i < vBlockTxs.size(); i++) {
+        ExecuteSequential(vBlockTxs[i], vSequential[i]);
+        Commit();
+    }
+    dev::h256 rootSequential = state->rootHash();
+    dev::h256 rootUTXOSequential = state->rootHashUTXO();
+    BOOST_CHECK(rootSequential != root);
+    BOOST_CHECK(vSequential[3][0].txRec.stateRoot() == dev::h256());
+
+    state->setRoot(root);
+    state->setRootUTXO(rootUTXO);
+    SpeculativeExec speculation(*state, envInfo, *sealEngine);
+    for (size_t i = 0; i < vBlockTxs.size(); i++)
+        speculation.Add(i, vBlockTxs[i]);
+    BOOST_CHECK_EQUAL(speculation.Size(), vBlockTxs.size());
+    speculation.Run();
+
+    std::vector<bool> vApplied;
+    for (size_t i = 0; i < vBlockTxs.size(); i++) {
+        std::vector<ResultExecute> result;
+        vApplied.push_back(speculation.Apply(i, vBlockTxs[i], result));
+        if (!vApplied.back()) {
+            BOOST_CHECK(result.empty());
+            speculation.BeginSequential();
+            ExecuteSequential(vBlockTxs[i], result);
+            speculation.EndSequential();
+        }
+        Commit();
+        CheckSameResults(result, vSequential[i]);
+    }
+    BOOST_CHECK(state->rootHash() == rootSequential);
+    BOOST_CHECK(state->rootHashUTXO() == rootUTXOSequential);
+
+    // Only the transaction reading what an earlier one wrote had to be executed again
+    std::vector<bool> vExpected = {true, true, false, true, true, false};
+    BOOST_CHECK(vApplied == vExpected);
+}
+
+BOOST_AUTO_TEST_CASE(changed_transactions)
+{
+    std::vector<QtumTransaction> txs = {Transfer(vTokens[0], RandomAddress())};
+    SpeculativeExec speculation(*state, envInfo, *sealEngine);
+    speculation.Add(0, txs);
+    speculation.Run();
+
+    // Results are only used for the transactions they were made for
+    std::vector<QtumTransaction> txsOther = {Transfer(vTokens[0], RandomAddress())};
+    std::vector<ResultExecute> result;
+    BOOST_CHECK(!speculation.Apply(0, txsOther, result));
+    BOOST_CHECK(!speculation.Apply(0, txs, result));
+    BOOST_CHECK(!speculation.Apply(1, txs, result));
+    BOOST_CHECK(result.empty());
+    BOOST_CHECK(state->rootHash() == root);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
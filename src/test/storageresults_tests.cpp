@@ -0,0 +1,278 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <qtum/storageresults.h>
+
+#include "test/test_bitcoin.h"
+
+#include <libdevcore/RLP.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+struct StorageResultsSetup : public BasicTestingSetup {
+    boost::filesystem::path path;
+
+    StorageResultsSetup()
+    {
+        path = boost::filesystem::temp_directory_path() / strprintf("test_storageresults_%lu_%i", (unsigned long)GetTime(), (int)GetRandInt(100000));
+        boost::filesystem::create_directories(path);
+    }
+
+    ~StorageResultsSetup()
+    {
+        boost::filesystem::remove_all(path);
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(storageresults_tests, StorageResultsSetup)
+
+static CTransactionRef Tx(uint32_t n)
+{
+    CMutableTransaction tx;
+    tx.nLockTime = n;
+    return MakeTransactionRef(tx);
+}
+
+static std::vector<TransactionReceiptInfo> Receipts(const CTransactionRef& tx, unsigned int nLogs)
+{
+    std::vector<TransactionReceiptInfo> receipts;
+    for (uint32_t i = 0; i < 2; i++) {
+        TransactionReceiptInfo r;
+        r.blockHash = ArithToUint256(arith_uint256(1000 + tx->nLockTime));
+        r.blockNumber = 100 + tx->nLockTime;
+        r.transactionHash = tx->GetHash();
+        r.transactionIndex = i;
+        r.from = dev::Address(1 + i);
+        r.to = dev::Address(10 + i);
+        r.cumulativeGasUsed = 21000 * (i + 1);
+        r.gasUsed = 21000;
+        r.contractAddress = dev::Address(20 + i);
+        for (unsigned int j = 0; j < nLogs; j++)
+            r.logs.push_back(dev::eth::LogEntry(r.to, dev::h256s{dev::h256(j), dev::h256(j + 1)}, dev::bytes(j + 1, 0xab)));
+        r.excepted = i ? dev::eth::TransactionException::OutOfGas : dev::eth::TransactionException::None;
+        receipts.push_back(r);
+    }
+    return receipts;
+}
+
+static void CheckEqual(const std::vector<TransactionReceiptInfo>& a, const std::vector<TransactionReceiptInfo>& b)
+{
+    BOOST_REQUIRE_EQUAL(a.size(), b.size());
+    for (size_t i = 0; i < a.size(); i++) {
+        BOOST_CHECK(a[i].blockHash == b[i].blockHash);
+        BOOST_CHECK_EQUAL(a[i].blockNumber, b[i].blockNumber);
+        BOOST_CHECK(a[i].transactionHash == b[i].transactionHash);
+        BOOST_CHECK_EQUAL(a[i].transactionIndex, b[i].transactionIndex);
+        BOOST_CHECK(a[i].from == b[i].from);
+        BOOST_CHECK(a[i].to == b[i].to);
+        BOOST_CHECK_EQUAL(a[i].cumulativeGasUsed, b[i].cumulativeGasUsed);
+        BOOST_CHECK_EQUAL(a[i].gasUsed, b[i].gasUsed);
+        BOOST_CHECK(a[i].contractAddress == b[i].contractAddress);
+        BOOST_CHECK(a[i].excepted == b[i].excepted);
+        BOOST_REQUIRE_EQUAL(a[i].logs.size(), b[i].logs.size());
+        for (size_t j = 0; j < a[i].logs.size(); j++) {
+            BOOST_CHECK(a[i].logs[j].address == b[i].logs[j].address);
+            BOOST_CHECK(a[i].logs[j].topics == b[i].logs[j].topics);
+            BOOST_CHECK(a[i].logs[j].data == b[i].logs[j].data);
+        }
+    }
+}
+
+static void Commit(StorageResults& results, const CTransactionRef& tx, unsigned int nLogs)
+{
+    std::vector<TransactionReceiptInfo> receipts = Receipts(tx, nLogs);
+    results.addResult(uintToh256(tx->GetHash()), receipts);
+    BOOST_CHECK(results.commitResults());
+}
+
+BOOST_AUTO_TEST_CASE(compact_roundtrip)
+{
+    CTransactionRef tx = Tx(1);
+    dev::h256 hash = uintToh256(tx->GetHash());
+    {
+        StorageResults results(path.string(), 1 << 20);
+        std::vector<TransactionReceiptInfo> receipts = Receipts(tx, 3);
+        results.addResult(hash, receipts);
+
+        // Staged receipts only show once their block is connected
+        BOOST_CHECK(results.getResult(hash).empty());
+        BOOST_CHECK(results.commitResults());
+        CheckEqual(results.getResult(hash), receipts);
+
+        // Receipts of a block that was not connected are dropped
+        CTransactionRef other = Tx(2);
+        std::vector<TransactionReceiptInfo> otherReceipts = Receipts(other, 1);
+        results.addResult(uintToh256(other->GetHash()), otherReceipts);
+        results.clearCacheResult();
+        BOOST_CHECK(results.commitResults());
+        BOOST_CHECK(results.getResult(uintToh256(other->GetHash())).empty());
+    }
+
+    // Written on shutdown and read back from disk
+    StorageResults results(path.string(), 1 << 20);
+    CheckEqual(results.getResult(hash), Receipts(tx, 3));
+    BOOST_CHECK_EQUAL(results.stats().misses, 1U);
+    CheckEqual(results.getResult(hash), Receipts(tx, 3));
+    BOOST_CHECK_EQUAL(results.stats().hits, 1U);
+}
+
+BOOST_AUTO_TEST_CASE(legacy_decode)
+{
+    CTransactionRef tx1 = Tx(1);
+    CTransactionRef tx2 = Tx(2);
+    std::vector<TransactionReceiptInfo> receipts1 = Receipts(tx1, 2);
+    std::vector<TransactionReceiptInfo> receipts2 = Receipts(tx2, 0);
+    {
+        // Earlier versions stored RLP under the hex of the transaction hash,
+        // the oldest without the exceptions
+        leveldb::DB* db;
+        leveldb::Options options;
+        options.create_if_missing = true;
+        BOOST_REQUIRE(leveldb::DB::Open(options, (path / "resultsDB").string(), &db).ok());
+        for (int nItems : {11, 10}) {
+            const std::vector<TransactionReceiptInfo>& receipts = nItems == 11 ? receipts1 : receipts2;
+            TransactionReceiptInfoSerialized tris;
+            for (const TransactionReceiptInfo& r : receipts) {
+                tris.blockHashes.push_back(uintToh256(r.blockHash));
+                tris.blockNumbers.push_back(r.blockNumber);
+                tris.transactionHashes.push_back(uintToh256(r.transactionHash));
+                tris.transactionIndexes.push_back(r.transactionIndex);
+                tris.senders.push_back(r.from);
+                tris.receivers.push_back(r.to);
+                tris.cumulativeGasUsed.push_back(r.cumulativeGasUsed);
+                tris.gasUsed.push_back(r.gasUsed);
+                tris.contractAddresses.push_back(r.contractAddress);
+                logEntriesSerializ logs;
+                for (const dev::eth::LogEntry& log : r.logs)
+                    logs.push_back(std::make_pair(log.address, std::make_pair(log.topics, log.data)));
+                tris.logs.push_back(logs);
+                tris.excepted.push_back(uint32_t(r.excepted));
+            }
+            dev::RLPStream streamRLP(nItems);
+            streamRLP << tris.blockHashes << tris.blockNumbers << tris.transactionHashes << tris.transactionIndexes << tris.senders;
+            streamRLP << tris.receivers << tris.cumulativeGasUsed << tris.gasUsed << tris.contractAddresses << tris.logs;
+            if (nItems == 11)
+                streamRLP << tris.excepted;
+            dev::bytes data = streamRLP.out();
+            BOOST_REQUIRE(db->Put(leveldb::WriteOptions(), uintToh256(receipts[0].transactionHash).hex(),
+                                  leveldb::Slice((const char*)data.data(), data.size())).ok());
+        }
+        delete db;
+    }
+
+    for (TransactionReceiptInfo& r : receipts2)
+        r.excepted = dev::eth::TransactionException::NoInformation;
+
+    StorageResults results(path.string(), 1 << 20);
+    CheckEqual(results.getResult(uintToh256(tx1->GetHash())), receipts1);
+    CheckEqual(results.getResult(uintToh256(tx2->GetHash())), receipts2);
+
+    // Cached in the compact encoding
+    CheckEqual(results.getResult(uintToh256(tx1->GetHash())), receipts1);
+    BOOST_CHECK_EQUAL(results.stats().hits, 1U);
+
+    // Deleting removes the legacy entry too
+    results.deleteResults(std::vector<CTransactionRef>{tx1});
+    BOOST_CHECK(results.getResult(uintToh256(tx1->GetHash())).empty());
+}
+
+BOOST_AUTO_TEST_CASE(lru_eviction)
+{
+    // All receipts encode to the same size
+    size_t nEntry;
+    {
+        StorageResults results(path.string(), 1 << 20);
+        Commit(results, Tx(1), 1);
+        nEntry = results.stats().bytes;
+        BOOST_CHECK(nEntry > StorageResults::c_entryOverhead);
+    }
+    boost::filesystem::remove_all(path);
+    boost::filesystem::create_directories(path);
+
+    StorageResults results(path.string(), 4 * nEntry);
+    std::vector<CTransactionRef> txs;
+    for (uint32_t i = 1; i <= 6; i++) {
+        txs.push_back(Tx(i));
+        Commit(results, txs.back(), 1);
+        BOOST_CHECK(results.flush());
+    }
+    StorageResults::Stats stats = results.stats();
+    BOOST_CHECK_EQUAL(stats.entries, 4U);
+    BOOST_CHECK_EQUAL(stats.dirty, 0U);
+    BOOST_CHECK_EQUAL(stats.bytes, 4 * nEntry);
+
+    // The most recent receipts are cached, touch the oldest of them
+    CheckEqual(results.getResult(uintToh256(txs[2]->GetHash())), Receipts(txs[2], 1));
+    BOOST_CHECK_EQUAL(results.stats().hits, 1U);
+
+    // Evicted receipts come from disk and push out the least recently used
+    CheckEqual(results.getResult(uintToh256(txs[0]->GetHash())), Receipts(txs[0], 1));
+    BOOST_CHECK_EQUAL(results.stats().misses, 1U);
+    BOOST_CHECK_EQUAL(results.stats().entries, 4U);
+    CheckEqual(results.getResult(uintToh256(txs[2]->GetHash())), Receipts(txs[2], 1));
+    CheckEqual(results.getResult(uintToh256(txs[0]->GetHash())), Receipts(txs[0], 1));
+    BOOST_CHECK_EQUAL(results.stats().hits, 3U);
+    CheckEqual(results.getResult(uintToh256(txs[3]->GetHash())), Receipts(txs[3], 1));
+    BOOST_CHECK_EQUAL(results.stats().misses, 2U);
+
+    // Deleted receipts leave the cache and the disk
+    results.deleteResults(std::vector<CTransactionRef>{txs[0], txs[2]});
+    BOOST_CHECK(results.getResult(uintToh256(txs[0]->GetHash())).empty());
+    BOOST_CHECK(results.getResult(uintToh256(txs[2]->GetHash())).empty());
+    BOOST_CHECK_EQUAL(results.stats().entries, 2U);
+    BOOST_CHECK_EQUAL(results.stats().bytes, 2 * nEntry);
+}
+
+BOOST_AUTO_TEST_CASE(dirty_flush)
+{
+    std::vector<CTransactionRef> txs;
+    for (uint32_t i = 1; i <= 3; i++)
+        txs.push_back(Tx(i));
+
+    size_t nEntry;
+    {
+        StorageResults results(path.string(), 1 << 20);
+        for (const CTransactionRef& tx : txs)
+            Commit(results, tx, 2);
+        StorageResults::Stats stats = results.stats();
+        BOOST_CHECK_EQUAL(stats.dirty, 3U);
+        BOOST_CHECK_EQUAL(stats.entries, 3U);
+        nEntry = stats.bytes / 3;
+
+        // Dirty receipts are served from memory
+        for (const CTransactionRef& tx : txs)
+            CheckEqual(results.getResult(uintToh256(tx->GetHash())), Receipts(tx, 2));
+        BOOST_CHECK_EQUAL(results.stats().hits, 3U);
+
+        // Deleting a dirty receipt means it is never written
+        results.deleteResults(std::vector<CTransactionRef>{txs[1]});
+        BOOST_CHECK_EQUAL(results.stats().dirty, 2U);
+
+        BOOST_CHECK(results.flush());
+        stats = results.stats();
+        BOOST_CHECK_EQUAL(stats.dirty, 0U);
+        BOOST_CHECK_EQUAL(stats.entries, 2U);
+        BOOST_CHECK(results.flush());
+    }
+    {
+        StorageResults results(path.string(), 1 << 20);
+        CheckEqual(results.getResult(uintToh256(txs[0]->GetHash())), Receipts(txs[0], 2));
+        BOOST_CHECK(results.getResult(uintToh256(txs[1]->GetHash())).empty());
+        CheckEqual(results.getResult(uintToh256(txs[2]->GetHash())), Receipts(txs[2], 2));
+    }
+    boost::filesystem::remove_all(path);
+    boost::filesystem::create_directories(path);
+
+    // Dirty receipts are written early once they take half the cache
+    StorageResults results(path.string(), 4 * nEntry);
+    Commit(results, txs[0], 2);
+    Commit(results, txs[1], 2);
+    BOOST_CHECK_EQUAL(results.stats().dirty, 2U);
+    Commit(results, txs[2], 2);
+    BOOST_CHECK_EQUAL(results.stats().dirty, 0U);
+    BOOST_CHECK_EQUAL(results.stats().entries, 3U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -12,6 +12,7 @@
 #include "pow.h"
 #include "uint256.h"
 
+#include <algorithm>
 #include <stdint.h>
 
 #include <boost/thread.hpp>
@@ -30,8 +31,11 @@ static const char DB_ADDR_TXS = 'r';
 static const char DB_ADDRESSINDEX = 'a';
 static const char DB_ADDRESSUNSPENTINDEX = 'u';
 static const char DB_SPENTINDEX = 'p';
+static const char DB_ADDRESSOUTPUTINDEX = 'o';
 ////////////////////////////////////////// // qtum
 static const char DB_HEIGHTINDEX = 'h';
+static const char DB_LOGBLOOM = 'L';
+static const char DB_TXLOGBLOOM = 'e';
 /////////////////////////////////////////
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_BEST_SAPLING_ANCHOR = 'z';
@@ -75,11 +79,11 @@ struct CoinEntry {
 
 }
 
-CCoinsViewDB::CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / dbName, nCacheSize, fMemory, fWipe)
+CCoinsViewDB::CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / dbName, nCacheSize, fMemory, fWipe), fNullifiersLoaded(false), fNullifiersLoading(false)
 {
 }
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe)
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe), fNullifiersLoaded(false), fNullifiersLoading(false)
 {
 }
 
@@ -92,23 +96,81 @@ bool CCoinsViewDB::GetSaplingAnchorAt(const uint256& rt, SaplingMerkleTree& tree
         return true;
     }
 
+    LOCK(cs_shielded);
+    if (anchorCache.get(rt, tree))
+        return true;
+
     bool read = db.Read(make_pair(DB_SAPLING_ANCHOR, rt), tree);
+    if (read)
+        anchorCache.insert(rt, tree);
 
     return read;
 }
 
+void CCoinsViewDB::LoadNullifiers()
+{
+    {
+        LOCK(cs_shielded);
+        if (fNullifiersLoaded || fNullifiersLoading)
+            return;
+        // From here on BatchWrite records what it changes, the iterator below may not see it
+        fNullifiersLoading = true;
+        vNullifiersPending.clear();
+    }
+    int64_t nStart = GetTimeMillis();
+
+    try {
+        boost::scoped_ptr<CDBIterator> pcursor(db.NewIterator());
+        pcursor->Seek(make_pair(DB_SAPLING_NULLIFIER, uint256()));
+        while (pcursor->Valid()) {
+            boost::this_thread::interruption_point();
+            std::pair<char, uint256> key;
+            if (!pcursor->GetKey(key) || key.first != DB_SAPLING_NULLIFIER)
+                break;
+            setNullifiers.insert(key.second);
+            pcursor->Next();
+        }
+    } catch (...) {
+        LOCK(cs_shielded);
+        setNullifiers.clear();
+        fNullifiersLoading = false;
+        vNullifiersPending.clear();
+        throw;
+    }
+
+    LOCK(cs_shielded);
+    // Replayed in order, changes the iterator already saw leave the set as it is
+    for (const std::pair<uint256, bool>& nf : vNullifiersPending) {
+        if (nf.second)
+            setNullifiers.insert(nf.first);
+        else
+            setNullifiers.erase(nf.first);
+    }
+    std::vector<std::pair<uint256, bool> >().swap(vNullifiersPending);
+    fNullifiersLoading = false;
+    fNullifiersLoaded = true;
+
+    LogPrint("coindb", "Loaded %u Sapling nullifiers (%.1f MiB) in %dms\n", setNullifiers.size(),
+             setNullifiers.DynamicMemoryUsage() * (1.0 / (1 << 20)), GetTimeMillis() - nStart);
+}
+
 bool CCoinsViewDB::GetNullifier(const uint256& nf, ShieldedType type) const
 {
-    bool spent = false;
-    char dbChar;
     switch (type) {
     case SAPLING:
-        dbChar = DB_SAPLING_NULLIFIER;
         break;
     default:
         throw runtime_error("Unknown shielded type");
     }
-    return db.Read(make_pair(dbChar, nf), spent);
+
+    // Most looked up nullifiers are unspent, the set answers without the database
+    {
+        LOCK(cs_shielded);
+        if (fNullifiersLoaded)
+            return setNullifiers.contains(nf);
+    }
+    bool spent = false;
+    return db.Read(make_pair(DB_SAPLING_NULLIFIER, nf), spent);
 }
 
 
@@ -146,7 +208,7 @@ uint256 CCoinsViewDB::GetBestAnchor(ShieldedType type) const
     return hashBestAnchor;
 }
 
-void BatchWriteNullifiers(CDBBatch& batch, CNullifiersMap& mapToUse, const char& dbChar)
+void BatchWriteNullifiers(CDBBatch& batch, CNullifiersMap& mapToUse, const char& dbChar, std::vector<std::pair<uint256, bool> >& vChanged)
 {
     for (CNullifiersMap::iterator it = mapToUse.begin(); it != mapToUse.end();) {
         if (it->second.flags & CNullifiersCacheEntry::DIRTY) {
@@ -154,6 +216,7 @@ void BatchWriteNullifiers(CDBBatch& batch, CNullifiersMap& mapToUse, const char&
                 batch.Erase(make_pair(dbChar, it->first));
             else
                 batch.Write(make_pair(dbChar, it->first), true);
+            vChanged.push_back(std::make_pair(it->first, it->second.entered));
             // TODO: changed++? ... See comment in CCoinsViewDB::BatchWrite. If this is needed we could return an int
         }
         CNullifiersMap::iterator itOld = it++;
@@ -162,15 +225,17 @@ void BatchWriteNullifiers(CDBBatch& batch, CNullifiersMap& mapToUse, const char&
 }
 
 template<typename Map, typename MapIterator, typename MapEntry, typename Tree>
-void BatchWriteAnchors(CDBBatch& batch, Map& mapToUse, const char& dbChar)
+void BatchWriteAnchors(CDBBatch& batch, Map& mapToUse, const char& dbChar, std::vector<std::pair<uint256, Tree> >& vWritten, std::vector<uint256>& vErased)
 {
     for (MapIterator it = mapToUse.begin(); it != mapToUse.end();) {
         if (it->second.flags & MapEntry::DIRTY) {
-            if (!it->second.entered)
+            if (!it->second.entered) {
                 batch.Erase(make_pair(dbChar, it->first));
-            else {
+                vErased.push_back(it->first);
+            } else {
                 if (it->first != Tree::empty_root()) {
                     batch.Write(make_pair(dbChar, it->first), it->second.tree);
+                    vWritten.push_back(std::make_pair(it->first, it->second.tree));
                 }
             }
             // TODO: changed++?
@@ -203,9 +268,12 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap& mapCoins,
         mapCoins.erase(itOld);
     }
 
-    ::BatchWriteAnchors<CAnchorsSaplingMap, CAnchorsSaplingMap::iterator, CAnchorsSaplingCacheEntry, SaplingMerkleTree>(batch, mapSaplingAnchors, DB_SAPLING_ANCHOR);
+    std::vector<std::pair<uint256, SaplingMerkleTree> > vAnchorsWritten;
+    std::vector<uint256> vAnchorsErased;
+    ::BatchWriteAnchors<CAnchorsSaplingMap, CAnchorsSaplingMap::iterator, CAnchorsSaplingCacheEntry, SaplingMerkleTree>(batch, mapSaplingAnchors, DB_SAPLING_ANCHOR, vAnchorsWritten, vAnchorsErased);
 
-    ::BatchWriteNullifiers(batch, mapSaplingNullifiers, DB_SAPLING_NULLIFIER);
+    std::vector<std::pair<uint256, bool> > vNullifiersChanged;
+    ::BatchWriteNullifiers(batch, mapSaplingNullifiers, DB_SAPLING_NULLIFIER, vNullifiersChanged);
 
     if (!hashBlock.IsNull())
         BatchWriteHashBestChain(batch, hashBlock);
@@ -213,7 +281,44 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap& mapCoins,
         batch.Write(DB_BEST_SAPLING_ANCHOR, hashSaplingAnchor);
 
     LogPrint("coindb", "Committing %u changed transactions (out of %u) to coin database...\n", (unsigned int) changed, (unsigned int) count);
-    return db.WriteBatch(batch);
+    if (!db.WriteBatch(batch))
+        return false;
+
+    // Until the nullifier set is loaded the database is all there is to update
+    LOCK(cs_shielded);
+    if (fNullifiersLoaded) {
+        for (const std::pair<uint256, bool>& nf : vNullifiersChanged) {
+            if (nf.second)
+                setNullifiers.insert(nf.first);
+            else
+                setNullifiers.erase(nf.first);
+        }
+    } else if (fNullifiersLoading) {
+        vNullifiersPending.insert(vNullifiersPending.end(), vNullifiersChanged.begin(), vNullifiersChanged.end());
+    }
+    for (const uint256& rt : vAnchorsErased)
+        anchorCache.erase(rt);
+    // Anchors of the latest blocks are the ones spends refer to next
+    for (const std::pair<uint256, SaplingMerkleTree>& anchor : vAnchorsWritten)
+        anchorCache.insert(anchor.first, anchor.second);
+    return true;
+}
+
+void CCoinsViewDB::GetShieldedIndexStats(CShieldedIndexStats& stats) const
+{
+    LOCK(cs_shielded);
+    stats.fNullifiersLoaded = fNullifiersLoaded;
+    if (fNullifiersLoaded) {
+        stats.nNullifiers = setNullifiers.size();
+        stats.nNullifierUsage = setNullifiers.DynamicMemoryUsage();
+        stats.nNullifierLookups = setNullifiers.nLookups;
+        stats.nNullifierFiltered = setNullifiers.nFiltered;
+        stats.nNullifierHits = setNullifiers.nHits;
+    }
+    stats.nAnchors = anchorCache.size();
+    stats.nAnchorUsage = anchorCache.DynamicMemoryUsage();
+    stats.nAnchorLookups = anchorCache.nLookups;
+    stats.nAnchorHits = anchorCache.nHits;
 }
 
 CCoinsViewCursor* CCoinsViewDB::Cursor() const
@@ -316,6 +421,23 @@ bool CBlockTreeDB::ReadTxIndex(const uint256& txid, CDiskTxPos& pos)
     return Read(make_pair(DB_TXINDEX, txid), pos);
 }
 
+void CBlockTreeDB::ReadTxIndex(const std::vector<uint256>& txids, std::vector<std::pair<uint256, CDiskTxPos> >& vect)
+{
+    // Keys compare like the serialized hashes, seeking them in order walks the table once
+    std::vector<uint256> sorted(txids);
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    for (const uint256& txid : sorted) {
+        pcursor->Seek(make_pair(DB_TXINDEX, txid));
+        std::pair<char, uint256> key;
+        CDiskTxPos pos;
+        if (pcursor->Valid() && pcursor->GetKey(key) && key.first == DB_TXINDEX && key.second == txid && pcursor->GetValue(pos))
+            vect.push_back(std::make_pair(txid, pos));
+    }
+}
+
 bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> >& vect)
 {
     CDBBatch batch(*this);
@@ -435,6 +557,103 @@ bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
     return true;
 }
 
+bool CBlockTreeDB::UpdateAddressOutputIndex(const std::vector<std::pair<CAddressOutputKey, CAmount> >& vect)
+{
+    CDBBatch batch(*this);
+    for (std::vector<std::pair<CAddressOutputKey, CAmount> >::const_iterator it = vect.begin(); it != vect.end(); it++) {
+        if (it->second == -1) {
+            batch.Erase(make_pair(DB_ADDRESSOUTPUTINDEX, it->first));
+        } else {
+            batch.Write(make_pair(DB_ADDRESSOUTPUTINDEX, it->first), it->second);
+        }
+    }
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadAddressOutputIndex(uint160 addressHash, int type, int start, int height, CAmount minValue,
+                                          const CAddressOutputKey* pkeyAfter, size_t maxResults,
+                                          std::vector<std::pair<CAddressOutputKey, CAmount> >& outputs, bool& fMore)
+{
+    fMore = false;
+
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    // Everything spent up to height sorts before the seek key
+    if (pkeyAfter)
+        pcursor->Seek(make_pair(DB_ADDRESSOUTPUTINDEX, *pkeyAfter));
+    else
+        pcursor->Seek(make_pair(DB_ADDRESSOUTPUTINDEX, CAddressIndexIteratorHeightKey(type, addressHash, height + 1)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CAddressOutputKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSOUTPUTINDEX || key.second.hashBytes != addressHash || key.second.type != (unsigned int)type)
+            break;
+
+        if (pkeyAfter && key.second.spentHeight == pkeyAfter->spentHeight && key.second.blockHeight == pkeyAfter->blockHeight &&
+            key.second.txhash == pkeyAfter->txhash && key.second.index == pkeyAfter->index) {
+            pcursor->Next();
+            continue;
+        }
+
+        if (key.second.spentHeight > height && key.second.blockHeight >= start && key.second.blockHeight <= height) {
+            CAmount nValue;
+            if (!pcursor->GetValue(nValue))
+                return error("failed to get address output value");
+            if (nValue >= minValue) {
+                if (outputs.size() >= maxResults) {
+                    fMore = true;
+                    break;
+                }
+                outputs.push_back(make_pair(key.second, nValue));
+            }
+        }
+        pcursor->Next();
+    }
+
+    return true;
+}
+
+bool CBlockTreeDB::BuildAddressOutputIndex()
+{
+    LogPrintf("Building address output index...\n");
+
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(DB_ADDRESSINDEX);
+
+    std::vector<std::pair<CAddressOutputKey, CAmount> > outputs;
+    size_t nCount = 0;
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CAddressIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSINDEX)
+            break;
+
+        const CAddressIndexKey& addressKey = key.second;
+        if (!addressKey.spending) {
+            CAmount nValue;
+            if (!pcursor->GetValue(nValue))
+                return error("failed to get address index value");
+            CSpentIndexKey spentKey(addressKey.txhash, addressKey.index);
+            CSpentIndexValue spentValue;
+            int nSpentHeight = ReadSpentIndex(spentKey, spentValue) ? spentValue.blockHeight : ADDRESS_OUTPUT_UNSPENT;
+            outputs.push_back(make_pair(CAddressOutputKey(addressKey.type, addressKey.hashBytes, nSpentHeight, addressKey.blockHeight, addressKey.txhash, addressKey.index), nValue));
+            if (outputs.size() >= 10000) {
+                if (!UpdateAddressOutputIndex(outputs))
+                    return false;
+                nCount += outputs.size();
+                outputs.clear();
+            }
+        }
+        pcursor->Next();
+    }
+    if (!UpdateAddressOutputIndex(outputs))
+        return false;
+    nCount += outputs.size();
+
+    LogPrintf("Indexed %u address outputs\n", nCount);
+    return WriteFlag("addressoutputindex", true);
+}
 
 bool CBlockTreeDB::WriteFlag(const std::string& name, bool fValue)
 {
@@ -474,9 +693,27 @@ bool CBlockTreeDB::EraseAnonymousBlock(const uint256& blockhash)
     return Erase(std::make_pair(DB_ANONYMOUS_BLOCK, blockhash));
 }
 
+/** Whether bloom contains all bits of one of filters, a word at a time as this runs for every block scanned */
+static bool LogBloomMatches(const dev::h2048& bloom, const std::vector<dev::h2048>& filters)
+{
+    for (const dev::h2048& filter : filters) {
+        bool fMatch = true;
+        for (unsigned int i = 0; i < dev::h2048::size && fMatch; i += sizeof(uint64_t)) {
+            uint64_t nBloom, nFilter;
+            memcpy(&nBloom, bloom.data() + i, sizeof(nBloom));
+            memcpy(&nFilter, filter.data() + i, sizeof(nFilter));
+            fMatch = (nBloom & nFilter) == nFilter;
+        }
+        if (fMatch)
+            return true;
+    }
+    return false;
+}
+
 int CBlockTreeDB::ReadHeightIndex(int low, int high, int minconf,
                                   std::vector<std::vector<uint256>>& blocksOfHashes,
-                                  std::set<dev::h160> const& addresses)
+                                  std::set<dev::h160> const& addresses,
+                                  std::vector<dev::h2048> const& blooms)
 {
 
     if ((high < low && high > -1) || (high == 0 && low == 0) || (high < -1 || low < 0)) {
@@ -485,6 +722,73 @@ int CBlockTreeDB::ReadHeightIndex(int low, int high, int minconf,
 
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
 
+    if (!blooms.empty()) {
+        // The block blooms are small and sequential, scan them first and only
+        // visit the heights whose logs may match
+        std::vector<unsigned int> vHeights;
+        int curheight = 0;
+        for (pcursor->Seek(std::make_pair(DB_LOGBLOOM, CHeightTxIndexIteratorKey(low))); pcursor->Valid(); pcursor->Next()) {
+            std::pair<char, CHeightTxIndexIteratorKey> key;
+            if (!pcursor->GetKey(key) || key.first != DB_LOGBLOOM) {
+                break;
+            }
+
+            int nextHeight = key.second.height;
+            if (high > -1 && nextHeight > high) {
+                break;
+            }
+            if (minconf > 0 && chainActive.Height() - nextHeight < minconf) {
+                break;
+            }
+            curheight = nextHeight;
+
+            std::vector<unsigned char> vchBloom;
+            if (!pcursor->GetValue(vchBloom)) {
+                break;
+            }
+            if (LogBloomMatches(dev::h2048(vchBloom), blooms)) {
+                vHeights.push_back(nextHeight);
+            }
+        }
+
+        for (unsigned int height : vHeights) {
+            std::set<uint256> setTxMatch;
+            for (pcursor->Seek(std::make_pair(DB_TXLOGBLOOM, CHeightTxIndexIteratorKey(height))); pcursor->Valid(); pcursor->Next()) {
+                std::pair<char, std::pair<CHeightTxIndexIteratorKey, uint256> > key;
+                if (!pcursor->GetKey(key) || key.first != DB_TXLOGBLOOM || key.second.first.height != height) {
+                    break;
+                }
+                std::vector<unsigned char> vchBloom;
+                if (pcursor->GetValue(vchBloom) && LogBloomMatches(dev::h2048(vchBloom), blooms)) {
+                    setTxMatch.insert(key.second.second);
+                }
+            }
+
+            for (pcursor->Seek(std::make_pair(DB_HEIGHTINDEX, CHeightTxIndexIteratorKey(height))); pcursor->Valid(); pcursor->Next()) {
+                std::pair<char, CHeightTxIndexKey> key;
+                if (!pcursor->GetKey(key) || key.first != DB_HEIGHTINDEX || key.second.height != height) {
+                    break;
+                }
+                if (!addresses.empty() && addresses.find(key.second.address) == addresses.end()) {
+                    continue;
+                }
+
+                std::vector<uint256> hashesTx;
+                if (!pcursor->GetValue(hashesTx)) {
+                    break;
+                }
+                hashesTx.erase(std::remove_if(hashesTx.begin(), hashesTx.end(), [&setTxMatch](const uint256& hash) {
+                    return !setTxMatch.count(hash);
+                }), hashesTx.end());
+                if (!hashesTx.empty()) {
+                    blocksOfHashes.push_back(hashesTx);
+                }
+            }
+        }
+
+        return curheight;
+    }
+
     pcursor->Seek(std::make_pair(DB_HEIGHTINDEX, CHeightTxIndexIteratorKey(low)));
 
     int curheight = 0;
@@ -573,6 +877,88 @@ bool CBlockTreeDB::WipeHeightIndex()
 
     return WriteBatch(batch);
 }
+
+bool CBlockTreeDB::WriteLogBloomIndex(unsigned int height, const dev::h2048& bloom, const std::vector<std::pair<uint256, dev::h2048> >& txBlooms)
+{
+    CDBBatch batch(*this);
+    batch.Write(std::make_pair(DB_LOGBLOOM, CHeightTxIndexIteratorKey(height)), bloom.asBytes());
+    for (const std::pair<uint256, dev::h2048>& txBloom : txBlooms) {
+        batch.Write(std::make_pair(DB_TXLOGBLOOM, std::make_pair(CHeightTxIndexIteratorKey(height), txBloom.first)), txBloom.second.asBytes());
+    }
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::EraseLogBloomIndex(unsigned int height)
+{
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    CDBBatch batch(*this);
+
+    batch.Erase(std::make_pair(DB_LOGBLOOM, CHeightTxIndexIteratorKey(height)));
+
+    pcursor->Seek(std::make_pair(DB_TXLOGBLOOM, CHeightTxIndexIteratorKey(height)));
+    while (pcursor->Valid()) {
+        std::pair<char, std::pair<CHeightTxIndexIteratorKey, uint256> > key;
+        if (pcursor->GetKey(key) && key.first == DB_TXLOGBLOOM && key.second.first.height == height) {
+            batch.Erase(key);
+            pcursor->Next();
+        } else {
+            break;
+        }
+    }
+
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::BuildLogBloomIndex(boost::function<dev::h2048(const uint256&)> getTxLogBloom)
+{
+    LogPrintf("Building log bloom index...\n");
+
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(DB_HEIGHTINDEX);
+
+    // A transaction can be listed under several contract addresses of its block
+    unsigned int height = 0;
+    std::map<uint256, dev::h2048> mapTxBlooms;
+    size_t nBlocks = 0;
+    while (true) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CHeightTxIndexKey> key;
+        bool fValid = pcursor->Valid() && pcursor->GetKey(key) && key.first == DB_HEIGHTINDEX;
+
+        if (nBlocks > 0 && (!fValid || key.second.height != height)) {
+            dev::h2048 bloom;
+            std::vector<std::pair<uint256, dev::h2048> > txBlooms;
+            for (const std::pair<uint256, dev::h2048>& txBloom : mapTxBlooms) {
+                if (txBloom.second) {
+                    bloom |= txBloom.second;
+                    txBlooms.push_back(txBloom);
+                }
+            }
+            if (!WriteLogBloomIndex(height, bloom, txBlooms))
+                return false;
+            mapTxBlooms.clear();
+        }
+        if (!fValid)
+            break;
+
+        if (nBlocks == 0 || key.second.height != height) {
+            height = key.second.height;
+            nBlocks++;
+        }
+
+        std::vector<uint256> hashesTx;
+        if (!pcursor->GetValue(hashesTx))
+            return error("failed to get height index value");
+        for (const uint256& hash : hashesTx) {
+            if (!mapTxBlooms.count(hash))
+                mapTxBlooms[hash] = getTxLogBloom(hash);
+        }
+        pcursor->Next();
+    }
+
+    LogPrintf("Indexed log blooms of %u blocks\n", nBlocks);
+    return WriteFlag("logbloomindex", true);
+}
 //////////////////////////////////////////////////////////////////
 
 bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&) > insertBlockIndex)
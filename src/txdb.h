@@ -10,7 +10,9 @@
 #include "coins.h"
 #include "dbwrapper.h"
 #include "chain.h"
+#include "shieldedindex.h"
 #include "spentindex.h"
+#include "sync.h"
 
 #include <map>
 #include <string>
@@ -77,9 +79,31 @@ class CCoinsViewDB : public CCoinsView
 protected:
     CDBWrapper db;
     CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    /**
+     * Sapling nullifiers and recently used anchors in memory. Until
+     * LoadNullifiers has built the nullifier set, lookups go to the database;
+     * afterwards the set is kept up to date by BatchWrite.
+     */
+    mutable CCriticalSection cs_shielded;
+    //! Only touched by LoadNullifiers until fNullifiersLoaded is set
+    mutable CNullifierSet setNullifiers;
+    bool fNullifiersLoaded;
+    bool fNullifiersLoading;
+    //! Nullifiers written while the set is being loaded, applied once it is
+    std::vector<std::pair<uint256, bool> > vNullifiersPending;
+    mutable CSaplingAnchorCache anchorCache;
+
 public:
     CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
 
+    /**
+     * Build the nullifier set from the database without holding up lookups or
+     * BatchWrite, which keep using the database until it is done. Started on
+     * its own thread after the chainstate is opened.
+     */
+    void LoadNullifiers();
+
     bool GetSaplingAnchorAt(const uint256& rt, SaplingMerkleTree& tree) const;
     bool GetNullifier(const uint256& nf, ShieldedType type) const;
     bool GetCoin(const COutPoint& outpoint, Coin& coin) const override;
@@ -92,6 +116,8 @@ public:
                     CAnchorsSaplingMap& mapSaplingAnchors,
                     CNullifiersMap& mapSaplingNullifiers);
     CCoinsViewCursor* Cursor() const override;
+
+    void GetShieldedIndexStats(CShieldedIndexStats& stats) const;
 };
 
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
@@ -131,6 +157,8 @@ public:
     bool WriteReindexing(bool fReindex);
     bool ReadReindexing(bool& fReindex);
     bool ReadTxIndex(const uint256& txid, CDiskTxPos& pos);
+    //! Look up many transactions in one ordered pass, positions found are appended to vect
+    void ReadTxIndex(const std::vector<uint256>& txids, std::vector<std::pair<uint256, CDiskTxPos> >& vect);
     bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> >& list);
     bool ReadSpentIndex(CSpentIndexKey& key, CSpentIndexValue& value);
     bool UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >& vect);
@@ -142,6 +170,14 @@ public:
     bool ReadAddressIndex(uint160 addressHash, int type,
                           std::vector<std::pair<CAddressIndexKey, CAmount> >& addressIndex,
                           int start = 0, int end = 0);
+    //! Entries with an amount of -1 are erased
+    bool UpdateAddressOutputIndex(const std::vector<std::pair<CAddressOutputKey, CAmount> >& vect);
+    //! Outputs to an address created in [start, height] and unspent at height, resuming after *pkeyAfter
+    bool ReadAddressOutputIndex(uint160 addressHash, int type, int start, int height, CAmount minValue,
+                                const CAddressOutputKey* pkeyAfter, size_t maxResults,
+                                std::vector<std::pair<CAddressOutputKey, CAmount> >& outputs, bool& fMore);
+    //! Fill the address output index from the address and spent indexes
+    bool BuildAddressOutputIndex();
     bool WriteFlag(const std::string& name, bool fValue);
     bool ReadFlag(const std::string& name, bool& fValue);
     ////////////////////////////////////////////////////////////////////////////// // qtum
@@ -159,14 +195,21 @@ public:
      * @param minconf stop iterating of the block height does not have enough confirmations (ignored if <= 0)
      * @param blocksOfHashes transaction hashes in blocks iterated are collected into this vector.
      * @param addresses filter out a block unless it matches one of the addresses in this set.
+     * @param blooms if not empty, filter out blocks and transactions whose log bloom contains none of these.
      *
      * @return the height of the latest block iterated. 0 if no block is iterated.
      */
     int ReadHeightIndex(int low, int high, int minconf,
                         std::vector<std::vector<uint256>>& blocksOfHashes,
-                        std::set<dev::h160> const& addresses);
+                        std::set<dev::h160> const& addresses,
+                        std::vector<dev::h2048> const& blooms = std::vector<dev::h2048>());
     bool EraseHeightIndex(const unsigned int& height);
     bool WipeHeightIndex();
+    //! Log bloom of a block in the height index and the blooms of its transactions with logs
+    bool WriteLogBloomIndex(unsigned int height, const dev::h2048& bloom, const std::vector<std::pair<uint256, dev::h2048> >& txBlooms);
+    bool EraseLogBloomIndex(unsigned int height);
+    //! Fill the log bloom index for the blocks in the height index from their receipts
+    bool BuildLogBloomIndex(boost::function<dev::h2048(const uint256&)> getTxLogBloom);
     ////////////////////////////////////////////////////
     bool LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex);
 };
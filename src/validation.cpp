@@ -11,6 +11,7 @@
 #include "addrman.h"
 #include "alert.h"
 #include "arith_uint256.h"
+#include "blockstore.h"
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "checkqueue.h"
@@ -42,6 +43,7 @@
 #include "masternodeman.h"
 
 #include <sstream>
+#include <tuple>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/filesystem.hpp>
@@ -96,6 +98,7 @@ bool fPruneMode = false;
 bool fIsBareMultisigStd = true;
 bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = true;
+bool fParanoidBlockReads = DEFAULT_PARANOID_BLOCK_READS;
 bool fCoinbaseEnforcedProtectionEnabled = true;
 size_t nCoinCacheUsage = 5000 * 300;
 uint64_t nPruneTarget = 0;
@@ -863,6 +866,60 @@ public:
 // Protected by cs_main
 static ThresholdConditionCache warningcache[VERSIONBITS_NUM_BITS];
 
+/**
+ * Verify the Sapling spend and output proofs of a transaction, followed by its
+ * binding signature. Both ContextualCheckTransaction and CSaplingCheck end up here.
+ */
+static bool CheckSaplingProofs(const CTransaction& tx, const uint256& dataToBeSigned, CValidationState& state)
+{
+    auto ctx = librustzcash_sapling_verification_ctx_init();
+
+    for (const SpendDescription& spend : tx.vShieldedSpend) {
+        if (!librustzcash_sapling_check_spend(
+                    ctx,
+                    spend.cv.begin(),
+                    spend.anchor.begin(),
+                    spend.nullifier.begin(),
+                    spend.rk.begin(),
+                    spend.zkproof.begin(),
+                    spend.spendAuthSig.begin(),
+                    dataToBeSigned.begin()
+                )) {
+            librustzcash_sapling_verification_ctx_free(ctx);
+            return state.DoS(100, error("CheckSaplingProofs(): Sapling spend description invalid"),
+                             REJECT_INVALID, "bad-txns-sapling-spend-description-invalid");
+        }
+    }
+
+    for (const OutputDescription& output : tx.vShieldedOutput) {
+        if (!librustzcash_sapling_check_output(
+                    ctx,
+                    output.cv.begin(),
+                    output.cm.begin(),
+                    output.ephemeralKey.begin(),
+                    output.zkproof.begin()
+                )) {
+            librustzcash_sapling_verification_ctx_free(ctx);
+            return state.DoS(100, error("CheckSaplingProofs(): Sapling output description invalid"),
+                             REJECT_INVALID, "bad-txns-sapling-output-description-invalid");
+        }
+    }
+
+    if (!librustzcash_sapling_final_check(
+                ctx,
+                tx.valueBalance,
+                tx.bindingSig.begin(),
+                dataToBeSigned.begin()
+            )) {
+        librustzcash_sapling_verification_ctx_free(ctx);
+        return state.DoS(100, error("CheckSaplingProofs(): Sapling binding signature invalid"),
+                         REJECT_INVALID, "bad-txns-sapling-binding-signature-invalid");
+    }
+
+    librustzcash_sapling_verification_ctx_free(ctx);
+    return true;
+}
+
 /**
  * Check a transaction contextually against a set of consensus rules valid at a given block height.
  *
@@ -877,7 +934,8 @@ bool ContextualCheckTransaction(
     CValidationState& state,
     const int nHeight,
     const int dosLevel,
-    bool (*isInitBlockDownload)())
+    bool (*isInitBlockDownload)(),
+    std::vector<CSaplingCheck>* pvChecks)
 {
     // Check that all transactions are unexpired
     if (IsExpiredTx(tx, nHeight)) {
@@ -910,51 +968,11 @@ bool ContextualCheckTransaction(
 
     if (!tx.vShieldedSpend.empty() ||
             !tx.vShieldedOutput.empty()) {
-        auto ctx = librustzcash_sapling_verification_ctx_init();
-
-        for (const SpendDescription& spend : tx.vShieldedSpend) {
-            if (!librustzcash_sapling_check_spend(
-                        ctx,
-                        spend.cv.begin(),
-                        spend.anchor.begin(),
-                        spend.nullifier.begin(),
-                        spend.rk.begin(),
-                        spend.zkproof.begin(),
-                        spend.spendAuthSig.begin(),
-                        dataToBeSigned.begin()
-                    )) {
-                librustzcash_sapling_verification_ctx_free(ctx);
-                return state.DoS(100, error("ContextualCheckTransaction(): Sapling spend description invalid"),
-                                 REJECT_INVALID, "bad-txns-sapling-spend-description-invalid");
-            }
-        }
-
-        for (const OutputDescription& output : tx.vShieldedOutput) {
-            if (!librustzcash_sapling_check_output(
-                        ctx,
-                        output.cv.begin(),
-                        output.cm.begin(),
-                        output.ephemeralKey.begin(),
-                        output.zkproof.begin()
-                    )) {
-                librustzcash_sapling_verification_ctx_free(ctx);
-                return state.DoS(100, error("ContextualCheckTransaction(): Sapling output description invalid"),
-                                 REJECT_INVALID, "bad-txns-sapling-output-description-invalid");
-            }
-        }
-
-        if (!librustzcash_sapling_final_check(
-                    ctx,
-                    tx.valueBalance,
-                    tx.bindingSig.begin(),
-                    dataToBeSigned.begin()
-                )) {
-            librustzcash_sapling_verification_ctx_free(ctx);
-            return state.DoS(100, error("ContextualCheckTransaction(): Sapling binding signature invalid"),
-                             REJECT_INVALID, "bad-txns-sapling-binding-signature-invalid");
+        if (pvChecks) {
+            pvChecks->push_back(CSaplingCheck(tx, dataToBeSigned));
+        } else if (!CheckSaplingProofs(tx, dataToBeSigned, state)) {
+            return false;
         }
-
-        librustzcash_sapling_verification_ctx_free(ctx);
     }
     return true;
 }
@@ -1603,13 +1621,47 @@ bool AcceptToMemoryPoolWithTime(CTxMemPool& pool, CValidationState& state, const
     return true;
 }
 
+/** Read the transactions at the ascending offsets vOffsets from the block stored at pos */
+static bool ReadTransactionsFromDisk(const CDiskBlockPos& pos, const std::vector<unsigned int>& vOffsets, uint256& hashBlock, std::vector<CTransactionRef>& vtx)
+{
+    CBlockHeader header;
+    vtx.resize(vOffsets.size());
+    try {
+        CBlockFileReader mapped;
+        if (blockFileCache.OpenRecord(pos, "blk", 0, mapped, SER_DISK, CLIENT_VERSION)) {
+            mapped >> header;
+            const size_t nBody = mapped.size();
+            for (size_t i = 0; i < vOffsets.size(); i++) {
+                size_t nRead = nBody - mapped.size();
+                if (vOffsets[i] < nRead)
+                    return error("%s: overlapping transactions at %s", __func__, pos.ToString());
+                mapped.ignore(vOffsets[i] - nRead);
+                mapped >> vtx[i];
+            }
+        } else {
+            CAutoFile file(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+            if (file.IsNull())
+                return error("%s: OpenBlockFile failed", __func__);
+            file >> header;
+            long nBody = ftell(file.Get());
+            for (size_t i = 0; i < vOffsets.size(); i++) {
+                if (fseek(file.Get(), nBody + vOffsets[i], SEEK_SET))
+                    return error("%s: fseek failed at %s", __func__, pos.ToString());
+                file >> vtx[i];
+            }
+        }
+    } catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+    }
+    hashBlock = header.GetHash();
+    return true;
+}
+
 /** Return transaction in tx, and if it was found inside a block, its hash is placed in hashBlock */
 bool GetTransaction(const uint256& hash, CTransactionRef& txOut, const Consensus::Params& consensusParams, uint256& hashBlock, bool fAllowSlow)
 {
     CBlockIndex* pindexSlow = NULL;
 
-    LOCK(cs_main);
-
     CTransactionRef ptx = mempool.get(hash);
     if (ptx) {
         txOut = ptx;
@@ -1626,26 +1678,21 @@ bool GetTransaction(const uint256& hash, CTransactionRef& txOut, const Consensus
             }
         }
 
+        // Indexed positions are written after the block and never pruned, reading them needs no cs_main
         CDiskTxPos postx;
         if (pblocktree->ReadTxIndex(hash, postx)) {
-            CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
-            if (file.IsNull())
-                return error("%s: OpenBlockFile failed", __func__);
-            CBlockHeader header;
-            try {
-                file >> header;
-                fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
-                file >> txOut;
-            } catch (const std::exception& e) {
-                return error("%s: Deserialize or I/O error - %s", __func__, e.what());
-            }
-            hashBlock = header.GetHash();
+            std::vector<CTransactionRef> vtx;
+            if (!ReadTransactionsFromDisk(postx, std::vector<unsigned int>(1, postx.nTxOffset), hashBlock, vtx))
+                return false;
+            txOut = vtx[0];
             if (txOut->GetHash() != hash)
                 return error("%s: txid mismatch", __func__);
             return true;
         }
     }
 
+    LOCK(cs_main);
+
     if (fAllowSlow) { // use coin database to locate block that contains transaction, and scan it
         const Coin& coin = AccessByTxid(*pcoinsTip, hash);
         if (!coin.IsSpent()) pindexSlow = chainActive[coin.nHeight];
@@ -1667,6 +1714,99 @@ bool GetTransaction(const uint256& hash, CTransactionRef& txOut, const Consensus
     return false;
 }
 
+void GetTransactions(const std::vector<uint256>& hashes, std::vector<CTransactionRef>& txOut, std::vector<uint256>& hashBlock, const Consensus::Params& consensusParams, bool fAllowSlow)
+{
+    txOut.assign(hashes.size(), nullptr);
+    hashBlock.assign(hashes.size(), uint256());
+
+    // Where each transaction goes in the results, it may have been asked for more than once
+    std::map<uint256, std::vector<size_t> > mapWanted;
+    for (size_t i = 0; i < hashes.size(); i++)
+        mapWanted[hashes[i]].push_back(i);
+
+    std::map<uint256, std::vector<size_t> >::iterator it;
+    auto found = [&](const CTransactionRef& tx, const uint256& hashBlockIn) {
+        for (size_t i : it->second) {
+            txOut[i] = tx;
+            hashBlock[i] = hashBlockIn;
+        }
+        it = mapWanted.erase(it);
+    };
+
+    {
+        LOCK(mempool.cs);
+        for (it = mapWanted.begin(); it != mapWanted.end();) {
+            CTransactionRef ptx = mempool.get(it->first);
+            if (ptx)
+                found(ptx, uint256());
+            else
+                ++it;
+        }
+    }
+
+    if (fTxIndex && !mapWanted.empty()) {
+        for (const auto& tx : Params().GenesisBlock().vtx) {
+            it = mapWanted.find(tx->GetHash());
+            if (it != mapWanted.end())
+                found(tx, consensusParams.hashGenesisBlock);
+        }
+
+        std::vector<uint256> vHashes;
+        for (const auto& wanted : mapWanted)
+            vHashes.push_back(wanted.first);
+        std::vector<std::pair<uint256, CDiskTxPos> > vPos;
+        pblocktree->ReadTxIndex(vHashes, vPos);
+
+        // In file order, every block is read once for all of its transactions
+        std::sort(vPos.begin(), vPos.end(), [](const std::pair<uint256, CDiskTxPos>& a, const std::pair<uint256, CDiskTxPos>& b) {
+            return std::make_tuple(a.second.nFile, a.second.nPos, a.second.nTxOffset) < std::make_tuple(b.second.nFile, b.second.nPos, b.second.nTxOffset);
+        });
+        for (size_t nBegin = 0, nEnd; nBegin < vPos.size(); nBegin = nEnd) {
+            const CDiskTxPos& pos = vPos[nBegin].second;
+            std::vector<unsigned int> vOffsets;
+            for (nEnd = nBegin; nEnd < vPos.size() && vPos[nEnd].second.nFile == pos.nFile && vPos[nEnd].second.nPos == pos.nPos; nEnd++)
+                vOffsets.push_back(vPos[nEnd].second.nTxOffset);
+
+            uint256 hashBlockRead;
+            std::vector<CTransactionRef> vtx;
+            if (!ReadTransactionsFromDisk(pos, vOffsets, hashBlockRead, vtx))
+                continue;
+            for (size_t i = 0; i < vtx.size(); i++) {
+                const uint256& hash = vPos[nBegin + i].first;
+                if (vtx[i]->GetHash() != hash) {
+                    error("%s: txid mismatch for %s", __func__, hash.ToString());
+                    continue;
+                }
+                it = mapWanted.find(hash);
+                if (it != mapWanted.end())
+                    found(vtx[i], hashBlockRead);
+            }
+        }
+    }
+
+    if (!fAllowSlow || mapWanted.empty())
+        return;
+
+    // Use coin database to locate blocks that contain the rest, and scan each once
+    LOCK(cs_main);
+    std::set<CBlockIndex*> setBlocks;
+    for (const auto& wanted : mapWanted) {
+        const Coin& coin = AccessByTxid(*pcoinsTip, wanted.first);
+        if (!coin.IsSpent() && chainActive[coin.nHeight])
+            setBlocks.insert(chainActive[coin.nHeight]);
+    }
+    for (CBlockIndex* pindex : setBlocks) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, consensusParams))
+            continue;
+        for (const auto& tx : block.vtx) {
+            it = mapWanted.find(tx->GetHash());
+            if (it != mapWanted.end())
+                found(tx, pindex->GetBlockHash());
+        }
+    }
+}
+
 /** Return merkletransaction in tx, and if it was found inside a block, its hash is placed in hashBlock */
 bool GetMerkleTransaction(const uint256& hash, CMerkleTransaction& txOut, const Consensus::Params& consensusParams)
 {
@@ -1676,9 +1816,6 @@ bool GetMerkleTransaction(const uint256& hash, CMerkleTransaction& txOut, const
     int nIndex = -1;
     CBlock block;
 
-    LOCK(cs_main);
-
-
     if (fTxIndex) {
         // Check if this is the coinbase transaction in genesis block
         for (int i = 0; i < Params().GenesisBlock().vtx.size(); i++) {
@@ -1698,11 +1835,16 @@ bool GetMerkleTransaction(const uint256& hash, CMerkleTransaction& txOut, const
 
         CDiskTxPos postx;
         if (pblocktree->ReadTxIndex(hash, postx)) {
-            CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
-            if (file.IsNull())
-                return error("%s: OpenBlockFile failed", __func__);
             try {
-                file >> block;
+                CBlockFileReader mapped;
+                if (blockFileCache.OpenRecord(postx, "blk", 0, mapped, SER_DISK, CLIENT_VERSION)) {
+                    mapped >> block;
+                } else {
+                    CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
+                    if (file.IsNull())
+                        return error("%s: OpenBlockFile failed", __func__);
+                    file >> block;
+                }
             } catch (const std::exception& e) {
                 return error("%s: Deserialize or I/O error - %s", __func__, e.what());
             }
@@ -1719,6 +1861,7 @@ bool GetMerkleTransaction(const uint256& hash, CMerkleTransaction& txOut, const
     }
 
     if (!fFindTx) {
+        LOCK(cs_main);
         const Coin& coin = AccessByTxid(*pcoinsTip, hash);
         if (!coin.IsSpent()) pindexSlow = chainActive[coin.nHeight];
 
@@ -1914,58 +2057,53 @@ bool GetAddressIndex(uint160 addressHash, int type,
     return true;
 }
 
+bool GetAddressUTXOAtHeight(uint160 addressHash, int type, int start, int height, const CAmount& valueLimit,
+                            const CAddressOutputKey* pkeyAfter, size_t maxResults,
+                            std::vector<CUtxo>& vTxOut, CAddressOutputKey& keyLast, bool& fMore)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    std::vector<std::pair<CAddressOutputKey, CAmount> > outputs;
+    if (!pblocktree->ReadAddressOutputIndex(addressHash, type, start, height, valueLimit, pkeyAfter, maxResults, outputs, fMore))
+        return error("unable to get outputs for address");
+
+    if (!outputs.empty())
+        keyLast = outputs.back().first;
+    else if (pkeyAfter)
+        keyLast = *pkeyAfter;
+
+    for (const std::pair<CAddressOutputKey, CAmount>& output : outputs) {
+        const CAddressOutputKey& key = output.first;
+        if (key.IsUnspent()) {
+            CSpentIndexKey spentKey(key.txhash, key.index);
+            CSpentIndexValue spentValue;
+            if (mempool.getSpentIndex(spentKey, spentValue))
+                continue;
+        }
+        CUtxo txout;
+        txout.txid = key.txhash;
+        txout.n = key.index;
+        txout.nValue = output.second;
+        txout.nHeight = key.blockHeight;
+        vTxOut.push_back(txout);
+    }
+    return true;
+}
+
 bool GetUTXOAtHeight(const CScript& script, const int nHeight, std::vector<CUtxo>& vTxOut, const CAmount& valueLimit)
 {
-    int start = 1;
-    int end = nHeight;
     uint160 dest;
     txnouttype type;
-    std::vector<std::pair<uint160, int> > addresses;
     if (!GetIndexKey(script, dest, type))
         return false;
 
-    addresses.push_back(std::make_pair(dest, type));
-
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
-            return false;
-        }
-    }
-
-    int ret = 0;
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it = addressIndex.begin(); it != addressIndex.end(); it++) {
-        int height = it->first.blockHeight;
-        uint256 txid = it->first.txhash;
-
-        if (it->second >= valueLimit) {
-            CSpentIndexKey key(txid, it->first.index);
-            CSpentIndexValue value;
-
-            if (!GetSpentIndex(key, value)) {
-                CUtxo txout;
-                txout.txid = txid;
-                txout.n = it->first.index;
-                txout.nValue = it->second;
-                txout.nHeight = height;
-                vTxOut.push_back(txout);
-                ret += 1;
-                continue;
-            }
-
-            if (value.blockHeight > end && end >= 0) {
-                CUtxo txout;
-                txout.txid = txid;
-                txout.n = it->first.index;
-                txout.nValue = it->second;
-                txout.nHeight = height;
-                vTxOut.push_back(txout);
-                ret += 1;
-            }
-        }
-    }
-    return (ret > 0);
+    size_t nPrevSize = vTxOut.size();
+    CAddressOutputKey keyLast;
+    bool fMore = false;
+    if (!GetAddressUTXOAtHeight(dest, type, 1, nHeight, valueLimit, nullptr, std::numeric_limits<size_t>::max(), vTxOut, keyLast, fMore))
+        return false;
+    return vTxOut.size() > nPrevSize;
 }
 //////////////////////////////////////////////////////////////////////////////
 //
@@ -1993,37 +2131,56 @@ bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHea
     return true;
 }
 
-bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams)
+static bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams, bool fCheckPoW)
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
-
     // Read block
     try {
-        filein >> block;
+        CBlockFileReader mapped;
+        if (blockFileCache.OpenRecord(pos, "blk", 0, mapped, SER_DISK, CLIENT_VERSION)) {
+            mapped >> block;
+        } else {
+            // Open history file to read
+            CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+            if (filein.IsNull())
+                return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+            filein >> block;
+        }
     }    catch (const std::exception& e) {
         return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
     }
 
     // Check the header
-    if (!(CheckEquihashSolution(&block, Params()) &&
+    if (fCheckPoW && !(CheckEquihashSolution(&block, Params()) &&
             CheckProofOfWork(block.GetPoWHash(), block.nBits, Params().GetConsensus())))
         return error("ReadBlockFromDisk: Errors in block header at %s", pos.ToString());
 
     return true;
 }
 
+bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams)
+{
+    return ReadBlockFromDisk(block, pos, consensusParams, true);
+}
+
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
 {
-    if (!ReadBlockFromDisk(block, pindex->GetBlockPos(), consensusParams))
+    // A block with valid transactions had its PoW checked before it was written, the hash in
+    // the index identifies its header and the merkle root its transactions, which is much
+    // cheaper than verifying the Equihash solution again
+    const bool fTrusted = !fParanoidBlockReads && pindex->IsValid(BLOCK_VALID_TRANSACTIONS);
+    if (!ReadBlockFromDisk(block, pindex->GetBlockPos(), consensusParams, !fTrusted))
         return false;
     if (block.GetHash() != pindex->GetBlockHash())
         return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): GetHash() doesn't match index for %s at %s",
                      pindex->ToString(), pindex->GetBlockPos().ToString());
+    if (fTrusted) {
+        bool mutated;
+        if (block.BuildMerkleTree(&mutated) != block.hashMerkleRoot || mutated)
+            return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): hashMerkleRoot mismatch for %s at %s",
+                         pindex->ToString(), pindex->GetBlockPos().ToString());
+    }
     return true;
 }
 
@@ -2345,6 +2502,12 @@ bool CScriptCheck::operator()()
     return true;
 }
 
+bool CSaplingCheck::operator()()
+{
+    CValidationState state;
+    return CheckSaplingProofs(*ptxTo, dataToBeSigned, state);
+}
+
 int GetSpendHeight(const CCoinsViewCache& inputs)
 {
     LOCK(cs_main);
@@ -2707,16 +2870,21 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
 
 bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uint256& hashBlock)
 {
-    // Open history file to read
-    CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("%s: OpenBlockFile failed", __func__);
-
     // Read block
     uint256 hashChecksum;
     try {
-        filein >> blockundo;
-        filein >> hashChecksum;
+        CBlockFileReader mapped;
+        if (blockFileCache.OpenRecord(pos, "rev", sizeof(hashChecksum), mapped, SER_DISK, CLIENT_VERSION)) {
+            mapped >> blockundo;
+            mapped >> hashChecksum;
+        } else {
+            // Open history file to read
+            CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
+            if (filein.IsNull())
+                return error("%s: OpenBlockFile failed", __func__);
+            filein >> blockundo;
+            filein >> hashChecksum;
+        }
     }    catch (const std::exception& e) {
         return error("%s: Deserialize or I/O error - %s", __func__, e.what());
     }
@@ -2816,6 +2984,7 @@ static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& s
 
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
+    std::vector<std::pair<CAddressOutputKey, CAmount> > addressOutputIndex;
     std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
 
     // undo transactions in reverse order
@@ -2836,6 +3005,9 @@ static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& s
                 // undo unspent index
                 addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, uint160(hashBytes), hash, k), CAddressUnspentValue()));
 
+                // undo output index
+                addressOutputIndex.push_back(std::make_pair(CAddressOutputKey(addressType, uint160(hashBytes), ADDRESS_OUTPUT_UNSPENT, pindex->nHeight, hash, k), -1));
+
             } else {
                 continue;
             }
@@ -2901,6 +3073,9 @@ static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& s
                     // restore unspent index
                     addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, uint160(hashBytes), input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, undoHeight)));
 
+                    // mark the output unspent again in the output index
+                    MoveAddressOutput(addressOutputIndex, CAddressOutputKey(addressType, uint160(hashBytes), pindex->nHeight, undoHeight, input.prevout.hash, input.prevout.n), ADDRESS_OUTPUT_UNSPENT, prevout.nValue);
+
                 } else {
                     continue;
                 }
@@ -2951,6 +3126,14 @@ static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& s
         AbortNode("Failed to write address unspent index");
         return DISCONNECT_FAILED;
     }
+    if (!pblocktree->UpdateAddressOutputIndex(addressOutputIndex)) {
+        AbortNode("Failed to write address output index");
+        return DISCONNECT_FAILED;
+    }
+    if (fLogEvents && !pblocktree->EraseLogBloomIndex(pindex->nHeight)) {
+        AbortNode("Failed to erase log bloom index");
+        return DISCONNECT_FAILED;
+    }
 
     if (!pblocktree->EraseAnonymousBlock(pindex->GetBlockHash())) {
         AbortNode(state, "Failed to delete anonymous block index");
@@ -2985,6 +3168,10 @@ void static FlushBlockFile(bool fFinalize = false)
         FileCommit(fileOld);
         fclose(fileOld);
     }
+
+    // Older mappings reach past the end of the truncated files
+    if (fFinalize)
+        blockFileCache.Forget(nLastBlockFile);
 }
 
 bool FindUndoPos(CValidationState& state, int nFile, CDiskBlockPos& pos, unsigned int nAddSize);
@@ -2997,6 +3184,14 @@ void ThreadScriptCheck()
     scriptcheckqueue.Thread();
 }
 
+static CCheckQueue<CSaplingCheck> saplingcheckqueue(16);
+
+void ThreadSaplingCheck()
+{
+    RenameThread("vds-saplingch");
+    saplingcheckqueue.Thread();
+}
+
 //
 // Called periodically asynchronously; alerts if it smells like
 // we're being fed a bad chain (blocks being generated much
@@ -3338,6 +3533,14 @@ void writeVMlog(const std::vector<ResultExecute>& res, const CTransaction& tx, c
     fIsVMlogFile = true;
 }
 
+dev::eth::LogBloom GetTxLogBloom(const uint256& txid)
+{
+    dev::eth::LogBloom bloom;
+    for (const TransactionReceiptInfo& receipt : pstorageresult->getResult(uintToh256(txid)))
+        bloom |= dev::eth::bloom(receipt.logs);
+    return bloom;
+}
+
 CTxDestination getAddressForVin(const CTransaction& tx, bool& found)
 {
     found = false;
@@ -3357,6 +3560,14 @@ CTxDestination getAddressForVin(const CTransaction& tx, bool& found)
 
 bool ByteCodeExec::performByteCode(dev::eth::Permanence type)
 {
+    if (speculation && type == dev::eth::Permanence::Committed) {
+        if (speculation->Apply(nTx, txs, result)) {
+            globalState->db().commit();
+            globalState->dbUtxo().commit();
+            return true;
+        }
+        speculation->BeginSequential();
+    }
     for (QtumTransaction& tx : txs) {
         //validate VM version
         if (tx.getVersion().toRaw() != VersionVM::GetEVMDefault().toRaw()) {
@@ -3371,6 +3582,8 @@ bool ByteCodeExec::performByteCode(dev::eth::Permanence type)
         }
         result.push_back(globalState->execute(envInfo, *globalSealEngine.get(), tx, type, OnOpFunc()));
     }
+    if (speculation)
+        speculation->EndSequential();
     globalState->db().commit();
     globalState->dbUtxo().commit();
     globalSealEngine.get()->deleteAddresses.clear();
@@ -3413,6 +3626,7 @@ bool ByteCodeExec::processingResults(ByteCodeExecResult& resultBCE)
         if (result[i].tx != CTransaction()) {
             resultBCE.valueTransfers.push_back(result[i].tx);
         }
+        resultBCE.logBloom |= result[i].txRec.bloom();
     }
     return true;
 }
@@ -3625,6 +3839,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     blockundo.vtxundo.reserve(block.vtx.size() - 1);
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
+    std::vector<std::pair<CAddressOutputKey, CAmount> > addressOutputIndex;
     std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
 
     SaplingMerkleTree sapling_tree;
@@ -3635,6 +3850,29 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
     ///////////////////////////////////////////////////////// // qtum
     std::map<dev::Address, std::pair<CHeightTxIndexKey, std::vector < uint256>>> heightIndexes;
+    dev::eth::LogBloom blockLogBloom;
+    std::vector<std::pair<uint256, dev::h2048> > txLogBlooms;
+
+    // Run the contract transactions of the block ahead on forks of the state, the results
+    // are picked up by ByteCodeExec in block order as long as they do not conflict
+    std::unique_ptr<SpeculativeExec> speculation;
+    if (SpeculativeExecEnabled()) {
+        ByteCodeExec envExec(block, std::vector<QtumTransaction>(), blockGasLimit);
+        speculation.reset(new SpeculativeExec(*globalState, envExec.BuildEVMEnvironment(), *globalSealEngine));
+        for (unsigned int i = 0; i < block.vtx.size(); i++) {
+            const CTransaction& tx = *(block.vtx[i]);
+            if (!tx.HasCreateOrCall() || tx.HasOpSpend())
+                continue;
+            QtumTxConverter convert(tx, &view, &block.vtx);
+            ExtractQtumTX resultConvertQtumTX;
+            if (convert.extractionQtumTransactions(resultConvertQtumTX))
+                speculation->Add(i, resultConvertQtumTX.first);
+        }
+        if (speculation->Size() > 1)
+            speculation->Run();
+        else
+            speculation.reset();
+    }
     /////////////////////////////////////////////////////////
     uint64_t blockGasUsed = 0;
     CAmount gasRefunds = 0;
@@ -3769,6 +4007,9 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
                     // remove address from unspent index
                     addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
+
+                    // move the output to its spent height in the output index
+                    MoveAddressOutput(addressOutputIndex, CAddressOutputKey(addressType, hashBytes, ADDRESS_OUTPUT_UNSPENT, coin.nHeight, input.prevout.hash, input.prevout.n), pindex->nHeight, prevout.nValue);
                 }
 
 
@@ -3812,7 +4053,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
 
             dev::u256 gasAllTxs = dev::u256(0);
-            ByteCodeExec exec(block, resultConvertQtumTX.first, blockGasLimit);
+            ByteCodeExec exec(block, resultConvertQtumTX.first, blockGasLimit, speculation.get(), i);
             //validate VM version and other ETH params before execution
             //Reject anything unknown (could be changed later by DGP)
             //TODO evaluate if this should be relaxed for soft-fork purposes
@@ -3895,6 +4136,11 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                 }
 
                 pstorageresult->addResult(uintToh256(tx.GetHash()), tri);
+
+                if (bcer.logBloom) {
+                    blockLogBloom |= bcer.logBloom;
+                    txLogBlooms.push_back(std::make_pair(tx.GetHash(), bcer.logBloom));
+                }
             }
 
             bool ifSuccess = true;
@@ -3938,6 +4184,9 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                 // record unspent output
                 addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, uint160(hashBytes), txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
 
+                // record output as unspent in the output index
+                addressOutputIndex.push_back(std::make_pair(CAddressOutputKey(addressType, uint160(hashBytes), ADDRESS_OUTPUT_UNSPENT, pindex->nHeight, txhash, k), out.nValue));
+
             } else {
                 continue;
             }
@@ -3959,9 +4208,12 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
         UpdateCoins(tx, state, view, i == 0 ? undoDummy : blockundo.vtxundo.back(), pindex->nHeight);
         if (tx.vShieldedOutput.size()) {
+            std::vector<libzcash::PedersenHash> commitments;
+            commitments.reserve(tx.vShieldedOutput.size());
             for (const OutputDescription& outputDescription : tx.vShieldedOutput) {
-                sapling_tree.append(outputDescription.cm);
+                commitments.push_back(outputDescription.cm);
             }
+            sapling_tree.append_batch(commitments, std::max(nScriptCheckThreads, 1));
         }
 
         vPos.push_back(std::make_pair(tx.GetHash(), pos));
@@ -4144,6 +4396,8 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             if (!pblocktree->WriteHeightIndex(e.second.first, e.second.second))
                 return AbortNode(state, "Failed to write height index");
         }
+        if (!heightIndexes.empty() && !pblocktree->WriteLogBloomIndex(pindex->nHeight, blockLogBloom, txLogBlooms))
+            return AbortNode(state, "Failed to write log bloom index");
     }
 
     if (!pblocktree->WriteTxIndex(vPos))
@@ -4157,6 +4411,10 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         return AbortNode(state, "Failed to write address unspent index");
     }
 
+    if (!pblocktree->UpdateAddressOutputIndex(addressOutputIndex)) {
+        return AbortNode(state, "Failed to write address output index");
+    }
+
     if (!pblocktree->UpdateSpentIndex(spentIndex))
         return AbortNode(state, "Failed to write transaction index");
 
@@ -4180,8 +4438,8 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     nTimeCallbacks += nTime4 - nTime3;
     LogPrint("bench", "    - Callbacks: %.2fms [%.2fs]\n", 0.001 * (nTime4 - nTime3), nTimeCallbacks * 0.000001);
 
-    if (fLogEvents)
-        pstorageresult->commitResults();
+    if (fLogEvents && !pstorageresult->commitResults())
+        return AbortNode(state, "Failed to write to contract receipt database");
 
     return true;
 }
@@ -4281,6 +4539,9 @@ bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
             // overwrite one. Still, use a conservative safety factor of 2.
             if (!CheckDiskSpace(128 * 2 * 2 * pcoinsTip->GetCacheSize()))
                 return state.Error("out of disk space");
+            // Receipts go first, they are written again if their blocks are connected again.
+            if (fLogEvents && !pstorageresult->flush())
+                return AbortNode(state, "Failed to write to contract receipt database");
             // Flush the chainstate (which may refer to block index entries).
             if (!pcoinsTip->Flush())
                 return AbortNode(state, "Failed to write to coin database");
@@ -5281,13 +5542,18 @@ bool ContextualCheckBlock(const CBlock& block, CValidationState& state, CBlockIn
     const int nHeight = pindexPrev == nullptr ? 0 : pindexPrev->nHeight + 1;
     const CChainParams& chainParams = Params();
 
+    // Sapling proofs of the whole block are verified on the check threads
+    CCheckQueueControl<CSaplingCheck> control(nScriptCheckThreads ? &saplingcheckqueue : nullptr);
+
     // Check that all transactions are finalized
     for (const auto& tx : block.vtx) {
 
         // Check transaction contextually against consensus rules at block height
-        if (!ContextualCheckTransaction(*tx, state, nHeight, 100)) {
+        std::vector<CSaplingCheck> vChecks;
+        if (!ContextualCheckTransaction(*tx, state, nHeight, 100, IsInitialBlockDownload, nScriptCheckThreads ? &vChecks : nullptr)) {
             return false; // Failure reason has been set in validation state object
         }
+        control.Add(vChecks);
 
         int nLockTimeFlags = 0;
         if (nHeight < chainParams.GetConsensus().nTandiaBallotStart && tx->nFlag == CTransaction::TANDIA_TX)
@@ -5301,6 +5567,15 @@ bool ContextualCheckBlock(const CBlock& block, CValidationState& state, CBlockIn
         }
     }
 
+    if (!control.Wait()) {
+        // Check again without the queue, for the reject reason of the first invalid transaction
+        for (const auto& tx : block.vtx) {
+            if (!ContextualCheckTransaction(*tx, state, nHeight, 100, IsInitialBlockDownload))
+                return false;
+        }
+        return state.DoS(100, error("%s: Sapling proof verification failed", __func__), REJECT_INVALID, "bad-txns-sapling-verification-failed");
+    }
+
     // Enforce block.nVersion=2 rule that the coinbase starts with serialized block height
     // if 750 of the last 1,000 blocks are version 2 or greater (51/100 if testnet):
     // Since MIN_BLOCK_VERSION = 4 all blocks with nHeight > 0 should satisfy this.
@@ -5533,6 +5808,8 @@ bool TestBlockValidity(CValidationState& state, const CChainParams& chainparams,
         pstorageresult->clearCacheResult();
         return false;
     }
+    // The receipts of a block that is only checked are never committed
+    pstorageresult->clearCacheResult();
     assert(state.IsValid());
     return true;
 }
@@ -5588,6 +5865,7 @@ void UnlinkPrunedFiles(std::set<int>& setFilesToPrune)
 {
     for (set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
         CDiskBlockPos pos(*it, 0);
+        blockFileCache.Forget(*it);
         boost::filesystem::remove(GetBlockPosFilename(pos, "blk"));
         boost::filesystem::remove(GetBlockPosFilename(pos, "rev"));
         LogPrintf("Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
@@ -6089,6 +6367,8 @@ bool InitBlockIndex(const CChainParams& chainparams)
     // Use the provided setting for -addressindex in the new database
     fAddressIndex = GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
     pblocktree->WriteFlag("addressindex", fAddressIndex);
+    pblocktree->WriteFlag("addressoutputindex", fAddressIndex);
+    pblocktree->WriteFlag("logbloomindex", fLogEvents);
 
 
     // Only add the genesis block if not reindexing (in which case we reuse the one already on disk)
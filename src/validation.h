@@ -53,6 +53,7 @@
 #include <libethashseal/GenesisInfo.h>
 #include <script/standard.h>
 #include <qtum/storageresults.h>
+#include <qtum/speculativeexec.h>
 #include "merkleblock.h"
 
 const int BID_COUNT_PRECISION = 2;
@@ -167,6 +168,10 @@ static const bool DEFAULT_SPENTINDEX = true;
 static const unsigned int DEFAULT_BANSCORE_THRESHOLD = 100;
 /** Default for -persistmempool */
 static const bool DEFAULT_PERSIST_MEMPOOL = true;
+/** Most transactions looked up at once by GETTXS and getrawtransactions */
+static const unsigned int MAX_TX_BATCH_SZ = 1000;
+/** Default for -paranoidblockreads */
+static const bool DEFAULT_PARANOID_BLOCK_READS = false;
 
 static const bool DEFAULT_TESTSAFEMODE = false;
 /** Default for -mempoolreplacement */
@@ -182,6 +187,11 @@ static const CAmount MAX_RPC_GAS_PRICE = 0.00000100 * COIN;
 
 static const size_t MAX_CONTRACT_VOUTS = 1000; // qtum
 
+//! -contractstatecache default (MiB) for contract state trie nodes read from disk
+static const int64_t DEFAULT_CONTRACT_STATE_CACHE = 32;
+//! -receiptcache default (MiB) for contract receipts
+static const int64_t DEFAULT_RECEIPT_CACHE = 32;
+
 static const CAmount CLUE_COST_PARENT_TOP   =   4 * COIN;
 static const CAmount CLUE_COST_PARENT_NOAWARWD =   3.5 * COIN;
 static const CAmount CLUE_COST_PARENT       =   0.5 * COIN;
@@ -225,12 +235,14 @@ extern bool fImporting;
 extern bool fReindex;
 extern int nScriptCheckThreads;
 extern bool fTxIndex;
+extern bool fAddressIndex;
 extern bool fLogEvents;
 extern bool fIsBareMultisigStd;
 extern bool fRequireStandard;
 extern unsigned int nBytesPerSigOp;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
+extern bool fParanoidBlockReads;
 // TODO: remove this flag by structuring our code such that
 // it is unneeded for testing
 extern bool fCoinbaseEnforcedProtectionEnabled;
@@ -330,6 +342,8 @@ bool LoadBlockIndex();
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the Sapling proof checking thread */
+void ThreadSaplingCheck();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 /** Format a string that describes several potential problems detected by the core.
@@ -342,6 +356,11 @@ bool IsInitialBlockDownload();
 std::string GetWarnings(const std::string& strFor);
 /** Retrieve a transaction (from memory pool, or from disk, if possible) */
 bool GetTransaction(const uint256& hash, CTransactionRef& tx, const Consensus::Params& params, uint256& hashBlock, bool fAllowSlow = false);
+/**
+ * Retrieve up to MAX_TX_BATCH_SZ transactions like GetTransaction, with one pass over the tx index
+ * and every block read once. tx[i] and hashBlock[i] belong to hashes[i], tx[i] is null if not found.
+ */
+void GetTransactions(const std::vector<uint256>& hashes, std::vector<CTransactionRef>& tx, std::vector<uint256>& hashBlock, const Consensus::Params& params, bool fAllowSlow = false);
 bool GetMerkleTransaction(const uint256& hash, CMerkleTransaction& txOut, const Consensus::Params& consensusParams);
 bool GetMerkleTransactionWithAnonymous(const int blockHeight, std::map<int, std::map<uint256, char>>& filterdTxids, std::vector<CMerkleTxBlock>& output);
 bool GetSampleMerkleTransactionWithAnonymous(const int blockHeight, std::map<int, std::map<uint256, char>>& filterdTxids, std::vector<CMerkleTxBlockSample>& output);
@@ -636,6 +655,33 @@ public:
     }
 };
 
+/**
+ * Closure representing the Sapling proof and signature verification of one
+ * transaction. The librustzcash verification context accumulates the value
+ * commitments of every spend and output, so all descriptions of a transaction
+ * are checked in one job and the binding signature is checked at its end.
+ * Note that this stores a reference to the transaction.
+ */
+class CSaplingCheck
+{
+private:
+    const CTransaction* ptxTo;
+    uint256 dataToBeSigned;
+
+public:
+    CSaplingCheck(): ptxTo(0) {}
+    CSaplingCheck(const CTransaction& txToIn, const uint256& dataToBeSignedIn) :
+        ptxTo(&txToIn), dataToBeSigned(dataToBeSignedIn) { }
+
+    bool operator()();
+
+    void swap(CSaplingCheck& check)
+    {
+        std::swap(ptxTo, check.ptxTo);
+        std::swap(dataToBeSigned, check.dataToBeSigned);
+    }
+};
+
 bool GetIndexKey(const CScript& scritPubKey, uint160& hashBytes, txnouttype& type);
 bool GetSpentIndex(CSpentIndexKey& key, CSpentIndexValue& value);
 bool GetAddressIndex(uint160 addressHash, int type,
@@ -651,6 +697,16 @@ struct CUtxo {
     CUtxo() {}
 };
 
+/**
+ * Outputs to an address created in [start, height] and unspent at height, in
+ * address output index order. Reads at most maxResults outputs after
+ * *pkeyAfter and sets keyLast to the last one read, so the next call can
+ * continue from there while fMore is set. Outputs spent in the mempool are
+ * left out of vTxOut.
+ */
+bool GetAddressUTXOAtHeight(uint160 addressHash, int type, int start, int height, const CAmount& valueLimit,
+                            const CAddressOutputKey* pkeyAfter, size_t maxResults,
+                            std::vector<CUtxo>& vTxOut, CAddressOutputKey& keyLast, bool& fMore);
 bool GetUTXOAtHeight(const CTxDestination& dest, const int nHeight, std::vector<CUtxo>& vTxOut, const CAmount& valueLimit = 0);
 bool GetUTXOAtHeight(const CScript& script, const int nHeight, std::vector<CUtxo>& vTxOut, const CAmount& valueLimit = 0);
 /** Functions for disk access for blocks */
@@ -680,9 +736,14 @@ bool ContextualCheckInputs(const CTransaction& tx, CValidationState& state,
                            bool cacheStore, PrecomputedTransactionData& txdata, const Consensus::Params& consensusParams,
                            std::vector<CScriptCheck>* pvChecks);
 
-/** Check a transaction contextually against a set of consensus rules */
+/**
+ * Check a transaction contextually against a set of consensus rules.
+ * If pvChecks is not NULL, the Sapling proof verification is appended to it
+ * instead of being performed inline.
+ */
 bool ContextualCheckTransaction(const CTransaction& tx, CValidationState& state, int nHeight, int dosLevel,
-                                bool (*isInitBlockDownload)() = IsInitialBlockDownload);
+                                bool (*isInitBlockDownload)() = IsInitialBlockDownload,
+                                std::vector<CSaplingCheck>* pvChecks = NULL);
 
 bool CheckClueParentsRelationship(const CClueFamilyTree& tree, const std::vector<CTxDestination>& parents, CValidationState& state);
 bool ContextualCheckClueTransaction(const CTransaction& tx, CValidationState& state, const CCoinsViewCache& inputs, const CClueViewCache& clueinputs, const Consensus::Params& consensusParams, const int nHeight);
@@ -790,6 +851,9 @@ void EnforceContractVoutLimit(ByteCodeExecResult& bcer, ByteCodeExecResult& bcer
 
 void writeVMlog(const std::vector<ResultExecute>& res, const CTransaction& tx = CTransaction(), const CBlock& block = CBlock());
 
+/** Log bloom of the receipts stored for a transaction */
+dev::eth::LogBloom GetTxLogBloom(const uint256& txid);
+
 CTxDestination getAddressForVin(const CTransaction& tx, bool& found);
 
 struct EthTransactionParams {
@@ -814,6 +878,7 @@ struct ByteCodeExecResult {
     CAmount refundSender = 0;
     std::vector<CTxOut> refundOutputs;
     std::vector<CTransaction> valueTransfers;
+    dev::eth::LogBloom logBloom;
 };
 
 class QtumTxConverter
@@ -846,7 +911,7 @@ class ByteCodeExec
 
 public:
 
-    ByteCodeExec(const CBlock& _block, std::vector<QtumTransaction> _txs, const uint64_t _blockGasLimit) : txs(_txs), block(_block), blockGasLimit(_blockGasLimit) {}
+    ByteCodeExec(const CBlock& _block, std::vector<QtumTransaction> _txs, const uint64_t _blockGasLimit, SpeculativeExec* _speculation = nullptr, size_t _nTx = 0) : txs(_txs), block(_block), blockGasLimit(_blockGasLimit), speculation(_speculation), nTx(_nTx) {}
 
     bool performByteCode(dev::eth::Permanence type = dev::eth::Permanence::Committed);
 
@@ -857,11 +922,11 @@ public:
         return result;
     }
 
-private:
-
     dev::eth::EnvInfo BuildEVMEnvironment();
 
-    dev::Address EthAddrFromScript(const CScript& scriptIn);
+    static dev::Address EthAddrFromScript(const CScript& scriptIn);
+
+private:
 
     std::vector<QtumTransaction> txs;
 
@@ -871,6 +936,11 @@ private:
 
     const uint64_t blockGasLimit;
 
+    //! speculative results of the block, the transactions executed are block.vtx[nTx]'s
+    SpeculativeExec* speculation;
+
+    const size_t nTx;
+
 };
 
 ////////////////////////////////////////////////////////
@@ -1,4 +1,5 @@
 #include <stdexcept>
+#include <thread>
 
 #include <boost/foreach.hpp>
 
@@ -134,6 +135,8 @@ void IncrementalMerkleTree<Depth, Hash>::append(Hash obj) {
         throw std::runtime_error("tree is full");
     }
 
+    cached_root = boost::none;
+
     if (!left) {
         // Set the left leaf
         left = obj;
@@ -165,6 +168,89 @@ void IncrementalMerkleTree<Depth, Hash>::append(Hash obj) {
     }
 }
 
+// Fewest hashes worth a thread of their own
+static const size_t MIN_PARALLEL_COMBINES = 256;
+
+// This hashes pairs of sibling nodes at `depth` into their parents.
+template<typename Hash>
+static std::vector<Hash> combine_level(const std::vector<Hash>& nodes, size_t depth, size_t nThreads) {
+    std::vector<Hash> combined(nodes.size() / 2);
+    auto combine_range = [&nodes, &combined, depth](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            combined[i] = Hash::combine(nodes[2 * i], nodes[2 * i + 1], depth);
+        }
+    };
+
+    size_t chunks = std::min(nThreads, combined.size() / MIN_PARALLEL_COMBINES);
+    if (chunks <= 1) {
+        combine_range(0, combined.size());
+        return combined;
+    }
+
+    // The pairs are independent, each thread takes a range of them
+    size_t chunk = (combined.size() + chunks - 1) / chunks;
+    std::vector<std::thread> threads;
+    for (size_t begin = chunk; begin < combined.size(); begin += chunk) {
+        threads.emplace_back(combine_range, begin, std::min(begin + chunk, combined.size()));
+    }
+    combine_range(0, chunk);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    return combined;
+}
+
+template<size_t Depth, typename Hash>
+void IncrementalMerkleTree<Depth, Hash>::append_batch(const std::vector<Hash>& objs, size_t nThreads) {
+    if (objs.empty()) {
+        return;
+    }
+    if (objs.size() > (size_t(1) << Depth) - size()) {
+        throw std::runtime_error("tree is full");
+    }
+
+    cached_root = boost::none;
+
+    // The leaves not combined yet, followed by the new ones
+    std::vector<Hash> nodes;
+    nodes.reserve(objs.size() + 2);
+    if (left) {
+        nodes.push_back(*left);
+    }
+    if (right) {
+        nodes.push_back(*right);
+    }
+    nodes.insert(nodes.end(), objs.begin(), objs.end());
+
+    // Like append, the last one or two leaves stay uncombined
+    size_t tail = nodes.size() % 2 ? 1 : 2;
+    left = nodes[nodes.size() - tail];
+    right = tail == 2 ? boost::optional<Hash>(nodes.back()) : boost::none;
+    nodes.resize(nodes.size() - tail);
+
+    // Then every completed node is carried up as append would, but each
+    // level is combined at once
+    std::vector<Hash> level = combine_level(nodes, 0, nThreads);
+    for (size_t i = 0; !level.empty(); i++) {
+        if (i < parents.size() && parents[i]) {
+            level.insert(level.begin(), *parents[i]);
+        }
+
+        boost::optional<Hash> pending;
+        if (level.size() % 2) {
+            pending = level.back();
+            level.pop_back();
+        }
+        if (i < parents.size()) {
+            parents[i] = pending;
+        } else {
+            parents.push_back(pending);
+        }
+
+        level = combine_level(level, i + 1, nThreads);
+    }
+}
+
 // This is for allowing the witness to determine if a subtree has filled
 // to a particular depth, or for append() to ensure we're not appending
 // to a full tree.
@@ -325,6 +411,8 @@ std::deque<Hash> IncrementalWitness<Depth, Hash>::partial_path() const {
 
 template<size_t Depth, typename Hash>
 void IncrementalWitness<Depth, Hash>::append(Hash obj) {
+    cached_root = boost::none;
+
     if (cursor) {
         cursor->append(obj);
 
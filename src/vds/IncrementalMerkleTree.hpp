@@ -101,8 +101,18 @@ public:
     size_t size() const;
 
     void append(Hash obj);
+    /**
+     * Append objs in order, leaving the tree as appending them one by one
+     * would. The nodes they complete are hashed a level at a time, large
+     * levels are split over nThreads threads.
+     */
+    void append_batch(const std::vector<Hash>& objs, size_t nThreads = 1);
+    // The root is kept until the tree changes, it costs Depth hashes
     Hash root() const {
-        return root(Depth, std::deque<Hash>());
+        if (!cached_root) {
+            cached_root = root(Depth, std::deque<Hash>());
+        }
+        return *cached_root;
     }
     Hash last() const;
 
@@ -118,6 +128,9 @@ public:
         READWRITE(right);
         READWRITE(parents);
 
+        if (ser_action.ForRead()) {
+            cached_root = boost::none;
+        }
         wfcheck();
     }
 
@@ -136,6 +149,7 @@ private:
 
     // Collapsed "left" subtrees ordered toward the root of the tree.
     std::vector<boost::optional<Hash>> parents;
+    mutable boost::optional<Hash> cached_root;
     MerklePath path(std::deque<Hash> filler_hashes = std::deque<Hash>()) const;
     Hash root(size_t depth, std::deque<Hash> filler_hashes = std::deque<Hash>()) const;
     bool is_complete(size_t depth = Depth) const;
@@ -175,7 +189,10 @@ public:
     }
 
     Hash root() const {
-        return tree.root(Depth, partial_path());
+        if (!cached_root) {
+            cached_root = tree.root(Depth, partial_path());
+        }
+        return *cached_root;
     }
 
     void append(Hash obj);
@@ -189,6 +206,7 @@ public:
         READWRITE(cursor);
 
         cursor_depth = tree.next_depth(filled.size());
+        cached_root = boost::none;
     }
 
     template <size_t D, typename H>
@@ -200,6 +218,7 @@ private:
     std::vector<Hash> filled;
     boost::optional<IncrementalMerkleTree<Depth, Hash>> cursor;
     size_t cursor_depth = 0;
+    mutable boost::optional<Hash> cached_root;
     std::deque<Hash> partial_path() const;
     IncrementalWitness(IncrementalMerkleTree<Depth, Hash> tree) : tree(tree) {}
 };
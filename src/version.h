@@ -9,7 +9,7 @@
  * network protocol versioning
  */
 
-static const int PROTOCOL_VERSION = 170004;
+static const int PROTOCOL_VERSION = 170005;
 
 //! initial proto version, to be increased after version/verack negotiation
 static const int INIT_PROTO_VERSION = 209;
@@ -40,4 +40,7 @@ static const int NO_BLOOM_VERSION = 70201;
 //! "sendheaders" command and announcing blocks with headers starts with this version
 static const int SENDHEADERS_VERSION = 70201;
 
+//! "gettxs" is answered with a single "txs" message starting with this version, before with "tx" and "notfound"
+static const int TXS_VERSION = 170005;
+
 #endif // VDS_VERSION_H
@@ -58,6 +58,10 @@ public:
 
     virtual UniValue getStatus() const;
 
+    virtual std::string getMethod() const {
+        return "v_sendmany";
+    }
+
     bool IsGuiMode();
     void SetGuiMode(bool _isGuiMode);
 
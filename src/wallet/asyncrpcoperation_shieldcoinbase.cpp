@@ -65,6 +65,9 @@ AsyncRPCOperation_shieldcoinbase::AsyncRPCOperation_shieldcoinbase(
 {
     assert(contextualTx.nVersion >= 2);  // transaction format version must support vjoinsplit
 
+    // Shielding can wait, payments queued after it go first
+    setPriority(ASYNC_RPC_PRIORITY_LOW);
+
     if (fee < 0 || fee > MAX_MONEY) {
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Fee is out of range");
     }
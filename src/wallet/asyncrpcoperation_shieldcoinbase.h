@@ -54,6 +54,10 @@ public:
 
     virtual UniValue getStatus() const;
 
+    virtual std::string getMethod() const {
+        return "v_shieldcoinbase";
+    }
+
     bool testmode = false;  // Set to true to disable sending txs and generating proofs
 
     bool paymentDisclosureMode = false; // Set to true to save esk for encrypted notes in payment disclosure database.
@@ -9,6 +9,7 @@
 #include "primitives/block.h"
 #include "random.h"
 #include "transaction_builder.h"
+#include "wallet/saplingdecrypt.h"
 #include "wallet/wallet.h"
 #include "vds/JoinSplit.hpp"
 #include "vds/Note.hpp"
@@ -221,7 +222,7 @@ TEST(WalletTests, FindMySaplingNotes)
     auto noteMap = wallet.FindMySaplingNotes(wtx).first;
     EXPECT_EQ(0, noteMap.size());
 
-    // Add spending key to wallet, so Sapling notes can be found
+    // Add spending key to wallet, so Sapling notes can be found by a decryptor rebuilt with it
     ASSERT_TRUE(wallet.AddSaplingZKey(sk, pk));
     ASSERT_TRUE(wallet.HaveSaplingSpendingKey(fvk));
     noteMap = wallet.FindMySaplingNotes(wtx).first;
@@ -229,6 +230,85 @@ TEST(WalletTests, FindMySaplingNotes)
 
 }
 
+TEST(WalletTests, FindMySaplingNotesBatch)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    auto consensusParams = Params().GetConsensus();
+
+    TestWallet wallet;
+
+    std::vector<unsigned char, secure_allocator<unsigned char>> rawSeed(32);
+    HDSeed seed(rawSeed);
+    auto sk = libzcash::SaplingExtendedSpendingKey::Master(seed);
+    auto expsk = sk.expsk;
+    auto fvk = expsk.full_viewing_key();
+    auto pk = sk.DefaultAddress();
+    ASSERT_TRUE(wallet.AddSaplingZKey(sk, pk));
+
+    // Two transactions paying the wallet around one without shielded outputs
+    std::vector<CTransaction> vTransactions;
+    for (CAmount nValue : {50000, 60000}) {
+        libzcash::SaplingNote note(pk, nValue);
+        SaplingMerkleTree tree;
+        tree.append(note.cm().get());
+        auto builder = TransactionBuilder(consensusParams, 1);
+        ASSERT_TRUE(builder.AddSaplingSpend(expsk, note, tree.root(), tree.witness()));
+        builder.AddSaplingOutput(fvk.ovk, pk, nValue / 2, {});
+        auto maybe_tx = builder.Build();
+        ASSERT_EQ(static_cast<bool>(maybe_tx), true);
+        vTransactions.push_back(maybe_tx.get());
+    }
+    CTransaction txEmpty;
+    std::vector<const CTransaction*> vtx {&vTransactions[0], &txEmpty, &vTransactions[1]};
+
+    // Same notes as one transaction at a time
+    auto vResults = wallet.FindMySaplingNotes(vtx);
+    ASSERT_EQ(3, vResults.size());
+    EXPECT_EQ(0, vResults[1].first.size());
+    for (size_t i : {0, 2}) {
+        EXPECT_EQ(2, vResults[i].first.size());
+        EXPECT_TRUE(wallet.FindMySaplingNotes(*vtx[i]).first == vResults[i].first);
+        for (const auto& item : vResults[i].first) {
+            EXPECT_EQ(vtx[i]->GetHash(), item.first.hash);
+        }
+    }
+}
+
+TEST(WalletTests, SaplingTrialDecryptorIsDeterministic)
+{
+    auto sk = libzcash::SaplingSpendingKey::random();
+    auto ivk = sk.full_viewing_key().in_viewing_key();
+    auto pa = sk.default_address();
+
+    // The wallet key appears twice, in different jobs
+    std::vector<libzcash::SaplingIncomingViewingKey> vKeys;
+    for (size_t i = 0; i < 3 * SAPLING_DECRYPT_KEYS_PER_JOB; i++) {
+        vKeys.push_back(libzcash::SaplingSpendingKey::random().full_viewing_key().in_viewing_key());
+    }
+    vKeys[SAPLING_DECRYPT_KEYS_PER_JOB + 5] = ivk;
+    vKeys[2 * SAPLING_DECRYPT_KEYS_PER_JOB] = ivk;
+
+    std::vector<OutputDescription> vOutputs(3);
+    for (size_t i = 0; i < vOutputs.size(); i++) {
+        auto to = (i == 1) ? libzcash::SaplingSpendingKey::random().default_address() : pa;
+        libzcash::SaplingNote note(to, 1000 + i);
+        auto enc = libzcash::SaplingNotePlaintext(note, {}).encrypt(to.pk_d).get();
+        vOutputs[i].cm = note.cm().get();
+        vOutputs[i].ephemeralKey = enc.second.get_epk();
+        vOutputs[i].encCiphertext = enc.first;
+    }
+
+    SaplingTrialDecryptor decryptor(vKeys);
+    auto vDecrypted = decryptor.Decrypt(vOutputs);
+    ASSERT_EQ(2, vDecrypted.size());
+    EXPECT_EQ(0, vDecrypted[0].nOutput);
+    EXPECT_EQ(SAPLING_DECRYPT_KEYS_PER_JOB + 5, vDecrypted[0].nKey);
+    EXPECT_EQ(1000, vDecrypted[0].plaintext.value());
+    EXPECT_EQ(2, vDecrypted[1].nOutput);
+    EXPECT_EQ(SAPLING_DECRYPT_KEYS_PER_JOB + 5, vDecrypted[1].nKey);
+    EXPECT_EQ(1002, vDecrypted[1].plaintext.value());
+}
+
 // Generate note A and spend to create note B, from which we spend to create two conflicting transactions
 TEST(WalletTests, GetConflictedSaplingNotes)
 {
@@ -1425,3 +1505,105 @@ TEST(WalletTests, SaplingNoteLocking)
     EXPECT_FALSE(wallet.IsLockedNote(sop1));
     EXPECT_FALSE(wallet.IsLockedNote(sop2));
 }
+
+TEST(WalletTests, SaplingWitnessesMatchPerNoteAppend)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    TestWallet wallet;
+
+    std::vector<unsigned char, secure_allocator<unsigned char>> rawSeed(32);
+    HDSeed seed(rawSeed);
+    auto pk = libzcash::SaplingExtendedSpendingKey::Master(seed).DefaultAddress();
+
+    // Blocks of three transactions with three outputs each, the middle output
+    // of the first two transactions belongs to the wallet
+    auto makeBlock = [&](CBlock& block) {
+        for (int t = 0; t < 3; t++) {
+            CMutableTransaction mtx;
+            mtx.vin.resize(1);
+            mtx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+            mtx.vShieldedOutput.resize(3);
+            for (OutputDescription& od : mtx.vShieldedOutput) {
+                od.cm = libzcash::SaplingNote(pk, 1).cm().get();
+            }
+            CTransactionRef tx = MakeTransactionRef(mtx);
+            block.vtx.push_back(tx);
+            if (t < 2) {
+                CWalletTx wtx {&wallet, tx};
+                mapSaplingNoteData_t noteData;
+                noteData[SaplingOutPoint(tx->GetHash(), 1)] = SaplingNoteData();
+                wtx.SetSaplingNoteData(noteData);
+                wallet.AddToWallet(wtx, true, NULL);
+            }
+        }
+    };
+
+    // Reference: every commitment appended to the tree and to each witness one at a time
+    SaplingMerkleTree refTree;
+    std::map<SaplingOutPoint, SaplingWitness> refWitnesses;
+    auto appendReference = [&](const CBlock& block) {
+        for (const CTransactionRef& tx : block.vtx) {
+            bool fMine = wallet.mapWallet.count(tx->GetHash());
+            for (uint32_t i = 0; i < tx->vShieldedOutput.size(); i++) {
+                const uint256& cm = tx->vShieldedOutput[i].cm;
+                refTree.append(cm);
+                for (auto& refWitness : refWitnesses) {
+                    refWitness.second.append(cm);
+                }
+                if (fMine && i == 1) {
+                    refWitnesses.emplace(SaplingOutPoint(tx->GetHash(), i), refTree.witness());
+                }
+            }
+        }
+    };
+
+    auto checkWitnesses = [&](int nHeight, const SaplingMerkleTree& saplingTree) {
+        EXPECT_EQ(saplingTree.root(), refTree.root());
+        std::vector<SaplingOutPoint> notes;
+        for (const auto& refWitness : refWitnesses) {
+            const SaplingNoteData& nd = wallet.mapWallet[refWitness.first.hash].mapSaplingNoteData[refWitness.first];
+            EXPECT_EQ(nd.witnessHeight, nHeight);
+            ASSERT_FALSE(nd.witnesses.empty());
+            EXPECT_TRUE(nd.witnesses.front() == refWitness.second);
+            notes.push_back(refWitness.first);
+        }
+        std::vector<boost::optional<SaplingWitness>> witnesses;
+        EXPECT_EQ(GetWitnessesAndAnchors(wallet, notes, witnesses), refTree.root());
+    };
+
+    const int nBlocks = 4;
+    std::vector<CBlockIndex> vIndex(nBlocks + 1);
+    std::vector<SaplingMerkleTree> vTrees(nBlocks + 1);
+    std::vector<std::map<SaplingOutPoint, SaplingWitness>> vRefWitnesses(nBlocks + 1);
+    std::vector<CBlock> vBlocks(nBlocks + 1);
+    SaplingMerkleTree saplingTree;
+    for (int nHeight = 1; nHeight <= nBlocks; nHeight++) {
+        vIndex[nHeight].nHeight = nHeight;
+        makeBlock(vBlocks[nHeight]);
+        wallet.IncrementNoteWitnesses(&vIndex[nHeight], &vBlocks[nHeight], saplingTree);
+        appendReference(vBlocks[nHeight]);
+        checkWitnesses(nHeight, saplingTree);
+        vTrees[nHeight] = saplingTree;
+        vRefWitnesses[nHeight] = refWitnesses;
+    }
+
+    // Disconnecting the tip brings back the witnesses of the block before
+    wallet.DecrementNoteWitnesses(&vIndex[nBlocks]);
+    saplingTree = vTrees[nBlocks - 1];
+    refTree = vTrees[nBlocks - 1];
+    refWitnesses = vRefWitnesses[nBlocks - 1];
+    checkWitnesses(nBlocks - 1, saplingTree);
+    for (const CTransactionRef& tx : vBlocks[nBlocks].vtx) {
+        if (wallet.mapWallet.count(tx->GetHash())) {
+            const SaplingNoteData& nd = wallet.mapWallet[tx->GetHash()].mapSaplingNoteData[SaplingOutPoint(tx->GetHash(), 1)];
+            EXPECT_TRUE(nd.witnesses.empty());
+        }
+    }
+
+    // and a competing block at the same height is witnessed from there
+    CBlock block;
+    makeBlock(block);
+    wallet.IncrementNoteWitnesses(&vIndex[nBlocks], &block, saplingTree);
+    appendReference(block);
+    checkWitnesses(nBlocks, saplingTree);
+}
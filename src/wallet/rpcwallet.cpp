@@ -35,6 +35,7 @@
 
 #include "sodium.h"
 #include "contractman.h"
+#include "qtum/contractcallpool.h"
 
 #include <stdint.h>
 
@@ -60,7 +61,7 @@ int64_t nWalletUnlockTime;
 static CCriticalSection cs_nWalletUnlockTime;
 
 // Private method:
-UniValue v_getoperationstatus_IMPL(const UniValue&, bool);
+UniValue v_getoperationstatus_IMPL(const UniValue&, bool, bool);
 
 std::string HelpRequiringPassphrase()
 {
@@ -814,7 +815,7 @@ UniValue callcontractfunc(const JSONRPCRequest& request)
             if (abiFunc.abiIn(values, strData, errors)) {
                 // toHexData
                 if (abiFunc.constant) {
-                    std::vector<ResultExecute> execResults = CallContract(dev::Address(contractAddress), ParseHex(strData));
+                    std::vector<ResultExecute> execResults = CallContractReadOnly(dev::Address(contractAddress), ParseHex(strData));
 
                     if (fRecordLogOpcodes) {
                         writeVMlog(execResults);
@@ -861,7 +862,7 @@ void abiInOut(FunctionABI& _abifunc, std::string& contractAddress, std::string _
     std::vector<std::vector<std::string>> inValues;
     if (_abifunc.abiIn(inValues, strData, errors)) {
         if (_abifunc.constant) {
-            std::vector<ResultExecute> execResults = CallContract(dev::Address(contractAddress), ParseHex(strData));
+            std::vector<ResultExecute> execResults = CallContractReadOnly(dev::Address(contractAddress), ParseHex(strData));
             if (_abifunc.outputs.size()) {
                 std::vector<std::vector<std::string>> outValues;
                 if (_abifunc.abiOut(HexStr(execResults[0].execRes.output), outValues, errors)) {
@@ -3257,6 +3258,16 @@ UniValue vc_benchmark(const JSONRPCRequest& request)
                 nInputs = request.params[2].get_int();
             }
             sample_times.push_back(benchmark_large_tx(nInputs));
+        } else if (benchmarktype == "buildsaplingtx") {
+            // Sapling spends in the built transaction
+            int nSpends = 2;
+            if (request.params.size() >= 3) {
+                nSpends = request.params[2].get_int();
+            }
+            if (nSpends <= 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of spends");
+            }
+            sample_times.push_back(benchmark_build_sapling_tx(nSpends));
         } else if (benchmarktype == "connectblockslow") {
             if (Params().NetworkIDString() != "regtest") {
                 throw JSONRPCError(RPC_TYPE_ERROR, "Benchmark must be run in regtest mode");
@@ -3631,7 +3642,7 @@ UniValue v_getoperationresult(const JSONRPCRequest& request)
         );
 
     // This call will remove finished operations
-    return v_getoperationstatus_IMPL(request.params, true);
+    return v_getoperationstatus_IMPL(request.params, true, false);
 }
 
 UniValue v_getoperationstatus(const JSONRPCRequest& request)
@@ -3639,27 +3650,30 @@ UniValue v_getoperationstatus(const JSONRPCRequest& request)
     if (!EnsureWalletIsAvailable(request.fHelp))
         return NullUniValue;
 
-    if (request.fHelp || request.params.size() > 1)
+    if (request.fHelp || request.params.size() > 2)
         throw runtime_error(
-            "v_getoperationstatus ([\"operationid\", ... ]) \n"
+            "v_getoperationstatus ([\"operationid\", ... ] timing) \n"
             "\nGet operation status and any associated result or error data.  The operation will remain in memory."
             + HelpRequiringPassphrase() + "\n"
             "\nArguments:\n"
-            "1. \"operationid\"         (array, optional) A list of operation ids we are interested in.  If not provided, examine all operations known to the node.\n"
+            "1. \"operationid\"         (array, optional) A list of operation ids we are interested in.  If not provided or empty, examine all operations known to the node.\n"
+            "2. timing                (boolean, optional, default=false) Add a \"timing\" object with the seconds a finished operation\n"
+            "                         was queued and executing, and histograms of these times for all operations of its method.\n"
             "\nResult:\n"
             "\"    [object, ...]\"      (array) A list of JSON objects\n"
         );
 
     // This call is idempotent so we don't want to remove finished operations
-    return v_getoperationstatus_IMPL(request.params, false);
+    bool fTiming = request.params.size() > 1 && request.params[1].get_bool();
+    return v_getoperationstatus_IMPL(request.params, false, fTiming);
 }
 
-UniValue v_getoperationstatus_IMPL(const UniValue& params, bool fRemoveFinishedOperations = false)
+UniValue v_getoperationstatus_IMPL(const UniValue& params, bool fRemoveFinishedOperations = false, bool fTiming = false)
 {
     LOCK2(cs_main, pwalletMain->cs_wallet);
 
     std::set<AsyncRPCOperationId> filter;
-    if (params.size() == 1) {
+    if (params.size() >= 1 && !params[0].isNull()) {
         UniValue ids = params[0].get_array();
         for (const UniValue& v : ids.getValues()) {
             filter.insert(v.get_str());
@@ -3683,6 +3697,14 @@ UniValue v_getoperationstatus_IMPL(const UniValue& params, bool fRemoveFinishedO
         }
 
         UniValue obj = operation->getStatus();
+        AsyncRPCOperationTiming timing;
+        if (fTiming && q->getOperationTiming(id, timing)) {
+            UniValue timingObj(UniValue::VOBJ);
+            timingObj.push_back(Pair("queue_secs", timing.queue_secs));
+            timingObj.push_back(Pair("execution_secs", timing.execution_secs));
+            timingObj.push_back(Pair("method_histograms", q->getMethodTimings(operation->getMethod())));
+            obj.push_back(Pair("timing", timingObj));
+        }
         std::string s = obj["status"].get_str();
         if (fRemoveFinishedOperations) {
             // Caller is only interested in retrieving finished results
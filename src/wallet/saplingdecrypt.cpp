@@ -0,0 +1,102 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "wallet/saplingdecrypt.h"
+
+#include "checkqueue.h"
+#include "util.h"
+
+#include <boost/thread.hpp>
+
+using namespace libzcash;
+
+static CCheckQueue<CSaplingDecryptCheck> decryptqueue(32);
+/** Serializes users of decryptqueue, which supports a single master at a time */
+static boost::mutex csDecryptQueue;
+/** Number of running worker threads, excluding the calling thread */
+static int nDecryptWorkers = 0;
+
+bool CSaplingDecryptCheck::operator()()
+{
+    for (size_t i = nBegin; i < nEnd; i++) {
+        auto result = SaplingNotePlaintext::decrypt(pOutput->encCiphertext, pKeys[i], pOutput->ephemeralKey, pOutput->cm);
+        if (result) {
+            pResult->nKey = i;
+            pResult->plaintext = result;
+            break;
+        }
+    }
+    return true;
+}
+
+std::vector<SaplingDecryptedOutput> SaplingTrialDecryptor::Decrypt(const std::vector<OutputDescription>& vOutputs) const
+{
+    std::vector<SaplingDecryptedOutput> vDecrypted;
+    if (vOutputs.empty() || vKeys.empty())
+        return vDecrypted;
+
+    const size_t nJobsPerOutput = (vKeys.size() + SAPLING_DECRYPT_KEYS_PER_JOB - 1) / SAPLING_DECRYPT_KEYS_PER_JOB;
+    // Slot of the job trying keys [j * KEYS_PER_JOB, (j + 1) * KEYS_PER_JOB) on output i is i * nJobsPerOutput + j
+    std::vector<CSaplingDecryptCheck::Result> vResults(vOutputs.size() * nJobsPerOutput);
+    std::vector<CSaplingDecryptCheck> vChecks;
+    vChecks.reserve(vResults.size());
+    for (size_t i = 0; i < vOutputs.size(); i++) {
+        for (size_t j = 0; j < nJobsPerOutput; j++) {
+            size_t nBegin = j * SAPLING_DECRYPT_KEYS_PER_JOB;
+            size_t nEnd = std::min(nBegin + SAPLING_DECRYPT_KEYS_PER_JOB, vKeys.size());
+            vChecks.emplace_back(vOutputs[i], vKeys.data(), nBegin, nEnd, vResults[i * nJobsPerOutput + j]);
+        }
+    }
+
+    if (nDecryptWorkers > 0 && vChecks.size() > 1) {
+        boost::unique_lock<boost::mutex> lock(csDecryptQueue);
+        CCheckQueueControl<CSaplingDecryptCheck> control(&decryptqueue);
+        control.Add(vChecks);
+        control.Wait();
+    } else {
+        for (CSaplingDecryptCheck& check : vChecks)
+            check();
+    }
+
+    // Per output, the first job (lowest key range) that decrypted it wins
+    for (size_t i = 0; i < vOutputs.size(); i++) {
+        for (size_t j = 0; j < nJobsPerOutput; j++) {
+            CSaplingDecryptCheck::Result& result = vResults[i * nJobsPerOutput + j];
+            if (result.plaintext) {
+                vDecrypted.push_back(SaplingDecryptedOutput{(uint32_t)i, result.nKey, result.plaintext.get()});
+                break;
+            }
+        }
+    }
+    return vDecrypted;
+}
+
+static void ThreadSaplingDecrypt()
+{
+    RenameThread("vds-decrypt");
+    decryptqueue.Thread();
+}
+
+void StartSaplingDecryptThreads(boost::thread_group& threadGroup, int nThreads)
+{
+    // The calling thread joins the pool as the last worker
+    for (int i = 0; i < nThreads - 1; i++) {
+        threadGroup.create_thread(&ThreadSaplingDecrypt);
+        nDecryptWorkers++;
+    }
+}
+
+int StartSaplingDecryptThreads(boost::thread_group& threadGroup)
+{
+    // -saplingdecryptthreads=0 means autodetect, like -par
+    int nThreads = GetArg("-saplingdecryptthreads", DEFAULT_SAPLING_DECRYPT_THREADS);
+    if (nThreads <= 0)
+        nThreads += GetNumCores();
+    if (nThreads > MAX_SAPLING_DECRYPT_THREADS)
+        nThreads = MAX_SAPLING_DECRYPT_THREADS;
+
+    LogPrintf("Using %u threads for Sapling trial decryption\n", std::max(nThreads, 1));
+    StartSaplingDecryptThreads(threadGroup, nThreads);
+    return nThreads;
+}
@@ -0,0 +1,100 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef VDS_WALLET_SAPLINGDECRYPT_H
+#define VDS_WALLET_SAPLINGDECRYPT_H
+
+#include "primitives/transaction.h"
+#include "vds/Address.hpp"
+#include "vds/Note.hpp"
+
+#include <vector>
+
+#include <boost/optional.hpp>
+
+namespace boost
+{
+class thread_group;
+} // namespace boost
+
+/** Number of trial decryption threads, 0 = as many as cores */
+static const int DEFAULT_SAPLING_DECRYPT_THREADS = 0;
+/** Maximum number of trial decryption threads */
+static const int MAX_SAPLING_DECRYPT_THREADS = 16;
+/** Number of viewing keys tried against one output by a single job */
+static const size_t SAPLING_DECRYPT_KEYS_PER_JOB = 64;
+
+/** An output of a transaction that decrypted under one of the viewing keys */
+struct SaplingDecryptedOutput {
+    uint32_t nOutput;   //!< index into vShieldedOutput
+    size_t nKey;        //!< index into the viewing keys of the decryptor
+    libzcash::SaplingNotePlaintext plaintext;
+};
+
+/**
+ * Closure trying a contiguous range of viewing keys against one output.
+ * The first key of the range that decrypts the output is stored in the
+ * result slot owned by the caller.
+ */
+class CSaplingDecryptCheck
+{
+public:
+    struct Result {
+        size_t nKey;
+        boost::optional<libzcash::SaplingNotePlaintext> plaintext;
+    };
+
+private:
+    const OutputDescription* pOutput;
+    const libzcash::SaplingIncomingViewingKey* pKeys;
+    size_t nBegin;
+    size_t nEnd;
+    Result* pResult;
+
+public:
+    CSaplingDecryptCheck() : pOutput(nullptr), pKeys(nullptr), nBegin(0), nEnd(0), pResult(nullptr) {}
+    CSaplingDecryptCheck(const OutputDescription& output, const libzcash::SaplingIncomingViewingKey* pKeysIn,
+                         size_t nBeginIn, size_t nEndIn, Result& result) :
+        pOutput(&output), pKeys(pKeysIn), nBegin(nBeginIn), nEnd(nEndIn), pResult(&result) {}
+
+    bool operator()();
+
+    void swap(CSaplingDecryptCheck& check)
+    {
+        std::swap(pOutput, check.pOutput);
+        std::swap(pKeys, check.pKeys);
+        std::swap(nBegin, check.nBegin);
+        std::swap(nEnd, check.nEnd);
+        std::swap(pResult, check.pResult);
+    }
+};
+
+/**
+ * Trial decryption of Sapling outputs against a fixed set of incoming
+ * viewing keys. The keys are flattened into a contiguous vector once, and
+ * outputs x keys are split into jobs run on the decryption threads.
+ *
+ * Results are deterministic: they are ordered by output index, and for each
+ * output the key with the lowest index that decrypts it is reported, exactly
+ * as a serial scan over the keys would do.
+ */
+class SaplingTrialDecryptor
+{
+private:
+    std::vector<libzcash::SaplingIncomingViewingKey> vKeys;
+
+public:
+    explicit SaplingTrialDecryptor(std::vector<libzcash::SaplingIncomingViewingKey> vKeysIn) : vKeys(std::move(vKeysIn)) {}
+
+    const std::vector<libzcash::SaplingIncomingViewingKey>& GetKeys() const { return vKeys; }
+
+    std::vector<SaplingDecryptedOutput> Decrypt(const std::vector<OutputDescription>& vOutputs) const;
+};
+
+/** Start the trial decryption worker threads (-saplingdecryptthreads), returns the thread count used */
+int StartSaplingDecryptThreads(boost::thread_group& threadGroup);
+/** Start a fixed number of trial decryption worker threads */
+void StartSaplingDecryptThreads(boost::thread_group& threadGroup, int nThreads);
+
+#endif // VDS_WALLET_SAPLINGDECRYPT_H
@@ -0,0 +1,51 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "wallet/saplingwitness.h"
+
+#include "checkqueue.h"
+#include "util.h"
+
+#include <boost/thread.hpp>
+
+static CCheckQueue<CSaplingWitnessAppend> witnessqueue(8);
+/** Serializes users of witnessqueue, which supports a single master at a time */
+static boost::mutex csWitnessQueue;
+/** Number of running worker threads, excluding the calling thread */
+static int nWitnessWorkers = 0;
+
+bool CSaplingWitnessAppend::operator()()
+{
+    for (size_t i = nBegin; i < pvCommitments->size(); i++) {
+        pWitness->append((*pvCommitments)[i]);
+    }
+    return true;
+}
+
+void AppendSaplingCommitments(std::vector<CSaplingWitnessAppend>& vAppends)
+{
+    if (nWitnessWorkers > 0 && vAppends.size() > 1) {
+        boost::unique_lock<boost::mutex> lock(csWitnessQueue);
+        CCheckQueueControl<CSaplingWitnessAppend> control(&witnessqueue);
+        control.Add(vAppends);
+        control.Wait();
+    } else {
+        for (CSaplingWitnessAppend& append : vAppends)
+            append();
+    }
+}
+
+static void ThreadSaplingWitness()
+{
+    RenameThread("vds-witness");
+    witnessqueue.Thread();
+}
+
+void StartSaplingWitnessThreads(boost::thread_group& threadGroup, int nThreads)
+{
+    for (int i = 0; i < nThreads - 1; i++) {
+        threadGroup.create_thread(&ThreadSaplingWitness);
+        nWitnessWorkers++;
+    }
+}
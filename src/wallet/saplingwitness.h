@@ -0,0 +1,50 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef VDS_WALLET_SAPLINGWITNESS_H
+#define VDS_WALLET_SAPLINGWITNESS_H
+
+#include "uint256.h"
+#include "vds/IncrementalMerkleTree.hpp"
+
+#include <vector>
+
+namespace boost
+{
+class thread_group;
+} // namespace boost
+
+/**
+ * Closure appending the tail of a block's note commitments to one witness.
+ * Note that this stores references to the witness and the commitments.
+ */
+class CSaplingWitnessAppend
+{
+private:
+    SaplingWitness* pWitness;
+    const std::vector<uint256>* pvCommitments;
+    size_t nBegin;
+
+public:
+    CSaplingWitnessAppend() : pWitness(nullptr), pvCommitments(nullptr), nBegin(0) {}
+    CSaplingWitnessAppend(SaplingWitness& witness, const std::vector<uint256>& vCommitments, size_t nBeginIn) :
+        pWitness(&witness), pvCommitments(&vCommitments), nBegin(nBeginIn) {}
+
+    bool operator()();
+
+    void swap(CSaplingWitnessAppend& check)
+    {
+        std::swap(pWitness, check.pWitness);
+        std::swap(pvCommitments, check.pvCommitments);
+        std::swap(nBegin, check.nBegin);
+    }
+};
+
+/** Run all appends, on the witness threads if they are running */
+void AppendSaplingCommitments(std::vector<CSaplingWitnessAppend>& vAppends);
+
+/** Start the witness update worker threads; the calling thread is the last worker */
+void StartSaplingWitnessThreads(boost::thread_group& threadGroup, int nThreads);
+
+#endif // VDS_WALLET_SAPLINGWITNESS_H
@@ -0,0 +1,145 @@
+// Copyright (c) 2014-2019 The vds Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "wallet/wallet.h"
+
+#include "chainparams.h"
+#include "clientversion.h"
+#include "init.h"
+#include "random.h"
+#include "script/standard.h"
+#include "test/test_bitcoin.h"
+#include "validation.h"
+#include "wallet/db.h"
+#include "wallet/walletdb.h"
+
+#include <boost/test/unit_test.hpp>
+
+extern volatile bool fRequestShutdown;
+
+static const std::string RESCAN_WALLET_FILE = "rescan_test.dat";
+static const int RESCAN_CHAIN_HEIGHT = 3 * RESCAN_BATCH_BLOCKS;
+static const int RESCAN_PAYMENT_HEIGHT = 10;
+
+/**
+ * A file backed wallet and a chain of blocks stored on disk replacing the
+ * active chain, with a payment to the wallet at RESCAN_PAYMENT_HEIGHT.
+ */
+struct RescanTestingSetup : public TestingSetup {
+    CWallet* pwallet;
+    CScript scriptWallet;
+    uint256 hashPayment;
+
+    RescanTestingSetup()
+    {
+        bitdb.MakeMock();
+        bool fFirstRun;
+        pwallet = new CWallet(RESCAN_WALLET_FILE);
+        pwallet->LoadWallet(fFirstRun);
+        CKey key;
+        key.MakeNewKey(true);
+        {
+            LOCK(pwallet->cs_wallet);
+            BOOST_REQUIRE(pwallet->AddKeyPubKey(key, key.GetPubKey()));
+        }
+        scriptWallet = GetScriptForDestination(key.GetPubKey().GetID());
+
+        LOCK(cs_main);
+        CBlockIndex* pindexPrev = nullptr;
+        unsigned int nPos = 0;
+        for (int nHeight = 0; nHeight <= RESCAN_CHAIN_HEIGHT; nHeight++) {
+            CBlock block;
+            block.nTime = GetTime();
+            block.nNonce = GetRandHash();
+            block.hashPrevBlock = pindexPrev ? pindexPrev->GetBlockHash() : uint256();
+            block.hashFinalSaplingRoot = SaplingMerkleTree::empty_root();
+            CMutableTransaction tx;
+            tx.vin.resize(1);
+            tx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+            tx.vout.resize(1);
+            tx.vout[0].nValue = 1000;
+            tx.vout[0].scriptPubKey = nHeight == RESCAN_PAYMENT_HEIGHT ? scriptWallet : CScript() << OP_TRUE;
+            block.vtx.push_back(MakeTransactionRef(tx));
+            block.hashMerkleRoot = block.BuildMerkleTree();
+            if (nHeight == RESCAN_PAYMENT_HEIGHT)
+                hashPayment = block.vtx[0]->GetHash();
+
+            CDiskBlockPos pos(0, nPos);
+            BOOST_REQUIRE(WriteBlockToDisk(block, pos, Params().MessageStart()));
+            nPos = pos.nPos + ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+
+            CBlockIndex* pindex = new CBlockIndex(block);
+            pindex->phashBlock = &mapBlockIndex.insert(std::make_pair(block.GetHash(), pindex)).first->first;
+            pindex->pprev = pindexPrev;
+            pindex->nHeight = nHeight;
+            pindex->nFile = pos.nFile;
+            pindex->nDataPos = pos.nPos;
+            pindex->nTx = 1;
+            pindex->nChainTx = nHeight + 1;
+            pindex->nStatus = BLOCK_HAVE_DATA | BLOCK_VALID_SCRIPTS;
+            pindex->BuildSkip();
+            pindexPrev = pindex;
+        }
+        chainActive.SetTip(pindexPrev);
+    }
+
+    ~RescanTestingSetup()
+    {
+        fRequestShutdown = false;
+        delete pwallet;
+        bitdb.Flush(true);
+        bitdb.Reset();
+    }
+
+    bool HasRescanProgress(CBlockIndex*& pindex)
+    {
+        CBlockLocator locator;
+        if (!CWalletDB(RESCAN_WALLET_FILE).ReadRescanProgress(locator))
+            return false;
+        LOCK(cs_main);
+        pindex = FindForkInGlobalIndex(chainActive, locator);
+        return true;
+    }
+};
+
+static void ShutdownOnTransaction(CWallet* wallet, const uint256& hashTx, ChangeType status)
+{
+    StartShutdown();
+}
+
+BOOST_FIXTURE_TEST_SUITE(rescan_tests, RescanTestingSetup)
+
+BOOST_AUTO_TEST_CASE(resume_interrupted_rescan)
+{
+    // The wallet was synced up to the payment, then restarted with a shutdown during its rescan
+    CBlockIndex* pindexStart = chainActive[RESCAN_PAYMENT_HEIGHT - 1];
+    pwallet->SetBestChain(chainActive.GetLocator(pindexStart));
+    BOOST_CHECK(CWallet::FindRescanStart(RESCAN_WALLET_FILE) == pindexStart);
+
+    boost::signals2::connection connection = pwallet->NotifyTransactionChanged.connect(&ShutdownOnTransaction);
+    BOOST_CHECK_EQUAL(pwallet->ScanForWalletTransactions(pindexStart, true), 1);
+    connection.disconnect();
+    BOOST_REQUIRE(pwallet->mapWallet.count(hashPayment));
+
+    // It stopped after the batch with the payment, well before the tip
+    CBlockIndex* pindexProgress = nullptr;
+    BOOST_REQUIRE(HasRescanProgress(pindexProgress));
+    BOOST_REQUIRE(pindexProgress);
+    BOOST_CHECK_GE(pindexProgress->nHeight, RESCAN_PAYMENT_HEIGHT);
+    BOOST_CHECK_LT(pindexProgress->nHeight, RESCAN_PAYMENT_HEIGHT + (int)RESCAN_BATCH_BLOCKS);
+
+    // CreateWalletFromFile marks the tip as seen after the rescan, the next start resumes from the checkpoint anyway
+    pwallet->SetBestChain(chainActive.GetLocator());
+    BOOST_CHECK(CWallet::FindRescanStart(RESCAN_WALLET_FILE) == pindexProgress);
+
+    // A completed rescan leaves no checkpoint behind
+    fRequestShutdown = false;
+    pwallet->ScanForWalletTransactions(pindexProgress, true);
+    BOOST_CHECK(!HasRescanProgress(pindexProgress));
+    BOOST_CHECK(CWallet::FindRescanStart(RESCAN_WALLET_FILE) == chainActive.Tip());
+    BOOST_CHECK_EQUAL(pwallet->mapWallet.size(), 1U);
+    BOOST_CHECK(pwallet->mapWallet[hashPayment].hashBlock == chainActive[RESCAN_PAYMENT_HEIGHT]->GetBlockHash());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -12,6 +12,8 @@
 #include "consensus/validation.h"
 #include "init.h"
 #include "wallet/fees.h"
+#include "wallet/saplingdecrypt.h"
+#include "wallet/saplingwitness.h"
 #include "key_io.h"
 #include "validation.h"
 #include "net.h"
@@ -30,6 +32,7 @@
 #include <policy/rbf.h>
 
 #include <assert.h>
+#include <deque>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/filesystem.hpp>
@@ -199,6 +202,18 @@ bool CWallet::AddSaplingIncomingViewingKey(
     return true;
 }
 
+bool CWallet::AddSaplingFullViewingKey(
+    const libzcash::SaplingFullViewingKey& fvk,
+    const libzcash::SaplingPaymentAddress& defaultAddr)
+{
+    LOCK(cs_SpendingKeyStore);
+    if (!CCryptoKeyStore::AddSaplingFullViewingKey(fvk, defaultAddr)) {
+        return false;
+    }
+    pSaplingDecryptor.reset();
+    return true;
+}
+
 CPubKey CWallet::GenerateNewKey(KeyCategory category)
 {
     AssertLockHeld(cs_wallet); // mapKeyMetadata
@@ -872,43 +887,26 @@ void CWallet::UpdateClueAddresses()
     }
 }
 
-template<typename NoteDataMap>
-void CopyPreviousWitnesses(NoteDataMap& noteDataMap, int indexHeight, int64_t nWitnessCacheSize)
+template<typename NoteData>
+void CopyPreviousWitness(NoteData& nd, int indexHeight, int64_t nWitnessCacheSize)
 {
-    for (auto& item : noteDataMap) {
-        auto* nd = &(item.second);
-        // Only increment witnesses that are behind the current height
-        if (nd->witnessHeight < indexHeight) {
-            // Check the validity of the cache
-            // The only time a note witnessed above the current height
-            // would be invalid here is during a reindex when blocks
-            // have been decremented, and we are incrementing the blocks
-            // immediately after.
-            assert(nWitnessCacheSize >= nd->witnesses.size());
-            // Witnesses being incremented should always be either -1
-            // (never incremented or decremented) or one below indexHeight
-            assert((nd->witnessHeight == -1) || (nd->witnessHeight == indexHeight - 1));
-            // Copy the witness for the previous block if we have one
-            if (nd->witnesses.size() > 0) {
-                nd->witnesses.push_front(nd->witnesses.front());
-            }
-            if (nd->witnesses.size() > WITNESS_CACHE_SIZE) {
-                nd->witnesses.pop_back();
-            }
+    // Only increment witnesses that are behind the current height
+    if (nd.witnessHeight < indexHeight) {
+        // Check the validity of the cache
+        // The only time a note witnessed above the current height
+        // would be invalid here is during a reindex when blocks
+        // have been decremented, and we are incrementing the blocks
+        // immediately after.
+        assert(nWitnessCacheSize >= nd.witnesses.size());
+        // Witnesses being incremented should always be either -1
+        // (never incremented or decremented) or one below indexHeight
+        assert((nd.witnessHeight == -1) || (nd.witnessHeight == indexHeight - 1));
+        // Copy the witness for the previous block if we have one
+        if (nd.witnesses.size() > 0) {
+            nd.witnesses.push_front(nd.witnesses.front());
         }
-    }
-}
-
-template<typename NoteDataMap>
-void AppendNoteCommitment(NoteDataMap& noteDataMap, int indexHeight, int64_t nWitnessCacheSize, const uint256& note_commitment)
-{
-    for (auto& item : noteDataMap) {
-        auto* nd = &(item.second);
-        if (nd->witnessHeight < indexHeight && nd->witnesses.size() > 0) {
-            // Check the validity of the cache
-            // See comment in CopyPreviousWitnesses about validity.
-            assert(nWitnessCacheSize >= nd->witnesses.size());
-            nd->witnesses.front().append(note_commitment);
+        if (nd.witnesses.size() > WITNESS_CACHE_SIZE) {
+            nd.witnesses.pop_back();
         }
     }
 }
@@ -944,28 +942,40 @@ void WitnessNoteIfMine(std::map<OutPoint, NoteData>& noteDataMap, int indexHeigh
 }
 
 
-template<typename NoteDataMap>
-void UpdateWitnessHeights(NoteDataMap& noteDataMap, int indexHeight, int64_t nWitnessCacheSize)
+template<typename NoteData>
+void UpdateWitnessHeight(NoteData& nd, int indexHeight, int64_t nWitnessCacheSize)
 {
-    for (auto& item : noteDataMap) {
-        auto* nd = &(item.second);
-        if (nd->witnessHeight < indexHeight) {
-            nd->witnessHeight = indexHeight;
-            // Check the validity of the cache
-            // See comment in CopyPreviousWitnesses about validity.
-            assert(nWitnessCacheSize >= nd->witnesses.size());
-        }
+    if (nd.witnessHeight < indexHeight) {
+        nd.witnessHeight = indexHeight;
+        // Check the validity of the cache
+        // See comment in CopyPreviousWitness about validity.
+        assert(nWitnessCacheSize >= nd.witnesses.size());
     }
 }
 
+std::vector<SaplingNoteData*> CWallet::GetSaplingNotesBelowHeight(int nHeight)
+{
+    AssertLockHeld(cs_wallet);
+    std::vector<SaplingNoteData*> vNotes;
+    for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
+        for (mapSaplingNoteData_t::value_type& item : wtxItem.second.mapSaplingNoteData) {
+            if (item.second.witnessHeight < nHeight) {
+                vNotes.push_back(&item.second);
+            }
+        }
+    }
+    return vNotes;
+}
 
 void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
                                      const CBlock* pblockIn,
                                      SaplingMerkleTree& saplingTree)
 {
     LOCK(cs_wallet);
-    for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
-        ::CopyPreviousWitnesses(wtxItem.second.mapSaplingNoteData, pindex->nHeight, nWitnessCacheSize);
+    // Every note updated by this block, collected in a single pass over mapWallet
+    std::vector<SaplingNoteData*> vNotes = GetSaplingNotesBelowHeight(pindex->nHeight);
+    for (SaplingNoteData* nd : vNotes) {
+        ::CopyPreviousWitness(*nd, pindex->nHeight, nWitnessCacheSize);
     }
 
     if (nWitnessCacheSize < WITNESS_CACHE_SIZE) {
@@ -979,6 +989,10 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
         pblock = &block;
     }
 
+    // Append the block's commitments to the tree, witnessing our own notes as they
+    // go by. A note witnessed here only receives the commitments that follow it.
+    std::vector<uint256> vCommitments;
+    std::map<const SaplingNoteData*, size_t> mapFirstCommitment;
     for (const CTransactionRef& tx : pblock->vtx) {
         auto hash = tx->GetHash();
         bool txIsOurs = mapWallet.count(hash);
@@ -986,23 +1000,39 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
         for (uint32_t i = 0; i < tx->vShieldedOutput.size(); i++) {
             const uint256& note_commitment = tx->vShieldedOutput[i].cm;
             saplingTree.append(note_commitment);
-
-            // Increment existing witnesses
-            for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
-                ::AppendNoteCommitment(wtxItem.second.mapSaplingNoteData, pindex->nHeight, nWitnessCacheSize, note_commitment);
-            }
+            vCommitments.push_back(note_commitment);
 
             // If this is our note, witness it
             if (txIsOurs) {
                 SaplingOutPoint outPoint {hash, i};
-                ::WitnessNoteIfMine(mapWallet[hash].mapSaplingNoteData, pindex->nHeight, nWitnessCacheSize, outPoint, saplingTree.witness());
+                mapSaplingNoteData_t& noteDataMap = mapWallet[hash].mapSaplingNoteData;
+                if (noteDataMap.count(outPoint) && noteDataMap[outPoint].witnessHeight < pindex->nHeight) {
+                    mapFirstCommitment[&noteDataMap[outPoint]] = vCommitments.size();
+                }
+                ::WitnessNoteIfMine(noteDataMap, pindex->nHeight, nWitnessCacheSize, outPoint, saplingTree.witness());
             }
         }
     }
 
+    // Increment existing witnesses with all of the block's commitments in one batch
+    std::vector<CSaplingWitnessAppend> vAppends;
+    for (SaplingNoteData* nd : vNotes) {
+        if (nd->witnesses.size() > 0) {
+            // Check the validity of the cache
+            // See comment in CopyPreviousWitness about validity.
+            assert(nWitnessCacheSize >= nd->witnesses.size());
+            auto it = mapFirstCommitment.find(nd);
+            size_t nBegin = it == mapFirstCommitment.end() ? 0 : it->second;
+            if (nBegin < vCommitments.size()) {
+                vAppends.emplace_back(nd->witnesses.front(), vCommitments, nBegin);
+            }
+        }
+    }
+    AppendSaplingCommitments(vAppends);
+
     // Update witness heights
-    for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
-        ::UpdateWitnessHeights(wtxItem.second.mapSaplingNoteData, pindex->nHeight, nWitnessCacheSize);
+    for (SaplingNoteData* nd : vNotes) {
+        ::UpdateWitnessHeight(*nd, pindex->nHeight, nWitnessCacheSize);
     }
 
     // For performance reasons, we write out the witness cache in
@@ -1010,43 +1040,40 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
     // of the wallet.dat is maintained).
 }
 
-template<typename NoteDataMap>
-void DecrementNoteWitnesses(NoteDataMap& noteDataMap, int indexHeight, int64_t nWitnessCacheSize)
+template<typename NoteData>
+void DecrementNoteWitness(NoteData& nd, int indexHeight, int64_t nWitnessCacheSize)
 {
-    for (auto& item : noteDataMap) {
-        auto* nd = &(item.second);
-        // Only decrement witnesses that are not above the current height
-        if (nd->witnessHeight <= indexHeight) {
-            // Check the validity of the cache
-            // See comment below (this would be invalid if there were a
-            // prior decrement).
-            assert(nWitnessCacheSize >= nd->witnesses.size());
-            // Witnesses being decremented should always be either -1
-            // (never incremented or decremented) or equal to the height
-            // of the block being removed (indexHeight)
-            assert((nd->witnessHeight == -1) || (nd->witnessHeight == indexHeight));
-            if (nd->witnesses.size() > 0) {
-                nd->witnesses.pop_front();
-            }
-            // indexHeight is the height of the block being removed, so
-            // the new witness cache height is one below it.
-            nd->witnessHeight = indexHeight - 1;
-        }
+    // Only decrement witnesses that are not above the current height
+    if (nd.witnessHeight <= indexHeight) {
         // Check the validity of the cache
-        // Technically if there are notes witnessed above the current
-        // height, their cache will now be invalid (relative to the new
-        // value of nWitnessCacheSize). However, this would only occur
-        // during a reindex, and by the time the reindex reaches the tip
-        // of the chain again, the existing witness caches will be valid
-        // again.
-        // We don't set nWitnessCacheSize to zero at the start of the
-        // reindex because the on-disk blocks had already resulted in a
-        // chain that didn't trigger the assertion below.
-        if (nd->witnessHeight < indexHeight) {
-            // Subtract 1 to compare to what nWitnessCacheSize will be after
-            // decrementing.
-            assert((nWitnessCacheSize - 1) >= nd->witnesses.size());
+        // See comment below (this would be invalid if there were a
+        // prior decrement).
+        assert(nWitnessCacheSize >= nd.witnesses.size());
+        // Witnesses being decremented should always be either -1
+        // (never incremented or decremented) or equal to the height
+        // of the block being removed (indexHeight)
+        assert((nd.witnessHeight == -1) || (nd.witnessHeight == indexHeight));
+        if (nd.witnesses.size() > 0) {
+            nd.witnesses.pop_front();
         }
+        // indexHeight is the height of the block being removed, so
+        // the new witness cache height is one below it.
+        nd.witnessHeight = indexHeight - 1;
+    }
+    // Check the validity of the cache
+    // Technically if there are notes witnessed above the current
+    // height, their cache will now be invalid (relative to the new
+    // value of nWitnessCacheSize). However, this would only occur
+    // during a reindex, and by the time the reindex reaches the tip
+    // of the chain again, the existing witness caches will be valid
+    // again.
+    // We don't set nWitnessCacheSize to zero at the start of the
+    // reindex because the on-disk blocks had already resulted in a
+    // chain that didn't trigger the assertion below.
+    if (nd.witnessHeight < indexHeight) {
+        // Subtract 1 to compare to what nWitnessCacheSize will be after
+        // decrementing.
+        assert((nWitnessCacheSize - 1) >= nd.witnesses.size());
     }
 }
 
@@ -1054,7 +1081,9 @@ void CWallet::DecrementNoteWitnesses(const CBlockIndex* pindex)
 {
     LOCK(cs_wallet);
     for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
-        ::DecrementNoteWitnesses(wtxItem.second.mapSaplingNoteData, pindex->nHeight, nWitnessCacheSize);
+        for (mapSaplingNoteData_t::value_type& item : wtxItem.second.mapSaplingNoteData) {
+            ::DecrementNoteWitness(item.second, pindex->nHeight, nWitnessCacheSize);
+        }
     }
     if (nWitnessCacheSize > 1) {
         nWitnessCacheSize -= 1;
@@ -1472,15 +1501,22 @@ bool CWallet::UpdatedNoteData(const CWalletTx& wtxIn, CWalletTx& wtx)
  * If fUpdate is true, existing transactions will be updated.
  */
 bool CWallet::AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlockIndex* pblock, int posInBlock, bool fUpdate)
+{
+    AssertLockHeld(cs_wallet);
+    if (!fUpdate && mapWallet.count(tx.GetHash()) != 0)
+        return false;
+    return AddToWalletIfInvolvingMe(tx, pblock, posInBlock, fUpdate, IsMine(tx), FindMySaplingNotes(tx));
+}
+
+bool CWallet::AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlockIndex* pblock, int posInBlock, bool fUpdate, bool fIsMine,
+                                       const std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap>& saplingNotes)
 {
     {
         AssertLockHeld(cs_wallet);
         bool fExisted = mapWallet.count(tx.GetHash()) != 0;
         if (fExisted && !fUpdate) return false;
-        auto saplingNoteDataAndAddressesToAdd = FindMySaplingNotes(tx);
-        auto saplingNoteData = saplingNoteDataAndAddressesToAdd.first;
-        auto addressesToAdd = saplingNoteDataAndAddressesToAdd.second;
-        for (const auto& addressToAdd : addressesToAdd) {
+        mapSaplingNoteData_t saplingNoteData = saplingNotes.first;
+        for (const auto& addressToAdd : saplingNotes.second) {
             if (!AddSaplingIncomingViewingKey(addressToAdd.second, addressToAdd.first)) {
                 return false;
             }
@@ -1496,7 +1532,7 @@ bool CWallet::AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlockIndex
                 }
             }
         }
-        if (fExisted || IsMine(tx) || IsFromMe(tx) || saplingNoteData.size() > 0) {
+        if (fExisted || fIsMine || IsFromMe(tx) || saplingNoteData.size() > 0) {
             CWalletTx wtx(this, MakeTransactionRef(tx));
 
             if (saplingNoteData.size() > 0) {
@@ -1660,36 +1696,62 @@ void CWallet::EraseFromWallet(const uint256& hash)
  */
 std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap> CWallet::FindMySaplingNotes(const CTransaction& tx) const
 {
-    LOCK(cs_SpendingKeyStore);
-    uint256 hash = tx.GetHash();
+    if (tx.vShieldedOutput.empty()) {
+        return std::make_pair(mapSaplingNoteData_t(), SaplingIncomingViewingKeyMap());
+    }
+    return FindMySaplingNotes(std::vector<const CTransaction*>(1, &tx))[0];
+}
+
+std::vector<std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap> > CWallet::FindMySaplingNotes(const std::vector<const CTransaction*>& vtx) const
+{
+    std::vector<std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap> > vResults(vtx.size());
 
-    mapSaplingNoteData_t noteData;
-    SaplingIncomingViewingKeyMap viewingKeysToAdd;
+    // The outputs of all transactions are decrypted in one pass, remember where each comes from
+    std::vector<OutputDescription> vOutputs;
+    std::vector<std::pair<size_t, uint32_t> > vOrigins;
+    for (size_t i = 0; i < vtx.size(); i++) {
+        for (uint32_t j = 0; j < vtx[i]->vShieldedOutput.size(); j++) {
+            vOutputs.push_back(vtx[i]->vShieldedOutput[j]);
+            vOrigins.push_back(std::make_pair(i, j));
+        }
+    }
+    if (vOutputs.empty()) {
+        return vResults;
+    }
 
     // Protocol Spec: 4.19 Block Chain Scanning (Sapling)
-    for (uint32_t i = 0; i < tx.vShieldedOutput.size(); ++i) {
-        const OutputDescription output = tx.vShieldedOutput[i];
-        for (auto it = mapSaplingFullViewingKeys.begin(); it != mapSaplingFullViewingKeys.end(); ++it) {
-            SaplingIncomingViewingKey ivk = it->first;
-            auto result = SaplingNotePlaintext::decrypt(output.encCiphertext, ivk, output.ephemeralKey, output.cm);
-            if (!result) {
-                continue;
-            }
-            auto address = ivk.address(result.get().d);
-            if (address && mapSaplingIncomingViewingKeys.count(address.get()) == 0) {
-                viewingKeysToAdd[address.get()] = ivk;
+    std::shared_ptr<const SaplingTrialDecryptor> decryptor;
+    {
+        LOCK(cs_SpendingKeyStore);
+        if (!pSaplingDecryptor) {
+            std::vector<SaplingIncomingViewingKey> vKeys;
+            vKeys.reserve(mapSaplingFullViewingKeys.size());
+            for (auto it = mapSaplingFullViewingKeys.begin(); it != mapSaplingFullViewingKeys.end(); ++it) {
+                vKeys.push_back(it->first);
             }
-            // We don't cache the nullifier here as computing it requires knowledge of the note position
-            // in the commitment tree, which can only be determined when the transaction has been mined.
-            SaplingOutPoint op {hash, i};
-            SaplingNoteData nd;
-            nd.ivk = ivk;
-            noteData.insert(std::make_pair(op, nd));
-            break;
+            pSaplingDecryptor = std::make_shared<const SaplingTrialDecryptor>(std::move(vKeys));
         }
+        decryptor = pSaplingDecryptor;
     }
+    std::vector<SaplingDecryptedOutput> vDecrypted = decryptor->Decrypt(vOutputs);
 
-    return std::make_pair(noteData, viewingKeysToAdd);
+    LOCK(cs_SpendingKeyStore);
+    for (const SaplingDecryptedOutput& decrypted : vDecrypted) {
+        const std::pair<size_t, uint32_t>& origin = vOrigins[decrypted.nOutput];
+        const SaplingIncomingViewingKey& ivk = decryptor->GetKeys()[decrypted.nKey];
+        auto address = ivk.address(decrypted.plaintext.d);
+        if (address && mapSaplingIncomingViewingKeys.count(address.get()) == 0) {
+            vResults[origin.first].second[address.get()] = ivk;
+        }
+        // We don't cache the nullifier here as computing it requires knowledge of the note position
+        // in the commitment tree, which can only be determined when the transaction has been mined.
+        SaplingOutPoint op {vtx[origin.first]->GetHash(), origin.second};
+        SaplingNoteData nd;
+        nd.ivk = ivk;
+        vResults[origin.first].first.insert(std::make_pair(op, nd));
+    }
+
+    return vResults;
 }
 
 bool CWallet::IsSaplingNullifierFromMe(const uint256& nullifier) const
@@ -2056,20 +2118,124 @@ bool CWallet::GetOutpointAndKeysFromOutput(const COutput& out, COutPoint& outpoi
 }
 
 
+namespace
+{
+
+/** Block read ahead by a rescan, with the transactions paying to wallet scripts */
+struct CRescanBlock {
+    CBlockIndex* pindex;
+    CBlock block;
+    std::vector<bool> vIsMine;
+};
+
+/**
+ * Reads a list of blocks in order on its own thread, keeping up to
+ * RESCAN_PREFETCH_BLOCKS of them ready, and matches the outputs of their
+ * transactions against the wallet scripts on the way. It takes no lock but
+ * the key store's, so it never waits on the thread applying the blocks.
+ */
+class CRescanBlockReader
+{
+private:
+    const CWallet& wallet;
+    const Consensus::Params& consensusParams;
+    const std::vector<CBlockIndex*> vIndex;
+
+    boost::mutex cs;
+    boost::condition_variable cond;
+    std::deque<std::shared_ptr<CRescanBlock> > queue;
+    bool fDone;
+    bool fStop;
+    boost::thread thread;
+
+    void Thread()
+    {
+        for (CBlockIndex* pindex : vIndex) {
+            {
+                boost::unique_lock<boost::mutex> lock(cs);
+                while (!fStop && queue.size() >= RESCAN_PREFETCH_BLOCKS)
+                    cond.wait(lock);
+                if (fStop)
+                    break;
+            }
+
+            std::shared_ptr<CRescanBlock> pblock = std::make_shared<CRescanBlock>();
+            pblock->pindex = pindex;
+            if (!ReadBlockFromDisk(pblock->block, pindex, consensusParams))
+                LogPrintf("%s: failed to read block %s\n", __func__, pindex->GetBlockHash().ToString());
+            pblock->vIsMine.reserve(pblock->block.vtx.size());
+            for (const CTransactionRef& tx : pblock->block.vtx)
+                pblock->vIsMine.push_back(wallet.IsMine(*tx));
+
+            boost::unique_lock<boost::mutex> lock(cs);
+            queue.push_back(pblock);
+            cond.notify_all();
+        }
+
+        boost::unique_lock<boost::mutex> lock(cs);
+        fDone = true;
+        cond.notify_all();
+    }
+
+public:
+    CRescanBlockReader(const CWallet& walletIn, std::vector<CBlockIndex*>&& vIndexIn, const Consensus::Params& consensusParamsIn) :
+        wallet(walletIn), consensusParams(consensusParamsIn), vIndex(std::move(vIndexIn)), fDone(false), fStop(false)
+    {
+        thread = boost::thread(&CRescanBlockReader::Thread, this);
+    }
+
+    ~CRescanBlockReader()
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            fStop = true;
+            cond.notify_all();
+        }
+        thread.join();
+    }
+
+    //! Next blocks in order, at most nMax, waits for one unless all were taken
+    std::vector<std::shared_ptr<CRescanBlock> > Take(size_t nMax)
+    {
+        std::vector<std::shared_ptr<CRescanBlock> > vBlocks;
+        boost::unique_lock<boost::mutex> lock(cs);
+        while (!fDone && queue.empty())
+            cond.wait(lock);
+        while (!queue.empty() && vBlocks.size() < nMax) {
+            vBlocks.push_back(queue.front());
+            queue.pop_front();
+        }
+        cond.notify_all();
+        return vBlocks;
+    }
+};
+
+} // namespace
+
 /**
  * Scan the block chain (starting in pindexStart) for transactions
  * from or to us. If fUpdate is true, found transactions that already
  * exist in the wallet will be updated.
+ *
+ * Blocks are read and matched against the wallet scripts ahead of time by
+ * CRescanBlockReader. The Sapling outputs of a batch of blocks are trial
+ * decrypted together on the decryption threads, then the batch is applied
+ * in chain order. cs_main is held throughout since note witnesses have to
+ * advance block by block with the chain, cs_wallet only while applying.
+ * The last applied block is checkpointed in the wallet, a rescan stopped by
+ * a shutdown resumes from there on the next start.
  */
 int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
 {
     int ret = 0;
     int64_t nNow = GetTime();
+    int64_t nLastCheckpoint = nNow;
     const CChainParams& chainParams = Params();
+    const bool fCheckpoint = fFileBacked;
 
     CBlockIndex* pindex = pindexStart;
     {
-        LOCK2(cs_main, cs_wallet);
+        LOCK(cs_main);
 
         // no need to read and scan block, if block was created before
         // our wallet birthday (as adjusted for block time variability)
@@ -2081,35 +2247,80 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
         ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
         double dProgressStart = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false);
         double dProgressTip = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), chainActive.Tip(), false);
-        while (pindex) {
-            if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
-                ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
-
-            CBlock block;
-            ReadBlockFromDisk(block, pindex, chainParams.GetConsensus());
-            for (int i = 0; i < block.vtx.size(); i++) {
-                if (AddToWalletIfInvolvingMe(*block.vtx[i], pindex, i, fUpdate))
-                    ret++;
+
+        std::vector<CBlockIndex*> vIndex;
+        if (pindex) {
+            vIndex.reserve(chainActive.Height() - pindex->nHeight + 1);
+            for (CBlockIndex* pnext = pindex; pnext; pnext = chainActive.Next(pnext))
+                vIndex.push_back(pnext);
+            if (fCheckpoint)
+                CWalletDB(strWalletFile).WriteRescanProgress(chainActive.GetLocator(pindex->pprev ? pindex->pprev : pindex));
+        }
+
+        CBlockIndex* pindexLast = nullptr;
+        bool fInterrupted = false;
+        CRescanBlockReader reader(*this, std::move(vIndex), chainParams.GetConsensus());
+        while (true) {
+            std::vector<std::shared_ptr<CRescanBlock> > vBatch = reader.Take(RESCAN_BATCH_BLOCKS);
+            if (vBatch.empty())
+                break;
+            if (ShutdownRequested()) {
+                fInterrupted = true;
+                break;
             }
 
-            if (pindex->nHeight > 0) {
-                SaplingMerkleTree saplingTree;
-                // This should never fail: we should always be able to get the tree
-                // state on the path to the tip of our chain
-                if (pindex->pprev) {
-                    assert(pcoinsTip->GetSaplingAnchorAt(pindex->pprev->hashFinalSaplingRoot, saplingTree));
+            std::vector<const CTransaction*> vtx;
+            for (const std::shared_ptr<CRescanBlock>& pblock : vBatch) {
+                for (const CTransactionRef& tx : pblock->block.vtx)
+                    vtx.push_back(tx.get());
+            }
+            std::vector<std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap> > vSaplingNotes = FindMySaplingNotes(vtx);
+
+            LOCK(cs_wallet);
+            size_t nTx = 0;
+            for (const std::shared_ptr<CRescanBlock>& pblock : vBatch) {
+                pindex = pblock->pindex;
+                if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
+                    ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
+
+                const CBlock& block = pblock->block;
+                for (int i = 0; i < block.vtx.size(); i++, nTx++) {
+                    if (AddToWalletIfInvolvingMe(*block.vtx[i], pindex, i, fUpdate, pblock->vIsMine[i], vSaplingNotes[nTx]))
+                        ret++;
                 }
-                // Increment note witness caches
-                // IncrementNoteWitnesses(pindex, &block, tree);
-                // Increment note witness caches
-                ChainTip(pindex, &block, saplingTree, true);
 
+                if (pindex->nHeight > 0) {
+                    SaplingMerkleTree saplingTree;
+                    // This should never fail: we should always be able to get the tree
+                    // state on the path to the tip of our chain
+                    if (pindex->pprev) {
+                        assert(pcoinsTip->GetSaplingAnchorAt(pindex->pprev->hashFinalSaplingRoot, saplingTree));
+                    }
+                    // Increment note witness caches
+                    ChainTip(pindex, &block, saplingTree, true);
+                }
             }
-            pindex = chainActive.Next(pindex);
+            pindexLast = pindex;
+
             if (GetTime() >= nNow + 60) {
                 nNow = GetTime();
                 LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex));
             }
+            if (fCheckpoint && GetTime() >= nLastCheckpoint + RESCAN_CHECKPOINT_INTERVAL) {
+                nLastCheckpoint = GetTime();
+                CWalletDB(strWalletFile).WriteRescanProgress(chainActive.GetLocator(pindex));
+            }
+        }
+
+        if (fCheckpoint) {
+            CWalletDB walletdb(strWalletFile);
+            if (fInterrupted) {
+                LogPrintf("Rescan interrupted, it resumes after block %d on the next start\n", pindexLast ? pindexLast->nHeight : -1);
+                if (pindexLast)
+                    walletdb.WriteRescanProgress(chainActive.GetLocator(pindexLast));
+            } else {
+                walletdb.EraseRescanProgress();
+            }
         }
         ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
     }
@@ -3353,6 +3564,31 @@ bool CWallet::CommitTransaction(CWalletTx& wtxNew, CReserveKey& reservekey, CVal
     return true;
 }
 
+CBlockIndex* CWallet::FindRescanStart(const std::string& walletFile)
+{
+    if (GetBoolArg("-rescan", false))
+        return chainActive.Genesis();
+
+    CWalletDB walletdb(walletFile);
+    CBlockIndex* pindexRescan;
+    CBlockLocator locator;
+    if (walletdb.ReadBestBlock(locator))
+        pindexRescan = FindForkInGlobalIndex(chainActive, locator);
+    else
+        pindexRescan = chainActive.Genesis();
+
+    // Pick up a rescan that was interrupted by a shutdown
+    CBlockLocator locatorRescan;
+    if (walletdb.ReadRescanProgress(locatorRescan)) {
+        CBlockIndex* pindexResume = FindForkInGlobalIndex(chainActive, locatorRescan);
+        if (pindexResume && (!pindexRescan || pindexResume->nHeight < pindexRescan->nHeight)) {
+            LogPrintf("Resuming interrupted rescan from block %d\n", pindexResume->nHeight);
+            pindexRescan = pindexResume;
+        }
+    }
+    return pindexRescan;
+}
+
 /**
  * add new from bitcoin
  * */
@@ -3457,18 +3693,7 @@ CWallet* CWallet::CreateWalletFromFile(const std::string walletFile)
 
     RegisterValidationInterface(walletInstance);
 
-    CBlockIndex* pindexRescan = chainActive.Tip();
-    if (GetBoolArg("-rescan", false))
-        pindexRescan = chainActive.Genesis();
-    else {
-        CWalletDB walletdb(walletFile);
-        CBlockLocator locator;
-        if (walletdb.ReadBestBlock(locator))
-            pindexRescan = FindForkInGlobalIndex(chainActive, locator);
-        else
-            pindexRescan = chainActive.Genesis();
-    }
-
+    CBlockIndex* pindexRescan = FindRescanStart(walletFile);
 
     if (chainActive.Tip() && chainActive.Tip() != pindexRescan) {
         //We can't rescan beyond non-pruned blocks, stop and throw an error
@@ -31,6 +31,7 @@
 
 #include <algorithm>
 #include <map>
+#include <memory>
 #include <set>
 #include <stdexcept>
 #include <stdint.h>
@@ -87,6 +88,13 @@ static const bool DEFAULT_DISABLE_WALLET = false;
 
 static const bool DEFAULT_NOT_USE_CHANGE_ADDRESS = false;
 
+//! Number of blocks a rescan reads ahead of the ones it applies
+static const size_t RESCAN_PREFETCH_BLOCKS = 128;
+//! Number of blocks a rescan trial decrypts and applies together
+static const size_t RESCAN_BATCH_BLOCKS = 32;
+//! Seconds between two rescan progress checkpoints in the wallet
+static const int64_t RESCAN_CHECKPOINT_INTERVAL = 60;
+
 extern const char* DEFAULT_WALLET_DAT;
 
 //! Size of HD seed in bytes
@@ -100,6 +108,7 @@ class CReserveKey;
 class CScript;
 class CTxMemPool;
 class CWalletTx;
+class SaplingTrialDecryptor;
 
 /** (client) version numbers for particular wallet features */
 enum WalletFeature {
@@ -737,6 +746,13 @@ private:
     typedef TxSpendMap<uint256> TxNullifiers;
     TxNullifiers mapTxSaplingNullifiers;
 
+    /**
+     * Trial decryptor over the incoming viewing keys of mapSaplingFullViewingKeys,
+     * guarded by cs_SpendingKeyStore. Dropped when a key is added and rebuilt by
+     * the next FindMySaplingNotes.
+     */
+    mutable std::shared_ptr<const SaplingTrialDecryptor> pSaplingDecryptor;
+
     void AddToTransparentSpends(const COutPoint& outpoint, const uint256& wtxid);
     void AddToSaplingSpends(const uint256& nullifier, const uint256& wtxid);
     void AddToSpends(const uint256& wtxid);
@@ -764,6 +780,8 @@ protected:
      * pindex is the old tip being disconnected.
      */
     void DecrementNoteWitnesses(const CBlockIndex* pindex);
+    /** Note data of every Sapling note whose witnesses are below nHeight */
+    std::vector<SaplingNoteData*> GetSaplingNotesBelowHeight(int nHeight);
 
     template <typename WalletDB>
     void SetBestChainINTERNAL(WalletDB& walletdb, const CBlockLocator& loc)
@@ -1055,6 +1073,9 @@ public:
     bool AddSaplingIncomingViewingKey(
         const libzcash::SaplingIncomingViewingKey& ivk,
         const libzcash::SaplingPaymentAddress& addr);
+    bool AddSaplingFullViewingKey(
+        const libzcash::SaplingFullViewingKey& fvk,
+        const libzcash::SaplingPaymentAddress& defaultAddr) override;
     bool AddCryptedSaplingSpendingKey(
         const libzcash::SaplingExtendedFullViewingKey& extfvk,
         const std::vector<unsigned char>& vchCryptedSecret,
@@ -1095,6 +1116,9 @@ public:
     bool AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletDB* pwalletdb);
     void SyncTransaction(const CTransactionRef& tx, const CBlockIndex* pindex = nullptr, int posInBlock = 0);
     bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlockIndex* pblock, int posInBlock, bool fUpdate = false);
+    //! Same with IsMine(tx) and FindMySaplingNotes(tx) computed by the caller, without cs_wallet
+    bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlockIndex* pblock, int posInBlock, bool fUpdate, bool fIsMine,
+                                  const std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap>& saplingNotes);
     void EraseFromWallet(const uint256& hash);
     int ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate = false);
     void ReacceptWalletTransactions();
@@ -1146,6 +1170,8 @@ public:
     std::set<CTxDestination> GetAccountAddresses(const std::string& strAccount) const;
 
     std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap> FindMySaplingNotes(const CTransaction& tx) const;
+    //! Trial decrypt the Sapling outputs of all transactions in one pass, one result per transaction
+    std::vector<std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap> > FindMySaplingNotes(const std::vector<const CTransaction*>& vtx) const;
     bool IsSaplingNullifierFromMe(const uint256& nullifier) const;
 
     void GetSaplingNoteWitnesses(
@@ -1285,6 +1311,8 @@ public:
 
     /* Initializes the wallet, returns a new CWallet instance or a null pointer in case of an error */
     static CWallet* CreateWalletFromFile(const std::string walletFile);
+    /* The block a wallet loaded at startup is rescanned from, also resuming a rescan a shutdown interrupted */
+    static CBlockIndex* FindRescanStart(const std::string& walletFile);
     static bool InitLoadWallet();
     bool BackupWallet(const std::string& strDest);
     /* Set the HD chain model (chain child index counters) */
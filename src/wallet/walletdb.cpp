@@ -215,6 +215,23 @@ bool CWalletDB::ReadBestBlock(CBlockLocator& locator)
     return Read(std::string("bestblock"), locator);
 }
 
+bool CWalletDB::WriteRescanProgress(const CBlockLocator& locator)
+{
+    nWalletDBUpdated++;
+    return Write(std::string("rescanprogress"), locator);
+}
+
+bool CWalletDB::ReadRescanProgress(CBlockLocator& locator)
+{
+    return Read(std::string("rescanprogress"), locator);
+}
+
+bool CWalletDB::EraseRescanProgress()
+{
+    nWalletDBUpdated++;
+    return Erase(std::string("rescanprogress"));
+}
+
 bool CWalletDB::WriteOrderPosNext(int64_t nOrderPosNext)
 {
     nWalletDBUpdated++;
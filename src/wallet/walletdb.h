@@ -180,6 +180,11 @@ public:
     bool WriteBestBlock(const CBlockLocator& locator);
     bool ReadBestBlock(CBlockLocator& locator);
 
+    //! Block up to which a running rescan has applied its results
+    bool WriteRescanProgress(const CBlockLocator& locator);
+    bool ReadRescanProgress(CBlockLocator& locator);
+    bool EraseRescanProgress();
+
     bool WriteOrderPosNext(int64_t nOrderPosNext);
 
     bool WriteDefaultKey(const CPubKey& vchPubKey);
@@ -22,6 +22,7 @@
 #include "script/sign.h"
 #include "sodium.h"
 #include "streams.h"
+#include "transaction_builder.h"
 #include "txdb.h"
 #include "wallet/wallet.h"
 #include "net_processing.h"
@@ -196,6 +197,41 @@ double benchmark_large_tx(size_t nInputs)
     return timer_stop(tv_start);
 }
 
+double benchmark_build_sapling_tx(size_t nSpends)
+{
+    auto sk = libzcash::SaplingSpendingKey::random();
+    auto expsk = sk.expanded_spending_key();
+    auto fvk = sk.full_viewing_key();
+    auto pk = sk.default_address();
+
+    // Notes to spend, witnessed against the same anchor
+    std::vector<libzcash::SaplingNote> notes;
+    std::vector<SaplingWitness> witnesses;
+    SaplingMerkleTree tree;
+    for (size_t i = 0; i < nSpends; i++) {
+        notes.emplace_back(pk, 100000);
+        auto cm = notes.back().cm().get();
+        tree.append(cm);
+        for (auto& witness : witnesses) {
+            witness.append(cm);
+        }
+        witnesses.push_back(tree.witness());
+    }
+
+    auto builder = TransactionBuilder(Params().GetConsensus(), chainActive.Height() + 1);
+    for (size_t i = 0; i < nSpends; i++) {
+        builder.AddSaplingSpend(expsk, notes[i], tree.root(), witnesses[i]);
+    }
+    builder.AddSaplingOutput(fvk.ovk, pk, 100000 * nSpends - 10000, {});
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    auto tx = builder.Build();
+    double elapsed = timer_stop(tv_start);
+    assert(tx);
+    return elapsed;
+}
+
 // Fake the input of a given block
 //class FakeCoinsViewDB : public CCoinsViewDB {
 //    uint256 hash;
@@ -9,6 +9,7 @@ extern double benchmark_solve_equihash();
 extern std::vector<double> benchmark_solve_equihash_threaded(int nThreads);
 extern double benchmark_verify_equihash();
 extern double benchmark_large_tx(size_t nInputs);
+extern double benchmark_build_sapling_tx(size_t nSpends);
 extern double benchmark_try_decrypt_notes(size_t nAddrs);
 extern double benchmark_increment_note_witnesses(size_t nTxs);
 extern double benchmark_connectblock_slow();